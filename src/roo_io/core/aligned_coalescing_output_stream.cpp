@@ -0,0 +1,107 @@
+#include "roo_io/core/aligned_coalescing_output_stream.h"
+
+#include <string.h>
+
+namespace roo_io {
+
+namespace {
+
+size_t SectorSize(const AlignedCoalescingOptions& options) {
+  return options.sector_size == 0 ? 1 : options.sector_size;
+}
+
+size_t BufferSize(const AlignedCoalescingOptions& options) {
+  size_t sector_size = SectorSize(options);
+  size_t sectors = (options.buffer_size + sector_size - 1) / sector_size;
+  return (sectors == 0 ? 1 : sectors) * sector_size;
+}
+
+}  // namespace
+
+AlignedCoalescingOutputStream::AlignedCoalescingOutputStream(
+    std::unique_ptr<OutputStream> out, AlignedCoalescingOptions options)
+    : out_(std::move(out)),
+      sector_size_(SectorSize(options)),
+      buffer_size_(BufferSize(options)),
+      buffer_(nullptr),
+      length_(0),
+      position_(options.start_offset),
+      status_(out_->status()),
+      stats_() {}
+
+size_t AlignedCoalescingOutputStream::write(const byte* buf, size_t count) {
+  if (status_ != kOk || count == 0) return 0;
+  if (length_ == 0 && position_ % sector_size_ == 0 && count >= sector_size_) {
+    // Whole sectors, from the caller's memory.
+    count -= count % sector_size_;
+    ++stats_.bypass_writes;
+    return writeOut(buf, count) ? count : 0;
+  }
+  if (buffer_ == nullptr) {
+    buffer_.reset(new byte[buffer_size_]);
+  }
+  // Shortened when the buffer starts mid-sector, so that it ends on a sector
+  // boundary.
+  size_t capacity = buffer_size_ - position_ % sector_size_;
+  if (count > capacity - length_) count = capacity - length_;
+  memcpy(&buffer_[length_], buf, count);
+  length_ += count;
+  if (length_ == capacity) writeBuffer();
+  return count;
+}
+
+void AlignedCoalescingOutputStream::flush() {
+  if (status_ != kOk) return;
+  if (!writeBuffer()) return;
+  out_->flush();
+  status_ = out_->status();
+}
+
+void AlignedCoalescingOutputStream::sync(SyncLevel level) {
+  if (status_ != kOk) return;
+  if (!writeBuffer()) return;
+  out_->sync(level);
+  status_ = out_->status();
+}
+
+void AlignedCoalescingOutputStream::preallocate(uint64_t bytes) {
+  if (status_ != kOk) return;
+  out_->preallocate(bytes);
+}
+
+void AlignedCoalescingOutputStream::close() {
+  if (status_ == kClosed) return;
+  if (status_ == kOk) writeBuffer();
+  out_->close();
+  if (status_ == kOk) status_ = out_->status();
+  buffer_ = nullptr;
+}
+
+bool AlignedCoalescingOutputStream::writeBuffer() {
+  if (length_ == 0) return true;
+  size_t length = length_;
+  length_ = 0;
+  return writeOut(buffer_.get(), length);
+}
+
+bool AlignedCoalescingOutputStream::writeOut(const byte* buf, size_t count) {
+  ++stats_.writes;
+  uint64_t begin = position_;
+  uint64_t end = position_ + count;
+  uint64_t first_full = (begin + sector_size_ - 1) / sector_size_;
+  uint64_t last_full = end / sector_size_;
+  uint64_t touched = (end - 1) / sector_size_ - begin / sector_size_ + 1;
+  uint64_t full = last_full > first_full ? last_full - first_full : 0;
+  stats_.full_sectors += full;
+  stats_.partial_sectors += touched - full;
+  size_t written = out_->writeFully(buf, count);
+  position_ += written;
+  if (written < count) {
+    status_ = out_->status();
+    if (status_ == kOk) status_ = kUnknownIOError;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace roo_io
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <memory>
+
+#include "roo_io/core/output_stream.h"
+#include "roo_io/core/sync_level.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Configuration of an `AlignedCoalescingOutputStream`.
+struct AlignedCoalescingOptions {
+  /// Size of the device sector or flash page, in bytes. Writes that cover
+  /// whole sectors avoid the read-modify-write cycle that the filesystem or
+  /// the card controller performs for partial ones.
+  size_t sector_size = 512;
+
+  /// Size of the buffer, in bytes; rounded up to a multiple of
+  /// `sector_size`. Larger buffers mean fewer, multi-sector writes.
+  size_t buffer_size = 512;
+
+  /// Position, in the file, at which the stream starts writing (e.g. the
+  /// current file size, when appending). Sector boundaries are computed
+  /// relative to the start of the file.
+  uint64_t start_offset = 0;
+};
+
+/// Write counters of an `AlignedCoalescingOutputStream`.
+struct AlignedCoalescingStats {
+  /// Number of writes issued to the underlying stream.
+  uint32_t writes = 0;
+
+  /// Number of those writes that passed large, aligned caller data through,
+  /// without copying it to the buffer.
+  uint32_t bypass_writes = 0;
+
+  /// Number of whole sectors written.
+  uint64_t full_sectors = 0;
+
+  /// Number of sectors written only in part (which typically cost a
+  /// read-modify-write). Only `flush()`, `sync()`, `close()`, and an
+  /// unaligned `start_offset` cause them.
+  uint64_t partial_sectors = 0;
+};
+
+/// Output stream decorator that turns small appends into whole-sector writes.
+///
+/// On SD cards and flash, the filesystem writes whole sectors or pages. Each
+/// small append that ends mid-sector thus costs a read-modify-write of that
+/// sector, and the next append rewrites it again. This stream collects data
+/// in a buffer whose end is aligned to a sector boundary, and writes it to
+/// the underlying stream only once full, so that every write ends on a
+/// boundary. Writes of at least a sector, starting on a boundary, go
+/// directly to the underlying stream (rounded down to whole sectors).
+/// Partial sectors are written only by `flush()`, `sync()`, and `close()`.
+///
+/// Example:
+///
+/// ```
+/// AlignedCoalescingOutputStream out(
+///     mount.fopenForWrite("/log.bin", kTruncateIfExists));
+/// for (const Sample& s : samples) out.writeFully(s.data(), s.size());
+/// out.close();
+/// ```
+class AlignedCoalescingOutputStream : public OutputStream {
+ public:
+  /// Creates a stream writing to `out`, which it takes ownership of.
+  AlignedCoalescingOutputStream(
+      std::unique_ptr<OutputStream> out,
+      AlignedCoalescingOptions options = AlignedCoalescingOptions());
+
+  /// Closes the stream, writing out the buffered data.
+  ~AlignedCoalescingOutputStream() override { close(); }
+
+  /// Writes up to `count` bytes.
+  size_t write(const byte* buf, size_t count) override;
+
+  /// Writes out the buffered data (possibly a partial sector), and flushes
+  /// the underlying stream.
+  void flush() override;
+
+  /// Writes out the buffered data, and syncs the underlying stream.
+  void sync(SyncLevel level) override;
+
+  /// Forwards the hint to the underlying stream.
+  void preallocate(uint64_t bytes) override;
+
+  /// Writes out the buffered data, and closes the underlying stream.
+  void close() override;
+
+  /// Returns the current stream status.
+  Status status() const override { return status_; }
+
+  /// Returns the write counters.
+  const AlignedCoalescingStats& stats() const { return stats_; }
+
+ private:
+  // Writes out the buffer contents. Returns false on error.
+  bool writeBuffer();
+
+  // Writes `count` bytes, which start at file position `position_`, to the
+  // underlying stream, and updates the counters.
+  bool writeOut(const byte* buf, size_t count);
+
+  std::unique_ptr<OutputStream> out_;
+  size_t sector_size_;
+  size_t buffer_size_;
+
+  // Allocated on first use.
+  std::unique_ptr<byte[]> buffer_;
+
+  // Number of bytes in the buffer.
+  size_t length_;
+
+  // File position of the first byte in the buffer, i.e. of all the data
+  // written out so far.
+  uint64_t position_;
+  Status status_;
+  AlignedCoalescingStats stats_;
+};
+
+}  // namespace roo_io
@@ -5,31 +5,70 @@
 
 #include "roo_io/core/input_iterator.h"
 #include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/read_ahead.h"
 
 namespace roo_io {
 
 static const size_t kMultipassInputStreamIteratorBufferSize = 64;
 
+/// Buffered iterator over a `MultipassInputStream`.
+///
+/// Reads the stream in chunks of up to the buffer size. The buffer doubles as
+/// a window over the stream: `seek()` and `rewind()` to a position within the
+/// bytes it holds are resolved in memory, without touching the stream.
+///
+/// Parsers that seek around a lot (e.g. over TLV or chunked formats) can use
+/// a larger buffer, so that more of their seeks stay within the window, and
+/// a read-behind margin: after a seek backward, out of the window, the buffer
+/// is refilled starting up to `read_behind` bytes before the target, so that
+/// further short backward seeks hit it too. `seekHits()` and `seekMisses()`
+/// tell how well it works.
+///
+/// Sequential scans of large files can instead let the buffer grow: with
+/// `max_buffer_size` greater than `buffer_size`, each refill that continues
+/// where the previous one ended doubles in size, up to `max_buffer_size`,
+/// and a refill after a seek falls back to `buffer_size` (see `ReadAhead`).
 class BufferedMultipassInputStreamIterator {
  public:
   /// Creates a detached iterator with `kClosed` status.
   BufferedMultipassInputStreamIterator()
+      : BufferedMultipassInputStreamIterator(
+            kMultipassInputStreamIteratorBufferSize) {}
+
+  /// Creates a detached iterator with `kClosed` status, which will use a
+  /// buffer of `buffer_size` bytes (growing up to `max_buffer_size` during
+  /// sequential reads), and keep up to `read_behind` bytes before the target
+  /// of backward seeks, once attached with `reset(input)`.
+  explicit BufferedMultipassInputStreamIterator(size_t buffer_size,
+                                                size_t read_behind = 0,
+                                                size_t max_buffer_size = 0)
       : input_(nullptr),
         buffer_(nullptr),
+        allocated_(0),
+        capacity_(buffer_size == 0 ? 1 : buffer_size),
+        read_behind_(read_behind < capacity_ ? read_behind : capacity_ - 1),
+        read_ahead_(capacity_, max_buffer_size),
         offset_(0),
         length_(0),
-        status_(kClosed) {}
+        pending_(0),
+        status_(kClosed),
+        seek_hits_(0),
+        seek_misses_(0) {}
 
-  /// Creates iterator over `input`.
+  /// Creates iterator over `input`, with a buffer of `buffer_size` bytes, a
+  /// read-behind margin of `read_behind` bytes (capped below the buffer
+  /// size), and a cap of `max_buffer_size` bytes for buffer growth during
+  /// sequential reads (no growth if not greater than `buffer_size`).
   ///
   /// Initializes `status()` from `input.status()`. Allocates internal buffer
   /// when initial status is `kOk` or `kEndOfStream`.
-  BufferedMultipassInputStreamIterator(roo_io::MultipassInputStream& input)
-      : input_(&input), offset_(0), length_(0), status_(input.status()) {
-    buffer_ = (status_ == kOk || status_ == kEndOfStream)
-                  ? std::unique_ptr<byte[]>(
-                        new byte[kMultipassInputStreamIteratorBufferSize])
-                  : nullptr;
+  BufferedMultipassInputStreamIterator(
+      roo_io::MultipassInputStream& input,
+      size_t buffer_size = kMultipassInputStreamIteratorBufferSize,
+      size_t read_behind = 0, size_t max_buffer_size = 0)
+      : BufferedMultipassInputStreamIterator(buffer_size, read_behind,
+                                             max_buffer_size) {
+    reset(input);
   }
 
   /// Move-constructs iterator state.
@@ -39,12 +78,21 @@ class BufferedMultipassInputStreamIterator {
       BufferedMultipassInputStreamIterator&& other)
       : input_(other.input_),
         buffer_(std::move(other.buffer_)),
+        allocated_(other.allocated_),
+        capacity_(other.capacity_),
+        read_behind_(other.read_behind_),
+        read_ahead_(other.read_ahead_),
         offset_(other.offset_),
         length_(other.length_),
-        status_(other.status_) {
+        pending_(other.pending_),
+        status_(other.status_),
+        seek_hits_(other.seek_hits_),
+        seek_misses_(other.seek_misses_) {
     other.input_ = nullptr;
+    other.allocated_ = 0;
     other.offset_ = 0;
     other.length_ = 0;
+    other.pending_ = 0;
     other.status_ = kClosed;
   }
 
@@ -56,12 +104,21 @@ class BufferedMultipassInputStreamIterator {
     if (this != &other) {
       input_ = other.input_;
       buffer_ = std::move(other.buffer_);
+      allocated_ = other.allocated_;
+      capacity_ = other.capacity_;
+      read_behind_ = other.read_behind_;
+      read_ahead_ = other.read_ahead_;
       offset_ = other.offset_;
       length_ = other.length_;
+      pending_ = other.pending_;
       status_ = other.status_;
+      seek_hits_ = other.seek_hits_;
+      seek_misses_ = other.seek_misses_;
       other.input_ = nullptr;
+      other.allocated_ = 0;
       other.offset_ = 0;
       other.length_ = 0;
+      other.pending_ = 0;
       other.status_ = kClosed;
     }
     return *this;
@@ -79,18 +136,8 @@ class BufferedMultipassInputStreamIterator {
     if (offset_ < length_) {
       return buffer_[offset_++];
     }
-    if (status_ != kOk) return byte{0};
-    size_t len =
-        input_->read(buffer_.get(), kMultipassInputStreamIteratorBufferSize);
-    if (len == 0) {
-      offset_ = 0;
-      length_ = 0;
-      status_ = input_->status();
-      return byte{0};
-    }
-    offset_ = 1;
-    length_ = len;
-    return buffer_[0];
+    if (status_ != kOk || !fill()) return byte{0};
+    return buffer_[offset_++];
   }
 
   /// Reads up to `count` bytes into `buf`.
@@ -113,29 +160,24 @@ class BufferedMultipassInputStreamIterator {
       // Already done.
       return 0;
     }
-    if (count >= kMultipassInputStreamIteratorBufferSize) {
-      // Skip buffering; read directly into the client's buffer.
+    if (count >= read_ahead_.maxSize() && pending_ == 0) {
+      // Skip buffering; read directly into the client's buffer. The buffer
+      // no longer holds the bytes preceding the stream position.
+      offset_ = 0;
+      length_ = 0;
       size_t len = input_->read(buf, count);
       if (len == 0) {
-        offset_ = 0;
-        length_ = 0;
         status_ = input_->status();
+      } else if (adaptive()) {
+        read_ahead_.advance(input_->position());
       }
       return len;
     }
-    size_t len =
-        input_->read(buffer_.get(), kMultipassInputStreamIteratorBufferSize);
-    if (len == 0) {
-      offset_ = 0;
-      length_ = 0;
-      status_ = input_->status();
-      return 0;
-    }
-    length_ = len;
-    if (count > static_cast<size_t>(length_))
-      count = static_cast<size_t>(length_);
-    memcpy(buf, buffer_.get(), count);
-    offset_ = count;
+    if (!fill()) return 0;
+    size_t remaining = length_ - offset_;
+    if (count > remaining) count = remaining;
+    memcpy(buf, &buffer_[offset_], count);
+    offset_ += count;
     return count;
   }
 
@@ -153,7 +195,8 @@ class BufferedMultipassInputStreamIterator {
       offset_ = 0;
       length_ = 0;
       if (status_ != kOk) return;
-      input_->skip(count - remaining);
+      input_->skip(count - remaining + pending_);
+      pending_ = 0;
       status_ = input_->status();
     }
   }
@@ -179,7 +222,7 @@ class BufferedMultipassInputStreamIterator {
   /// @return Current position, or zero when iterator is in other statuses.
   uint64_t position() const {
     return (status_ == kOk || status_ == kEndOfStream)
-               ? input_->position() + offset_ - length_
+               ? input_->position() + offset_ - length_ + pending_
                : 0;
   }
 
@@ -196,11 +239,15 @@ class BufferedMultipassInputStreamIterator {
     if (file_pos <= length_) {
       // Keep the buffer data and length.
       offset_ = 0;
+      pending_ = 0;
+      ++seek_hits_;
     } else {
       // Reset the buffer.
+      ++seek_misses_;
       input_->rewind();
       offset_ = 0;
       length_ = 0;
+      pending_ = 0;
       status_ = input_->status();
     }
   }
@@ -210,26 +257,48 @@ class BufferedMultipassInputStreamIterator {
   /// If status is neither `kOk` nor `kEndOfStream`, no-op.
   /// If target lies within buffered window, adjusts offset only.
   /// Otherwise delegates seek to underlying stream, clears buffer, and
-  /// synchronizes from `input.status()`.
+  /// synchronizes from `input.status()`. If the target precedes the window,
+  /// the underlying stream is positioned up to `read_behind` bytes before it,
+  /// and the next refill keeps these bytes in the window.
   ///
   /// As implemented, accepted seek requests set iterator status to `kOk`
   /// at the end of the call.
   void seek(uint64_t position) {
     if (status_ != kOk && status_ != kEndOfStream) return;
     uint64_t file_pos = input_->position();
-    if (file_pos <= position + length_ && file_pos >= position) {
+    if (pending_ == 0 && file_pos <= position + length_ &&
+        file_pos >= position) {
       // Seek within the area we have in the buffer.
       offset_ = position + length_ - file_pos;
       status_ = kOk;
-    } else {
-      // Seek outside the buffer. Just seek in the file and reset the buffer.
-      input_->seek(position);
-      offset_ = 0;
-      length_ = 0;
-      status_ = input_->status();
+      ++seek_hits_;
+      return;
     }
+    // Seek outside the buffer. Just seek in the file and reset the buffer.
+    ++seek_misses_;
+    size_t behind = 0;
+    if (position + length_ < file_pos) {
+      behind = position < read_behind_ ? position : read_behind_;
+    }
+    input_->seek(position - behind);
+    offset_ = 0;
+    length_ = 0;
+    status_ = input_->status();
+    pending_ = (status_ == kOk) ? behind : 0;
   }
 
+  /// Returns the number of `seek()` and `rewind()` calls resolved within the
+  /// buffered window.
+  uint32_t seekHits() const { return seek_hits_; }
+
+  /// Returns the number of `seek()` and `rewind()` calls that had to
+  /// reposition the underlying stream.
+  uint32_t seekMisses() const { return seek_misses_; }
+
+  /// Returns the statistics of refill sizes, if the buffer can grow (i.e.
+  /// `max_buffer_size` is greater than `buffer_size`).
+  const ReadAheadStats& readAheadStats() const { return read_ahead_.stats(); }
+
   /// Returns whether `status() == kOk`.
   ///
   /// @return `true` iff current status is `kOk`.
@@ -248,10 +317,13 @@ class BufferedMultipassInputStreamIterator {
     input_ = &input;
     offset_ = 0;
     length_ = 0;
+    pending_ = 0;
     status_ = input.status();
+    seek_hits_ = 0;
+    seek_misses_ = 0;
     if ((status_ == kOk || status_ == kEndOfStream) && buffer_ == nullptr) {
-      buffer_ = std::unique_ptr<byte[]>(
-          new byte[kMultipassInputStreamIteratorBufferSize]);
+      buffer_ = std::unique_ptr<byte[]>(new byte[capacity_]);
+      allocated_ = capacity_;
     }
   }
 
@@ -261,17 +333,71 @@ class BufferedMultipassInputStreamIterator {
   void reset() {
     input_ = nullptr;
     buffer_ = nullptr;
+    allocated_ = 0;
     offset_ = 0;
     length_ = 0;
+    pending_ = 0;
     status_ = kClosed;
   }
 
  private:
+  // Refills the buffer from the stream, leaving `offset_` at the current
+  // position. On failure, returns false and updates `status_`.
+  bool fill() {
+    size_t size = capacity_;
+    uint64_t start = 0;
+    if (adaptive()) {
+      start = input_->position();
+      size = read_ahead_.next(start);
+      if (size > allocated_) {
+        buffer_ = std::unique_ptr<byte[]>(new byte[size]);
+        allocated_ = size;
+      }
+    }
+    size_t len = input_->read(buffer_.get(), size);
+    if (pending_ > 0 && len <= pending_ &&
+        (len > 0 || input_->status() == kEndOfStream)) {
+      // Short read that did not reach the target; retry from the target.
+      start = input_->position() + pending_ - len;
+      input_->seek(start);
+      len = input_->status() == kOk ? input_->read(buffer_.get(), size) : 0;
+      pending_ = 0;
+    }
+    if (adaptive()) read_ahead_.advance(start + len);
+    if (len == 0) {
+      offset_ = 0;
+      length_ = 0;
+      pending_ = 0;
+      status_ = input_->status();
+      return false;
+    }
+    offset_ = pending_;
+    length_ = len;
+    pending_ = 0;
+    return true;
+  }
+
+  // Whether the buffer grows during sequential reads.
+  bool adaptive() const { return read_ahead_.maxSize() > capacity_; }
+
   roo_io::MultipassInputStream* input_;
   std::unique_ptr<byte[]> buffer_;
-  uint8_t offset_;
-  uint8_t length_;
+  size_t allocated_;
+
+  // Minimum (and initial) refill size.
+  size_t capacity_;
+  size_t read_behind_;
+  ReadAhead read_ahead_;
+  size_t offset_;
+  size_t length_;
+
+  // After a seek with read-behind: the number of bytes, at the start of the
+  // next refill, that precede the current position. The buffer is then
+  // empty.
+  size_t pending_;
   Status status_;
+  uint32_t seek_hits_;
+  uint32_t seek_misses_;
 };
 
 }  // namespace roo_io
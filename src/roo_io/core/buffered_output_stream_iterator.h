@@ -121,6 +121,18 @@ class BufferedOutputStreamIterator {
     }
   }
 
+  /// Flushes buffered data and then syncs underlying stream with `level`.
+  ///
+  /// If `status() != kOk`, this call is a no-op.
+  /// Updates `status()` from `output.status()`.
+  void sync(SyncLevel level) {
+    if (status_ == kOk) {
+      if (offset_ > 0) writeBuffer();
+      output_->sync(level);
+      status_ = output_->status();
+    }
+  }
+
   /// Returns current iterator status.
   ///
   /// @return Current status value.
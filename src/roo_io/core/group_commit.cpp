@@ -0,0 +1,74 @@
+#include "roo_io/core/group_commit.h"
+
+namespace roo_io {
+
+GroupCommit::GroupCommit(OutputStream& output, SyncLevel level)
+    : output_(output),
+      level_(level),
+      status_(output.status()),
+      written_(0),
+      synced_(0),
+      sync_count_(0),
+      syncing_(false) {}
+
+uint64_t GroupCommit::write(const byte* buf, size_t count) {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ == kOk) {
+    if (syncing_) {
+      // The stream is not thread-safe; stay off it while it is being synced.
+      pending_.insert(pending_.end(), buf, buf + count);
+    } else {
+      writePending();
+      if (status_ == kOk) {
+        output_.writeFully(buf, count);
+        status_ = output_.status();
+      }
+    }
+  }
+  return ++written_;
+}
+
+void GroupCommit::writePending() {
+  if (pending_.empty() || status_ != kOk) return;
+  output_.writeFully(&pending_[0], pending_.size());
+  status_ = output_.status();
+  pending_.clear();
+}
+
+Status GroupCommit::commit(uint64_t ticket) {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (true) {
+    if (status_ != kOk) return status_;
+    if (synced_ >= ticket) return kOk;
+    if (!syncing_) break;
+    idle_.wait(lock);
+  }
+  // Become the leader: sync everything written so far, on behalf of all
+  // waiting writers.
+  writePending();
+  if (status_ != kOk) return status_;
+  syncing_ = true;
+  uint64_t target = written_;
+  lock.unlock();
+  output_.sync(level_);
+  Status status = output_.status();
+  lock.lock();
+  syncing_ = false;
+  ++sync_count_;
+  status_ = status;
+  if (status == kOk) synced_ = target;
+  idle_.notify_all();
+  return status;
+}
+
+Status GroupCommit::status() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return status_;
+}
+
+uint64_t GroupCommit::syncCount() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return sync_count_;
+}
+
+}  // namespace roo_io
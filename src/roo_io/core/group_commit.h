@@ -0,0 +1,86 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <vector>
+
+#include "roo_io/core/output_stream.h"
+#include "roo_io/core/sync_level.h"
+#include "roo_io/status.h"
+#include "roo_threads.h"
+#include "roo_threads/condition_variable.h"
+#include "roo_threads/mutex.h"
+
+namespace roo_io {
+
+/// Shares an output stream between several writer threads, and batches their
+/// durability requests, so that one device sync covers the records of all the
+/// writers that were waiting for it.
+///
+/// Each `write()` appends a record atomically with respect to other writers,
+/// and returns a ticket. `commit(ticket)` blocks until the record is on
+/// stable storage. The first committing thread syncs the stream on behalf of
+/// everybody. Writes do not wait for a sync in progress: their records are
+/// queued in memory, and the next sync writes them out and covers them all,
+/// together. Under load, the number of syncs is thus bounded by the device
+/// latency, rather than by the number of records.
+///
+/// The stream must not be used directly while shared.
+///
+/// Example:
+///
+/// ```
+/// GroupCommit log(*stream, kSyncData);
+/// // In each writer thread:
+/// Status status = log.writeAndCommit(record, record_size);
+/// ```
+class GroupCommit {
+ public:
+  /// Shares `output`, syncing it with the specified `level`.
+  GroupCommit(OutputStream& output, SyncLevel level = kSyncData);
+
+  /// Writes `count` bytes from `buf`, not interleaved with other writes. If a
+  /// sync is in progress, queues them instead, to be written by the next
+  /// `commit()`.
+  ///
+  /// @return Ticket to pass to `commit()`. Tickets increase with each call.
+  uint64_t write(const byte* buf, size_t count);
+
+  /// Blocks until all data written up to, and including, the write that
+  /// returned `ticket`, is synced.
+  ///
+  /// @return `kOk` on success; otherwise, the error of the stream.
+  Status commit(uint64_t ticket);
+
+  /// Writes `count` bytes from `buf`, and waits until they are synced.
+  Status writeAndCommit(const byte* buf, size_t count) {
+    return commit(write(buf, count));
+  }
+
+  /// Returns the status of the underlying stream, as of the last write or
+  /// sync.
+  Status status() const;
+
+  /// Returns the number of syncs issued to the underlying stream so far.
+  uint64_t syncCount() const;
+
+ private:
+  // Writes the queued records to the stream. Must be called with the mutex
+  // held, while not syncing.
+  void writePending();
+
+  OutputStream& output_;
+  SyncLevel level_;
+  mutable roo::mutex mutex_;
+  roo::condition_variable idle_;
+  Status status_;
+  uint64_t written_;
+  uint64_t synced_;
+  uint64_t sync_count_;
+  bool syncing_;
+
+  // Records written while syncing, in ticket order.
+  std::vector<byte> pending_;
+};
+
+}  // namespace roo_io
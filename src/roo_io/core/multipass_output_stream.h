@@ -0,0 +1,45 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "roo_io/core/output_stream.h"
+
+namespace roo_io {
+
+/// Virtualizes access to files, memory, and other writable sinks that support
+/// random access.
+///
+/// Represents an open resource with a seekable write cursor. Lets container
+/// formats reserve space for a header (e.g. a size or a checksum), stream the
+/// body, and then seek back to fill the header in, without buffering the body
+/// or writing it twice.
+class MultipassOutputStream : public OutputStream {
+ public:
+  /// Returns stream size in bytes from beginning, including data that has
+  /// been written but not yet flushed.
+  ///
+  /// If pre-call status is not `kOk`, status is unchanged and return value
+  /// is 0.
+  ///
+  /// On error, status updates accordingly and return value is 0.
+  virtual uint64_t size() = 0;
+
+  /// Returns current byte offset from beginning of stream.
+  ///
+  /// If status is not `kOk`, return value is unspecified.
+  virtual uint64_t position() const = 0;
+
+  /// Seeks to byte offset from beginning.
+  ///
+  /// Subsequent writes overwrite existing data, and extend the stream past
+  /// its end. Offset may be greater than current `size()`; the gap is then
+  /// filled with zeros (no later than when data is written past it).
+  ///
+  /// If pre-call status is not `kOk`, status is unchanged.
+  ///
+  /// On success, `position()` equals `offset`. On error, status updates
+  /// accordingly.
+  virtual void seek(uint64_t offset) = 0;
+};
+
+}  // namespace roo_io
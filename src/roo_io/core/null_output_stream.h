@@ -1,12 +1,12 @@
 #pragma once
 
 #include "roo_io/base/byte.h"
-#include "roo_io/core/output_stream.h"
+#include "roo_io/core/multipass_output_stream.h"
 
 namespace roo_io {
 
 /// Output stream that discards all writes and reports a preset status.
-class NullOutputStream : public OutputStream {
+class NullOutputStream : public MultipassOutputStream {
  public:
   /// Creates a detached null stream that reports `error` from `status()`.
   NullOutputStream(Status error = kClosed) : status_(error) {}
@@ -20,8 +20,17 @@ class NullOutputStream : public OutputStream {
   /// Accepts no data and always returns zero bytes written.
   size_t write(const byte* buf, size_t count) override { return 0; }
 
+  /// Returns zero because the stream has no backing data.
+  uint64_t size() override { return 0; }
+
+  /// Returns zero because the stream never advances.
+  uint64_t position() const override { return 0; }
+
+  /// Ignores seek requests.
+  void seek(uint64_t /*offset*/) override {}
+
  private:
   Status status_;
 };
 
-}  // namespace roo_io
\ No newline at end of file
+}  // namespace roo_io
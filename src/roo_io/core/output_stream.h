@@ -1,8 +1,11 @@
 #pragma once
 
+#include <inttypes.h>
+
 #include <cstddef>
 
 #include "roo_io/base/byte.h"
+#include "roo_io/core/sync_level.h"
 #include "roo_io/status.h"
 
 namespace roo_io {
@@ -91,6 +94,30 @@ class OutputStream {
   /// May update `status()`. Stream is also flushed on destruction.
   virtual void flush() {}
 
+  /// Flushes buffered data, and then pushes it to stable storage, as
+  /// requested by `level`.
+  ///
+  /// Unlike `flush()`, which only hands data over to the sink (e.g. the OS),
+  /// a successful `sync()` on a file stream means that the data survives a
+  /// power loss. Sinks without a notion of stable storage (memory, pipes,
+  /// serial links) just flush.
+  ///
+  /// If pre-call status is not `kOk`, this call is a no-op. May update
+  /// `status()`.
+  virtual void sync(SyncLevel level) {
+    (void)level;
+    flush();
+  }
+
+  /// Hints that about `bytes` more bytes are going to be written past the
+  /// current position, so that the sink can reserve the space up front.
+  ///
+  /// Lets file streams allocate storage in one go, rather than a block at a
+  /// time as the file grows, which reduces fragmentation and metadata
+  /// updates. Does not change the data visible through the stream, and does
+  /// not update `status()`; sinks that cannot make use of the hint ignore it.
+  virtual void preallocate(uint64_t bytes) { (void)bytes; }
+
   /// Returns underlying stream status.
   ///
   /// Updated by write/flush operations. Status is either `kOk` or an error
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace roo_io {
+
+/// Statistics of a `ReadAhead` tracker.
+struct ReadAheadStats {
+  /// Number of reads that continued where the previous one ended.
+  uint32_t sequential_reads = 0;
+
+  /// Number of reads that started elsewhere (e.g. after a seek).
+  uint32_t random_reads = 0;
+
+  /// Size chosen for the most recent read.
+  size_t last_size = 0;
+
+  /// Largest size chosen so far.
+  size_t peak_size = 0;
+};
+
+/// Chooses the size of buffer refills from the observed access pattern, in
+/// the spirit of Linux readahead.
+///
+/// The first read, and every read that does not continue where the previous
+/// one ended (i.e. follows a seek), is `min_size` bytes. Each read that does
+/// continue doubles the size, up to `max_size`. Sequential scans thus quickly
+/// switch to large I/Os, while random lookups keep reading small chunks.
+///
+/// Usage, for each refill at `position`:
+///
+/// ```
+/// size_t size = read_ahead.next(position);
+/// size_t len = file.read(buffer, size);
+/// read_ahead.advance(position + len);
+/// ```
+class ReadAhead {
+ public:
+  /// Creates a tracker choosing sizes between `min_size` and `max_size`.
+  ReadAhead(size_t min_size, size_t max_size)
+      : min_size_(min_size == 0 ? 1 : min_size),
+        max_size_(max_size < min_size_ ? min_size_ : max_size),
+        size_(0),
+        expected_(0),
+        stats_() {}
+
+  /// Returns the number of bytes to read at `position`.
+  size_t next(uint64_t position) {
+    if (size_ > 0 && position == expected_) {
+      size_ = (size_ <= max_size_ / 2) ? size_ * 2 : max_size_;
+      ++stats_.sequential_reads;
+    } else {
+      size_ = min_size_;
+      ++stats_.random_reads;
+    }
+    stats_.last_size = size_;
+    if (size_ > stats_.peak_size) stats_.peak_size = size_;
+    return size_;
+  }
+
+  /// Records that the reader has consumed the stream up to `position`, by a
+  /// refill, or by a read that bypassed the buffer. A refill at `position`
+  /// continues the sequential run.
+  void advance(uint64_t position) { expected_ = position; }
+
+  /// Returns the smallest read size.
+  size_t minSize() const { return min_size_; }
+
+  /// Returns the largest read size, i.e. the buffer memory cap.
+  size_t maxSize() const { return max_size_; }
+
+  /// Returns the statistics.
+  const ReadAheadStats& stats() const { return stats_; }
+
+ private:
+  size_t min_size_;
+  size_t max_size_;
+  size_t size_;
+  uint64_t expected_;
+  ReadAheadStats stats_;
+};
+
+}  // namespace roo_io
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace roo_io {
+
+/// How far written data is pushed towards stable storage before an operation
+/// reports completion.
+///
+/// Higher levels survive more kinds of failure (process crash, power loss),
+/// at the cost of waiting for the device. Each level includes all the
+/// guarantees of the lower ones.
+enum SyncLevel {
+  /// No explicit sync. Data reaches the device when the OS or the filesystem
+  /// decides to write it back. Survives a process crash, but not necessarily
+  /// a power loss.
+  kSyncNone = 0,
+
+  /// File data, and the metadata needed to read it back (such as its size),
+  /// is on stable storage (`fdatasync()`).
+  kSyncData = 1,
+
+  /// Like `kSyncData`, and additionally all other file metadata (such as
+  /// modification time) is on stable storage (`fsync()`).
+  kSyncFull = 2,
+
+  /// Like `kSyncFull`, and additionally the directory entry is on stable
+  /// storage, so that a newly created or renamed file is guaranteed to be
+  /// found under its name after a power loss.
+  kSyncDataAndDirectory = 3,
+};
+
+}  // namespace roo_io
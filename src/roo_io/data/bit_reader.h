@@ -0,0 +1,195 @@
+#pragma once
+
+#include <cstdint>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/data/byte_order.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Reads bit-packed data from an input iterator.
+///
+/// With `kMsbFirst`, bits are consumed starting from the most significant bit
+/// of each byte, and multi-bit fields are read most significant bit first.
+/// With `kLsbFirst`, bits are consumed starting from the least significant bit
+/// of each byte, and multi-bit fields are read least significant bit first.
+///
+/// Bits are buffered in a 64-bit accumulator. For memory-backed iterators, the
+/// accumulator is refilled with word-sized loads; otherwise, one byte at a
+/// time. Since the reader buffers up to 8 bytes ahead, the iterator should not
+/// be used directly while the reader is in use.
+///
+/// Reading past the end of the data (or past an iterator error) returns zero
+/// and sets `status()`.
+template <typename InputIterator, BitOrder bit_order = kMsbFirst>
+class BitReader {
+ public:
+  explicit BitReader(InputIterator& in)
+      : in_(in), acc_(0), bits_(0), status_(kOk) {}
+
+  /// Reads `count` bits (1 to 64), returning them in the low bits of the
+  /// result.
+  uint64_t read(int count) {
+    if (count > 56) {
+      uint64_t first = read(32);
+      uint64_t second = read(count - 32);
+      return bit_order == kMsbFirst ? (first << (count - 32)) | second
+                                    : first | (second << 32);
+    }
+    if (bits_ < count) {
+      refill();
+      if (bits_ < count) {
+        fail();
+        return 0;
+      }
+    }
+    uint64_t result = bit_order == kMsbFirst
+                          ? acc_ >> (64 - count)
+                          : acc_ & ((uint64_t(1) << count) - 1);
+    consume(count);
+    return result;
+  }
+
+  /// Reads `count` bits (1 to 64) as a two's complement signed value.
+  int64_t readSigned(int count) {
+    uint64_t value = read(count);
+    if (count < 64 && (value >> (count - 1)) != 0) {
+      value |= ~uint64_t(0) << count;
+    }
+    return (int64_t)value;
+  }
+
+  /// Reads a single bit.
+  bool readBit() { return read(1) != 0; }
+
+  /// Reads a unary-coded value: the number of zero bits preceding the next
+  /// one bit (which is also consumed).
+  uint32_t readUnary() {
+    uint32_t count = 0;
+    while (true) {
+      if (bits_ == 0) {
+        refill();
+        if (bits_ == 0) {
+          fail();
+          return 0;
+        }
+      }
+      int zeros = leadingZeros();
+      if (zeros < bits_) {
+        consume(zeros + 1);
+        return count + zeros;
+      }
+      count += bits_;
+      consume(bits_);
+    }
+  }
+
+  /// Reads an unsigned Exp-Golomb-coded value (`ue(v)` in H.264 terms).
+  ///
+  /// Sets status to `kInvalidFormat` if the encoded value does not fit in 64
+  /// bits.
+  uint64_t readExpGolomb() {
+    uint32_t zeros = readUnary();
+    if (status_ != kOk) return 0;
+    if (zeros > 63) {
+      status_ = kInvalidFormat;
+      return 0;
+    }
+    if (zeros == 0) return 0;
+    uint64_t suffix = read(zeros);
+    if (bit_order == kLsbFirst) suffix = ReverseBits(suffix, zeros);
+    return ((uint64_t(1) << zeros) - 1) + suffix;
+  }
+
+  /// Reads a signed Exp-Golomb-coded value (`se(v)` in H.264 terms).
+  int64_t readSignedExpGolomb() {
+    uint64_t k = readExpGolomb();
+    return (k & 1) ? (int64_t)((k >> 1) + 1) : -(int64_t)(k >> 1);
+  }
+
+  /// Skips to the next byte boundary.
+  void alignToByte() { consume(bits_ % 8); }
+
+  /// Returns whether the reader is positioned at a byte boundary.
+  bool isByteAligned() const { return bits_ % 8 == 0; }
+
+  /// Returns `kOk` if all reads so far have succeeded. Otherwise, returns
+  /// the status of the iterator at the time of the first failed read
+  /// (typically `kEndOfStream`), or `kInvalidFormat` for malformed
+  /// Exp-Golomb codes.
+  Status status() const { return status_; }
+
+ private:
+  // Tops up the accumulator to at least 57 bits, if data is available. Bits
+  // beyond `bits_` are either zero, or the actual upcoming data (which makes
+  // it safe to OR in overlapping word loads).
+  void refill() {
+    if (status_ != kOk) return;
+    const byte* p = internal::ContiguousLookahead<InputIterator>::peek(in_, 8);
+    if (p != nullptr) {
+      if (bit_order == kMsbFirst) {
+        acc_ |= LoadBeU64(p) >> bits_;
+      } else {
+        acc_ |= LoadLeU64(p) << bits_;
+      }
+      int bytes = (63 - bits_) >> 3;
+      in_.skip(bytes);
+      bits_ += bytes * 8;
+      return;
+    }
+    // Like the word-sized load, leaves at most 63 bits, so that they can
+    // always be consumed at once.
+    while (bits_ <= 55) {
+      uint64_t b = (uint8_t)in_.read();
+      if (in_.status() != kOk) return;
+      if (bit_order == kMsbFirst) {
+        acc_ |= b << (56 - bits_);
+      } else {
+        acc_ |= b << bits_;
+      }
+      bits_ += 8;
+    }
+  }
+
+  // Drops `count` (at most 63) bits from the accumulator.
+  void consume(int count) {
+    if (bit_order == kMsbFirst) {
+      acc_ <<= count;
+    } else {
+      acc_ >>= count;
+    }
+    bits_ -= count;
+  }
+
+  // Returns the number of zero bits at the front of the accumulator.
+  int leadingZeros() const {
+    if (acc_ == 0) return 64;
+    return bit_order == kMsbFirst ? __builtin_clzll(acc_)
+                                  : __builtin_ctzll(acc_);
+  }
+
+  static uint64_t ReverseBits(uint64_t v, int count) {
+    uint64_t result = 0;
+    for (int i = 0; i < count; ++i) {
+      result = (result << 1) | (v & 1);
+      v >>= 1;
+    }
+    return result;
+  }
+
+  void fail() {
+    if (status_ == kOk) {
+      status_ = in_.status() == kOk ? kEndOfStream : in_.status();
+    }
+  }
+
+  InputIterator& in_;
+  uint64_t acc_;
+  int bits_;
+  Status status_;
+};
+
+}  // namespace roo_io
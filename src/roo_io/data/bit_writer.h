@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/data/byte_order.h"
+#include "roo_io/data/write.h"
+#include "roo_io/memory/store.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Writes bit-packed data to an output iterator.
+///
+/// The bit orders are as in `BitReader`: with `kMsbFirst`, bits fill each byte
+/// starting from the most significant bit, and multi-bit fields are written
+/// most significant bit first; with `kLsbFirst`, the other way around.
+///
+/// Bits are collected in a 64-bit accumulator, and written out to the iterator
+/// a word at a time. Call `flush()` (or destroy the writer) to pad the last
+/// byte with zero bits and write out the remaining data; note that this does
+/// not flush the iterator itself.
+template <typename OutputIterator, BitOrder bit_order = kMsbFirst>
+class BitWriter {
+ public:
+  explicit BitWriter(OutputIterator& out) : out_(out), acc_(0), bits_(0) {}
+
+  ~BitWriter() { flush(); }
+
+  /// Writes the low `count` bits (1 to 64) of `value`.
+  void write(uint64_t value, int count) {
+    if (count > 56) {
+      if (bit_order == kMsbFirst) {
+        write(value >> 32, count - 32);
+        write(value, 32);
+      } else {
+        write(value, 32);
+        write(value >> 32, count - 32);
+      }
+      return;
+    }
+    if (bits_ + count > 64) drain();
+    value &= (uint64_t(1) << count) - 1;
+    if (bit_order == kMsbFirst) {
+      acc_ |= value << (64 - bits_ - count);
+    } else {
+      acc_ |= value << bits_;
+    }
+    bits_ += count;
+  }
+
+  /// Writes the low `count` bits (1 to 64) of a two's complement signed value.
+  void writeSigned(int64_t value, int count) { write((uint64_t)value, count); }
+
+  /// Writes a single bit.
+  void writeBit(bool bit) { write(bit ? 1 : 0, 1); }
+
+  /// Writes `value` in unary code: `value` zero bits, followed by a one bit.
+  void writeUnary(uint32_t value) {
+    while (value > 56) {
+      write(0, 56);
+      value -= 56;
+    }
+    if (value > 0) write(0, value);
+    write(1, 1);
+  }
+
+  /// Writes an unsigned Exp-Golomb-coded value (`ue(v)` in H.264 terms).
+  ///
+  /// `value` must be less than 2^64 - 1.
+  void writeExpGolomb(uint64_t value) {
+    uint64_t v = value + 1;
+    int bits = 64 - __builtin_clzll(v);
+    writeUnary(bits - 1);
+    if (bits == 1) return;
+    // The leading one has already been written by writeUnary().
+    uint64_t suffix = v & ((uint64_t(1) << (bits - 1)) - 1);
+    if (bit_order == kLsbFirst) suffix = ReverseBits(suffix, bits - 1);
+    write(suffix, bits - 1);
+  }
+
+  /// Writes a signed Exp-Golomb-coded value (`se(v)` in H.264 terms).
+  void writeSignedExpGolomb(int64_t value) {
+    writeExpGolomb(value > 0 ? 2 * (uint64_t)value - 1
+                             : 2 * (0 - (uint64_t)value));
+  }
+
+  /// Pads with zero bits to the next byte boundary.
+  void alignToByte() { bits_ = (bits_ + 7) & ~7; }
+
+  /// Returns whether the writer is positioned at a byte boundary.
+  bool isByteAligned() const { return bits_ % 8 == 0; }
+
+  /// Pads with zero bits to the next byte boundary, and writes all buffered
+  /// bytes to the iterator.
+  void flush() {
+    alignToByte();
+    drain();
+  }
+
+  /// Returns the status of the underlying iterator.
+  Status status() const { return out_.status(); }
+
+ private:
+  // Writes out all complete bytes from the accumulator.
+  void drain() {
+    int bytes = bits_ / 8;
+    if (bytes == 0) return;
+    byte buf[8];
+    if (bit_order == kMsbFirst) {
+      StoreBeU64(acc_, buf);
+      acc_ = (bytes == 8) ? 0 : acc_ << (bytes * 8);
+    } else {
+      StoreLeU64(acc_, buf);
+      acc_ = (bytes == 8) ? 0 : acc_ >> (bytes * 8);
+    }
+    WriteByteArray(out_, buf, bytes);
+    bits_ -= bytes * 8;
+  }
+
+  static uint64_t ReverseBits(uint64_t v, int count) {
+    uint64_t result = 0;
+    for (int i = 0; i < count; ++i) {
+      result = (result << 1) | (v & 1);
+      v >>= 1;
+    }
+    return result;
+  }
+
+  OutputIterator& out_;
+  uint64_t acc_;
+  int bits_;
+};
+
+}  // namespace roo_io
@@ -8,9 +8,21 @@
 // and inline swaps using native builtins.
 
 #include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
 
+#include <type_traits>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/data/ieee754.h"
 #include "roo_io/third_party/endianness.h"
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace roo_io {
 
 /// Names the supported byte orders used by serialization helpers.
@@ -25,6 +37,18 @@ enum ByteOrder {
 #endif
 };
 
+/// Names the orders in which bits are packed into bytes by bit-level readers
+/// and writers.
+enum BitOrder {
+  /// The first bit occupies the most significant bit of the first byte (as
+  /// in most network protocols and video codecs).
+  kMsbFirst = 0,
+
+  /// The first bit occupies the least significant bit of the first byte (as
+  /// in DEFLATE).
+  kLsbFirst = 1,
+};
+
 }  // namespace roo_io
 
 // Determine the native byte order if possible.
@@ -86,6 +110,112 @@ constexpr storage_type Convert(storage_type in) {
   return Converter<storage_type, src, dst>()(in);
 }
 
+namespace internal {
+
+template <size_t size>
+struct UnsignedOfSize;
+
+template <>
+struct UnsignedOfSize<1> {
+  using type = uint8_t;
+};
+
+template <>
+struct UnsignedOfSize<2> {
+  using type = uint16_t;
+};
+
+template <>
+struct UnsignedOfSize<4> {
+  using type = uint32_t;
+};
+
+template <>
+struct UnsignedOfSize<8> {
+  using type = uint64_t;
+};
+
+// Swaps one element at a time. Buffers may be unaligned.
+template <typename storage_type>
+inline void SwapArrayScalar(const byte* src, byte* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    storage_type v;
+    memcpy(&v, src, sizeof(v));
+    v = Swap(v);
+    memcpy(dst, &v, sizeof(v));
+    src += sizeof(v);
+    dst += sizeof(v);
+  }
+}
+
+// Swaps 16 bytes (i.e. several elements) at a time where the hardware allows,
+// and finishes off the tail one element at a time.
+template <typename storage_type>
+inline void SwapArray(const byte* src, byte* dst, size_t count) {
+  constexpr size_t kPerVector = 16 / sizeof(storage_type);
+  size_t vectors = (sizeof(storage_type) == 1) ? 0 : count / kPerVector;
+#if defined(__SSSE3__)
+  const __m128i mask =
+      (sizeof(storage_type) == 2)
+          ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+      : (sizeof(storage_type) == 4)
+          ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+          : _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+  for (size_t i = 0; i < vectors; ++i) {
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+    _mm_storeu_si128((__m128i*)dst, _mm_shuffle_epi8(v, mask));
+    src += 16;
+    dst += 16;
+  }
+#elif defined(__ARM_NEON)
+  for (size_t i = 0; i < vectors; ++i) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)src);
+    v = (sizeof(storage_type) == 2)   ? vrev16q_u8(v)
+        : (sizeof(storage_type) == 4) ? vrev32q_u8(v)
+                                      : vrev64q_u8(v);
+    vst1q_u8((uint8_t*)dst, v);
+    src += 16;
+    dst += 16;
+  }
+#else
+  vectors = 0;
+#endif
+  SwapArrayScalar<storage_type>(src, dst, count - vectors * kPerVector);
+}
+
+template <typename T, ByteOrder src_order, ByteOrder dst_order>
+struct ArrayConverter {
+  void operator()(const byte* src, byte* dst, size_t count) const {
+    SwapArray<typename UnsignedOfSize<sizeof(T)>::type>(src, dst, count);
+  }
+};
+
+template <typename T, ByteOrder byte_order>
+struct ArrayConverter<T, byte_order, byte_order> {
+  void operator()(const byte* src, byte* dst, size_t count) const {
+    if (src != dst) memcpy(dst, src, count * sizeof(T));
+  }
+};
+
+}  // namespace internal
+
+/// Copies `count` values of arithmetic type `T` from `src` to `dst`,
+/// converting each from `src_order` to `dst_order`.
+///
+/// Floating-point types are supported when `ROO_IO_IEEE754` is enabled.
+///
+/// Neither buffer needs to be aligned. The buffers may be the same (for
+/// in-place conversion), but must not otherwise overlap. Uses vector byte
+/// shuffles where available (SSSE3, NEON), and compiles to a plain copy when
+/// the byte orders match.
+template <typename T, ByteOrder src_order, ByteOrder dst_order>
+inline void ConvertArray(const byte* src, byte* dst, size_t count) {
+  static_assert(std::is_integral<T>::value ||
+                    (std::is_floating_point<T>::value && ROO_IO_IEEE754),
+                "ConvertArray requires an integer or IEEE754 type");
+  internal::ArrayConverter<T, src_order, dst_order>()(src, dst, count);
+}
+
 }  // namespace byte_order
 
 /// Swaps the bytes in `in`.
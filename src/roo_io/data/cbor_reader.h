@@ -0,0 +1,391 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/data/half.h"
+#include "roo_io/data/ieee754.h"
+#include "roo_io/data/read.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Type of a CBOR (RFC 8949) data item, as reported by `CborReader`.
+enum class CborType {
+  /// No current item (before the first `next()`, or after an error).
+  kNone,
+  kUnsignedInt,
+  kNegativeInt,
+  kBytes,
+  kString,
+  kArray,
+  kMap,
+  kTag,
+  kBool,
+  kNull,
+  kUndefined,
+  /// Other simple value; see `CborReader::simpleValue()`.
+  kSimple,
+  /// Half-, single-, or double-precision float.
+  kFloat,
+  /// Terminator of an indefinite-length array, map, or string.
+  kBreak,
+};
+
+/// Pull-style CBOR (RFC 8949) decoder over an input iterator.
+///
+/// Each call to `next()` decodes the head of the next data item; the item is
+/// then described by `type()` and the value accessors. The reader does not
+/// track nesting: after an array or map head, the following `next()` calls
+/// return its elements (for maps, keys and values alternately), and after a
+/// tag, the tagged item. Use `skip()` to skip over an item with all of its
+/// nested items.
+///
+/// The content of byte and text strings is not consumed by `next()`; read it
+/// with `readContent()`, or, for memory iterators, access it in place with
+/// `readContentInPlace()` / `readStringView()`. Any unread content is skipped
+/// by the following `next()`. Indefinite-length strings are reported as a
+/// string head with `isIndefinite()`, followed by definite-length chunks, and
+/// a `kBreak`.
+///
+/// The reader never allocates. Malformed input sets the status to
+/// `kInvalidFormat`; a truncated input leaves the status reported by the
+/// iterator (typically `kEndOfStream`).
+template <typename InputIterator>
+class CborReader {
+ public:
+  explicit CborReader(InputIterator& in)
+      : in_(in),
+        status_(kOk),
+        type_(CborType::kNone),
+        info_(0),
+        argument_(0),
+        content_remaining_(0) {}
+
+  /// Decodes the head of the next data item. Returns false at the end of the
+  /// stream or on error; see `status()`.
+  bool next() {
+    if (status_ != kOk) return false;
+    if (content_remaining_ > 0 && !skipContent()) return false;
+    type_ = CborType::kNone;
+    uint8_t initial = (uint8_t)in_.read();
+    if (in_.status() != kOk) {
+      status_ = in_.status();
+      return false;
+    }
+    uint8_t major = initial >> 5;
+    info_ = initial & 0x1F;
+    if (info_ < 24) {
+      argument_ = info_;
+    } else if (info_ <= 27) {
+      argument_ = readArgument(info_);
+      if (in_.status() != kOk) {
+        status_ = in_.status();
+        return false;
+      }
+    } else if (info_ == 31 && (major >= 2 && major != 6)) {
+      // Indefinite length, or break.
+      argument_ = 0;
+    } else {
+      status_ = kInvalidFormat;
+      return false;
+    }
+    switch (major) {
+      case 0: {
+        type_ = CborType::kUnsignedInt;
+        break;
+      }
+      case 1: {
+        type_ = CborType::kNegativeInt;
+        break;
+      }
+      case 2:
+      case 3: {
+        type_ = (major == 2) ? CborType::kBytes : CborType::kString;
+        content_remaining_ = argument_;
+        break;
+      }
+      case 4: {
+        type_ = CborType::kArray;
+        break;
+      }
+      case 5: {
+        type_ = CborType::kMap;
+        break;
+      }
+      case 6: {
+        type_ = CborType::kTag;
+        break;
+      }
+      default: {
+        type_ = simpleType();
+        break;
+      }
+    }
+    return true;
+  }
+
+  /// Returns the type of the current item.
+  CborType type() const { return type_; }
+
+  /// Returns whether the current array, map, or string has indefinite length.
+  bool isIndefinite() const {
+    return info_ == 31 && type_ != CborType::kBreak;
+  }
+
+  /// Returns the value of a `kUnsignedInt` item, or the encoded argument `n`
+  /// of a `kNegativeInt` item (whose value is -1 - n).
+  uint64_t uintValue() const { return argument_; }
+
+  /// Returns whether the current `kUnsignedInt` or `kNegativeInt` item fits in
+  /// `int64_t`.
+  bool fitsInt64() const {
+    return argument_ <= (uint64_t)std::numeric_limits<int64_t>::max();
+  }
+
+  /// Returns the value of a `kUnsignedInt` or `kNegativeInt` item. The value
+  /// must fit in `int64_t` (see `fitsInt64()`).
+  int64_t intValue() const {
+    return type_ == CborType::kNegativeInt ? -1 - (int64_t)argument_
+                                           : (int64_t)argument_;
+  }
+
+  /// Returns the length of the current byte string, text string (in bytes),
+  /// or array, or the number of key-value pairs of the current map. Returns
+  /// zero for indefinite lengths.
+  uint64_t length() const { return argument_; }
+
+  /// Returns the tag number of the current `kTag` item.
+  uint64_t tag() const { return argument_; }
+
+  /// Returns the value of the current `kBool` item.
+  bool boolValue() const { return argument_ == 21; }
+
+  /// Returns the value (0-255) of the current simple-value item.
+  uint8_t simpleValue() const { return (uint8_t)argument_; }
+
+#if ROO_IO_IEEE754
+
+  /// Returns the value of the current `kFloat` item, widened to double.
+  double doubleValue() const {
+    if (info_ == 25) return HalfToFloat((uint16_t)argument_);
+    if (info_ == 26) {
+      float f;
+      uint32_t bits = (uint32_t)argument_;
+      memcpy(&f, &bits, sizeof(f));
+      return f;
+    }
+    double d;
+    memcpy(&d, &argument_, sizeof(d));
+    return d;
+  }
+
+#endif  // ROO_IO_IEEE754
+
+  /// Returns the number of content bytes of the current definite-length
+  /// string that have not been read yet.
+  uint64_t contentRemaining() const { return content_remaining_; }
+
+  /// Reads up to `max` content bytes of the current string into `result`.
+  /// Returns the number of bytes read.
+  size_t readContent(byte* result, size_t max) {
+    if (status_ != kOk) return 0;
+    if (max > content_remaining_) max = (size_t)content_remaining_;
+    size_t read = ReadByteArray(in_, result, max);
+    content_remaining_ -= read;
+    if (read < max) status_ = in_.status();
+    return read;
+  }
+
+  /// If the remaining content of the current string is contiguous in memory
+  /// (i.e. the iterator is a memory iterator), sets `data` to point to it,
+  /// consumes it, and returns true. Otherwise, returns false.
+  bool readContentInPlace(const byte*& data) {
+    if (status_ != kOk) return false;
+    if (content_remaining_ == 0) {
+      data = nullptr;
+      return true;
+    }
+    if (content_remaining_ > std::numeric_limits<size_t>::max()) return false;
+    size_t n = (size_t)content_remaining_;
+    const byte* p = internal::ContiguousLookahead<InputIterator>::peek(in_, n);
+    if (p == nullptr) return false;
+    in_.skip(n);
+    content_remaining_ = 0;
+    data = p;
+    return true;
+  }
+
+  /// Like `readContentInPlace()`, but returns the content as a string view.
+  bool readStringView(roo::string_view& result) {
+    size_t n = (size_t)content_remaining_;
+    const byte* data;
+    if (!readContentInPlace(data)) return false;
+    result = roo::string_view((const char*)data, n);
+    return true;
+  }
+
+  /// Skips the rest of the current item: the unread content of a string, the
+  /// elements of an array or map, or the item following a tag, recursively.
+  /// Returns false on error; see `status()`.
+  ///
+  /// Nesting deeper than `kMaxSkipDepth` levels is reported as
+  /// `kOutOfRange`.
+  bool skip() {
+    if (status_ != kOk) return false;
+    uint64_t pending[kMaxSkipDepth];
+    int depth = 0;
+    if (!pushChildren(pending, depth)) return false;
+    while (depth > 0) {
+      uint64_t& top = pending[depth - 1];
+      if (top == 0) {
+        --depth;
+        continue;
+      }
+      if (!next()) return false;
+      if (type_ == CborType::kBreak) {
+        if (top != kIndefinite) {
+          status_ = kInvalidFormat;
+          return false;
+        }
+        --depth;
+        continue;
+      }
+      if (top != kIndefinite) --top;
+      if (!pushChildren(pending, depth)) return false;
+    }
+    if (content_remaining_ > 0) return skipContent();
+    return true;
+  }
+
+  /// Returns `kOk`, `kEndOfStream`, `kInvalidFormat`, `kOutOfRange`, or the
+  /// error reported by the iterator.
+  Status status() const { return status_; }
+
+  static constexpr int kMaxSkipDepth = 16;
+
+ private:
+  static constexpr uint64_t kIndefinite = std::numeric_limits<uint64_t>::max();
+
+  // Reads the 1, 2, 4, or 8 byte argument indicated by `info` (24-27).
+  uint64_t readArgument(uint8_t info) {
+    size_t size = (size_t)1 << (info - 24);
+    const byte* p =
+        internal::ContiguousLookahead<InputIterator>::peek(in_, size);
+    if (p != nullptr) {
+      in_.skip(size);
+      switch (info) {
+        case 24:
+          return LoadU8(p);
+        case 25:
+          return LoadBeU16(p);
+        case 26:
+          return LoadBeU32(p);
+        default:
+          return LoadBeU64(p);
+      }
+    }
+    switch (info) {
+      case 24:
+        return ReadU8(in_);
+      case 25:
+        return ReadBeU16(in_);
+      case 26:
+        return ReadBeU32(in_);
+      default:
+        return ReadBeU64(in_);
+    }
+  }
+
+  CborType simpleType() const {
+    if (info_ == 31) return CborType::kBreak;
+    if (info_ >= 25) return CborType::kFloat;
+    switch (argument_) {
+      case 20:
+      case 21: {
+        return CborType::kBool;
+      }
+      case 22: {
+        return CborType::kNull;
+      }
+      case 23: {
+        return CborType::kUndefined;
+      }
+      default: {
+        return CborType::kSimple;
+      }
+    }
+  }
+
+  bool skipContent() {
+    while (content_remaining_ > 0) {
+      size_t n = content_remaining_ > std::numeric_limits<size_t>::max()
+                     ? std::numeric_limits<size_t>::max()
+                     : (size_t)content_remaining_;
+      in_.skip(n);
+      content_remaining_ -= n;
+    }
+    if (in_.status() != kOk) {
+      status_ = in_.status();
+      return false;
+    }
+    return true;
+  }
+
+  // Pushes the number of nested items of the current item, if any, onto the
+  // `pending` stack.
+  bool pushChildren(uint64_t* pending, int& depth) {
+    uint64_t count;
+    switch (type_) {
+      case CborType::kArray: {
+        count = isIndefinite() ? kIndefinite : argument_;
+        break;
+      }
+      case CborType::kMap: {
+        if (isIndefinite()) {
+          count = kIndefinite;
+        } else if (argument_ >= kIndefinite / 2) {
+          status_ = kInvalidFormat;
+          return false;
+        } else {
+          count = argument_ * 2;
+        }
+        break;
+      }
+      case CborType::kTag: {
+        count = 1;
+        break;
+      }
+      case CborType::kBytes:
+      case CborType::kString: {
+        if (!isIndefinite()) return true;
+        count = kIndefinite;
+        break;
+      }
+      default: {
+        return true;
+      }
+    }
+    if (count == 0) return true;
+    if (depth == kMaxSkipDepth) {
+      status_ = kOutOfRange;
+      return false;
+    }
+    pending[depth++] = count;
+    return true;
+  }
+
+  InputIterator& in_;
+  Status status_;
+  CborType type_;
+  uint8_t info_;
+  uint64_t argument_;
+  uint64_t content_remaining_;
+};
+
+}  // namespace roo_io
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/data/half.h"
+#include "roo_io/data/ieee754.h"
+#include "roo_io/data/write.h"
+#include "roo_io/memory/store.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Push-style CBOR (RFC 8949) encoder over an output iterator.
+///
+/// Integers, lengths, and tags are written in the shortest form. The writer
+/// does not track nesting: after `beginArray(n)`, write `n` items; after
+/// `beginMap(n)`, write `n` keys and values alternately; after the indefinite
+/// variants, write the items followed by `endIndefinite()`.
+///
+/// The writer never allocates. Errors are reported by the iterator; see
+/// `status()`.
+template <typename OutputIterator>
+class CborWriter {
+ public:
+  explicit CborWriter(OutputIterator& out) : out_(out) {}
+
+  /// Writes an unsigned integer.
+  void writeUInt(uint64_t v) { writeHead(0, v); }
+
+  /// Writes a signed integer.
+  void writeInt(int64_t v) {
+    if (v >= 0) {
+      writeHead(0, (uint64_t)v);
+    } else {
+      writeHead(1, (uint64_t)(-1 - v));
+    }
+  }
+
+  /// Writes a byte string.
+  void writeBytes(const byte* data, size_t size) {
+    writeHead(2, size);
+    WriteByteArray(out_, data, size);
+  }
+
+  /// Writes a UTF-8 text string.
+  void writeString(const char* data, size_t size) {
+    writeHead(3, size);
+    WriteByteArray(out_, (const byte*)data, size);
+  }
+
+  /// Writes a UTF-8 text string.
+  void writeString(roo::string_view s) { writeString(s.data(), s.size()); }
+
+  /// Writes the head of a byte string of `size` bytes. Follow with exactly
+  /// `size` bytes written directly to the iterator.
+  void beginBytes(uint64_t size) { writeHead(2, size); }
+
+  /// Writes the head of a text string of `size` bytes. Follow with exactly
+  /// `size` bytes written directly to the iterator.
+  void beginString(uint64_t size) { writeHead(3, size); }
+
+  /// Writes the head of an array of `count` items.
+  void beginArray(uint64_t count) { writeHead(4, count); }
+
+  /// Writes the head of a map of `count` key-value pairs.
+  void beginMap(uint64_t count) { writeHead(5, count); }
+
+  /// Starts an indefinite-length array. Terminate with `endIndefinite()`.
+  void beginIndefiniteArray() { writeByte(0x9F); }
+
+  /// Starts an indefinite-length map. Terminate with `endIndefinite()`.
+  void beginIndefiniteMap() { writeByte(0xBF); }
+
+  /// Starts an indefinite-length byte string, to be followed by definite-length
+  /// byte string chunks. Terminate with `endIndefinite()`.
+  void beginIndefiniteBytes() { writeByte(0x5F); }
+
+  /// Starts an indefinite-length text string, to be followed by
+  /// definite-length text string chunks. Terminate with `endIndefinite()`.
+  void beginIndefiniteString() { writeByte(0x7F); }
+
+  /// Terminates an indefinite-length array, map, or string.
+  void endIndefinite() { writeByte(0xFF); }
+
+  /// Writes a tag; follow with the tagged item.
+  void writeTag(uint64_t tag) { writeHead(6, tag); }
+
+  /// Writes a boolean.
+  void writeBool(bool v) { writeByte(v ? 0xF5 : 0xF4); }
+
+  /// Writes null.
+  void writeNull() { writeByte(0xF6); }
+
+  /// Writes undefined.
+  void writeUndefined() { writeByte(0xF7); }
+
+  /// Writes a simple value (0-19, or 32-255).
+  void writeSimple(uint8_t v) {
+    if (v < 24) {
+      writeByte(0xE0 | v);
+    } else {
+      byte buf[2] = {byte{0xF8}, (byte)v};
+      WriteByteArray(out_, buf, 2);
+    }
+  }
+
+#if ROO_IO_IEEE754
+
+  /// Writes a half-precision float, rounding `v` to nearest even.
+  void writeHalf(float v) {
+    byte buf[3];
+    buf[0] = byte{0xF9};
+    StoreBeU16(FloatToHalf(v), buf + 1);
+    WriteByteArray(out_, buf, 3);
+  }
+
+  /// Writes a single-precision float.
+  void writeFloat(float v) {
+    byte buf[5];
+    buf[0] = byte{0xFA};
+    StoreBeFloat(v, buf + 1);
+    WriteByteArray(out_, buf, 5);
+  }
+
+  /// Writes a double-precision float.
+  void writeDouble(double v) {
+    byte buf[9];
+    buf[0] = byte{0xFB};
+    StoreBeDouble(v, buf + 1);
+    WriteByteArray(out_, buf, 9);
+  }
+
+#endif  // ROO_IO_IEEE754
+
+  /// Returns the status of the underlying iterator.
+  Status status() const { return out_.status(); }
+
+ private:
+  void writeByte(uint8_t b) { out_.write((byte)b); }
+
+  // Writes the initial byte and the argument, in the shortest form.
+  void writeHead(uint8_t major, uint64_t arg) {
+    byte buf[9];
+    size_t size;
+    major <<= 5;
+    if (arg < 24) {
+      buf[0] = (byte)(major | arg);
+      size = 1;
+    } else if (arg <= 0xFF) {
+      buf[0] = (byte)(major | 24);
+      buf[1] = (byte)arg;
+      size = 2;
+    } else if (arg <= 0xFFFF) {
+      buf[0] = (byte)(major | 25);
+      StoreBeU16((uint16_t)arg, buf + 1);
+      size = 3;
+    } else if (arg <= 0xFFFFFFFF) {
+      buf[0] = (byte)(major | 26);
+      StoreBeU32((uint32_t)arg, buf + 1);
+      size = 5;
+    } else {
+      buf[0] = (byte)(major | 27);
+      StoreBeU64(arg, buf + 1);
+      size = 9;
+    }
+    WriteByteArray(out_, buf, size);
+  }
+
+  OutputIterator& out_;
+};
+
+}  // namespace roo_io
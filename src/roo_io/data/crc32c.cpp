@@ -0,0 +1,34 @@
+#include "roo_io/data/crc32c.h"
+
+namespace roo_io {
+
+namespace {
+
+struct Crc32cTable {
+  constexpr Crc32cTable() : entries() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+      }
+      entries[i] = crc;
+    }
+  }
+
+  uint32_t entries[256];
+};
+
+// Computed at compile time, so that it lives in flash on microcontrollers.
+constexpr Crc32cTable kTable;
+
+}  // namespace
+
+uint32_t Crc32c(const byte* data, size_t size, uint32_t crc) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; ++i) {
+    crc = kTable.entries[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+}  // namespace roo_io
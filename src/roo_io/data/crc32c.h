@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "roo_io/base/byte.h"
+
+// CRC-32C (Castagnoli) checksums, as used by storage formats (e.g. iSCSI,
+// ext4, LevelDB) to detect torn or corrupted records.
+
+namespace roo_io {
+
+/// Returns the CRC-32C of `size` bytes at `data`.
+///
+/// To checksum data that comes in pieces, pass the result for the preceding
+/// pieces as `crc`: `Crc32c(b, nb, Crc32c(a, na))` equals the checksum of
+/// `a` followed by `b`.
+uint32_t Crc32c(const byte* data, size_t size, uint32_t crc = 0);
+
+}  // namespace roo_io
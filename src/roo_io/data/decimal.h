@@ -0,0 +1,383 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/data/ieee754.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/status.h"
+
+// Parsers of decimal text representations of numbers, reading directly from
+// input iterators (no intermediate copy, no `strtoll` / `strtod`).
+//
+// All parsers consume the longest prefix that forms a number, plus the single
+// byte that terminates it (since iterators cannot 'un-read'). That terminating
+// byte can be retrieved via the optional `terminator` argument; it is set to
+// '\0' when the number ends at the end of the stream. Leading whitespace is
+// not skipped.
+//
+// Errors are reported through the `status` argument:
+// * `kOk`: a number has been parsed (it may have ended at the end of stream),
+// * `kEndOfStream`: the stream was already exhausted,
+// * `kInvalidFormat`: the input does not start with a number,
+// * `kOutOfRange`: the number does not fit the result type; the result
+//   saturates (to the min/max value, or to infinity / zero for doubles), and
+//   all of its digits are still consumed,
+// * other: the error reported by the underlying iterator.
+
+namespace roo_io {
+
+namespace internal {
+
+// Returns true if all 8 bytes of `chunk` are ASCII decimal digits.
+inline constexpr bool IsEightDecimalDigits(uint64_t chunk) {
+  return (((chunk + 0x4646464646464646ULL) | (chunk - 0x3030303030303030ULL)) &
+          0x8080808080808080ULL) == 0;
+}
+
+inline constexpr uint64_t CombineDecimalDigitPairs(uint64_t chunk) {
+  return ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+}
+
+inline constexpr uint64_t CombineDecimalDigitQuads(uint64_t chunk) {
+  return ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+}
+
+// Converts 8 ASCII decimal digits, loaded in little-endian order (so that the
+// first digit is in the least significant byte), to their numeric value.
+inline constexpr uint32_t ParseEightDecimalDigits(uint64_t chunk) {
+  return (uint32_t)(((CombineDecimalDigitQuads(
+                          CombineDecimalDigitPairs(chunk)) &
+                      0x0000FFFF0000FFFFULL) *
+                     42949672960001ULL) >>
+                    32);
+}
+
+inline constexpr bool IsDecimalDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Single-character lookahead over an input iterator. A character that has
+// been peeked at is already consumed from the underlying iterator.
+template <typename InputIterator>
+class DecimalScanner {
+ public:
+  explicit DecimalScanner(InputIterator& in)
+      : in_(in), pending_(false), consumed_(false), c_(0) {}
+
+  // Sets `c` to the next character, without consuming it from the scanner.
+  // Returns false if no more characters are available.
+  bool peek(char& c) {
+    if (!pending_) {
+      byte b = in_.read();
+      if (in_.status() != kOk) return false;
+      c_ = (char)b;
+      pending_ = true;
+    }
+    c = c_;
+    return true;
+  }
+
+  // Consumes the character returned by the preceding `peek()`.
+  void consume() {
+    pending_ = false;
+    consumed_ = true;
+  }
+
+  // Returns true if the next character is `expected`, ignoring ASCII case, and
+  // consumes it.
+  bool consumeIgnoreCase(char expected) {
+    char c;
+    if (!peek(c) || (c | 0x20) != expected) return false;
+    consume();
+    return true;
+  }
+
+  // If the next 8 characters are digits, and they are known to be available
+  // in contiguous memory, consumes them, stores their value in `value`, and
+  // returns true. Otherwise, returns false and consumes nothing.
+  bool consumeEightDigits(uint32_t& value) {
+    if (pending_) return false;
+    const byte* data = ContiguousLookahead<InputIterator>::peek(in_, 8);
+    if (data == nullptr) return false;
+    uint64_t chunk = LoadLeU64(data);
+    if (!IsEightDecimalDigits(chunk)) return false;
+    value = ParseEightDecimalDigits(chunk);
+    in_.skip(8);
+    return true;
+  }
+
+  // Returns the character that has been read from the iterator but not
+  // consumed, or '\0' if there is none.
+  char terminator() const { return pending_ ? c_ : '\0'; }
+
+  // Determines the final parse status, given whether a well-formed number has
+  // been found.
+  Status finish(bool parsed) const {
+    Status status = in_.status();
+    if (status != kOk && status != kEndOfStream) return status;
+    if (parsed) return kOk;
+    // Reaching the end of stream is only reported as such if it happened
+    // before any characters were seen.
+    return pending_ || consumed_ || status == kOk ? kInvalidFormat
+                                                  : kEndOfStream;
+  }
+
+ private:
+  InputIterator& in_;
+  bool pending_;
+  bool consumed_;
+  char c_;
+};
+
+// Consumes a sequence of decimal digits, accumulating them into `value`.
+// Sets `overflow` if the value does not fit in 64 bits, in which case the
+// remaining digits are consumed but ignored. Returns true if at least one
+// digit has been consumed.
+template <typename InputIterator>
+bool ConsumeDecimalDigits(DecimalScanner<InputIterator>& scanner,
+                          uint64_t& value, bool& overflow) {
+  // Largest value that can absorb 8 more digits without overflowing.
+  constexpr uint64_t kMaxBeforeEightDigits =
+      (std::numeric_limits<uint64_t>::max() - 99999999) / 100000000;
+  bool any = false;
+  while (true) {
+    uint32_t chunk;
+    if (value <= kMaxBeforeEightDigits && scanner.consumeEightDigits(chunk)) {
+      value = value * 100000000 + chunk;
+      any = true;
+      continue;
+    }
+    char c;
+    if (!scanner.peek(c) || !IsDecimalDigit(c)) break;
+    scanner.consume();
+    any = true;
+    uint8_t digit = c - '0';
+    if (overflow ||
+        value > (std::numeric_limits<uint64_t>::max() - digit) / 10) {
+      overflow = true;
+      continue;
+    }
+    value = value * 10 + digit;
+  }
+  return any;
+}
+
+#if ROO_IO_IEEE754
+
+// Converts w * 10^q to the nearest double, using the Clinger fast path or the
+// Eisel-Lemire algorithm. The result is exact (correctly rounded) for any
+// `w`; the `negative` flag only determines the sign.
+double DecimalToDouble(uint64_t w, int64_t q, bool negative);
+
+// Slow-path conversion of the (possibly truncated) significant digits in
+// `digits`, scaled by 10^exponent.
+double DecimalDigitsToDouble(const char* digits, size_t count,
+                             int64_t exponent, bool negative);
+
+#endif  // ROO_IO_IEEE754
+
+}  // namespace internal
+
+/// Parses an unsigned decimal integer from `in`.
+///
+/// Accepts one or more ASCII digits, with no sign. See the notes at the top of
+/// this file for the consumption and error reporting rules. On overflow,
+/// returns `UINT64_MAX` and sets `status` to `kOutOfRange`.
+template <typename InputIterator>
+uint64_t ReadDecimalU64(InputIterator& in, Status& status,
+                        char* terminator = nullptr) {
+  internal::DecimalScanner<InputIterator> scanner(in);
+  uint64_t value = 0;
+  bool overflow = false;
+  bool parsed = internal::ConsumeDecimalDigits(scanner, value, overflow);
+  if (terminator != nullptr) *terminator = scanner.terminator();
+  status = scanner.finish(parsed);
+  if (status != kOk) return 0;
+  if (overflow) {
+    status = kOutOfRange;
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return value;
+}
+
+/// Parses an optionally signed ('+' or '-') decimal integer from `in`.
+///
+/// See the notes at the top of this file for the consumption and error
+/// reporting rules. On overflow, returns `INT64_MAX` or `INT64_MIN`, and sets
+/// `status` to `kOutOfRange`.
+template <typename InputIterator>
+int64_t ReadDecimalS64(InputIterator& in, Status& status,
+                       char* terminator = nullptr) {
+  internal::DecimalScanner<InputIterator> scanner(in);
+  bool negative = false;
+  char c;
+  if (scanner.peek(c) && (c == '-' || c == '+')) {
+    negative = (c == '-');
+    scanner.consume();
+  }
+  uint64_t magnitude = 0;
+  bool overflow = false;
+  bool parsed = internal::ConsumeDecimalDigits(scanner, magnitude, overflow);
+  if (terminator != nullptr) *terminator = scanner.terminator();
+  status = scanner.finish(parsed);
+  if (status != kOk) return 0;
+  const uint64_t limit =
+      (uint64_t)std::numeric_limits<int64_t>::max() + (negative ? 1 : 0);
+  if (overflow || magnitude > limit) {
+    status = kOutOfRange;
+    return negative ? std::numeric_limits<int64_t>::min()
+                    : std::numeric_limits<int64_t>::max();
+  }
+  return negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+}
+
+#if ROO_IO_IEEE754
+
+/// Maximum number of significant digits retained by `ReadDecimalDouble` for the
+/// rare slow path.
+static constexpr size_t kDecimalDoubleMaxBufferedDigits = 64;
+
+/// Parses a decimal floating-point number from `in`.
+///
+/// Accepts an optional sign, digits with an optional decimal point (at least
+/// one digit is required), and an optional exponent ('e' or 'E', optional
+/// sign, digits). Also accepts "inf", "infinity", and "nan", ignoring case.
+/// The result is correctly rounded (round-to-nearest-even), matching
+/// `strtod`, except that numbers with more than
+/// `kDecimalDoubleMaxBufferedDigits` significant digits, lying extremely close
+/// to a rounding boundary, may be off by one unit in the last place.
+///
+/// Unlike `strtod`, an exponent marker that is not followed by digits (e.g.
+/// "1e") is reported as `kInvalidFormat`, since the marker has already been
+/// consumed. See the notes at the top of this file for the other consumption
+/// and error reporting rules.
+///
+/// Uses the Clinger fast path when possible, and the Eisel-Lemire algorithm
+/// otherwise. This method is named `ReadDecimalDouble` rather than
+/// `ReadDouble`, which reads the binary IEEE754 representation.
+template <typename InputIterator>
+double ReadDecimalDouble(InputIterator& in, Status& status,
+                         char* terminator = nullptr) {
+  internal::DecimalScanner<InputIterator> scanner(in);
+  bool negative = false;
+  char c;
+  if (scanner.peek(c) && (c == '-' || c == '+')) {
+    negative = (c == '-');
+    scanner.consume();
+  }
+  if (scanner.peek(c) && ((c | 0x20) == 'i' || (c | 0x20) == 'n')) {
+    bool parsed;
+    double value;
+    if ((c | 0x20) == 'i') {
+      scanner.consume();
+      parsed = scanner.consumeIgnoreCase('n') && scanner.consumeIgnoreCase('f');
+      if (parsed && scanner.consumeIgnoreCase('i')) {
+        parsed = scanner.consumeIgnoreCase('n') &&
+                 scanner.consumeIgnoreCase('i') &&
+                 scanner.consumeIgnoreCase('t') &&
+                 scanner.consumeIgnoreCase('y');
+      }
+      value = std::numeric_limits<double>::infinity();
+    } else {
+      scanner.consume();
+      parsed = scanner.consumeIgnoreCase('a') && scanner.consumeIgnoreCase('n');
+      value = std::numeric_limits<double>::quiet_NaN();
+    }
+    if (terminator != nullptr) *terminator = scanner.terminator();
+    status = scanner.finish(parsed);
+    if (status != kOk) return 0;
+    return negative ? -value : value;
+  }
+
+  // The number is: (all significant digits, as an integer) * 10^exponent.
+  // The first (up to) 19 significant digits are accumulated in `w`; the first
+  // (up to) kDecimalDoubleMaxBufferedDigits are also retained in `digits`, for
+  // the rare cases when `w` is not precise enough.
+  uint64_t w = 0;
+  int64_t significant_count = 0;
+  int64_t exponent = 0;
+  bool truncated = false;
+  char digits[kDecimalDoubleMaxBufferedDigits + 1];
+  size_t digits_count = 0;
+  bool sticky = false;
+  bool any_digit = false;
+  bool fraction = false;
+  while (true) {
+    if (!scanner.peek(c)) break;
+    if (c == '.' && !fraction) {
+      fraction = true;
+      scanner.consume();
+      continue;
+    }
+    if (!internal::IsDecimalDigit(c)) break;
+    scanner.consume();
+    any_digit = true;
+    if (fraction) --exponent;
+    if (significant_count == 0 && c == '0') continue;
+    ++significant_count;
+    if (significant_count <= 19) {
+      w = w * 10 + (c - '0');
+    } else if (c != '0') {
+      truncated = true;
+    }
+    if (digits_count < kDecimalDoubleMaxBufferedDigits) {
+      digits[digits_count++] = c;
+    } else if (c != '0') {
+      sticky = true;
+    }
+  }
+  if (any_digit && scanner.peek(c) && (c | 0x20) == 'e') {
+    scanner.consume();
+    bool exponent_negative = false;
+    if (scanner.peek(c) && (c == '-' || c == '+')) {
+      exponent_negative = (c == '-');
+      scanner.consume();
+    }
+    uint64_t explicit_exponent = 0;
+    bool exponent_overflow = false;
+    if (!internal::ConsumeDecimalDigits(scanner, explicit_exponent,
+                                        exponent_overflow)) {
+      any_digit = false;
+    } else {
+      // Anything beyond this bound saturates to zero or infinity anyway.
+      if (exponent_overflow || explicit_exponent > 100000) {
+        explicit_exponent = 100000;
+      }
+      exponent += exponent_negative ? -(int64_t)explicit_exponent
+                                    : (int64_t)explicit_exponent;
+    }
+  }
+  if (terminator != nullptr) *terminator = scanner.terminator();
+  status = scanner.finish(any_digit);
+  if (status != kOk) return 0;
+  if (significant_count == 0) return negative ? -0.0 : 0.0;
+
+  // Exponent applying to `w`, which holds the first (up to) 19 digits.
+  int64_t w_exponent =
+      exponent + (significant_count > 19 ? significant_count - 19 : 0);
+  double value = internal::DecimalToDouble(w, w_exponent, negative);
+  if (truncated &&
+      value != internal::DecimalToDouble(w + 1, w_exponent, negative)) {
+    // The dropped digits matter for rounding. Fall back to the slow path.
+    size_t count = digits_count;
+    if (sticky) {
+      // Makes sure that the truncated value is not mistaken for an exact
+      // halfway point.
+      digits[count++] = '1';
+    }
+    value = internal::DecimalDigitsToDouble(
+        digits, count, exponent + significant_count - (int64_t)count,
+        negative);
+  }
+  if (value == 0.0 ||
+      value == std::numeric_limits<double>::infinity() ||
+      value == -std::numeric_limits<double>::infinity()) {
+    status = kOutOfRange;
+  }
+  return value;
+}
+
+#endif  // ROO_IO_IEEE754
+
+}  // namespace roo_io
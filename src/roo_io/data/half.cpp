@@ -0,0 +1,61 @@
+#include "roo_io/data/half.h"
+
+#if ROO_IO_IEEE754
+
+#if defined(__F16C__) && defined(__AVX__)
+#include <immintrin.h>
+#define ROO_IO_HALF_F16C 1
+#elif defined(__ARM_NEON) && defined(__ARM_FP16_FORMAT_IEEE)
+#include <arm_neon.h>
+#define ROO_IO_HALF_NEON 1
+#endif
+
+namespace roo_io {
+
+void ConvertHalfToFloat(const uint16_t* src, float* dst, size_t count) {
+  size_t i = 0;
+#if defined(ROO_IO_HALF_F16C)
+  for (; i + 8 <= count; i += 8) {
+    __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(h));
+  }
+#elif defined(ROO_IO_HALF_NEON)
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t h = vreinterpret_f16_u16(vld1_u16(src + i));
+    vst1q_f32(dst + i, vcvt_f32_f16(h));
+  }
+#endif
+  for (; i < count; ++i) dst[i] = HalfToFloat(src[i]);
+}
+
+void ConvertFloatToHalf(const float* src, uint16_t* dst, size_t count) {
+  size_t i = 0;
+#if defined(ROO_IO_HALF_F16C)
+  for (; i + 8 <= count; i += 8) {
+    __m256 f = _mm256_loadu_ps(src + i);
+    _mm_storeu_si128((__m128i*)(dst + i),
+                     _mm256_cvtps_ph(f, _MM_FROUND_TO_NEAREST_INT));
+  }
+#elif defined(ROO_IO_HALF_NEON)
+  for (; i + 4 <= count; i += 4) {
+    float16x4_t h = vcvt_f16_f32(vld1q_f32(src + i));
+    vst1_u16(dst + i, vreinterpret_u16_f16(h));
+  }
+#endif
+  for (; i < count; ++i) dst[i] = FloatToHalf(src[i]);
+}
+
+// The bfloat16 conversions are simple integer operations, which compilers
+// vectorize on their own.
+
+void ConvertBFloat16ToFloat(const uint16_t* src, float* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i) dst[i] = BFloat16ToFloat(src[i]);
+}
+
+void ConvertFloatToBFloat16(const float* src, uint16_t* dst, size_t count) {
+  for (size_t i = 0; i < count; ++i) dst[i] = FloatToBFloat16(src[i]);
+}
+
+}  // namespace roo_io
+
+#endif  // ROO_IO_IEEE754
@@ -0,0 +1,129 @@
+#pragma once
+
+// Conversions between 32-bit floats and the 16-bit IEEE754 half-precision
+// (binary16) and bfloat16 formats.
+//
+// The 16-bit values are handled as their raw bit patterns (`uint16_t`).
+// Conversions to 16 bits round to nearest, ties to even; values too large
+// for the target format become infinity, and NaNs stay NaNs (quieted, with as
+// much of the payload as fits).
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "roo_io/data/ieee754.h"
+
+#if ROO_IO_IEEE754
+
+namespace roo_io {
+
+namespace internal {
+
+inline uint32_t FloatBits(float v) {
+  static_assert(sizeof(float) == sizeof(uint32_t),
+                "Half-precision support requires 32-bit float.");
+  static_assert(std::numeric_limits<float>::is_iec559,
+                "Half-precision support requires IEEE754 float.");
+  uint32_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+
+inline float FloatFromBits(uint32_t bits) {
+  float v;
+  memcpy(&v, &bits, sizeof(v));
+  return v;
+}
+
+}  // namespace internal
+
+/// Converts a half-precision (binary16) bit pattern to a float. The
+/// conversion is exact.
+inline float HalfToFloat(uint16_t h) {
+  uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t exp = (h >> 10) & 0x1F;
+  uint32_t mant = h & 0x3FF;
+  uint32_t bits;
+  if (exp == 0x1F) {
+    // Infinity or NaN; NaNs are quieted.
+    bits = sign | 0x7F800000 | (mant << 13) | (mant != 0 ? 0x400000 : 0);
+  } else if (exp != 0) {
+    bits = sign | ((exp + 112) << 23) | (mant << 13);
+  } else if (mant == 0) {
+    bits = sign;
+  } else {
+    // Subnormal; normalize.
+    int shift = __builtin_clz(mant) - 21;
+    mant = (mant << shift) & 0x3FF;
+    bits = sign | ((113 - shift) << 23) | (mant << 13);
+  }
+  return internal::FloatFromBits(bits);
+}
+
+/// Converts a float to the nearest half-precision (binary16) bit pattern.
+inline uint16_t FloatToHalf(float v) {
+  uint32_t x = internal::FloatBits(v);
+  uint16_t sign = (x >> 16) & 0x8000;
+  uint32_t ax = x & 0x7FFFFFFF;
+  if (ax >= 0x7F800000) {
+    // Infinity or NaN; NaNs are quieted.
+    return sign | 0x7C00 | (ax > 0x7F800000 ? 0x200 | ((ax >> 13) & 0x3FF) : 0);
+  }
+  if (ax >= 0x477FF000) {
+    // 65520 and above round to infinity.
+    return sign | 0x7C00;
+  }
+  if (ax < 0x38800000) {
+    // Below the smallest normal half; the result is subnormal or zero.
+    if (ax <= 0x33000000) return sign;
+    uint32_t m = (ax & 0x7FFFFF) | 0x800000;
+    int shift = 126 - (int)(ax >> 23);
+    uint32_t result = m >> shift;
+    uint32_t rem = m & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (result & 1))) ++result;
+    return sign | result;
+  }
+  uint32_t result = (ax >> 13) - (112 << 10);
+  uint32_t rem = ax & 0x1FFF;
+  // Rounding up may carry into the exponent, which is correct.
+  if (rem > 0x1000 || (rem == 0x1000 && (result & 1))) ++result;
+  return sign | result;
+}
+
+/// Converts a bfloat16 bit pattern to a float. The conversion is exact.
+inline float BFloat16ToFloat(uint16_t b) {
+  return internal::FloatFromBits((uint32_t)b << 16);
+}
+
+/// Converts a float to the nearest bfloat16 bit pattern.
+inline uint16_t FloatToBFloat16(float v) {
+  uint32_t x = internal::FloatBits(v);
+  if ((x & 0x7FFFFFFF) > 0x7F800000) {
+    // NaN; quieted, so that truncating the payload cannot make it infinity.
+    return (x >> 16) | 0x40;
+  }
+  return (x + 0x7FFF + ((x >> 16) & 1)) >> 16;
+}
+
+/// Converts `count` half-precision values from `src` to floats in `dst`.
+///
+/// Uses F16C or NEON instructions where available.
+void ConvertHalfToFloat(const uint16_t* src, float* dst, size_t count);
+
+/// Converts `count` floats from `src` to half-precision values in `dst`.
+///
+/// Uses F16C or NEON instructions where available.
+void ConvertFloatToHalf(const float* src, uint16_t* dst, size_t count);
+
+/// Converts `count` bfloat16 values from `src` to floats in `dst`.
+void ConvertBFloat16ToFloat(const uint16_t* src, float* dst, size_t count);
+
+/// Converts `count` floats from `src` to bfloat16 values in `dst`.
+void ConvertFloatToBFloat16(const float* src, uint16_t* dst, size_t count);
+
+}  // namespace roo_io
+
+#endif  // ROO_IO_IEEE754
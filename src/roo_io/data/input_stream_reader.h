@@ -5,6 +5,7 @@
 #include "roo_io/core/buffered_input_stream_iterator.h"
 #include "roo_io/core/input_stream.h"
 #include "roo_io/data/byte_order.h"
+#include "roo_io/data/decimal.h"
 #include "roo_io/data/ieee754.h"
 #include "roo_io/data/read.h"
 
@@ -180,6 +181,24 @@ class InputStreamReader {
 
   uint64_t readVarU64() { return ReadVarU64(in_); }
 
+  uint32_t readVarU32() { return ReadVarU32(in_); }
+
+  int64_t readVarS64() { return ReadVarS64(in_); }
+
+  uint64_t readDecimalU64(Status& status, char* terminator = nullptr) {
+    return ReadDecimalU64(in_, status, terminator);
+  }
+
+  int64_t readDecimalS64(Status& status, char* terminator = nullptr) {
+    return ReadDecimalS64(in_, status, terminator);
+  }
+
+#if ROO_IO_IEEE754
+  double readDecimalDouble(Status& status, char* terminator = nullptr) {
+    return ReadDecimalDouble(in_, status, terminator);
+  }
+#endif  // ROO_IO_IEEE754
+
  private:
   roo_io::InputStream* is_;
   bool owned_;
@@ -5,6 +5,7 @@
 #include "roo_io/core/buffered_multipass_input_stream_iterator.h"
 #include "roo_io/core/multipass_input_stream.h"
 #include "roo_io/data/byte_order.h"
+#include "roo_io/data/decimal.h"
 #include "roo_io/data/ieee754.h"
 #include "roo_io/data/read.h"
 
@@ -12,8 +13,10 @@ namespace roo_io {
 
 /// Buffered typed reader over `MultipassInputStream`.
 ///
-/// Uses a 64-byte internal buffer to avoid tiny upstream reads while exposing
-/// typed helpers and seek operations.
+/// Uses an internal buffer (64 bytes by default) to avoid tiny upstream reads
+/// while exposing typed helpers and seek operations. Seeks that land within
+/// the buffered window do not touch the stream; see
+/// `BufferedMultipassInputStreamIterator`.
 ///
 /// Construction with `unique_ptr` transfers ownership.
 ///
@@ -34,8 +37,14 @@ class MultipassInputStreamReader {
       default;
 
   /// Takes ownership of `is` and binds the reader to it when non-null.
-  MultipassInputStreamReader(std::unique_ptr<roo_io::MultipassInputStream> is)
-      : is_(std::move(is)), in_() {
+  ///
+  /// `buffer_size`, `read_behind`, and `max_buffer_size` configure the
+  /// buffered window, as in `BufferedMultipassInputStreamIterator`.
+  MultipassInputStreamReader(
+      std::unique_ptr<roo_io::MultipassInputStream> is,
+      size_t buffer_size = kMultipassInputStreamIteratorBufferSize,
+      size_t read_behind = 0, size_t max_buffer_size = 0)
+      : is_(std::move(is)), in_(buffer_size, read_behind, max_buffer_size) {
     if (is_ != nullptr) {
       in_.reset(*is_);
     }
@@ -80,6 +89,15 @@ class MultipassInputStreamReader {
   /// Seeks to `position` in the underlying stream.
   void seek(uint64_t position) { in_.seek(position); }
 
+  /// Returns the number of seeks resolved within the buffered window.
+  uint32_t seekHits() const { return in_.seekHits(); }
+
+  /// Returns the number of seeks that had to reposition the stream.
+  uint32_t seekMisses() const { return in_.seekMisses(); }
+
+  /// Returns the statistics of refill sizes, if the buffer can grow.
+  const ReadAheadStats& readAheadStats() const { return in_.readAheadStats(); }
+
   /// Reads and returns one byte.
   byte read() { return in_.read(); }
 
@@ -181,6 +199,32 @@ class MultipassInputStreamReader {
   /// Reads a protobuf-style variable-length unsigned 64-bit integer.
   uint64_t readVarU64() { return ReadVarU64(in_); }
 
+  /// Reads a protobuf-style variable-length unsigned 32-bit integer.
+  uint32_t readVarU32() { return ReadVarU32(in_); }
+
+  /// Reads a ZigZag-encoded variable-length signed 64-bit integer.
+  int64_t readVarS64() { return ReadVarS64(in_); }
+
+  /// Reads an unsigned decimal integer as text, setting `status` and (if not
+  /// null) `terminator` as `ReadDecimalU64()` in `roo_io/data/decimal.h`.
+  uint64_t readDecimalU64(Status& status, char* terminator = nullptr) {
+    return ReadDecimalU64(in_, status, terminator);
+  }
+
+  /// Reads a signed decimal integer as text, setting `status` and (if not
+  /// null) `terminator` as `ReadDecimalS64()`.
+  int64_t readDecimalS64(Status& status, char* terminator = nullptr) {
+    return ReadDecimalS64(in_, status, terminator);
+  }
+
+#if ROO_IO_IEEE754
+  /// Reads a decimal floating-point number as text, setting `status` and (if
+  /// not null) `terminator` as `ReadDecimalDouble()`.
+  double readDecimalDouble(Status& status, char* terminator = nullptr) {
+    return ReadDecimalDouble(in_, status, terminator);
+  }
+#endif  // ROO_IO_IEEE754
+
  private:
   std::unique_ptr<roo_io::MultipassInputStream> is_;
   BufferedMultipassInputStreamIterator in_;
@@ -177,6 +177,8 @@ class OutputStreamWriter {
 
   void writeVarU64(uint64_t data) { return WriteVarU64(out_, data); }
 
+  void writeVarS64(int64_t data) { return WriteVarS64(out_, data); }
+
  private:
   roo_io::OutputStream* os_;
   bool owned_;
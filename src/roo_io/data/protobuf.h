@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/data/varint.h"
+#include "roo_io/status.h"
+
+// Protocol Buffers wire-format building blocks, shared by `ProtoReader`
+// (`protobuf_reader.h`) and `ProtoWriter` (`protobuf_writer.h`).
+//
+// These are low-level primitives, to be used by hand-written (or generated)
+// code that knows the message schema. They do not depend on libprotobuf, and
+// never allocate.
+
+namespace roo_io {
+
+/// Wire type of a protobuf field, as encoded in the low 3 bits of the tag.
+enum class ProtoWireType : uint8_t {
+  kVarint = 0,
+  kFixed64 = 1,
+  kLengthDelimited = 2,
+  kStartGroup = 3,
+  kEndGroup = 4,
+  kFixed32 = 5,
+};
+
+/// Returns the tag (key) of a field with the given number and wire type.
+inline constexpr uint64_t ProtoTag(uint32_t field, ProtoWireType wire_type) {
+  return ((uint64_t)field << 3) | (uint8_t)wire_type;
+}
+
+/// Returns the encoded size of a field tag.
+inline constexpr size_t ProtoTagSize(uint32_t field) {
+  return VarintSize((uint64_t)field << 3);
+}
+
+/// Returns the encoded size of a varint field (tag and value).
+inline constexpr size_t ProtoVarintFieldSize(uint32_t field, uint64_t value) {
+  return ProtoTagSize(field) + VarintSize(value);
+}
+
+/// Returns the encoded size of a fixed32 or float field (tag and value).
+inline constexpr size_t ProtoFixed32FieldSize(uint32_t field) {
+  return ProtoTagSize(field) + 4;
+}
+
+/// Returns the encoded size of a fixed64 or double field (tag and value).
+inline constexpr size_t ProtoFixed64FieldSize(uint32_t field) {
+  return ProtoTagSize(field) + 8;
+}
+
+/// Returns the encoded size of a length-delimited field (bytes, string,
+/// submessage, or packed repeated field) with `length` bytes of content,
+/// including the tag and the length prefix.
+inline constexpr size_t ProtoLengthDelimitedFieldSize(uint32_t field,
+                                                      uint64_t length) {
+  return ProtoTagSize(field) + VarintSize(length) + length;
+}
+
+/// An output iterator that discards the data, counting the bytes written.
+///
+/// Serializing a submessage with `ProtoWriter<ProtoSizeCounter>` computes its
+/// size, so that it can then be written with a precomputed length prefix
+/// (see `ProtoWriter::beginMessage()`), using the same serialization code.
+class ProtoSizeCounter {
+ public:
+  ProtoSizeCounter() : size_(0) {}
+
+  void write(byte /*v*/) { ++size_; }
+
+  size_t write(const byte* /*buf*/, size_t count) {
+    size_ += count;
+    return count;
+  }
+
+  Status status() const { return kOk; }
+
+  /// Returns the number of bytes written so far.
+  size_t size() const { return size_; }
+
+ private:
+  size_t size_;
+};
+
+}  // namespace roo_io
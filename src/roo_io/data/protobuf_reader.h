@@ -0,0 +1,404 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/data/byte_order.h"
+#include "roo_io/data/ieee754.h"
+#include "roo_io/data/protobuf.h"
+#include "roo_io/data/read.h"
+#include "roo_io/data/varint.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Reads protobuf wire-format fields from an input iterator.
+///
+/// Each call to `next()` decodes the tag of the next field (and, for
+/// length-delimited fields, the length); the value is then consumed with the
+/// `read*()` method matching the field's type. Values that are not consumed
+/// are skipped by the following `next()`, so unknown fields can be ignored.
+///
+/// Submessages are read in place: `enterMessage()` limits the reader to the
+/// content of the current length-delimited field, so that `next()` returns
+/// false at its end, and `exitMessage()` skips the rest of it and restores the
+/// enclosing limit.
+///
+/// Reads of varints, fixed-size values, and packed repeated fields decode
+/// directly from memory when the iterator is memory-backed. The reader never
+/// allocates. Malformed input (including a value of the wrong wire type, and
+/// the deprecated group wire types) sets the status to `kInvalidFormat`; a
+/// truncated input leaves the status reported by the iterator (typically
+/// `kEndOfStream`).
+template <typename InputIterator>
+class ProtoReader {
+ public:
+  explicit ProtoReader(InputIterator& in)
+      : in_(in),
+        status_(kOk),
+        position_(0),
+        limit_(kNoLimit),
+        field_(0),
+        wire_type_(ProtoWireType::kVarint),
+        value_pending_(false),
+        content_remaining_(0) {}
+
+  /// Decodes the tag of the next field. Returns false at the end of the
+  /// stream (status `kEndOfStream`), at the end of the current submessage
+  /// (status `kOk`), or on error.
+  bool next() {
+    if (status_ != kOk) return false;
+    if (!skipValue()) return false;
+    if (position_ == limit_) return false;
+    uint64_t tag;
+    if (readRawVarint(tag, limit_ - position_) == 0) return false;
+    field_ = (uint32_t)(tag >> 3);
+    wire_type_ = (ProtoWireType)(tag & 7);
+    if (field_ == 0 || tag > 0xFFFFFFFF) return fail(kInvalidFormat);
+    switch (wire_type_) {
+      case ProtoWireType::kVarint: {
+        value_pending_ = true;
+        return true;
+      }
+      case ProtoWireType::kFixed32: {
+        if (limit_ - position_ < 4) return fail(kInvalidFormat);
+        value_pending_ = true;
+        return true;
+      }
+      case ProtoWireType::kFixed64: {
+        if (limit_ - position_ < 8) return fail(kInvalidFormat);
+        value_pending_ = true;
+        return true;
+      }
+      case ProtoWireType::kLengthDelimited: {
+        uint64_t length;
+        if (readRawVarint(length, limit_ - position_) == 0) return false;
+        if (length > limit_ - position_) return fail(kInvalidFormat);
+        content_remaining_ = length;
+        return true;
+      }
+      default: {
+        return fail(kInvalidFormat);
+      }
+    }
+  }
+
+  /// Returns the field number of the current field.
+  uint32_t fieldNumber() const { return field_; }
+
+  /// Returns the wire type of the current field.
+  ProtoWireType wireType() const { return wire_type_; }
+
+  /// Reads the value of a varint field (`uint32`, `uint64`, or `enum`).
+  uint64_t readVarint() {
+    if (!startValue(ProtoWireType::kVarint)) return 0;
+    uint64_t v;
+    return readRawVarint(v, limit_ - position_) > 0 ? v : 0;
+  }
+
+  /// Reads the value of an `int32` or `int64` field.
+  int64_t readInt64() { return (int64_t)readVarint(); }
+
+  /// Reads the value of a ZigZag-encoded `sint32` or `sint64` field.
+  int64_t readSInt64() { return ZigZagDecode64(readVarint()); }
+
+  /// Reads the value of a `bool` field.
+  bool readBool() { return readVarint() != 0; }
+
+  /// Reads the value of a `fixed32` (or, cast, `sfixed32`) field.
+  uint32_t readFixed32() {
+    if (!startValue(ProtoWireType::kFixed32)) return 0;
+    position_ += 4;
+    const byte* p = internal::ContiguousLookahead<InputIterator>::peek(in_, 4);
+    if (p != nullptr) {
+      in_.skip(4);
+      return LoadLeU32(p);
+    }
+    uint32_t v = ReadLeU32(in_);
+    return checkIterator() ? v : 0;
+  }
+
+  /// Reads the value of a `fixed64` (or, cast, `sfixed64`) field.
+  uint64_t readFixed64() {
+    if (!startValue(ProtoWireType::kFixed64)) return 0;
+    position_ += 8;
+    const byte* p = internal::ContiguousLookahead<InputIterator>::peek(in_, 8);
+    if (p != nullptr) {
+      in_.skip(8);
+      return LoadLeU64(p);
+    }
+    uint64_t v = ReadLeU64(in_);
+    return checkIterator() ? v : 0;
+  }
+
+#if ROO_IO_IEEE754
+
+  /// Reads the value of a `float` field.
+  float readFloat() {
+    uint32_t bits = readFixed32();
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  /// Reads the value of a `double` field.
+  double readDouble() {
+    uint64_t bits = readFixed64();
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+#endif  // ROO_IO_IEEE754
+
+  /// Returns the number of content bytes of the current length-delimited
+  /// field that have not been read yet.
+  uint64_t contentRemaining() const { return content_remaining_; }
+
+  /// Reads up to `max` content bytes of the current length-delimited field
+  /// (`bytes` or `string`) into `result`. Returns the number of bytes read.
+  size_t readContent(byte* result, size_t max) {
+    if (status_ != kOk) return 0;
+    if (max > content_remaining_) max = (size_t)content_remaining_;
+    size_t read = ReadByteArray(in_, result, max);
+    position_ += read;
+    content_remaining_ -= read;
+    if (read < max) checkIterator();
+    return read;
+  }
+
+  /// If the remaining content of the current length-delimited field is
+  /// contiguous in memory (i.e. the iterator is a memory iterator), sets
+  /// `data` to point to it, consumes it, and returns true. Otherwise, returns
+  /// false.
+  bool readContentInPlace(const byte*& data) {
+    if (status_ != kOk) return false;
+    if (content_remaining_ == 0) {
+      data = nullptr;
+      return true;
+    }
+    if (content_remaining_ > std::numeric_limits<size_t>::max()) return false;
+    size_t n = (size_t)content_remaining_;
+    const byte* p = internal::ContiguousLookahead<InputIterator>::peek(in_, n);
+    if (p == nullptr) return false;
+    in_.skip(n);
+    position_ += n;
+    content_remaining_ = 0;
+    data = p;
+    return true;
+  }
+
+  /// Like `readContentInPlace()`, but returns the content as a string view.
+  bool readStringView(roo::string_view& result) {
+    size_t n = (size_t)content_remaining_;
+    const byte* data;
+    if (!readContentInPlace(data)) return false;
+    result = roo::string_view((const char*)data, n);
+    return true;
+  }
+
+  /// Limits the reader to the content of the current length-delimited field,
+  /// to read it as a submessage. Returns the previous limit, to be passed to
+  /// `exitMessage()`.
+  uint64_t enterMessage() {
+    uint64_t saved = limit_;
+    if (status_ != kOk) return saved;
+    if (wire_type_ != ProtoWireType::kLengthDelimited) {
+      fail(kInvalidFormat);
+      return saved;
+    }
+    limit_ = position_ + content_remaining_;
+    content_remaining_ = 0;
+    return saved;
+  }
+
+  /// Skips the unread rest of the current submessage, and restores the limit
+  /// returned by the matching `enterMessage()`. Returns false on error.
+  bool exitMessage(uint64_t saved_limit) {
+    if (status_ != kOk) return false;
+    if (!skipValue()) return false;
+    if (!skipBytes(limit_ - position_)) return false;
+    limit_ = saved_limit;
+    return true;
+  }
+
+  /// Reads up to `max` values of the current packed repeated varint field
+  /// into `result`. Returns the number of values read; call repeatedly until
+  /// `contentRemaining()` is zero.
+  ///
+  /// Memory-backed input is decoded in batches, with `DecodeVarintsU64()`.
+  size_t readPackedVarints(uint64_t* result, size_t max) {
+    if (status_ != kOk) return 0;
+    if (wire_type_ != ProtoWireType::kLengthDelimited) {
+      fail(kInvalidFormat);
+      return 0;
+    }
+    if (content_remaining_ <= std::numeric_limits<size_t>::max()) {
+      size_t n = (size_t)content_remaining_;
+      const byte* p =
+          internal::ContiguousLookahead<InputIterator>::peek(in_, n);
+      if (p != nullptr) {
+        size_t consumed;
+        size_t count = DecodeVarintsU64(p, n, result, max, &consumed);
+        in_.skip(consumed);
+        position_ += consumed;
+        content_remaining_ -= consumed;
+        if (count < max && content_remaining_ > 0) fail(kInvalidFormat);
+        return count;
+      }
+    }
+    size_t count = 0;
+    while (count < max && content_remaining_ > 0) {
+      size_t len = readRawVarint(result[count], content_remaining_);
+      if (len == 0) break;
+      content_remaining_ -= len;
+      ++count;
+    }
+    return count;
+  }
+
+  /// Reads up to `max` values of the current packed repeated fixed-size field
+  /// into `result`. `T` is as in `ProtoWriter::writePackedFixed()`. Returns
+  /// the number of values read; call repeatedly until `contentRemaining()` is
+  /// zero.
+  template <typename T>
+  size_t readPackedFixed(T* result, size_t max) {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                  "Packed fixed fields are 32 or 64 bits wide");
+    if (status_ != kOk) return 0;
+    if (wire_type_ != ProtoWireType::kLengthDelimited ||
+        content_remaining_ % sizeof(T) != 0) {
+      fail(kInvalidFormat);
+      return 0;
+    }
+    if (max > content_remaining_ / sizeof(T)) {
+      max = (size_t)(content_remaining_ / sizeof(T));
+    }
+    size_t read = ReadArray<T, kLittleEndian>(in_, result, max);
+    position_ += read * sizeof(T);
+    content_remaining_ -= read * sizeof(T);
+    if (read < max) checkIterator();
+    return read;
+  }
+
+  /// Skips the unread value of the current field. (The following `next()`
+  /// does that too.) Returns false on error.
+  bool skip() { return status_ == kOk && skipValue(); }
+
+  /// Returns `kOk`, `kEndOfStream`, `kInvalidFormat`, or the error reported
+  /// by the iterator.
+  Status status() const { return status_; }
+
+ private:
+  static constexpr uint64_t kNoLimit = std::numeric_limits<uint64_t>::max();
+
+  bool fail(Status status) {
+    status_ = status;
+    return false;
+  }
+
+  // Updates the status from the iterator. Returns true if it is `kOk`.
+  bool checkIterator() {
+    if (in_.status() == kOk) return true;
+    status_ = in_.status();
+    return false;
+  }
+
+  // Checks that the current field has the specified wire type, and that its
+  // value has not been read yet.
+  bool startValue(ProtoWireType wire_type) {
+    if (status_ != kOk) return false;
+    if (wire_type_ != wire_type || !value_pending_) return fail(kInvalidFormat);
+    value_pending_ = false;
+    return true;
+  }
+
+  // Reads a varint of at most `available` bytes. Returns its length, or zero
+  // on error.
+  size_t readRawVarint(uint64_t& v, uint64_t available) {
+    size_t max = available < 10 ? (size_t)available : 10;
+    const byte* p =
+        internal::ContiguousLookahead<InputIterator>::peek(in_, max);
+    if (p != nullptr) {
+      size_t len = internal::DecodeVarintU64(p, max, v);
+      if (len == 0) {
+        fail(kInvalidFormat);
+        return 0;
+      }
+      in_.skip(len);
+      position_ += len;
+      return len;
+    }
+    uint64_t result = 0;
+    for (size_t i = 0; i < max; ++i) {
+      uint8_t b = (uint8_t)in_.read();
+      if (!checkIterator()) return 0;
+      ++position_;
+      result |= (uint64_t)(b & 0x7F) << (7 * i);
+      if (b < 0x80) {
+        v = result;
+        return i + 1;
+      }
+    }
+    fail(kInvalidFormat);
+    return 0;
+  }
+
+  bool skipBytes(uint64_t count) {
+    position_ += count;
+    while (count > 0) {
+      size_t n = count > std::numeric_limits<size_t>::max()
+                     ? std::numeric_limits<size_t>::max()
+                     : (size_t)count;
+      in_.skip(n);
+      count -= n;
+    }
+    return checkIterator();
+  }
+
+  // Skips the unread value of the current field, if any.
+  bool skipValue() {
+    if (value_pending_) {
+      value_pending_ = false;
+      switch (wire_type_) {
+        case ProtoWireType::kVarint: {
+          uint64_t v;
+          return readRawVarint(v, limit_ - position_) > 0;
+        }
+        case ProtoWireType::kFixed32: {
+          return skipBytes(4);
+        }
+        default: {
+          return skipBytes(8);
+        }
+      }
+    }
+    if (content_remaining_ > 0) {
+      uint64_t n = content_remaining_;
+      content_remaining_ = 0;
+      return skipBytes(n);
+    }
+    return true;
+  }
+
+  InputIterator& in_;
+  Status status_;
+
+  // Bytes consumed so far, and the end of the current submessage.
+  uint64_t position_;
+  uint64_t limit_;
+
+  uint32_t field_;
+  ProtoWireType wire_type_;
+  bool value_pending_;
+  uint64_t content_remaining_;
+};
+
+}  // namespace roo_io
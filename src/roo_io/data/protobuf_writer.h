@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/data/byte_order.h"
+#include "roo_io/data/ieee754.h"
+#include "roo_io/data/protobuf.h"
+#include "roo_io/data/varint.h"
+#include "roo_io/data/write.h"
+#include "roo_io/memory/store.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Writes protobuf wire-format fields to an output iterator.
+///
+/// Each `write*()` method writes one complete field (tag and value), with a
+/// single call to the iterator. Submessages (and other length-delimited
+/// content written piecewise) need their length up front; either compute it
+/// first, e.g. with `ProtoSizeCounter` or the `Proto*FieldSize()` helpers, and
+/// call `beginMessage(field, size)`, or, when writing to memory, use
+/// `beginPatchedMessage()` / `endPatchedMessage()` to fill in the length
+/// afterwards.
+///
+/// Errors are reported by the iterator; see `status()`.
+template <typename OutputIterator>
+class ProtoWriter {
+ public:
+  explicit ProtoWriter(OutputIterator& out) : out_(out) {}
+
+  /// Writes a field tag. Follow with the value, written directly to the
+  /// iterator.
+  void writeTag(uint32_t field, ProtoWireType wire_type) {
+    WriteVarU64(out_, ProtoTag(field, wire_type));
+  }
+
+  /// Writes a varint field (`uint32`, `uint64`, or `enum`).
+  void writeVarint(uint32_t field, uint64_t value) {
+    byte buf[20];
+    size_t size = EncodeVarintU64(ProtoTag(field, ProtoWireType::kVarint), buf);
+    size += EncodeVarintU64(value, buf + size);
+    WriteByteArray(out_, buf, size);
+  }
+
+  /// Writes an `int32` or `int64` field. Negative values take 10 bytes.
+  void writeInt64(uint32_t field, int64_t value) {
+    writeVarint(field, (uint64_t)value);
+  }
+
+  /// Writes a ZigZag-encoded `sint32` or `sint64` field.
+  void writeSInt64(uint32_t field, int64_t value) {
+    writeVarint(field, ZigZagEncode64(value));
+  }
+
+  /// Writes a `bool` field.
+  void writeBool(uint32_t field, bool value) {
+    writeVarint(field, value ? 1 : 0);
+  }
+
+  /// Writes a `fixed32` (or, cast, `sfixed32`) field.
+  void writeFixed32(uint32_t field, uint32_t value) {
+    byte buf[9];
+    size_t size =
+        EncodeVarintU64(ProtoTag(field, ProtoWireType::kFixed32), buf);
+    StoreLeU32(value, buf + size);
+    WriteByteArray(out_, buf, size + 4);
+  }
+
+  /// Writes a `fixed64` (or, cast, `sfixed64`) field.
+  void writeFixed64(uint32_t field, uint64_t value) {
+    byte buf[13];
+    size_t size =
+        EncodeVarintU64(ProtoTag(field, ProtoWireType::kFixed64), buf);
+    StoreLeU64(value, buf + size);
+    WriteByteArray(out_, buf, size + 8);
+  }
+
+#if ROO_IO_IEEE754
+
+  /// Writes a `float` field.
+  void writeFloat(uint32_t field, float value) {
+    byte buf[9];
+    size_t size =
+        EncodeVarintU64(ProtoTag(field, ProtoWireType::kFixed32), buf);
+    StoreLeFloat(value, buf + size);
+    WriteByteArray(out_, buf, size + 4);
+  }
+
+  /// Writes a `double` field.
+  void writeDouble(uint32_t field, double value) {
+    byte buf[13];
+    size_t size =
+        EncodeVarintU64(ProtoTag(field, ProtoWireType::kFixed64), buf);
+    StoreLeDouble(value, buf + size);
+    WriteByteArray(out_, buf, size + 8);
+  }
+
+#endif  // ROO_IO_IEEE754
+
+  /// Writes a `bytes` field.
+  void writeBytes(uint32_t field, const byte* data, size_t size) {
+    beginMessage(field, size);
+    WriteByteArray(out_, data, size);
+  }
+
+  /// Writes a `string` field.
+  void writeString(uint32_t field, roo::string_view value) {
+    writeBytes(field, (const byte*)value.data(), value.size());
+  }
+
+  /// Writes the tag and length prefix of a length-delimited field with
+  /// `size` bytes of content (e.g. a submessage). Follow with exactly `size`
+  /// bytes of content.
+  void beginMessage(uint32_t field, uint64_t size) {
+    byte buf[20];
+    size_t n =
+        EncodeVarintU64(ProtoTag(field, ProtoWireType::kLengthDelimited), buf);
+    n += EncodeVarintU64(size, buf + n);
+    WriteByteArray(out_, buf, n);
+  }
+
+  /// Starts a length-delimited field whose length is not known yet. Returns a
+  /// marker to pass to `endPatchedMessage()` after the content is written.
+  ///
+  /// Reserves 5 bytes for the length, as a zero-padded varint (which all
+  /// protobuf parsers accept), so the content must be shorter than 2^35
+  /// bytes. Only available for iterators writing to memory that expose
+  /// `ptr()`, such as `MemoryOutputIterator`.
+  byte* beginPatchedMessage(uint32_t field) {
+    writeTag(field, ProtoWireType::kLengthDelimited);
+    byte* marker = out_.ptr();
+    static const byte kPlaceholder[kPatchedLengthSize] = {
+        byte{0x80}, byte{0x80}, byte{0x80}, byte{0x80}, byte{0x00}};
+    WriteByteArray(out_, kPlaceholder, kPatchedLengthSize);
+    return marker;
+  }
+
+  /// Completes a field started with `beginPatchedMessage()`, filling in its
+  /// length.
+  void endPatchedMessage(byte* marker) {
+    if (out_.status() != kOk) return;
+    uint64_t size = out_.ptr() - marker - kPatchedLengthSize;
+    for (size_t i = 0; i < kPatchedLengthSize - 1; ++i) {
+      marker[i] = (byte)((size & 0x7F) | 0x80);
+      size >>= 7;
+    }
+    marker[kPatchedLengthSize - 1] = (byte)size;
+  }
+
+  /// Writes a packed repeated varint field (`uint32`, `uint64`, `int32`,
+  /// `int64`, `bool`, or `enum`; for `sint*`, ZigZag-encode the values
+  /// first). Writes nothing if `count` is zero.
+  void writePackedVarints(uint32_t field, const uint64_t* values,
+                          size_t count) {
+    if (count == 0) return;
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i) size += VarintSize(values[i]);
+    beginMessage(field, size);
+    byte buf[128];
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i) {
+      if (n > sizeof(buf) - 10) {
+        WriteByteArray(out_, buf, n);
+        n = 0;
+      }
+      n += EncodeVarintU64(values[i], buf + n);
+    }
+    WriteByteArray(out_, buf, n);
+  }
+
+  /// Writes a packed repeated fixed-size field: `T` is `uint32_t` or
+  /// `int32_t` (`fixed32`, `sfixed32`), `uint64_t` or `int64_t` (`fixed64`,
+  /// `sfixed64`), or `float` or `double`. Writes nothing if `count` is zero.
+  template <typename T>
+  void writePackedFixed(uint32_t field, const T* values, size_t count) {
+    static_assert(sizeof(T) == 4 || sizeof(T) == 8,
+                  "Packed fixed fields are 32 or 64 bits wide");
+    if (count == 0) return;
+    beginMessage(field, (uint64_t)count * sizeof(T));
+    WriteArray<T, kLittleEndian>(out_, values, count);
+  }
+
+  /// Returns the status of the underlying iterator.
+  Status status() const { return out_.status(); }
+
+ private:
+  static constexpr size_t kPatchedLengthSize = 5;
+
+  OutputIterator& out_;
+};
+
+}  // namespace roo_io
@@ -8,7 +8,9 @@
 #include "roo_backport/string_view.h"
 #include "roo_io/core/input_iterator.h"
 #include "roo_io/data/byte_order.h"
+#include "roo_io/data/half.h"
 #include "roo_io/data/ieee754.h"
+#include "roo_io/data/varint.h"
 #include "roo_io/memory/memory_input_iterator.h"
 
 namespace roo_io {
@@ -190,6 +192,30 @@ inline double ReadLeDouble(InputIterator& in) {
   memcpy(&value, &bits, sizeof(value));
   return value;
 }
+
+/// Reads a big-endian half-precision (binary16) float from `in`.
+template <typename InputIterator>
+inline float ReadBeHalf(InputIterator& in) {
+  return HalfToFloat(ReadBeU16(in));
+}
+
+/// Reads a little-endian half-precision (binary16) float from `in`.
+template <typename InputIterator>
+inline float ReadLeHalf(InputIterator& in) {
+  return HalfToFloat(ReadLeU16(in));
+}
+
+/// Reads a big-endian bfloat16 float from `in`.
+template <typename InputIterator>
+inline float ReadBeBFloat16(InputIterator& in) {
+  return BFloat16ToFloat(ReadBeU16(in));
+}
+
+/// Reads a little-endian bfloat16 float from `in`.
+template <typename InputIterator>
+inline float ReadLeBFloat16(InputIterator& in) {
+  return BFloat16ToFloat(ReadLeU16(in));
+}
 #endif  // ROO_IO_IEEE754
 
 /// Reads up to `count` bytes from `in` into `result`.
@@ -210,12 +236,43 @@ size_t ReadByteArray(InputIterator& in, byte* result, size_t count) {
   return read_total;
 }
 
+/// Reads an array of `count` values of type `T`, stored in `byte_order`, from
+/// `in` into `result`.
+///
+/// `T` is an integer type, or `float`/`double` if `ROO_IO_IEEE754` is enabled.
+/// Reads the data in bulk via `ReadByteArray()`, and then converts it to the
+/// native byte order in place (which is a no-op if `byte_order` is
+/// `kNativeEndian`).
+///
+/// Returns the number of values read. A short count indicates that the end of
+/// stream was reached or that the iterator entered an error state; a trailing
+/// partial value may have been consumed.
+template <typename T, ByteOrder byte_order, typename InputIterator>
+size_t ReadArray(InputIterator& in, T* result, size_t count) {
+  size_t read = ReadByteArray(in, (byte*)result, count * sizeof(T)) / sizeof(T);
+  byte_order::ConvertArray<T, byte_order, kNativeEndian>(
+      (const byte*)result, (byte*)result, read);
+  return read;
+}
+
 /// Reads a protobuf-style variable-length unsigned 64-bit integer from `in`.
 ///
 /// This uses the protobuf varint encoding, so values up to 127 occupy one
 /// byte. Returns zero if the iterator leaves the `kOk` state while decoding.
+///
+/// For memory iterators, values of up to 8 bytes are decoded without a
+/// per-byte loop.
 template <typename InputIterator>
 uint64_t ReadVarU64(InputIterator& in) {
+  const byte* data = internal::ContiguousLookahead<InputIterator>::peek(in, 8);
+  if (data != nullptr) {
+    uint64_t result;
+    size_t len = internal::DecodeShortVarintU64(data, result);
+    if (len > 0) {
+      in.skip(len);
+      return result;
+    }
+  }
   uint64_t result = 0;
   byte read;
   int shift = 0;
@@ -224,12 +281,31 @@ uint64_t ReadVarU64(InputIterator& in) {
     if (in.status() != kOk) {
       return 0;
     }
-    result |= ((uint64_t)(read & byte{0x7F}) << shift);
+    if (shift < 64) result |= ((uint64_t)(read & byte{0x7F}) << shift);
     shift += 7;
   } while ((read & byte{0x80}) != byte{0});
   return result;
 }
 
+/// Reads a protobuf-style variable-length unsigned 32-bit integer from `in`.
+///
+/// Longer encodings (e.g. negative 32-bit values written as 64-bit varints)
+/// are consumed fully, and truncated to the low 32 bits. Returns zero if the
+/// iterator leaves the `kOk` state while decoding.
+template <typename InputIterator>
+uint32_t ReadVarU32(InputIterator& in) {
+  return (uint32_t)ReadVarU64(in);
+}
+
+/// Reads a ZigZag-encoded variable-length signed 64-bit integer from `in` (as
+/// in protobuf's `sint64`).
+///
+/// Returns zero if the iterator leaves the `kOk` state while decoding.
+template <typename InputIterator>
+int64_t ReadVarS64(InputIterator& in) {
+  return ZigZagDecode64(ReadVarU64(in));
+}
+
 /// Byte-order-specific integer reader helper.
 template <ByteOrder byte_order>
 class IntegerReader;
@@ -422,6 +498,18 @@ template <typename InputIterator, ByteOrder byte_order>
 inline double ReadDouble(InputIterator& in) {
   return FloatReader<byte_order>().readDouble(in);
 }
+
+/// Reads a byte-order-selected half-precision float from `in`.
+template <typename InputIterator, ByteOrder byte_order>
+inline float ReadHalf(InputIterator& in) {
+  return HalfToFloat(ReadU16<InputIterator, byte_order>(in));
+}
+
+/// Reads a byte-order-selected bfloat16 float from `in`.
+template <typename InputIterator, ByteOrder byte_order>
+inline float ReadBFloat16(InputIterator& in) {
+  return BFloat16ToFloat(ReadU16<InputIterator, byte_order>(in));
+}
 #endif  // ROO_IO_IEEE754
 
 /// Reads host-native trivially copyable values from an input iterator.
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/data/byte_order.h"
+#include "roo_io/data/half.h"
+#include "roo_io/data/ieee754.h"
+#include "roo_io/data/read.h"
+#include "roo_io/data/write.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/store.h"
+
+// Declarative codecs for fixed-layout binary records.
+//
+// A record layout lists the fields of a struct once, in wire order, together
+// with their wire formats. The layout then provides matching `load()`,
+// `store()`, `read()`, and `write()` functions, and the encoded size as a
+// compile-time constant, so that the encoder and the decoder cannot drift
+// apart:
+//
+//   struct Header {
+//     uint32_t magic;
+//     uint16_t version;
+//     int32_t offset;
+//     float scale;
+//   };
+//
+//   using HeaderLayout = roo_io::RecordLayout<
+//       Header,
+//       ROO_IO_RECORD_FIELD(Header, magic, roo_io::record::BeU32),
+//       ROO_IO_RECORD_FIELD(Header, version, roo_io::record::BeU16),
+//       roo_io::record::Padding<2>,
+//       ROO_IO_RECORD_FIELD(Header, offset, roo_io::record::BeS24),
+//       ROO_IO_RECORD_FIELD(Header, scale, roo_io::record::LeFloat)>;
+//
+//   static_assert(HeaderLayout::kSize == 15, "");
+//
+//   Header h;
+//   HeaderLayout::read(in, h);
+//
+// All field offsets are resolved at compile time, and each field is decoded
+// with a single (unaligned) word load and a byte swap if needed. Reading from
+// a memory iterator decodes directly from the underlying buffer; other
+// iterators read the whole record into a stack buffer first.
+
+namespace roo_io {
+namespace record {
+
+/// Wire format of an integer stored in 1, 2, 4, or 8 bytes, in `byte_order`.
+/// `T` determines the size and signedness.
+template <typename T, ByteOrder byte_order>
+struct Int {
+  static_assert(std::is_integral<T>::value, "Int requires an integer type");
+
+  using value_type = T;
+  static constexpr size_t kSize = sizeof(T);
+
+  /// Loads the value from the first `kSize` bytes at `source`.
+  static T load(const byte* source) {
+    using U = typename byte_order::internal::UnsignedOfSize<sizeof(T)>::type;
+    U v;
+    memcpy(&v, source, sizeof(v));
+    return (T)toh<U, byte_order>(v);
+  }
+
+  /// Stores the value into the first `kSize` bytes at `target`.
+  static void store(T v, byte* target) {
+    using U = typename byte_order::internal::UnsignedOfSize<sizeof(T)>::type;
+    U u = hto<U, byte_order>((U)v);
+    memcpy(target, &u, sizeof(u));
+  }
+};
+
+/// Wire format of an unsigned 24-bit integer, in `byte_order`.
+template <ByteOrder byte_order>
+struct U24 {
+  using value_type = uint32_t;
+  static constexpr size_t kSize = 3;
+
+  static uint32_t load(const byte* source) {
+    return LoadU24<byte_order>(source);
+  }
+
+  static void store(uint32_t v, byte* target) {
+    StoreU24<byte_order>(v, target);
+  }
+};
+
+/// Wire format of a signed 24-bit integer, in `byte_order`.
+template <ByteOrder byte_order>
+struct S24 {
+  using value_type = int32_t;
+  static constexpr size_t kSize = 3;
+
+  static int32_t load(const byte* source) {
+    return LoadS24<byte_order>(source);
+  }
+
+  static void store(int32_t v, byte* target) {
+    StoreS24<byte_order>(v, target);
+  }
+};
+
+#if ROO_IO_IEEE754
+
+/// Wire format of an IEEE754 float or double, in `byte_order`.
+template <typename T, ByteOrder byte_order>
+struct Ieee754 {
+  static_assert(std::is_floating_point<T>::value,
+                "Ieee754 requires a floating-point type");
+
+  using value_type = T;
+  static constexpr size_t kSize = sizeof(T);
+
+  static T load(const byte* source) {
+    using U = typename byte_order::internal::UnsignedOfSize<sizeof(T)>::type;
+    U bits;
+    memcpy(&bits, source, sizeof(bits));
+    bits = toh<U, byte_order>(bits);
+    T v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+  }
+
+  static void store(T v, byte* target) {
+    using U = typename byte_order::internal::UnsignedOfSize<sizeof(T)>::type;
+    U bits;
+    memcpy(&bits, &v, sizeof(bits));
+    bits = hto<U, byte_order>(bits);
+    memcpy(target, &bits, sizeof(bits));
+  }
+};
+
+/// Wire format of a half-precision (binary16) float, in `byte_order`. Stores
+/// round to nearest even.
+template <ByteOrder byte_order>
+struct Half {
+  using value_type = float;
+  static constexpr size_t kSize = 2;
+
+  static float load(const byte* source) {
+    return HalfToFloat(Int<uint16_t, byte_order>::load(source));
+  }
+
+  static void store(float v, byte* target) {
+    Int<uint16_t, byte_order>::store(FloatToHalf(v), target);
+  }
+};
+
+/// Wire format of a bfloat16 float, in `byte_order`. Stores round to nearest
+/// even.
+template <ByteOrder byte_order>
+struct BFloat16 {
+  using value_type = float;
+  static constexpr size_t kSize = 2;
+
+  static float load(const byte* source) {
+    return BFloat16ToFloat(Int<uint16_t, byte_order>::load(source));
+  }
+
+  static void store(float v, byte* target) {
+    Int<uint16_t, byte_order>::store(FloatToBFloat16(v), target);
+  }
+};
+
+#endif  // ROO_IO_IEEE754
+
+// Shorthands for the common formats.
+
+using U8 = Int<uint8_t, kBigEndian>;
+using S8 = Int<int8_t, kBigEndian>;
+using BeU16 = Int<uint16_t, kBigEndian>;
+using LeU16 = Int<uint16_t, kLittleEndian>;
+using BeS16 = Int<int16_t, kBigEndian>;
+using LeS16 = Int<int16_t, kLittleEndian>;
+using BeU24 = U24<kBigEndian>;
+using LeU24 = U24<kLittleEndian>;
+using BeS24 = S24<kBigEndian>;
+using LeS24 = S24<kLittleEndian>;
+using BeU32 = Int<uint32_t, kBigEndian>;
+using LeU32 = Int<uint32_t, kLittleEndian>;
+using BeS32 = Int<int32_t, kBigEndian>;
+using LeS32 = Int<int32_t, kLittleEndian>;
+using BeU64 = Int<uint64_t, kBigEndian>;
+using LeU64 = Int<uint64_t, kLittleEndian>;
+using BeS64 = Int<int64_t, kBigEndian>;
+using LeS64 = Int<int64_t, kLittleEndian>;
+
+#if ROO_IO_IEEE754
+
+using BeFloat = Ieee754<float, kBigEndian>;
+using LeFloat = Ieee754<float, kLittleEndian>;
+using BeDouble = Ieee754<double, kBigEndian>;
+using LeDouble = Ieee754<double, kLittleEndian>;
+using BeHalf = Half<kBigEndian>;
+using LeHalf = Half<kLittleEndian>;
+using BeBFloat16 = BFloat16<kBigEndian>;
+using LeBFloat16 = BFloat16<kLittleEndian>;
+
+#endif  // ROO_IO_IEEE754
+
+/// A record field that maps the data member `member` of `Record` to the wire
+/// format `Format`. The member is converted to and from the format's value
+/// type with `static_cast`, so that e.g. enums and narrower or wider integer
+/// members can be used.
+///
+/// Usually spelled with `ROO_IO_RECORD_FIELD()`.
+template <typename Record, typename Member, Member Record::*member,
+          typename Format>
+struct Field {
+  static constexpr size_t kSize = Format::kSize;
+
+  static void load(const byte* source, Record& record) {
+    record.*member = static_cast<Member>(Format::load(source));
+  }
+
+  static void store(const Record& record, byte* target) {
+    Format::store(static_cast<typename Format::value_type>(record.*member),
+                  target);
+  }
+};
+
+/// `size` reserved bytes, not mapped to any member. Ignored when loading, and
+/// zero-filled when storing.
+template <size_t size>
+struct Padding {
+  static constexpr size_t kSize = size;
+
+  template <typename Record>
+  static void load(const byte* /*source*/, Record& /*record*/) {}
+
+  template <typename Record>
+  static void store(const Record& /*record*/, byte* target) {
+    memset(target, 0, size);
+  }
+};
+
+}  // namespace record
+
+/// Declares a `record::Field` for `record_type::member`, encoded as `format`.
+#define ROO_IO_RECORD_FIELD(record_type, member, format)              \
+  ::roo_io::record::Field<record_type, decltype(record_type::member), \
+                          &record_type::member, format>
+
+namespace internal {
+
+template <size_t offset, typename... Fields>
+struct RecordFieldList;
+
+template <size_t offset>
+struct RecordFieldList<offset> {
+  static constexpr size_t kEnd = offset;
+
+  template <typename Record>
+  static void load(const byte* /*source*/, Record& /*record*/) {}
+
+  template <typename Record>
+  static void store(const Record& /*record*/, byte* /*target*/) {}
+};
+
+template <size_t offset, typename Field, typename... Rest>
+struct RecordFieldList<offset, Field, Rest...> {
+  using Next = RecordFieldList<offset + Field::kSize, Rest...>;
+  static constexpr size_t kEnd = Next::kEnd;
+
+  template <typename Record>
+  static void load(const byte* source, Record& record) {
+    Field::load(source + offset, record);
+    Next::load(source, record);
+  }
+
+  template <typename Record>
+  static void store(const Record& record, byte* target) {
+    Field::store(record, target + offset);
+    Next::store(record, target);
+  }
+};
+
+}  // namespace internal
+
+/// Binary layout of `Record`: a sequence of fields (`record::Field` or
+/// `record::Padding`) stored back to back, with no implicit padding.
+///
+/// See the top of this file for an example.
+template <typename Record, typename... Fields>
+class RecordLayout {
+  using FieldList = internal::RecordFieldList<0, Fields...>;
+
+ public:
+  static_assert(sizeof...(Fields) > 0, "A record needs at least one field");
+
+  /// The encoded size of the record, in bytes.
+  static constexpr size_t kSize = FieldList::kEnd;
+
+  /// Decodes the record from the first `kSize` bytes at `source`.
+  static void load(const byte* source, Record& result) {
+    FieldList::load(source, result);
+  }
+
+  /// Encodes `record` into the first `kSize` bytes at `target`.
+  static void store(const Record& record, byte* target) {
+    FieldList::store(record, target);
+  }
+
+  /// Reads the record from `in`.
+  ///
+  /// If fewer than `kSize` bytes could be read, `result` is left unmodified;
+  /// inspect `in.status()` to tell the end of stream from an error.
+  template <typename InputIterator>
+  static void read(InputIterator& in, Record& result) {
+    const byte* p =
+        internal::ContiguousLookahead<InputIterator>::peek(in, kSize);
+    if (p != nullptr) {
+      load(p, result);
+      in.skip(kSize);
+      return;
+    }
+    byte buf[kSize];
+    if (ReadByteArray(in, buf, kSize) < kSize) return;
+    load(buf, result);
+  }
+
+  /// Writes `record` to `out`. Inspect `out.status()` for errors.
+  template <typename OutputIterator>
+  static void write(OutputIterator& out, const Record& record) {
+    byte buf[kSize];
+    store(record, buf);
+    WriteByteArray(out, buf, kSize);
+  }
+};
+
+}  // namespace roo_io
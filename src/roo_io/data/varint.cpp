@@ -0,0 +1,32 @@
+#include "roo_io/data/varint.h"
+
+namespace roo_io {
+
+size_t DecodeVarintsU64(const byte* data, size_t size, uint64_t* out,
+                        size_t count, size_t* consumed) {
+  size_t pos = 0;
+  size_t n = 0;
+  while (n < count) {
+    if (count - n >= 8 && size - pos >= 8) {
+      uint64_t w = LoadLeU64(data + pos);
+      if ((w & 0x8080808080808080ULL) == 0) {
+        // Eight single-byte values.
+        for (int i = 0; i < 8; ++i) {
+          out[n + i] = (w >> (8 * i)) & 0xFF;
+        }
+        n += 8;
+        pos += 8;
+        continue;
+      }
+    }
+    if (pos == size) break;
+    size_t len = internal::DecodeVarintU64(data + pos, size - pos, out[n]);
+    if (len == 0) break;
+    ++n;
+    pos += len;
+  }
+  if (consumed != nullptr) *consumed = pos;
+  return n;
+}
+
+}  // namespace roo_io
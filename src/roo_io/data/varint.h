@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/memory/load.h"
+
+// Helpers for protobuf-style variable-length integers (varints).
+//
+// Iterator-based readers and writers (`ReadVarU64()`, `WriteVarS64()`, etc.)
+// live in `read.h` and `write.h`; this header provides the encoding
+// primitives, and batched decoding from memory.
+
+namespace roo_io {
+
+/// Maps a signed integer to an unsigned one so that values of small magnitude
+/// (positive or negative) have small encodings: 0, -1, 1, -2, ... map to 0, 1,
+/// 2, 3, ...
+inline constexpr uint64_t ZigZagEncode64(int64_t v) {
+  return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+/// Inverse of `ZigZagEncode64()`.
+inline constexpr int64_t ZigZagDecode64(uint64_t v) {
+  return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/// Returns the number of bytes (1 to 10) in the varint encoding of `v`.
+inline constexpr size_t VarintSize(uint64_t v) {
+  return v < 0x80 ? 1 : (64 - __builtin_clzll(v) + 6) / 7;
+}
+
+/// Returns the number of bytes (1 to 10) in the ZigZag varint encoding of `v`.
+inline constexpr size_t VarintSizeS64(int64_t v) {
+  return VarintSize(ZigZagEncode64(v));
+}
+
+/// Encodes `v` as a varint into `target`, which must have room for
+/// `VarintSize(v)` bytes (at most 10). Returns the number of bytes written.
+inline size_t EncodeVarintU64(uint64_t v, byte* target) {
+  size_t size = 0;
+  while (v >= 0x80) {
+    target[size++] = (byte)(v | 0x80);
+    v >>= 7;
+  }
+  target[size++] = (byte)v;
+  return size;
+}
+
+namespace internal {
+
+// Concatenates the low 7 bits of each byte of `w`, in little-endian order,
+// into a 56-bit value.
+inline uint64_t CompactVarintGroups(uint64_t w) {
+  w &= 0x7F7F7F7F7F7F7F7FULL;
+  w = (w & 0x007F007F007F007FULL) | ((w & 0x7F007F007F007F00ULL) >> 1);
+  w = (w & 0x00003FFF00003FFFULL) | ((w & 0x3FFF00003FFF0000ULL) >> 2);
+  w = (w & 0x000000000FFFFFFFULL) | ((w & 0x0FFFFFFF00000000ULL) >> 4);
+  return w;
+}
+
+// Decodes a varint of up to 8 bytes, without branching on individual bytes.
+// Requires 8 readable bytes at `p`. Returns the length of the varint, or zero
+// if it is longer than 8 bytes.
+inline size_t DecodeShortVarintU64(const byte* p, uint64_t& v) {
+  uint64_t w = LoadLeU64(p);
+  uint64_t stops = ~w & 0x8080808080808080ULL;
+  if (stops == 0) return 0;
+  size_t len = (__builtin_ctzll(stops) >> 3) + 1;
+  if (len < 8) w &= (uint64_t(1) << (len * 8)) - 1;
+  v = CompactVarintGroups(w);
+  return len;
+}
+
+// Decodes a varint from [`p`, `p + available`). Returns the length of the
+// varint, or zero if it is truncated or longer than 10 bytes.
+inline size_t DecodeVarintU64(const byte* p, size_t available, uint64_t& v) {
+  if (available >= 8) {
+    size_t len = DecodeShortVarintU64(p, v);
+    if (len > 0) return len;
+  }
+  uint64_t result = 0;
+  for (size_t i = 0; i < available && i < 10; ++i) {
+    uint8_t b = (uint8_t)p[i];
+    result |= (uint64_t)(b & 0x7F) << (7 * i);
+    if (b < 0x80) {
+      v = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace internal
+
+/// Decodes up to `count` consecutive varints from [`data`, `data + size`) into
+/// `out`.
+///
+/// Runs of single-byte values are decoded eight at a time, and longer values
+/// with word-at-a-time bit manipulation rather than a per-byte loop.
+///
+/// Returns the number of values decoded. Stops early at the end of data, or
+/// at a truncated or malformed (longer than 10 bytes) varint. If `consumed`
+/// is not null, sets it to the number of bytes consumed.
+size_t DecodeVarintsU64(const byte* data, size_t size, uint64_t* out,
+                        size_t count, size_t* consumed = nullptr);
+
+}  // namespace roo_io
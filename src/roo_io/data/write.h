@@ -8,7 +8,9 @@
 #include "roo_backport/string_view.h"
 #include "roo_io/core/output_iterator.h"
 #include "roo_io/data/byte_order.h"
+#include "roo_io/data/half.h"
 #include "roo_io/data/ieee754.h"
+#include "roo_io/data/varint.h"
 
 namespace roo_io {
 
@@ -186,6 +188,32 @@ inline void WriteLeDouble(OutputIterator& out, double v) {
   memcpy(&bits, &v, sizeof(bits));
   WriteLeU64(out, bits);
 }
+
+/// Writes a big-endian half-precision (binary16) float to `out`, rounding to
+/// nearest even.
+template <typename OutputIterator>
+inline void WriteBeHalf(OutputIterator& out, float v) {
+  WriteBeU16(out, FloatToHalf(v));
+}
+
+/// Writes a little-endian half-precision (binary16) float to `out`, rounding
+/// to nearest even.
+template <typename OutputIterator>
+inline void WriteLeHalf(OutputIterator& out, float v) {
+  WriteLeU16(out, FloatToHalf(v));
+}
+
+/// Writes a big-endian bfloat16 float to `out`, rounding to nearest even.
+template <typename OutputIterator>
+inline void WriteBeBFloat16(OutputIterator& out, float v) {
+  WriteBeU16(out, FloatToBFloat16(v));
+}
+
+/// Writes a little-endian bfloat16 float to `out`, rounding to nearest even.
+template <typename OutputIterator>
+inline void WriteLeBFloat16(OutputIterator& out, float v) {
+  WriteLeU16(out, FloatToBFloat16(v));
+}
 #endif  // ROO_IO_IEEE754
 
 /// Writes up to `count` bytes from `source` through `out`.
@@ -205,6 +233,36 @@ size_t WriteByteArray(OutputIterator& out, const byte* source, size_t count) {
   return written_total;
 }
 
+/// Writes an array of `count` values of type `T` from `data` through `out`,
+/// in `byte_order`.
+///
+/// `T` is an integer type, or `float`/`double` if `ROO_IO_IEEE754` is enabled.
+/// If `byte_order` is `kNativeEndian`, writes the data directly; otherwise,
+/// converts it in chunks through a small stack buffer.
+///
+/// Returns the number of values written. A short count indicates that the
+/// iterator entered an error state; inspect `out.status()` for the cause.
+template <typename T, ByteOrder byte_order, typename OutputIterator>
+size_t WriteArray(OutputIterator& out, const T* data, size_t count) {
+  if (byte_order == kNativeEndian) {
+    return WriteByteArray(out, (const byte*)data, count * sizeof(T)) /
+           sizeof(T);
+  }
+  constexpr size_t kChunk = 128 / sizeof(T);
+  byte buf[kChunk * sizeof(T)];
+  size_t written = 0;
+  while (written < count) {
+    size_t n = count - written;
+    if (n > kChunk) n = kChunk;
+    byte_order::ConvertArray<T, kNativeEndian, byte_order>(
+        (const byte*)(data + written), buf, n);
+    size_t n_written = WriteByteArray(out, buf, n * sizeof(T)) / sizeof(T);
+    written += n_written;
+    if (n_written < n) break;
+  }
+  return written;
+}
+
 /// Writes a protobuf-style variable-length unsigned 64-bit integer to `out`.
 ///
 /// This uses the protobuf varint encoding, so values up to 127 occupy one
@@ -227,6 +285,16 @@ void WriteVarU64(OutputIterator& out, uint64_t data) {
   out.write(buffer, size);
 }
 
+/// Writes a ZigZag-encoded variable-length signed 64-bit integer to `out` (as
+/// in protobuf's `sint64`).
+///
+/// Values of small magnitude, positive or negative, occupy few bytes; e.g.
+/// values in [-64, 63] occupy one byte.
+template <typename OutputIterator>
+void WriteVarS64(OutputIterator& out, int64_t data) {
+  WriteVarU64(out, ZigZagEncode64(data));
+}
+
 /// Writes `data` using roo_io's portable string encoding.
 ///
 /// The encoding is the varint length followed by the raw character bytes.
@@ -377,6 +445,18 @@ template <typename OutputIterator, ByteOrder byte_order>
 inline void WriteDouble(OutputIterator& in, double v) {
   FloatWriter<byte_order>().writeDouble(in, v);
 }
+
+/// Writes a byte-order-selected half-precision float to `out`.
+template <typename OutputIterator, ByteOrder byte_order>
+inline void WriteHalf(OutputIterator& out, float v) {
+  WriteU16<OutputIterator, byte_order>(out, FloatToHalf(v));
+}
+
+/// Writes a byte-order-selected bfloat16 float to `out`.
+template <typename OutputIterator, ByteOrder byte_order>
+inline void WriteBFloat16(OutputIterator& out, float v) {
+  WriteU16<OutputIterator, byte_order>(out, FloatToBFloat16(v));
+}
 #endif  // ROO_IO_IEEE754
 
 /// Writes host-native trivially copyable values to an output iterator.
@@ -8,17 +8,25 @@
 
 #include "roo_backport/byte.h"
 #include "roo_io/core/input_iterator.h"
+#include "roo_io/core/read_ahead.h"
 #include "roo_io/status.h"
 
 namespace roo_io {
 
 static const size_t kFileInputIteratorBufferSize = 64;
+static const size_t kFileInputIteratorMaxBufferSize = 512;
 
 /// Buffered input iterator wrapper around an Arduino `fs::File`.
+///
+/// Refills start at `kFileInputIteratorBufferSize` bytes, and double while
+/// reads are sequential, up to `max_buffer_size`; after a seek, they fall back
+/// to the initial size (see `ReadAhead`).
 class ArduinoFileInputIterator {
  public:
   /// Opens the iterator over an already open Arduino file handle.
-  ArduinoFileInputIterator(::fs::File file) : rep_(new Rep(std::move(file))) {}
+  ArduinoFileInputIterator(
+      ::fs::File file, size_t max_buffer_size = kFileInputIteratorMaxBufferSize)
+      : rep_(new Rep(std::move(file), max_buffer_size)) {}
 
   /// Reads and returns one byte.
   byte read() { return rep_->read(); }
@@ -41,13 +49,18 @@ class ArduinoFileInputIterator {
   /// Seeks to `position` in the file.
   void seek(uint64_t position) { rep_->seek(position); }
 
+  /// Returns the statistics of the chosen refill sizes.
+  const ReadAheadStats& readAheadStats() const {
+    return rep_->readAheadStats();
+  }
+
   // void reset(::File file) { rep_->reset(&input); }
   // void reset() { rep_->reset(nullptr); }
 
  private:
   class Rep {
    public:
-    Rep(::fs::File file);
+    Rep(::fs::File file, size_t max_buffer_size);
     ~Rep();
     byte read();
     size_t read(byte* buf, size_t count);
@@ -60,15 +73,25 @@ class ArduinoFileInputIterator {
     void rewind();
     void seek(uint64_t position);
 
+    const ReadAheadStats& readAheadStats() const {
+      return read_ahead_.stats();
+    }
+
    private:
     Rep(const Rep&) = delete;
     Rep(Rep&&) = delete;
     Rep& operator=(const Rep&) = delete;
 
+    // Refills the buffer. Returns the number of bytes read, or zero (with
+    // status updated) on end of file or error.
+    size_t fill();
+
     ::fs::File file_;
-    byte buffer_[kFileInputIteratorBufferSize];
-    uint8_t offset_;
-    uint8_t length_;
+    ReadAhead read_ahead_;
+    std::unique_ptr<byte[]> buffer_;
+    size_t allocated_;
+    size_t offset_;
+    size_t length_;
     Status status_;
   };
 
@@ -79,8 +102,12 @@ class ArduinoFileInputIterator {
   std::unique_ptr<Rep> rep_;
 };
 
-inline ArduinoFileInputIterator::Rep::Rep(::fs::File file)
+inline ArduinoFileInputIterator::Rep::Rep(::fs::File file,
+                                          size_t max_buffer_size)
     : file_(std::move(file)),
+      read_ahead_(kFileInputIteratorBufferSize, max_buffer_size),
+      buffer_(nullptr),
+      allocated_(0),
       offset_(0),
       length_(0),
       status_(file_ ? kOk : kClosed) {}
@@ -92,7 +119,7 @@ inline uint64_t ArduinoFileInputIterator::Rep::size() const {
 }
 
 inline uint64_t ArduinoFileInputIterator::Rep::position() const {
-  return file_.position() + offset_ - length_;
+  return file_.position() - length_ + offset_;
 }
 
 inline void ArduinoFileInputIterator::Rep::rewind() {
@@ -125,26 +152,35 @@ inline void ArduinoFileInputIterator::Rep::seek(uint64_t position) {
   }
 }
 
-inline byte ArduinoFileInputIterator::Rep::read() {
-  if (offset_ < length_) {
-    return buffer_[offset_++];
+inline size_t ArduinoFileInputIterator::Rep::fill() {
+  uint64_t position = file_.position();
+  size_t size = read_ahead_.next(position);
+  if (size > allocated_) {
+    buffer_.reset(new byte[size]);
+    allocated_ = size;
   }
-  if (status_ != kOk) return byte{0};
-  size_t len = file_.read((uint8_t*)buffer_, kFileInputIteratorBufferSize);
+  size_t len = file_.read((uint8_t*)buffer_.get(), size);
+  offset_ = 0;
   if (len == 0) {
-    offset_ = 0;
     length_ = 0;
     status_ = kEndOfStream;
-    return byte{0};
+    return 0;
   } else if (len == ((size_t)(-1))) {
-    offset_ = 0;
     length_ = 0;
     status_ = kReadError;
-    return byte{0};
+    return 0;
   }
-  offset_ = 1;
+  read_ahead_.advance(position + len);
   length_ = len;
-  return buffer_[0];
+  return len;
+}
+
+inline byte ArduinoFileInputIterator::Rep::read() {
+  if (offset_ < length_) {
+    return buffer_[offset_++];
+  }
+  if (status_ != kOk || fill() == 0) return byte{0};
+  return buffer_[offset_++];
 }
 
 inline size_t ArduinoFileInputIterator::Rep::read(byte* buf, size_t count) {
@@ -160,8 +196,11 @@ inline size_t ArduinoFileInputIterator::Rep::read(byte* buf, size_t count) {
     // Already done.
     return 0;
   }
-  if (count >= kFileInputIteratorBufferSize) {
-    // Skip buffering; read directly into the client's buffer.
+  if (count >= read_ahead_.maxSize()) {
+    // Skip buffering; read directly into the client's buffer. The buffer
+    // no longer holds the bytes preceding the file position.
+    offset_ = 0;
+    length_ = 0;
     size_t len = file_.read((uint8_t*)buf, count);
     if (len == 0) {
       offset_ = 0;
@@ -174,23 +213,12 @@ inline size_t ArduinoFileInputIterator::Rep::read(byte* buf, size_t count) {
       status_ = kReadError;
       return 0;
     }
+    read_ahead_.advance(file_.position());
     return len;
   }
-  size_t len = file_.read((uint8_t*)buffer_, kFileInputIteratorBufferSize);
-  if (len == 0) {
-    offset_ = 0;
-    length_ = 0;
-    status_ = kEndOfStream;
-    return 0;
-  } else if (len == ((size_t)(-1))) {
-    offset_ = 0;
-    length_ = 0;
-    status_ = kReadError;
-    return 0;
-  }
-  length_ = len;
+  if (fill() == 0) return 0;
   if (count > length_) count = length_;
-  memcpy(buf, buffer_, count);
+  memcpy(buf, buffer_.get(), count);
   offset_ = count;
   return count;
 }
@@ -5,20 +5,57 @@
 namespace roo_io {
 
 ArduinoFileOutputStream::ArduinoFileOutputStream(Status error)
-    : file_(), status_(error) {}
+    : file_(),
+      status_(error),
+      position_(0),
+      size_(0),
+      durability_(kSyncNone),
+      fs_(nullptr) {}
 
 ArduinoFileOutputStream::ArduinoFileOutputStream(fs::File file)
     : ArduinoFileOutputStream(nullptr, std::move(file)) {}
 
 ArduinoFileOutputStream::ArduinoFileOutputStream(
     std::shared_ptr<MountImpl> mount, fs::File file)
+    : ArduinoFileOutputStream(std::move(mount), std::move(file), kSyncNone) {}
+
+ArduinoFileOutputStream::ArduinoFileOutputStream(
+    std::shared_ptr<MountImpl> mount, fs::File file, SyncLevel durability)
+    : mount_(std::move(mount)),
+      file_(std::move(file)),
+      status_(file_ ? kOk : kClosed),
+      position_(file_ ? file_.position() : 0),
+      size_(file_ ? file_.size() : 0),
+      durability_(durability),
+      fs_(nullptr) {}
+
+ArduinoFileOutputStream::ArduinoFileOutputStream(
+    std::shared_ptr<MountImpl> mount, fs::FS& fs, fs::File file,
+    SyncLevel durability, String temp_path, String replace_target)
     : mount_(std::move(mount)),
       file_(std::move(file)),
-      status_(file_ ? kOk : kClosed) {}
+      status_(file_ ? kOk : kClosed),
+      position_(0),
+      size_(0),
+      durability_(durability),
+      fs_(&fs),
+      temp_path_(std::move(temp_path)),
+      replace_target_(std::move(replace_target)) {}
+
+ArduinoFileOutputStream::~ArduinoFileOutputStream() { discardTemporary(); }
+
+void ArduinoFileOutputStream::discardTemporary() {
+  if (fs_ == nullptr) return;
+  file_.close();
+  fs_->remove(temp_path_);
+  fs_ = nullptr;
+}
 
 size_t ArduinoFileOutputStream::write(const byte* buf, size_t count) {
   if (status_ != kOk) return 0;
   size_t result = file_.write((const uint8_t*)buf, count);
+  position_ += result;
+  extend();
   if (result < count) {
     status_ = roo_io::kWriteError;
     mount_.reset();
@@ -26,6 +63,31 @@ size_t ArduinoFileOutputStream::write(const byte* buf, size_t count) {
   return result;
 }
 
+uint64_t ArduinoFileOutputStream::size() {
+  if (status_ != kOk) return 0;
+  return file_.size();
+}
+
+void ArduinoFileOutputStream::seek(uint64_t offset) {
+  if (status_ != kOk) return;
+  uint64_t size = file_.size();
+  if (!file_.seek(offset <= size ? offset : size)) {
+    status_ = kSeekError;
+    mount_.reset();
+    return;
+  }
+  position_ = offset <= size ? offset : size;
+  if (offset > size) {
+    static const byte kZeros[64] = {};
+    uint64_t remaining = offset - size;
+    while (remaining > 0 && status_ == kOk) {
+      remaining -= write(kZeros, remaining < sizeof(kZeros)
+                                     ? (size_t)remaining
+                                     : sizeof(kZeros));
+    }
+  }
+}
+
 void ArduinoFileOutputStream::flush() {
   if (status_ == kClosed) return;
   file_.flush();
@@ -35,13 +97,62 @@ void ArduinoFileOutputStream::flush() {
   }
 }
 
+void ArduinoFileOutputStream::sync(SyncLevel level) {
+  (void)level;
+  if (status_ != kOk) return;
+  flush();
+}
+
 void ArduinoFileOutputStream::close() {
   mount_.reset();
   if (status_ == kClosed) return;
+  if (status_ != kOk) {
+    discardTemporary();
+    file_.close();
+    return;
+  }
+  if (durability_ != kSyncNone) file_.flush();
+  // Neither File::flush() nor File::close() reports errors. File::size()
+  // flushes buffered data (on ESP32, returning 0 if that fails), so a file
+  // shorter than what has been written means that some data got lost.
+  if (file_.size() < size_) {
+    status_ = kWriteError;
+    discardTemporary();
+    file_.close();
+    return;
+  }
   file_.close();
-  if (status_ == kOk) {
-    status_ = kClosed;
+  if (fs_ != nullptr) {
+    // Check that the closed file holds all the data before it replaces the
+    // target.
+    bool complete;
+    {
+      fs::File check = fs_->open(temp_path_, "r");
+      complete = check && check.size() >= size_;
+    }
+    if (!complete) {
+      status_ = kWriteError;
+      discardTemporary();
+      return;
+    }
+    // Some filesystems (e.g. FAT) refuse to rename over an existing file.
+    if (!fs_->rename(temp_path_, replace_target_)) {
+      if (!fs_->remove(replace_target_)) {
+        // The target is intact.
+        status_ = kWriteError;
+        discardTemporary();
+        return;
+      }
+      if (!fs_->rename(temp_path_, replace_target_)) {
+        // Keep the temporary file; it holds the only copy of the data.
+        status_ = kWriteError;
+        fs_ = nullptr;
+        return;
+      }
+    }
+    fs_ = nullptr;
   }
+  status_ = kClosed;
 }
 
 }  // namespace roo_io
@@ -4,13 +4,17 @@
 
 #include <FS.h>
 
-#include "roo_io/core/output_stream.h"
+#include "roo_io/core/multipass_output_stream.h"
+#include "roo_io/core/sync_level.h"
 #include "roo_io/fs/mount_impl.h"
 
 namespace roo_io {
 
 /// Output stream wrapper around an Arduino `fs::File`.
-class ArduinoFileOutputStream : public OutputStream {
+///
+/// Seeking is only meaningful for files not opened in append mode, i.e. those
+/// opened with `Mount::fopenForRandomWrite()`.
+class ArduinoFileOutputStream : public MultipassOutputStream {
  public:
   /// Creates a detached stream that reports `error` from `status()`.
   ArduinoFileOutputStream(Status error);
@@ -22,22 +26,72 @@ class ArduinoFileOutputStream : public OutputStream {
   /// Wraps an already open file and keeps the mount alive while it is in use.
   ArduinoFileOutputStream(std::shared_ptr<MountImpl> mount, fs::File file);
 
+  /// Wraps an already open file, flushed on `close()` per `durability`.
+  ArduinoFileOutputStream(std::shared_ptr<MountImpl> mount, fs::File file,
+                          SyncLevel durability);
+
+  /// Wraps an already open temporary file at `temp_path` in `fs`. When the
+  /// stream is closed successfully, the file is renamed to `replace_target`;
+  /// otherwise, it is removed.
+  ArduinoFileOutputStream(std::shared_ptr<MountImpl> mount, fs::FS& fs,
+                          fs::File file, SyncLevel durability,
+                          String temp_path, String replace_target);
+
+  /// Abandons the pending replacement, if any, when not closed.
+  ~ArduinoFileOutputStream();
+
   /// Writes up to `count` bytes to the file.
   size_t write(const byte* buf, size_t count) override;
 
+  /// Returns the file size in bytes.
+  uint64_t size() override;
+
+  /// Returns the current file offset.
+  uint64_t position() const override { return file_.position(); }
+
+  /// Seeks to `offset` in the file. Seeking past the end of the file extends
+  /// it with zeros right away, since not all Arduino filesystems support
+  /// sparse seeks.
+  void seek(uint64_t offset) override;
+
   /// Flushes pending file data to the backing filesystem.
   void flush() override;
 
-  /// Closes the file and releases any retained mount reference.
+  /// Flushes the file. Arduino filesystems offer no separate sync call; on
+  /// ESP32, `File::flush()` already calls `fsync()`, which covers every level
+  /// except the directory sync of `kSyncDataAndDirectory`.
+  void sync(SyncLevel level) override;
+
+  /// Closes the file (and if it is a temporary file, renames it over its
+  /// target), and releases any retained mount reference.
   void close() override;
 
   /// Returns the current stream status.
   Status status() const override { return status_; }
 
  private:
+  // Closes and removes the temporary file, if any, leaving the target intact.
+  void discardTemporary();
+
+  // Records that the file extends at least to `position_`.
+  void extend() {
+    if (position_ > size_) size_ = position_;
+  }
+
   std::shared_ptr<MountImpl> mount_;
   fs::File file_;
   Status status_;
+
+  // Tracked independently of the file, so that `close()` can verify that all
+  // of the data made it to the filesystem; `File::flush()` and `File::close()`
+  // do not report errors.
+  uint64_t position_;
+  uint64_t size_;
+
+  SyncLevel durability_;
+  fs::FS* fs_;
+  String temp_path_;
+  String replace_target_;
 };
 
 }  // namespace roo_io
@@ -1,5 +1,9 @@
 #include "roo_io/fs/arduino/mount.h"
 
+#include <stdio.h>
+
+#include <atomic>
+
 #include "roo_io/fs/arduino/file_input_stream.h"
 #include "roo_io/fs/arduino/file_output_stream.h"
 
@@ -34,6 +38,16 @@ Status CheckParentage(FS& fs, const char* path) {
   }
 }
 
+// Returns the path of a temporary file next to `path`, unique within the
+// process, so that concurrent replacements and truncations of the same file
+// do not write to the same temporary file.
+String TempPath(const char* path) {
+  static std::atomic<uint32_t> counter(0);
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), ".tmp.%u", (unsigned)++counter);
+  return String(path) + suffix;
+}
+
 }  // namespace
 
 ArduinoMountImpl::ArduinoMountImpl(FS& fs, bool read_only,
@@ -93,6 +107,64 @@ Status ArduinoMountImpl::rename(const char* pathFrom, const char* pathTo) {
   return kUnknownIOError;
 }
 
+Status ArduinoMountImpl::truncate(const char* path, uint64_t size) {
+  if (path == nullptr || path[0] != '/') {
+    return kInvalidPath;
+  }
+  if (!active_) return kNotMounted;
+  if (read_only_) return kReadOnlyFilesystem;
+  Stat st = stat(path);
+  if (!st.exists()) return st.status();
+  if (st.isDirectory()) return kNotFile;
+  if (size == st.size()) return kOk;
+  // The Arduino File API has no way to resize a file.
+  uint8_t buf[64];
+  if (size > st.size()) {
+    fs::File f = fs_.open(path, "a");
+    if (!f) return kOpenError;
+    memset(buf, 0, sizeof(buf));
+    uint64_t remaining = size - st.size();
+    while (remaining > 0) {
+      size_t n = remaining < sizeof(buf) ? (size_t)remaining : sizeof(buf);
+      if (f.write(buf, n) != n) return kNoSpaceLeftOnDevice;
+      remaining -= n;
+    }
+    return kOk;
+  }
+  // Shrinking: copy the retained prefix to a temporary file, and swap it in.
+  String temp_path = TempPath(path);
+  {
+    fs::File in = fs_.open(path, "r");
+    if (!in) return kOpenError;
+    fs::File out = fs_.open(temp_path, "w");
+    if (!out) return kOpenError;
+    uint64_t remaining = size;
+    while (remaining > 0) {
+      size_t n = remaining < sizeof(buf) ? (size_t)remaining : sizeof(buf);
+      if (in.read(buf, n) != n) {
+        out.close();
+        fs_.remove(temp_path);
+        return kReadError;
+      }
+      if (out.write(buf, n) != n) {
+        out.close();
+        fs_.remove(temp_path);
+        return kNoSpaceLeftOnDevice;
+      }
+      remaining -= n;
+    }
+  }
+  if (fs_.rename(temp_path, path)) return kOk;
+  // Some filesystems do not rename over an existing file.
+  if (!fs_.remove(path)) {
+    fs_.remove(temp_path);
+    return kUnknownIOError;
+  }
+  // If this fails, the temporary file holds the only copy; keep it, so that
+  // recovery can adopt it.
+  return fs_.rename(temp_path, path) ? kOk : kUnknownIOError;
+}
+
 Status ArduinoMountImpl::mkdir(const char* path) {
   if (path == nullptr || path[0] != '/') {
     return kInvalidPath;
@@ -174,7 +246,7 @@ std::unique_ptr<MultipassInputStream> ArduinoMountImpl::fopen(
 
 std::unique_ptr<OutputStream> ArduinoMountImpl::fopenForWrite(
     std::shared_ptr<MountImpl> mount, const char* path,
-    FileUpdatePolicy update_policy) {
+    FileUpdatePolicy update_policy, SyncLevel durability) {
   if (path == nullptr || path[0] != '/') {
     return OutputError(kInvalidPath);
   }
@@ -182,6 +254,10 @@ std::unique_ptr<OutputStream> ArduinoMountImpl::fopenForWrite(
   if (read_only_) {
     return OutputError(kReadOnlyFilesystem);
   }
+  if (update_policy == kReplaceAtomically) {
+    return std::unique_ptr<OutputStream>(
+        openForReplace(std::move(mount), path, durability));
+  }
   fs::File f;
   if (update_policy == kFailIfExists) {
     if (fs_.exists(path)) {
@@ -205,7 +281,60 @@ std::unique_ptr<OutputStream> ArduinoMountImpl::fopenForWrite(
     return OutputError(kOpenError);
   }
   return std::unique_ptr<OutputStream>(
-      new ArduinoFileOutputStream(std::move(mount), std::move(f)));
+      new ArduinoFileOutputStream(std::move(mount), std::move(f), durability));
+}
+
+std::unique_ptr<MultipassOutputStream> ArduinoMountImpl::fopenForRandomWrite(
+    std::shared_ptr<MountImpl> mount, const char* path,
+    FileUpdatePolicy update_policy, SyncLevel durability) {
+  if (path == nullptr || path[0] != '/') {
+    return MultipassOutputError(kInvalidPath);
+  }
+  if (!active_) return MultipassOutputError(kNotMounted);
+  if (read_only_) {
+    return MultipassOutputError(kReadOnlyFilesystem);
+  }
+  if (update_policy == kReplaceAtomically) {
+    return openForReplace(std::move(mount), path, durability);
+  }
+  fs::File f;
+  if (fs_.exists(path)) {
+    f = fs_.open(path, "r");
+    if (f.isDirectory()) {
+      return MultipassOutputError(update_policy == kFailIfExists
+                                      ? kDirectoryExists
+                                      : kNotFile);
+    }
+    if (update_policy == kFailIfExists) {
+      return MultipassOutputError(kFileExists);
+    }
+    // The "a" mode would force all writes to the end of the file; "r+" keeps
+    // the content, and allows overwriting it.
+    f = fs_.open(path, update_policy == kTruncateIfExists ? "w" : "r+");
+    if (f && update_policy == kAppendIfExists) f.seek(0, SeekEnd);
+  } else {
+    f = fs_.open(path, "w");
+  }
+  if (!f) {
+    return MultipassOutputError(kOpenError);
+  }
+  return std::unique_ptr<MultipassOutputStream>(
+      new ArduinoFileOutputStream(std::move(mount), std::move(f), durability));
+}
+
+std::unique_ptr<MultipassOutputStream> ArduinoMountImpl::openForReplace(
+    std::shared_ptr<MountImpl> mount, const char* path, SyncLevel durability) {
+  if (fs_.exists(path) && fs_.open(path, "r").isDirectory()) {
+    return MultipassOutputError(kNotFile);
+  }
+  String temp_path = TempPath(path);
+  fs::File f = fs_.open(temp_path, "w");
+  if (!f) {
+    return MultipassOutputError(kOpenError);
+  }
+  return std::unique_ptr<MultipassOutputStream>(new ArduinoFileOutputStream(
+      std::move(mount), fs_, std::move(f), durability, std::move(temp_path),
+      String(path)));
 }
 
 void ArduinoMountImpl::deactivate() { active_ = false; }
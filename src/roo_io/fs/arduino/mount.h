@@ -24,6 +24,8 @@ class ArduinoMountImpl : public MountImpl {
 
   Status rename(const char* pathFrom, const char* pathTo) override;
 
+  Status truncate(const char* path, uint64_t size) override;
+
   Status mkdir(const char* path) override;
 
   Status rmdir(const char* path) override;
@@ -36,13 +38,22 @@ class ArduinoMountImpl : public MountImpl {
 
   std::unique_ptr<OutputStream> fopenForWrite(
       std::shared_ptr<MountImpl> mount, const char* path,
-      FileUpdatePolicy update_policy) override;
+      FileUpdatePolicy update_policy, SyncLevel durability) override;
+
+  std::unique_ptr<MultipassOutputStream> fopenForRandomWrite(
+      std::shared_ptr<MountImpl> mount, const char* path,
+      FileUpdatePolicy update_policy, SyncLevel durability) override;
 
   bool active() const override { return active_; }
 
   void deactivate() override;
 
  private:
+  // Opens a temporary sibling of `path`, renamed over `path` on close.
+  std::unique_ptr<MultipassOutputStream> openForReplace(
+      std::shared_ptr<MountImpl> mount, const char* path,
+      SyncLevel durability);
+
   FS& fs_;
   bool active_;
   bool read_only_;
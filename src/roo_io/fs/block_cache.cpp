@@ -0,0 +1,287 @@
+#include "roo_io/fs/block_cache.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <iterator>
+#include <unordered_set>
+
+namespace roo_io {
+
+size_t BlockCache::KeyHash::operator()(const Key& key) const {
+  // Murmur3 finalizer over the combined key.
+  uint64_t h = key.file_id * 0x9E3779B97F4A7C15ull + key.block;
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return (size_t)h;
+}
+
+BlockCache::BlockCache(size_t capacity, size_t block_size, int shard_count)
+    : block_size_(block_size == 0 ? 1 : block_size),
+      shard_capacity_(capacity / (shard_count < 1 ? 1 : shard_count)),
+      next_file_id_(0),
+      // Twice the number of blocks that fit, so that pruning is amortized.
+      max_files_(2 * (capacity / block_size_ + 1)) {
+  if (shard_count < 1) shard_count = 1;
+  for (int i = 0; i < shard_count; ++i) {
+    shards_.emplace_back(new Shard());
+  }
+}
+
+size_t BlockCache::usage() const {
+  size_t usage = 0;
+  for (const auto& shard : shards_) {
+    roo::unique_lock<roo::mutex> lock(shard->mutex);
+    usage += shard->usage;
+  }
+  return usage;
+}
+
+uint64_t BlockCache::fileId(uint64_t mount, const char* path) {
+  roo::unique_lock<roo::mutex> lock(files_mutex_);
+  if (files_.size() >= max_files_) prune();
+  auto result = files_.emplace(FileKey(mount, path), File{next_file_id_, 0});
+  if (result.second) ++next_file_id_;
+  return result.first->second.id;
+}
+
+void BlockCache::invalidate(uint64_t mount, const char* path) {
+  uint64_t file_id;
+  {
+    roo::unique_lock<roo::mutex> lock(files_mutex_);
+    auto itr = files_.find(FileKey(mount, path));
+    if (itr == files_.end()) return;
+    file_id = renew(itr);
+  }
+  evict(file_id);
+}
+
+void BlockCache::beginWrite(uint64_t mount, const char* path) {
+  uint64_t file_id;
+  {
+    roo::unique_lock<roo::mutex> lock(files_mutex_);
+    auto result = files_.emplace(FileKey(mount, path), File{next_file_id_, 0});
+    if (result.second) {
+      // No blocks to evict.
+      ++next_file_id_;
+      result.first->second.writers = 1;
+      return;
+    }
+    ++result.first->second.writers;
+    file_id = renew(result.first);
+  }
+  evict(file_id);
+}
+
+void BlockCache::endWrite(uint64_t mount, const char* path) {
+  uint64_t file_id;
+  {
+    roo::unique_lock<roo::mutex> lock(files_mutex_);
+    auto itr = files_.find(FileKey(mount, path));
+    if (itr == files_.end()) return;
+    if (itr->second.writers > 0) --itr->second.writers;
+    file_id = renew(itr);
+  }
+  evict(file_id);
+}
+
+bool BlockCache::isBeingWritten(uint64_t mount, const char* path) const {
+  roo::unique_lock<roo::mutex> lock(files_mutex_);
+  auto itr = files_.find(FileKey(mount, path));
+  return itr != files_.end() && itr->second.writers > 0;
+}
+
+size_t BlockCache::fileCount() const {
+  roo::unique_lock<roo::mutex> lock(files_mutex_);
+  return files_.size();
+}
+
+uint64_t BlockCache::renew(std::map<FileKey, File>::iterator itr) {
+  uint64_t file_id = itr->second.id;
+  if (itr->second.writers > 0) {
+    itr->second.id = next_file_id_++;
+  } else {
+    files_.erase(itr);
+  }
+  return file_id;
+}
+
+void BlockCache::evict(uint64_t file_id) {
+  for (auto& shard : shards_) {
+    roo::unique_lock<roo::mutex> lock(shard->mutex);
+    for (auto itr = shard->lru.begin(); itr != shard->lru.end();) {
+      if (itr->key.file_id != file_id) {
+        ++itr;
+        continue;
+      }
+      shard->index.erase(itr->key);
+      shard->usage -= itr->size;
+      itr = shard->lru.erase(itr);
+    }
+  }
+}
+
+void BlockCache::prune() {
+  std::unordered_set<uint64_t> cached;
+  for (auto& shard : shards_) {
+    roo::unique_lock<roo::mutex> lock(shard->mutex);
+    for (const Entry& entry : shard->lru) {
+      cached.insert(entry.key.file_id);
+    }
+  }
+  // Streams opened earlier may still cache blocks under a forgotten ID; the
+  // blocks are then only visible to them, and age out of the LRU lists.
+  for (auto itr = files_.begin(); itr != files_.end();) {
+    if (itr->second.writers == 0 && cached.count(itr->second.id) == 0) {
+      itr = files_.erase(itr);
+    } else {
+      ++itr;
+    }
+  }
+  max_files_ =
+      std::max(2 * (capacity() / block_size_ + 1), 2 * files_.size());
+}
+
+void BlockCache::clear() {
+  for (auto& shard : shards_) {
+    roo::unique_lock<roo::mutex> lock(shard->mutex);
+    shard->index.clear();
+    shard->lru.clear();
+    shard->usage = 0;
+  }
+  roo::unique_lock<roo::mutex> lock(files_mutex_);
+  for (auto itr = files_.begin(); itr != files_.end();) {
+    auto next = std::next(itr);
+    renew(itr);
+    itr = next;
+  }
+}
+
+BlockCache::Shard& BlockCache::shardFor(const Key& key) {
+  // Use the high bits; the low ones select the bucket within the shard.
+  return *shards_[(KeyHash()(key) >> 16) % shards_.size()];
+}
+
+bool BlockCache::lookup(uint64_t file_id, uint64_t block, size_t offset,
+                        byte* buf, size_t& count) {
+  Key key{file_id, block};
+  Shard& shard = shardFor(key);
+  roo::unique_lock<roo::mutex> lock(shard.mutex);
+  auto itr = shard.index.find(key);
+  if (itr == shard.index.end()) return false;
+  const Entry& entry = *itr->second;
+  if (offset >= entry.size) {
+    count = 0;
+  } else {
+    if (count > entry.size - offset) count = entry.size - offset;
+    memcpy(buf, &entry.data[offset], count);
+  }
+  shard.lru.splice(shard.lru.begin(), shard.lru, itr->second);
+  return true;
+}
+
+void BlockCache::insert(uint64_t file_id, uint64_t block, const byte* data,
+                        size_t size) {
+  if (size > shard_capacity_) return;
+  Key key{file_id, block};
+  Shard& shard = shardFor(key);
+  roo::unique_lock<roo::mutex> lock(shard.mutex);
+  auto itr = shard.index.find(key);
+  if (itr != shard.index.end()) {
+    // Fetched concurrently by another stream.
+    shard.lru.splice(shard.lru.begin(), shard.lru, itr->second);
+    return;
+  }
+  while (shard.usage + size > shard_capacity_) {
+    Entry& victim = shard.lru.back();
+    shard.index.erase(victim.key);
+    shard.usage -= victim.size;
+    shard.lru.pop_back();
+  }
+  std::unique_ptr<byte[]> copy(new byte[size]);
+  memcpy(copy.get(), data, size);
+  shard.lru.push_front(Entry{key, std::move(copy), size});
+  shard.index.emplace(key, shard.lru.begin());
+  shard.usage += size;
+}
+
+CachedMultipassInputStream::CachedMultipassInputStream(
+    std::unique_ptr<MultipassInputStream> in, std::shared_ptr<BlockCache> cache,
+    uint64_t file_id)
+    : in_(std::move(in)),
+      cache_(std::move(cache)),
+      file_id_(file_id),
+      position_(0),
+      buffer_(nullptr),
+      status_(in_->status()) {}
+
+size_t CachedMultipassInputStream::read(byte* buf, size_t count) {
+  if (status_ != kOk || count == 0) return 0;
+  size_t block_size = cache_->blockSize();
+  uint64_t block = position_ / block_size;
+  size_t offset = position_ % block_size;
+  if (count > block_size - offset) count = block_size - offset;
+  if (!cache_->lookup(file_id_, block, offset, buf, count)) {
+    size_t size = fetch(block);
+    if (status_ != kOk) return 0;
+    if (offset >= size) {
+      count = 0;
+    } else {
+      if (count > size - offset) count = size - offset;
+      memcpy(buf, &buffer_[offset], count);
+    }
+  }
+  if (count == 0) {
+    status_ = kEndOfStream;
+    return 0;
+  }
+  position_ += count;
+  return count;
+}
+
+size_t CachedMultipassInputStream::fetch(uint64_t block) {
+  size_t block_size = cache_->blockSize();
+  if (buffer_ == nullptr) {
+    buffer_.reset(new byte[block_size]);
+  }
+  in_->seek(block * block_size);
+  size_t size = 0;
+  if (in_->status() == kOk) {
+    size = in_->readFully(buffer_.get(), block_size);
+  }
+  Status status = in_->status();
+  if (status != kOk && status != kEndOfStream) {
+    status_ = status;
+    return 0;
+  }
+  if (size > 0) cache_->insert(file_id_, block, buffer_.get(), size);
+  return size;
+}
+
+uint64_t CachedMultipassInputStream::size() {
+  if (status_ != kOk && status_ != kEndOfStream) return 0;
+  uint64_t size = in_->size();
+  Status status = in_->status();
+  if (status != kOk && status != kEndOfStream) {
+    status_ = status;
+    return 0;
+  }
+  return size;
+}
+
+void CachedMultipassInputStream::seek(uint64_t offset) {
+  if (status_ != kOk && status_ != kEndOfStream) return;
+  position_ = offset;
+  status_ = kOk;
+}
+
+void CachedMultipassInputStream::close() {
+  if (in_ != nullptr) in_->close();
+  if (status_ == kOk || status_ == kEndOfStream) status_ = kClosed;
+  buffer_ = nullptr;
+}
+
+}  // namespace roo_io
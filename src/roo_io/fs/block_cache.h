@@ -0,0 +1,228 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/status.h"
+#include "roo_threads.h"
+#include "roo_threads/mutex.h"
+
+namespace roo_io {
+
+/// Fixed-budget cache of file blocks, shared by any number of
+/// `CachedMultipassInputStream`s.
+///
+/// Files are divided into blocks of `blockSize()` bytes. A block is read from
+/// the underlying stream on the first access, and then served from memory
+/// until it gets evicted. The cache holds at most `capacity()` bytes of block
+/// data; when it is full, the least recently used blocks are evicted.
+///
+/// To reduce lock contention, blocks are spread over independent shards, each
+/// with its own LRU list and a proportional share of the capacity.
+///
+/// Files are identified by a (mount, path) pair, mapped to a numeric file ID
+/// by `fileId()`. Each mount of a filesystem has a distinct key, so that
+/// blocks read before an unmount (e.g. from another SD card) are never served
+/// after a remount. The cache does not notice changes made to the files; call
+/// `invalidate()` when a cached file changes, or bracket the changes with
+/// `beginWrite()` and `endWrite()` (`Mount` does that for the changes made
+/// through it). IDs of files with no cached blocks are forgotten once there
+/// are many of them, so that the bookkeeping stays proportional to the
+/// capacity.
+///
+/// Thread-safe.
+///
+/// Example:
+///
+/// ```
+/// auto cache = std::make_shared<BlockCache>(32 * 1024);
+/// mount.setBlockCache(cache, [](const char* path) {
+///   return strncmp(path, "/index/", 7) == 0;
+/// });
+/// ```
+class BlockCache {
+ public:
+  /// Creates a cache holding up to `capacity` bytes, in blocks of
+  /// `block_size` bytes, spread over `shard_count` shards.
+  BlockCache(size_t capacity, size_t block_size = 512, int shard_count = 4);
+
+  BlockCache(const BlockCache&) = delete;
+  BlockCache& operator=(const BlockCache&) = delete;
+
+  /// Returns the block size, in bytes.
+  size_t blockSize() const { return block_size_; }
+
+  /// Returns the maximum number of bytes of block data held by the cache.
+  size_t capacity() const { return shard_capacity_ * shards_.size(); }
+
+  /// Returns the number of bytes of block data currently held by the cache.
+  size_t usage() const;
+
+  /// Returns the ID identifying the file at `path` in `mount`. `mount` is an
+  /// arbitrary number that distinguishes file namespaces, such as
+  /// `Mount::cacheKey()`.
+  uint64_t fileId(uint64_t mount, const char* path);
+
+  /// Forgets the cached blocks of the file at `path` in `mount`. Subsequent
+  /// `fileId()` calls return a new ID, so that new streams re-read the file.
+  /// Streams opened before keep their ID, and may keep seeing the old
+  /// contents.
+  void invalidate(uint64_t mount, const char* path);
+
+  /// Invalidates the file at `path` in `mount`, which is about to change, and
+  /// makes `isBeingWritten()` return true for it until the matching
+  /// `endWrite()`. Calls may nest.
+  void beginWrite(uint64_t mount, const char* path);
+
+  /// Invalidates the file at `path` in `mount` again, once it has changed,
+  /// and ends the write started by `beginWrite()`.
+  void endWrite(uint64_t mount, const char* path);
+
+  /// Returns whether the file at `path` in `mount` is being written. Such
+  /// files should be read without the cache, which could otherwise keep
+  /// their intermediate contents.
+  bool isBeingWritten(uint64_t mount, const char* path) const;
+
+  /// Returns the number of files that have an ID.
+  size_t fileCount() const;
+
+  /// Evicts all blocks, and forgets all file IDs.
+  void clear();
+
+ private:
+  friend class CachedMultipassInputStream;
+
+  struct Key {
+    uint64_t file_id;
+    uint64_t block;
+
+    bool operator==(const Key& other) const {
+      return file_id == other.file_id && block == other.block;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
+  struct Entry {
+    Key key;
+    std::unique_ptr<byte[]> data;
+    size_t size;
+  };
+
+  struct Shard {
+    mutable roo::mutex mutex;
+    // Most recently used first.
+    std::list<Entry> lru;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index;
+    size_t usage = 0;
+  };
+
+  struct File {
+    uint64_t id;
+
+    // Number of writes in progress.
+    int writers;
+  };
+
+  using FileKey = std::pair<uint64_t, std::string>;
+
+  Shard& shardFor(const Key& key);
+
+  // Gives the file a new ID, or forgets it if it is not being written.
+  // Returns the old ID. Called with `files_mutex_` held.
+  uint64_t renew(std::map<FileKey, File>::iterator itr);
+
+  // Evicts the blocks of the file.
+  void evict(uint64_t file_id);
+
+  // Forgets the IDs of files that are not being written, and have no cached
+  // blocks. Called with `files_mutex_` held.
+  void prune();
+
+  // If the block is cached, copies up to `count` bytes of it, starting at
+  // `offset`, to `buf`, sets `count` to the number of bytes copied (zero if
+  // `offset` is past the end of the block), and returns true. Otherwise,
+  // returns false.
+  bool lookup(uint64_t file_id, uint64_t block, size_t offset, byte* buf,
+              size_t& count);
+
+  // Caches `size` bytes of the block, evicting other blocks as needed.
+  void insert(uint64_t file_id, uint64_t block, const byte* data,
+              size_t size);
+
+  size_t block_size_;
+  size_t shard_capacity_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  mutable roo::mutex files_mutex_;
+  std::map<FileKey, File> files_;
+  uint64_t next_file_id_;
+
+  // When `files_` grows to this size, it gets pruned.
+  size_t max_files_;
+};
+
+/// Multipass input stream that reads another one through a `BlockCache`.
+///
+/// Reads are served block by block from the cache. On a miss, the whole block
+/// is read from the underlying stream (with one seek and one read), and
+/// cached. Seeks are free; they only move the read position.
+///
+/// Usually obtained from `Mount::fopen()`, for paths selected with
+/// `Mount::setBlockCache()`.
+class CachedMultipassInputStream : public MultipassInputStream {
+ public:
+  /// Creates a stream reading `in`, caching its blocks in `cache` under
+  /// `file_id` (see `BlockCache::fileId()`).
+  CachedMultipassInputStream(std::unique_ptr<MultipassInputStream> in,
+                             std::shared_ptr<BlockCache> cache,
+                             uint64_t file_id);
+
+  ~CachedMultipassInputStream() override { close(); }
+
+  /// Reads up to `count` bytes, but not past the end of the current block.
+  size_t read(byte* buf, size_t count) override;
+
+  /// Returns the size of the underlying stream.
+  uint64_t size() override;
+
+  /// Returns the current read position.
+  uint64_t position() const override { return position_; }
+
+  /// Moves the read position to `offset`, without accessing the underlying
+  /// stream.
+  void seek(uint64_t offset) override;
+
+  /// Closes the underlying stream.
+  void close() override;
+
+  /// Returns the current stream status.
+  Status status() const override { return status_; }
+
+ private:
+  // Reads the block from the underlying stream into `buffer_`, and caches
+  // it. Returns the block size, or zero on error (in which case `status_` is
+  // updated).
+  size_t fetch(uint64_t block);
+
+  std::unique_ptr<MultipassInputStream> in_;
+  std::shared_ptr<BlockCache> cache_;
+  uint64_t file_id_;
+  uint64_t position_;
+
+  // Allocated on the first miss.
+  std::unique_ptr<byte[]> buffer_;
+  Status status_;
+};
+
+}  // namespace roo_io
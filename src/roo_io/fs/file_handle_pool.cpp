@@ -0,0 +1,277 @@
+#include "roo_io/fs/file_handle_pool.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include "roo_threads.h"
+#include "roo_threads/condition_variable.h"
+#include "roo_threads/mutex.h"
+
+namespace roo_io {
+
+// Shared by the pool and the streams it hands out, so that streams may
+// outlive the pool.
+class FileHandlePool::State {
+ public:
+  struct Key {
+    // Idle handles do not keep the mount alive; they get closed once it is
+    // gone.
+    std::weak_ptr<MountImpl> mount;
+
+    // Identifies the mount while it is alive.
+    const MountImpl* mount_ptr;
+    std::string path;
+
+    bool unmounted() const { return mount.expired(); }
+
+    // Matches all the files of the mount if `p` is null.
+    bool matches(const MountImpl* m, const char* p) const {
+      return mount_ptr == m && !unmounted() && (p == nullptr || path == p);
+    }
+  };
+
+  struct Idle {
+    Key key;
+    std::unique_ptr<MultipassInputStream> in;
+  };
+
+  // A handle in use.
+  struct Lease {
+    Key key;
+
+    // If true, the file has changed (or the pool got cleared) since the
+    // handle was opened, so it must not return to the pool.
+    bool stale;
+  };
+
+  using LeaseItr = std::list<Lease>::iterator;
+
+  State(size_t max_open_files, bool wait_if_exhausted)
+      : max_open_files(max_open_files == 0 ? 1 : max_open_files),
+        wait_if_exhausted(wait_if_exhausted) {}
+
+  // Ends the lease, pooling `in` unless it is null or stale.
+  void release(LeaseItr lease, std::unique_ptr<MultipassInputStream> in) {
+    {
+      roo::unique_lock<roo::mutex> lock(mutex);
+      if (in != nullptr && !lease->stale) {
+        idle.push_front(Idle{std::move(lease->key), std::move(in)});
+      }
+      leases.erase(lease);
+      released.notify_all();
+    }
+    if (in != nullptr) in->close();
+  }
+
+  // Removes the idle handles matching the predicate, and marks the matching
+  // leases stale. Returns the removed handles, to be closed outside the lock.
+  template <typename Pred>
+  std::vector<std::unique_ptr<MultipassInputStream>> removeIf(Pred pred) {
+    std::vector<std::unique_ptr<MultipassInputStream>> removed;
+    roo::unique_lock<roo::mutex> lock(mutex);
+    for (auto itr = idle.begin(); itr != idle.end();) {
+      if (!pred(itr->key)) {
+        ++itr;
+        continue;
+      }
+      removed.push_back(std::move(itr->in));
+      itr = idle.erase(itr);
+    }
+    for (Lease& lease : leases) {
+      if (pred(lease.key)) lease.stale = true;
+    }
+    if (!removed.empty()) released.notify_all();
+    return removed;
+  }
+
+  const size_t max_open_files;
+  const bool wait_if_exhausted;
+
+  mutable roo::mutex mutex;
+  roo::condition_variable released;
+
+  // Most recently used first. Searched linearly; the pool is small.
+  std::list<Idle> idle;
+  std::list<Lease> leases;
+  FileHandlePoolStats stats;
+};
+
+// Hands the underlying handle back to the pool when closed.
+class FileHandlePool::PooledInputStream : public MultipassInputStream {
+ public:
+  PooledInputStream(std::shared_ptr<State> state, State::LeaseItr lease,
+                    std::shared_ptr<MountImpl> mount,
+                    std::unique_ptr<MultipassInputStream> in)
+      : state_(std::move(state)),
+        lease_(lease),
+        mount_(std::move(mount)),
+        in_(std::move(in)) {}
+
+  ~PooledInputStream() override { close(); }
+
+  size_t read(byte* buf, size_t count) override {
+    return in_ == nullptr ? 0 : in_->read(buf, count);
+  }
+
+  size_t tryRead(byte* buf, size_t count) override {
+    return in_ == nullptr ? 0 : in_->tryRead(buf, count);
+  }
+
+  size_t readFully(byte* buf, size_t count) override {
+    return in_ == nullptr ? 0 : in_->readFully(buf, count);
+  }
+
+  void skip(uint64_t count) override {
+    if (in_ != nullptr) in_->skip(count);
+  }
+
+  uint64_t size() override { return in_ == nullptr ? 0 : in_->size(); }
+
+  uint64_t position() const override {
+    return in_ == nullptr ? 0 : in_->position();
+  }
+
+  void seek(uint64_t offset) override {
+    if (in_ != nullptr) in_->seek(offset);
+  }
+
+  void close() override {
+    if (in_ == nullptr) return;
+    Status status = in_->status();
+    // Do not reuse handles in an error state, nor of a mount that is about to
+    // go away.
+    if ((status != kOk && status != kEndOfStream) || mount_.use_count() == 1) {
+      in_->close();
+      in_ = nullptr;
+    }
+    state_->release(lease_, std::move(in_));
+    // Possibly unmounts, which evicts the idle handles of the mount.
+    mount_ = nullptr;
+  }
+
+  Status status() const override {
+    return in_ == nullptr ? kClosed : in_->status();
+  }
+
+ private:
+  std::shared_ptr<State> state_;
+  State::LeaseItr lease_;
+
+  // Keeps the mount alive while the handle is in use.
+  std::shared_ptr<MountImpl> mount_;
+  std::unique_ptr<MultipassInputStream> in_;
+};
+
+FileHandlePool::FileHandlePool(size_t max_open_files, bool wait_if_exhausted)
+    : state_(std::make_shared<State>(max_open_files, wait_if_exhausted)) {}
+
+FileHandlePool::~FileHandlePool() { clear(); }
+
+size_t FileHandlePool::maxOpenFiles() const { return state_->max_open_files; }
+
+bool FileHandlePool::waitIfExhausted() const {
+  return state_->wait_if_exhausted;
+}
+
+size_t FileHandlePool::inUseCount() const {
+  roo::unique_lock<roo::mutex> lock(state_->mutex);
+  return state_->leases.size();
+}
+
+size_t FileHandlePool::idleCount() const {
+  roo::unique_lock<roo::mutex> lock(state_->mutex);
+  return state_->idle.size();
+}
+
+FileHandlePoolStats FileHandlePool::stats() const {
+  roo::unique_lock<roo::mutex> lock(state_->mutex);
+  return state_->stats;
+}
+
+std::unique_ptr<MultipassInputStream> FileHandlePool::fopen(
+    std::shared_ptr<MountImpl> mount, const char* path) {
+  evictUnmounted();
+  State& state = *state_;
+  std::unique_ptr<MultipassInputStream> in;
+  std::unique_ptr<MultipassInputStream> victim;
+  State::LeaseItr lease;
+  {
+    roo::unique_lock<roo::mutex> lock(state.mutex);
+    bool waited = false;
+    while (true) {
+      auto itr = state.idle.begin();
+      while (itr != state.idle.end() && !itr->key.matches(mount.get(), path)) {
+        ++itr;
+      }
+      if (itr != state.idle.end()) {
+        in = std::move(itr->in);
+        state.idle.erase(itr);
+        ++state.stats.hits;
+        break;
+      }
+      if (state.leases.size() + state.idle.size() < state.max_open_files) {
+        ++state.stats.misses;
+        break;
+      }
+      if (!state.idle.empty()) {
+        victim = std::move(state.idle.back().in);
+        state.idle.pop_back();
+        ++state.stats.evictions;
+        ++state.stats.misses;
+        break;
+      }
+      if (!state.wait_if_exhausted) {
+        ++state.stats.rejections;
+        return InputError(kTooManyFilesOpen);
+      }
+      if (!waited) {
+        ++state.stats.waits;
+        waited = true;
+      }
+      state.released.wait(lock);
+    }
+    lease = state.leases.insert(
+        state.leases.end(), State::Lease{{mount, mount.get(), path}, false});
+  }
+  if (victim != nullptr) victim->close();
+  if (in != nullptr) {
+    in->rewind();
+    if (in->status() != kOk) {
+      in->close();
+      in = nullptr;
+    }
+  }
+  if (in == nullptr) {
+    // The handle does not own the mount, so that it does not keep it alive
+    // while idle; the returned stream does, while in use.
+    std::shared_ptr<MountImpl> unowned(std::shared_ptr<MountImpl>(),
+                                       mount.get());
+    in = mount->fopen(unowned, path);
+    if (in->status() != kOk) {
+      state.release(lease, nullptr);
+      return in;
+    }
+  }
+  return std::unique_ptr<MultipassInputStream>(new PooledInputStream(
+      state_, lease, std::move(mount), std::move(in)));
+}
+
+void FileHandlePool::evict(const MountImpl* mount, const char* path) {
+  auto removed = state_->removeIf(
+      [&](const State::Key& key) { return key.matches(mount, path); });
+  for (auto& in : removed) in->close();
+}
+
+void FileHandlePool::evictUnmounted() {
+  auto removed = state_->removeIf(
+      [](const State::Key& key) { return key.unmounted(); });
+  for (auto& in : removed) in->close();
+}
+
+void FileHandlePool::clear() {
+  auto removed = state_->removeIf([](const State::Key&) { return true; });
+  for (auto& in : removed) in->close();
+}
+
+}  // namespace roo_io
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <memory>
+
+#include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/fs/mount_impl.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Counters of a `FileHandlePool`.
+struct FileHandlePoolStats {
+  /// Number of opens served by rewinding an idle handle.
+  uint32_t hits = 0;
+
+  /// Number of opens that had to open the file.
+  uint32_t misses = 0;
+
+  /// Number of idle handles closed to make room for other files.
+  uint32_t evictions = 0;
+
+  /// Number of opens that had to wait for a handle to be released.
+  uint32_t waits = 0;
+
+  /// Number of opens that failed with `kTooManyFilesOpen`, because all
+  /// handles were in use.
+  uint32_t rejections = 0;
+
+  /// Returns the fraction of opens served from the pool.
+  float hitRate() const {
+    return hits + misses == 0 ? 0.0f : (float)hits / (hits + misses);
+  }
+};
+
+/// Bounded pool of open read-only file handles, shared by all mounts of a
+/// `Filesystem`.
+///
+/// Opening a file on FAT or SPIFFS walks the directory and allocates a
+/// descriptor, which takes a while; and ESP32 filesystems allow only
+/// `maxOpenFiles()` descriptors at a time. With the pool attached (see
+/// `Filesystem::setHandlePool()`), closing a stream returned by
+/// `Mount::fopen()` keeps the underlying file open, and the next `fopen()` of
+/// the same path rewinds and reuses it.
+///
+/// At most `maxOpenFiles()` handles, in use or idle, are open at a time. When
+/// a new file needs a handle, and the limit has been reached, the least
+/// recently used idle handle is closed. If all handles are in use, `fopen()`
+/// either fails with `kTooManyFilesOpen`, or waits for one to be released,
+/// depending on `waitIfExhausted()`.
+///
+/// Only reads are pooled; set the limit below the backend's, to leave room
+/// for files opened for writing, and for directories. Removing, renaming,
+/// truncating, or writing a file through a `Mount` closes its idle handles,
+/// and keeps the ones in use from being pooled again.
+///
+/// Idle handles do not keep the backend mounted: when the last `Mount` (and
+/// stream) of a filesystem goes away, the filesystem closes its idle handles
+/// before unmounting. The pool may thus be shared by several filesystems,
+/// and outlive them.
+///
+/// Thread-safe.
+///
+/// Example:
+///
+/// ```
+/// // The VFS allows 5 open files; keep one for writing.
+/// fs.setHandlePool(std::make_shared<FileHandlePool>(4));
+/// ```
+class FileHandlePool {
+ public:
+  /// Creates a pool holding up to `max_open_files` handles. If
+  /// `wait_if_exhausted` is true, opens block while all handles are in use;
+  /// otherwise, they fail immediately.
+  FileHandlePool(size_t max_open_files, bool wait_if_exhausted = false);
+
+  FileHandlePool(const FileHandlePool&) = delete;
+  FileHandlePool& operator=(const FileHandlePool&) = delete;
+
+  /// Closes the idle handles. Streams still in use stay valid, and close
+  /// their files when closed.
+  ~FileHandlePool();
+
+  /// Returns the maximum number of open handles.
+  size_t maxOpenFiles() const;
+
+  /// Returns whether opens wait while all handles are in use.
+  bool waitIfExhausted() const;
+
+  /// Returns the number of handles in use.
+  size_t inUseCount() const;
+
+  /// Returns the number of idle handles.
+  size_t idleCount() const;
+
+  /// Returns a snapshot of the counters.
+  FileHandlePoolStats stats() const;
+
+  /// Opens the file at `path` in `mount` for reading, reusing an idle handle
+  /// if there is one. The returned stream gives the handle back to the pool
+  /// when closed or destroyed. Fails with `kTooManyFilesOpen` if all handles
+  /// are in use (unless waiting).
+  std::unique_ptr<MultipassInputStream> fopen(std::shared_ptr<MountImpl> mount,
+                                              const char* path);
+
+  /// Closes the idle handles of the file at `path` in `mount` (or of all
+  /// its files, if `path` is null), and keeps the ones in use from returning
+  /// to the pool. Call before the file changes.
+  void evict(const MountImpl* mount, const char* path);
+
+  /// Closes the idle handles whose mount is gone. Called by `Filesystem`
+  /// before unmounting.
+  void evictUnmounted();
+
+  /// Closes all idle handles, and keeps the ones in use from returning to
+  /// the pool.
+  void clear();
+
+ private:
+  class State;
+  class PooledInputStream;
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace roo_io
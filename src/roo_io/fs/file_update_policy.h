@@ -7,6 +7,17 @@ enum FileUpdatePolicy {
   kFailIfExists = 0,
   kTruncateIfExists = 1,
   kAppendIfExists = 2,
+
+  /// Writes to a sibling temporary file (the target path with a ".tmp."
+  /// suffix and a unique number, so that concurrent writers do not collide),
+  /// and replaces the target with it when the stream is closed
+  /// successfully. Readers, and the file after a crash, see either the old
+  /// content or the complete new content, never a partial write. If the
+  /// stream fails, the target is left untouched.
+  ///
+  /// For crash safety across power loss, combine with a `SyncLevel` of at
+  /// least `kSyncData`.
+  kReplaceAtomically = 3,
 };
 
-}  // namespace roo_io
\ No newline at end of file
+}  // namespace roo_io
@@ -10,9 +10,12 @@ Mount Filesystem::mount() {
   bool read_only = (policy == kMountReadOnly);
   std::shared_ptr<MountImpl> existing = mount_.lock();
   if (existing != nullptr) {
-    return Mount(existing, read_only);
+    return Mount(existing, read_only, handle_pool_);
   }
-  MountImpl::MountResult mount_result = mountImpl([this]() { unmountImpl(); });
+  MountImpl::MountResult mount_result = mountImpl([this]() {
+    if (handle_pool_ != nullptr) handle_pool_->evictUnmounted();
+    unmountImpl();
+  });
   if (mount_result.status != kOk) {
     Status status = mount_result.status;
     if (status == kGenericMountError && checkMediaPresence() == kMediaAbsent) {
@@ -29,7 +32,7 @@ Mount Filesystem::mount() {
   if (unmounting_policy_ == kUnmountLazily) {
     lazy_unmount_ = impl;
   }
-  return Mount(impl, read_only);
+  return Mount(impl, read_only, handle_pool_);
 }
 
 void Filesystem::setUnmountingPolicy(UnmountingPolicy unmounting_policy) {
@@ -41,9 +44,18 @@ void Filesystem::setUnmountingPolicy(UnmountingPolicy unmounting_policy) {
   }
 }
 
+void Filesystem::setHandlePool(std::shared_ptr<FileHandlePool> pool) {
+  if (handle_pool_ != nullptr) {
+    auto m = mount_.lock();
+    if (m != nullptr) handle_pool_->evict(m.get(), nullptr);
+  }
+  handle_pool_ = std::move(pool);
+}
+
 void Filesystem::forceUnmount() {
   auto m = mount_.lock();
   if (m != nullptr) {
+    if (handle_pool_ != nullptr) handle_pool_->evict(m.get(), nullptr);
     m->deactivate();
   }
   mount_.reset();
@@ -3,6 +3,7 @@
 #include <memory>
 
 #include "roo_io/fs/directory.h"
+#include "roo_io/fs/file_handle_pool.h"
 #include "roo_io/fs/mount.h"
 #include "roo_io/fs/mount_impl.h"
 #include "roo_io/status.h"
@@ -115,6 +116,21 @@ class Filesystem {
   /// such as shutdown.
   void forceUnmount();
 
+  /// Makes `Mount::fopen()`, on mounts created from now on, take file handles
+  /// from `pool`, and give them back to it when the streams are closed, so
+  /// that reading the same files repeatedly (e.g. through `FileResource`)
+  /// does not pay the open cost each time. Pass null to stop pooling.
+  ///
+  /// Idle handles in the pool do not keep the backend mounted; they are
+  /// closed before it gets unmounted. Replacing the pool closes the idle
+  /// handles of this filesystem in the old one.
+  void setHandlePool(std::shared_ptr<FileHandlePool> pool);
+
+  /// Returns the handle pool, or null if there is none.
+  const std::shared_ptr<FileHandlePool>& handlePool() const {
+    return handle_pool_;
+  }
+
  protected:
   Filesystem()
       : mounting_policy_(kMountReadWrite),
@@ -133,6 +149,7 @@ class Filesystem {
 
   MountingPolicy mounting_policy_;
   UnmountingPolicy unmounting_policy_;
+  std::shared_ptr<FileHandlePool> handle_pool_;
 };
 
 /// Returns a pointer inside `path` positioned past the last `/` separator.
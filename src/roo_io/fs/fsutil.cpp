@@ -86,10 +86,10 @@ MultipassInputStreamReader OpenDataFile(roo_io::Mount& fs, const char* path) {
   return MultipassInputStreamReader(fs.fopen(path));
 }
 
-OutputStreamWriter OpenDataFileForWrite(
-    roo_io::Mount& fs, const char* path,
-    roo_io::FileUpdatePolicy update_policy) {
-  return OutputStreamWriter(fs.fopenForWrite(path, update_policy));
+OutputStreamWriter OpenDataFileForWrite(roo_io::Mount& fs, const char* path,
+                                        roo_io::FileUpdatePolicy update_policy,
+                                        roo_io::SyncLevel durability) {
+  return OutputStreamWriter(fs.fopenForWrite(path, update_policy, durability));
 }
 
 }  // namespace roo_io
\ No newline at end of file
@@ -38,9 +38,12 @@ MultipassInputStreamReader OpenDataFile(roo_io::Mount& fs, const char* path);
 
 /// Opens `path` for buffered typed writing using `update_policy`.
 ///
-/// The returned writer wraps `fs.fopenForWrite(path, update_policy)` directly
-/// and reports mount, permission, or open failures through the writer status.
-OutputStreamWriter OpenDataFileForWrite(roo_io::Mount& fs, const char* path,
-                                        roo_io::FileUpdatePolicy update_policy);
+/// The returned writer wraps `fs.fopenForWrite(path, update_policy,
+/// durability)` directly and reports mount, permission, or open failures
+/// through the writer status.
+OutputStreamWriter OpenDataFileForWrite(
+    roo_io::Mount& fs, const char* path,
+    roo_io::FileUpdatePolicy update_policy,
+    roo_io::SyncLevel durability = roo_io::kSyncNone);
 
 }  // namespace roo_io
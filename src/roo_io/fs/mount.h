@@ -1,11 +1,18 @@
 #pragma once
 
+#include <functional>
 #include <memory>
+#include <string>
 
 #include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/multipass_output_stream.h"
 #include "roo_io/core/output_stream.h"
+#include "roo_io/core/sync_level.h"
+#include "roo_io/fs/block_cache.h"
 #include "roo_io/fs/directory.h"
+#include "roo_io/fs/file_handle_pool.h"
 #include "roo_io/fs/mount_impl.h"
+#include "roo_io/fs/notifying_output_stream.h"
 #include "roo_io/fs/stat.h"
 
 namespace roo_io {
@@ -28,6 +35,9 @@ class Mount {
     mount_ = other.mount_;
     status_ = other.status_;
     read_only_ = other.read_only_;
+    cache_ = std::move(other.cache_);
+    cache_selector_ = std::move(other.cache_selector_);
+    handle_pool_ = std::move(other.handle_pool_);
     other.close();
   }
 
@@ -36,6 +46,9 @@ class Mount {
     mount_ = other.mount_;
     status_ = other.status_;
     read_only_ = other.read_only_;
+    cache_ = std::move(other.cache_);
+    cache_selector_ = std::move(other.cache_selector_);
+    handle_pool_ = std::move(other.handle_pool_);
     other.close();
     return *this;
   }
@@ -94,9 +107,12 @@ class Mount {
   /// - A copy of `status()` such as `kNotMounted` or `kNoMedia`, if the mount
   ///   is not healthy.
   Status remove(const char* path) {
-    return status_ != kOk ? status_
-           : read_only_   ? kReadOnlyFilesystem
-                          : mount_->remove(path);
+    if (status_ != kOk) return status_;
+    if (read_only_) return kReadOnlyFilesystem;
+    closeHandles(path);
+    Status status = mount_->remove(path);
+    invalidate(path);
+    return status;
   }
 
   /// Renames or moves an existing file or directory.
@@ -117,9 +133,43 @@ class Mount {
   /// - A copy of `status()` such as `kNotMounted` or `kNoMedia`, if the mount
   ///   is not healthy.
   Status rename(const char* pathFrom, const char* pathTo) {
-    return status_ != kOk ? status_
-           : read_only_   ? kReadOnlyFilesystem
-                          : mount_->rename(pathFrom, pathTo);
+    if (status_ != kOk) return status_;
+    if (read_only_) return kReadOnlyFilesystem;
+    closeHandles(pathFrom);
+    closeHandles(pathTo);
+    Status status = mount_->rename(pathFrom, pathTo);
+    invalidate(pathFrom);
+    invalidate(pathTo);
+    return status;
+  }
+
+  /// Sets the size of the existing file at `path` to `size` bytes.
+  ///
+  /// If the file is larger, it is cut; if it is smaller, it is extended with
+  /// zeros. On backends without native support (Arduino), shrinking rewrites
+  /// the file, and extending appends zeros.
+  ///
+  /// Returns one of:
+  /// - `kOk`, if the file was successfully resized.
+  /// - `kInvalidPath`, if `path` is syntactically invalid.
+  /// - `kNotFound`, if the target path, or any intermediate component, does
+  ///   not exist.
+  /// - `kNotFile`, if the target exists but is not a file.
+  /// - `kNotDirectory`, or permissibly `kNotFound`, if an intermediate path
+  ///   component exists but is not a directory.
+  /// - `kAccessDenied`, if permissions are insufficient.
+  /// - `kReadOnlyFilesystem`, if the mount is read-only.
+  /// - `kOutOfMemory`, `kNoSpaceLeftOnDevice`, or `kUnknownIOError`, if the
+  ///   backend reports that failure.
+  /// - A copy of `status()` such as `kNotMounted` or `kNoMedia`, if the mount
+  ///   is not healthy.
+  Status truncate(const char* path, uint64_t size) {
+    if (status_ != kOk) return status_;
+    if (read_only_) return kReadOnlyFilesystem;
+    closeHandles(path);
+    Status status = mount_->truncate(path, size);
+    invalidate(path);
+    return status;
   }
 
   /// Creates the directory at `path`.
@@ -200,8 +250,24 @@ class Mount {
   ///   `kUnknownIOError`, if the backend reports that failure.
   /// - A copy of `status()` such as `kNotMounted` or `kNoMedia`, if the mount
   ///   is not healthy.
+  ///
+  /// If a block cache is set, and selects `path`, the stream reads through
+  /// it; see `setBlockCache()`. If the filesystem has a handle pool, the
+  /// file handle comes from it, and returns to it when the stream is closed;
+  /// see `Filesystem::setHandlePool()`.
   std::unique_ptr<MultipassInputStream> fopen(const char* path) {
-    return status_ != kOk ? InputError(status_) : mount_->fopen(mount_, path);
+    if (status_ != kOk) return InputError(status_);
+    std::unique_ptr<MultipassInputStream> in =
+        handle_pool_ != nullptr ? handle_pool_->fopen(mount_, path)
+                                : mount_->fopen(mount_, path);
+    if (cache_ == nullptr || in->status() != kOk ||
+        (cache_selector_ != nullptr && !cache_selector_(path)) ||
+        cache_->isBeingWritten(mount_->id(), path)) {
+      return in;
+    }
+    return std::unique_ptr<MultipassInputStream>(
+        new CachedMultipassInputStream(std::move(in), cache_,
+                                       cache_->fileId(mount_->id(), path)));
   }
 
   /// Opens the file at `path` for writing using `update_policy`.
@@ -209,6 +275,13 @@ class Mount {
   /// The file is created if it does not already exist. If it does exist, the
   /// behavior is controlled by `update_policy`.
   ///
+  /// `durability` controls how far the data is synced to stable storage when
+  /// the stream is closed. With `kReplaceAtomically`, the data is synced
+  /// before the target is replaced, so that `kSyncData` or higher makes the
+  /// update crash-safe; with `kSyncDataAndDirectory`, the replacement itself
+  /// is durable when `close()` returns. Backends sync as much as the
+  /// underlying filesystem allows.
+  ///
   /// The returned output stream is in one of these states:
   /// - `kOk`, if the file was successfully opened.
   /// - `kInvalidPath`, if `path` is syntactically invalid.
@@ -223,13 +296,75 @@ class Mount {
   ///   backend reports that failure.
   /// - A copy of `status()` such as `kNotMounted` or `kNoMedia`, if the mount
   ///   is not healthy.
-  std::unique_ptr<OutputStream> fopenForWrite(const char* path,
-                                              FileUpdatePolicy update_policy) {
-    return status_ != kOk ? OutputError(status_)
-           : read_only_   ? OutputError(kReadOnlyFilesystem)
-                          : mount_->fopenForWrite(mount_, path, update_policy);
+  std::unique_ptr<OutputStream> fopenForWrite(
+      const char* path, FileUpdatePolicy update_policy,
+      SyncLevel durability = kSyncNone) {
+    if (status_ != kOk) return OutputError(status_);
+    if (read_only_) return OutputError(kReadOnlyFilesystem);
+    closeHandles(path);
+    if (cache_ == nullptr && handle_pool_ == nullptr) {
+      return mount_->fopenForWrite(mount_, path, update_policy, durability);
+    }
+    if (cache_ != nullptr) cache_->beginWrite(mount_->id(), path);
+    std::unique_ptr<OutputStream> out =
+        mount_->fopenForWrite(mount_, path, update_policy, durability);
+    return std::unique_ptr<OutputStream>(new internal::NotifyingOutputStream(
+        std::move(out), endWriteFn(path)));
+  }
+
+  /// Opens the file at `path` for writing with a seekable write cursor.
+  ///
+  /// Use it to write formats with headers that are only known after the body
+  /// has been written: reserve the header, stream the body, then `seek()`
+  /// back and patch the header in place.
+  ///
+  /// The file is created if it does not already exist. If it does exist, the
+  /// behavior is controlled by `update_policy`; with `kAppendIfExists`, the
+  /// existing content is retained and the stream is positioned at its end,
+  /// but (unlike with `fopenForWrite()`) it can be overwritten after seeking
+  /// back.
+  ///
+  /// `durability`, and the returned stream states, are as for
+  /// `fopenForWrite()`.
+  std::unique_ptr<MultipassOutputStream> fopenForRandomWrite(
+      const char* path, FileUpdatePolicy update_policy,
+      SyncLevel durability = kSyncNone) {
+    if (status_ != kOk) return MultipassOutputError(status_);
+    if (read_only_) return MultipassOutputError(kReadOnlyFilesystem);
+    closeHandles(path);
+    if (cache_ == nullptr && handle_pool_ == nullptr) {
+      return mount_->fopenForRandomWrite(mount_, path, update_policy,
+                                         durability);
+    }
+    if (cache_ != nullptr) cache_->beginWrite(mount_->id(), path);
+    std::unique_ptr<MultipassOutputStream> out = mount_->fopenForRandomWrite(
+        mount_, path, update_policy, durability);
+    return std::unique_ptr<MultipassOutputStream>(
+        new internal::NotifyingMultipassOutputStream(std::move(out),
+                                                     endWriteFn(path)));
   }
 
+  /// Makes `fopen()` read the files selected by `selector` (or all files, if
+  /// `selector` is null) through `cache`, so that blocks read repeatedly,
+  /// such as the index blocks of a table, stay in memory. Pass a null `cache`
+  /// to stop caching.
+  ///
+  /// The cache may be shared by several mounts. Removing, renaming, or
+  /// truncating a file through this handle invalidates its cached blocks;
+  /// so do opening it for writing, and closing the stream. While the stream
+  /// is open, the file is read without the cache. The cache does not notice
+  /// other changes (made through other handles); call
+  /// `BlockCache::invalidate()` with `cacheKey()` after making them. Streams
+  /// opened before a change may keep seeing the old contents.
+  void setBlockCache(std::shared_ptr<BlockCache> cache,
+                     std::function<bool(const char* path)> selector = nullptr) {
+    cache_ = std::move(cache);
+    cache_selector_ = std::move(selector);
+  }
+
+  /// Returns the value identifying this mount in a `BlockCache`.
+  uint64_t cacheKey() const { return mount_ == nullptr ? 0 : mount_->id(); }
+
   /// Returns whether the mount is known to be read-only.
   bool isReadOnly() const { return read_only_; }
 
@@ -249,12 +384,45 @@ class Mount {
 
   Mount(Status error) : mount_(nullptr), status_(error), read_only_(false) {}
 
-  Mount(std::shared_ptr<MountImpl> impl, bool read_only)
-      : mount_(impl), status_(kOk), read_only_(read_only) {}
+  Mount(std::shared_ptr<MountImpl> impl, bool read_only,
+        std::shared_ptr<FileHandlePool> handle_pool)
+      : mount_(impl),
+        status_(kOk),
+        read_only_(read_only),
+        handle_pool_(std::move(handle_pool)) {}
+
+  // Forgets the cached blocks of the file at `path`.
+  void invalidate(const char* path) {
+    if (cache_ != nullptr) cache_->invalidate(mount_->id(), path);
+  }
+
+  // Returns the function to call when the stream writing the file at `path`
+  // gets closed. It ends the cache write, and closes the pooled handles
+  // opened meanwhile (which may still see the old file, if it got replaced).
+  std::function<void()> endWriteFn(const char* path) {
+    std::shared_ptr<BlockCache> cache = cache_;
+    std::shared_ptr<FileHandlePool> pool = handle_pool_;
+    const MountImpl* mount = mount_.get();
+    uint64_t key = mount_->id();
+    std::string p = path;
+    return [cache, pool, mount, key, p]() {
+      if (pool != nullptr) pool->evict(mount, p.c_str());
+      if (cache != nullptr) cache->endWrite(key, p.c_str());
+    };
+  }
+
+  // Closes the pooled handles of the file at `path`, before it changes. (Some
+  // filesystems, e.g. FAT, cannot remove or rename open files.)
+  void closeHandles(const char* path) {
+    if (handle_pool_ != nullptr) handle_pool_->evict(mount_.get(), path);
+  }
 
   std::shared_ptr<MountImpl> mount_;
   mutable Status status_;
   bool read_only_;
+  std::shared_ptr<BlockCache> cache_;
+  std::function<bool(const char* path)> cache_selector_;
+  std::shared_ptr<FileHandlePool> handle_pool_;
 };
 
 }  // namespace roo_io
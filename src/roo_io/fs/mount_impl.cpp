@@ -1,10 +1,18 @@
 #include "roo_io/fs/mount_impl.h"
 
+#include <atomic>
+
 #include "roo_io/core/null_input_stream.h"
 #include "roo_io/core/null_output_stream.h"
 
 namespace roo_io {
 
+MountImpl::MountImpl(std::function<void()> unmount_fn)
+    : unmount_fn_(unmount_fn) {
+  static std::atomic<uint64_t> next_id(1);
+  id_ = next_id++;
+}
+
 MountImpl::MountResult MountImpl::Mounted(
     std::unique_ptr<MountImpl> mount_impl) {
   return MountImpl::MountResult{.status = kOk, .mount = std::move(mount_impl)};
@@ -46,4 +54,8 @@ std::unique_ptr<OutputStream> OutputError(Status error) {
   return std::unique_ptr<OutputStream>(new NullOutputStream(error));
 }
 
+std::unique_ptr<MultipassOutputStream> MultipassOutputError(Status error) {
+  return std::unique_ptr<MultipassOutputStream>(new NullOutputStream(error));
+}
+
 }  // namespace roo_io
\ No newline at end of file
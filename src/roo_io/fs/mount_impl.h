@@ -4,7 +4,9 @@
 #include <memory>
 
 #include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/multipass_output_stream.h"
 #include "roo_io/core/output_stream.h"
+#include "roo_io/core/sync_level.h"
 #include "roo_io/fs/directory_impl.h"
 #include "roo_io/fs/file_update_policy.h"
 #include "roo_io/fs/stat.h"
@@ -39,6 +41,8 @@ class MountImpl {
 
   virtual Status rename(const char* pathFrom, const char* pathTo) = 0;
 
+  virtual Status truncate(const char* path, uint64_t size) = 0;
+
   // Can return 'kOk', 'kNotMounted', 'kDirectoryExists', 'kInvalidPath',
   // 'kInvalidType', 'kOutOfMemory', 'kUnknownIOError'.
   virtual Status mkdir(const char* path) = 0;
@@ -53,7 +57,15 @@ class MountImpl {
 
   virtual std::unique_ptr<OutputStream> fopenForWrite(
       std::shared_ptr<MountImpl> mount, const char* path,
-      FileUpdatePolicy update_policy) = 0;
+      FileUpdatePolicy update_policy, SyncLevel durability) = 0;
+
+  virtual std::unique_ptr<MultipassOutputStream> fopenForRandomWrite(
+      std::shared_ptr<MountImpl> mount, const char* path,
+      FileUpdatePolicy update_policy, SyncLevel durability) = 0;
+
+  /// Returns the number identifying this mount. Never reused, unlike the
+  /// address of the object: a remount gets a new one.
+  uint64_t id() const { return id_; }
 
   virtual bool active() const = 0;
 
@@ -62,15 +74,17 @@ class MountImpl {
   virtual void deactivate() = 0;
 
  protected:
-  MountImpl(std::function<void()> unmount_fn) : unmount_fn_(unmount_fn) {}
+  MountImpl(std::function<void()> unmount_fn);
 
  private:
   std::function<void()> unmount_fn_;
+  uint64_t id_;
 };
 
 // Helper functions.
 std::unique_ptr<DirectoryImpl> DirectoryError(Status error);
 std::unique_ptr<MultipassInputStream> InputError(Status error);
 std::unique_ptr<OutputStream> OutputError(Status error);
+std::unique_ptr<MultipassOutputStream> MultipassOutputError(Status error);
 
 }  // namespace roo_io
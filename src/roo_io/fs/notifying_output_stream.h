@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "roo_io/core/multipass_output_stream.h"
+#include "roo_io/core/output_stream.h"
+
+namespace roo_io {
+namespace internal {
+
+// Output stream decorator that calls a function once the underlying stream
+// gets closed (or the decorator destroyed). Used by `Mount` to learn when a
+// file has been written.
+template <typename Base>
+class NotifyingOutputStreamBase : public Base {
+ public:
+  NotifyingOutputStreamBase(std::unique_ptr<Base> out,
+                            std::function<void()> on_close)
+      : out_(std::move(out)), on_close_(std::move(on_close)) {}
+
+  ~NotifyingOutputStreamBase() override { close(); }
+
+  size_t write(const byte* buf, size_t count) override {
+    return out_->write(buf, count);
+  }
+
+  size_t tryWrite(const byte* buf, size_t count) override {
+    return out_->tryWrite(buf, count);
+  }
+
+  size_t writeFully(const byte* buf, size_t count) override {
+    return out_->writeFully(buf, count);
+  }
+
+  void flush() override { out_->flush(); }
+
+  void sync(SyncLevel level) override { out_->sync(level); }
+
+  void preallocate(uint64_t bytes) override { out_->preallocate(bytes); }
+
+  void close() override {
+    out_->close();
+    if (on_close_ != nullptr) {
+      std::function<void()> on_close = std::move(on_close_);
+      on_close_ = nullptr;
+      on_close();
+    }
+  }
+
+  Status status() const override { return out_->status(); }
+
+ protected:
+  std::unique_ptr<Base> out_;
+
+ private:
+  std::function<void()> on_close_;
+};
+
+using NotifyingOutputStream = NotifyingOutputStreamBase<OutputStream>;
+
+class NotifyingMultipassOutputStream
+    : public NotifyingOutputStreamBase<MultipassOutputStream> {
+ public:
+  using NotifyingOutputStreamBase::NotifyingOutputStreamBase;
+
+  uint64_t size() override { return out_->size(); }
+
+  uint64_t position() const override { return out_->position(); }
+
+  void seek(uint64_t offset) override { out_->seek(offset); }
+};
+
+}  // namespace internal
+}  // namespace roo_io
@@ -8,4 +8,14 @@
 #define ROO_IO_FS_SUPPORT_POSIX 0 
 #endif
 
-#endif
\ No newline at end of file
+#endif
+
+// Refill sizes of POSIX file input streams. Reads start at the minimum, and
+// double while they are sequential, up to the maximum; see `ReadAhead`.
+#ifndef ROO_IO_POSIX_FILE_READ_AHEAD_MIN
+#define ROO_IO_POSIX_FILE_READ_AHEAD_MIN 512
+#endif
+
+#ifndef ROO_IO_POSIX_FILE_READ_AHEAD_MAX
+#define ROO_IO_POSIX_FILE_READ_AHEAD_MAX 4096
+#endif
@@ -4,26 +4,75 @@
 
 #include "roo_io/fs/posix/posix_file_input_stream.h"
 
+#include <string.h>
 #include <sys/stat.h>
 
 namespace roo_io {
 
 PosixFileInputStream::PosixFileInputStream(Status error)
-    : file_(nullptr), status_(error) {}
+    : file_(nullptr),
+      file_pos_(0),
+      read_ahead_(ROO_IO_POSIX_FILE_READ_AHEAD_MIN,
+                  ROO_IO_POSIX_FILE_READ_AHEAD_MAX),
+      allocated_(0),
+      offset_(0),
+      length_(0),
+      status_(error) {}
 
 PosixFileInputStream::PosixFileInputStream(std::shared_ptr<MountImpl> mount,
                                            FILE* file)
     : mount_(std::move(mount)),
       file_(file),
-      status_(file_ != nullptr ? kOk : kClosed) {}
+      file_pos_(0),
+      read_ahead_(ROO_IO_POSIX_FILE_READ_AHEAD_MIN,
+                  ROO_IO_POSIX_FILE_READ_AHEAD_MAX),
+      allocated_(0),
+      offset_(0),
+      length_(0),
+      status_(file_ != nullptr ? kOk : kClosed) {
+  // We buffer ourselves.
+  if (file_ != nullptr) setvbuf(file_, nullptr, _IONBF, 0);
+}
 
 PosixFileInputStream::~PosixFileInputStream() {
   if (file_ != nullptr) ::fclose(file_);
 }
 
 size_t PosixFileInputStream::read(byte* buf, size_t count) {
-  if (status_ != kOk) return 0;
-  int result = fread(buf, 1, count, file_);
+  if (offset_ < length_) {
+    size_t available = length_ - offset_;
+    if (count > available) count = available;
+    memcpy(buf, &buffer_[offset_], count);
+    offset_ += count;
+    return count;
+  }
+  if (status_ != kOk || count == 0) return 0;
+  offset_ = 0;
+  length_ = 0;
+  if (count >= read_ahead_.maxSize()) {
+    // Large read; skip buffering.
+    size_t result = readFile(buf, count);
+    read_ahead_.advance(file_pos_);
+    return result;
+  }
+  size_t size = read_ahead_.next(file_pos_);
+  if (size > allocated_) {
+    buffer_.reset(new byte[size]);
+    allocated_ = size;
+  }
+  size_t result = readFile(buffer_.get(), size);
+  read_ahead_.advance(file_pos_);
+  if (result == 0) return 0;
+  length_ = result;
+  if (count > result) count = result;
+  memcpy(buf, buffer_.get(), count);
+  offset_ = count;
+  return count;
+}
+
+size_t PosixFileInputStream::readFile(byte* buf, size_t count) {
+  size_t result = fread(buf, 1, count, file_);
+  file_pos_ += result;
   if (result > 0) return result;
   if (ferror(file_) != 0) {
     switch (errno) {
@@ -48,7 +97,16 @@ size_t PosixFileInputStream::read(byte* buf, size_t count) {
 
 void PosixFileInputStream::seek(uint64_t offset) {
   if (status_ != kOk && status_ != kEndOfStream) return;
+  if (offset <= file_pos_ && offset + length_ >= file_pos_) {
+    // Within the buffer.
+    offset_ = offset + length_ - file_pos_;
+    status_ = kOk;
+    return;
+  }
+  offset_ = 0;
+  length_ = 0;
   if (::fseek(file_, offset, SEEK_SET) == 0) {
+    file_pos_ = offset;
     status_ = kOk;
     return;
   }
@@ -67,8 +125,16 @@ void PosixFileInputStream::seek(uint64_t offset) {
 
 void PosixFileInputStream::skip(uint64_t count) {
   if (status_ != kOk) return;
-  if (::fseek(file_, count, SEEK_CUR) == 0) {
-    if (position() > size()) status_ = kEndOfStream;
+  if (count < length_ - offset_) {
+    offset_ += count;
+    return;
+  }
+  uint64_t target = position() + count;
+  offset_ = 0;
+  length_ = 0;
+  if (::fseek(file_, target, SEEK_SET) == 0) {
+    file_pos_ = target;
+    if (target > size()) status_ = kEndOfStream;
     return;
   }
   switch (errno) {
@@ -102,6 +168,10 @@ bool PosixFileInputStream::isOpen() const {
 
 void PosixFileInputStream::close() {
   mount_.reset();
+  buffer_ = nullptr;
+  allocated_ = 0;
+  offset_ = 0;
+  length_ = 0;
   if (status_ != kOk && status_ != kEndOfStream) return;
   if (::fclose(file_) == 0) {
     status_ = kClosed;
@@ -9,11 +9,19 @@
 #include <memory>
 
 #include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/read_ahead.h"
 #include "roo_io/fs/mount_impl.h"
 
 namespace roo_io {
 
 /// Multipass input stream wrapper around a POSIX `FILE*`.
+///
+/// Bypasses the stdio buffer, whose fixed size is often small (e.g. 128
+/// bytes on ESP-IDF), and buffers reads itself, with sizes adapted to the
+/// access pattern: from `ROO_IO_POSIX_FILE_READ_AHEAD_MIN` bytes after each
+/// seek, doubling while reads are sequential, up to
+/// `ROO_IO_POSIX_FILE_READ_AHEAD_MAX` bytes. Seeks within the buffered bytes
+/// do not touch the file.
 class PosixFileInputStream : public MultipassInputStream {
  public:
   /// Creates a detached stream that reports `error` from `status()`.
@@ -34,8 +42,8 @@ class PosixFileInputStream : public MultipassInputStream {
   /// Skips forward by `count` bytes.
   void skip(uint64_t count) override;
 
-  /// Returns the current file offset.
-  uint64_t position() const override { return (::ftell(file_)); }
+  /// Returns the current read offset.
+  uint64_t position() const override { return file_pos_ - length_ + offset_; }
 
   /// Returns the total file size.
   uint64_t size() override;
@@ -49,9 +57,26 @@ class PosixFileInputStream : public MultipassInputStream {
   /// Returns the current stream status.
   Status status() const override { return status_; }
 
+  /// Returns the statistics of the chosen read sizes.
+  const ReadAheadStats& readAheadStats() const { return read_ahead_.stats(); }
+
  private:
+  // Reads up to `count` bytes from the file, at `file_pos_`, advancing it.
+  // Updates status on failure or end of file.
+  size_t readFile(byte* buf, size_t count);
+
   std::shared_ptr<MountImpl> mount_;
   FILE* file_;
+
+  // Offset of the file handle.
+  uint64_t file_pos_;
+  ReadAhead read_ahead_;
+  std::unique_ptr<byte[]> buffer_;
+  size_t allocated_;
+
+  // Buffered bytes end at `file_pos_`.
+  size_t offset_;
+  size_t length_;
   mutable Status status_;
 };
 
@@ -4,24 +4,101 @@
 
 #include "roo_io/fs/posix/posix_file_output_stream.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
 namespace roo_io {
 
+namespace {
+
+Status SyncFile(int fd, SyncLevel level) {
+#if defined(__linux__)
+  int result = (level == kSyncData) ? ::fdatasync(fd) : ::fsync(fd);
+#else
+  int result = ::fsync(fd);
+#endif
+  if (result == 0) return kOk;
+  switch (errno) {
+    case ENOSPC:
+      return kNoSpaceLeftOnDevice;
+    case EINVAL:
+      // Syncing not supported by the filesystem.
+      return kOk;
+    default:
+      return kUnknownIOError;
+  }
+}
+
+// Makes the directory entry of `path` durable. Best effort: not all
+// filesystems (e.g. ESP32 VFS ones) can open directories as files; they
+// typically commit directory updates synchronously.
+Status SyncParentDirectory(const char* path) {
+  const char* slash = strrchr(path, '/');
+  if (slash == nullptr) return kOk;
+  size_t len = (slash == path) ? 1 : slash - path;
+  std::unique_ptr<char[]> dir(new char[len + 1]);
+  memcpy(dir.get(), path, len);
+  dir[len] = 0;
+  int fd = ::open(dir.get(), O_RDONLY);
+  if (fd < 0) return kOk;
+  Status status = kOk;
+  if (::fsync(fd) != 0 && errno != EINVAL) status = kUnknownIOError;
+  ::close(fd);
+  return status;
+}
+
+}  // namespace
+
 PosixFileOutputStream::PosixFileOutputStream(Status error)
-    : file_(nullptr), size_(-1), status_(error) {}
+    : file_(nullptr),
+      size_(-1),
+      status_(error),
+      durability_(kSyncNone),
+      extent_(-1) {}
 
 PosixFileOutputStream::PosixFileOutputStream(std::shared_ptr<MountImpl> mount,
                                              FILE* file)
+    : PosixFileOutputStream(std::move(mount), file, kSyncNone, nullptr) {}
+
+PosixFileOutputStream::PosixFileOutputStream(
+    std::shared_ptr<MountImpl> mount, FILE* file, SyncLevel durability,
+    std::unique_ptr<char[]> path, std::unique_ptr<char[]> replace_target)
     : mount_(std::move(mount)),
       file_(file),
       size_(-1),
-      status_(file_ != nullptr ? kOk : kClosed) {}
+      status_(file_ != nullptr ? kOk : kClosed),
+      durability_(durability),
+      extent_(-1),
+      path_(std::move(path)),
+      replace_target_(std::move(replace_target)) {}
 
-PosixFileOutputStream::~PosixFileOutputStream() { ::fclose(file_); }
+PosixFileOutputStream::~PosixFileOutputStream() {
+  discardTemporary();
+  if (file_ != nullptr) ::fclose(file_);
+}
+
+void PosixFileOutputStream::discardTemporary() {
+  if (replace_target_ == nullptr) return;
+  if (file_ != nullptr) {
+    ::fclose(file_);
+    file_ = nullptr;
+  }
+  ::unlink(path_.get());
+  replace_target_ = nullptr;
+}
 
 size_t PosixFileOutputStream::write(const byte* buf, size_t count) {
   if (status_ != kOk) return 0;
   size_t result = ::fwrite(buf, 1, count, file_);
-  if (result == count) return result;
+  if (result == count) {
+    if (extent_ >= 0) {
+      int64_t pos = ::ftello(file_);
+      if (pos > extent_) extent_ = pos;
+    }
+    return result;
+  }
   if (ferror(file_)) {
     mount_.reset();
     switch (errno) {
@@ -43,20 +120,146 @@ size_t PosixFileOutputStream::write(const byte* buf, size_t count) {
   return result;
 }
 
-void PosixFileOutputStream::close() {
-  mount_.reset();
-  if (status_ != kOk && status_ != kEndOfStream) return;
-  if (::fclose(file_) == 0) {
-    status_ = kClosed;
-    return;
+uint64_t PosixFileOutputStream::size() {
+  if (status_ != kOk) return 0;
+  if (extent_ >= 0) return extent_;
+  struct stat st;
+  if (::fflush(file_) != 0 || ::fstat(fileno(file_), &st) != 0) {
+    status_ = (errno == ENOSPC) ? kNoSpaceLeftOnDevice : kUnknownIOError;
+    mount_.reset();
+    return 0;
   }
+  return st.st_size;
+}
+
+void PosixFileOutputStream::seek(uint64_t offset) {
+  if (status_ != kOk) return;
+  if (::fseek(file_, offset, SEEK_SET) == 0) return;
   switch (errno) {
+    case EFBIG:
+    case EINVAL:
+    case EOVERFLOW:
+      status_ = kSeekError;
+      break;
     case ENOSPC:
       status_ = kNoSpaceLeftOnDevice;
       break;
     default:
       status_ = kUnknownIOError;
+      break;
+  }
+  mount_.reset();
+}
+
+void PosixFileOutputStream::flush() {
+  if (status_ != kOk) return;
+  if (::fflush(file_) != 0) {
+    status_ = (errno == ENOSPC) ? kNoSpaceLeftOnDevice : kUnknownIOError;
+    mount_.reset();
+  }
+}
+
+void PosixFileOutputStream::sync(SyncLevel level) {
+  flush();
+  if (status_ != kOk || level == kSyncNone) return;
+  Status status = SyncFile(fileno(file_), level);
+  if (status == kOk && level == kSyncDataAndDirectory && path_ != nullptr) {
+    status = SyncParentDirectory(path_.get());
+  }
+  if (status != kOk) {
+    status_ = status;
+    mount_.reset();
+  }
+}
+
+void PosixFileOutputStream::preallocate(uint64_t bytes) {
+  if (status_ != kOk || bytes == 0) return;
+  if (::fflush(file_) != 0) return;
+  int fd = fileno(file_);
+  off_t pos = ::ftello(file_);
+  if (pos < 0) return;
+#if defined(__linux__)
+  // Reserves the blocks without changing the file size.
+  if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, pos, bytes) == 0) return;
+#endif
+  // Otherwise (notably, on ESP32 VFS), pre-extend the file, and cut it back to
+  // the written extent on close. Not possible in append mode, where writes
+  // would land past the extension.
+  if ((::fcntl(fd, F_GETFL) & O_APPEND) != 0) return;
+  struct stat st;
+  if (::fstat(fd, &st) != 0) return;
+  if ((uint64_t)pos + bytes <= (uint64_t)st.st_size) return;
+  int64_t previous_extent = extent_;
+  if (extent_ < 0) extent_ = st.st_size;
+  if (::ftruncate(fd, pos + bytes) != 0) extent_ = previous_extent;
+}
+
+Status PosixFileOutputStream::trimPreallocated() {
+  if (extent_ < 0) return kOk;
+  int64_t extent = extent_;
+  extent_ = -1;
+  if (::fflush(file_) != 0 || ::ftruncate(fileno(file_), extent) != 0) {
+    return (errno == ENOSPC) ? kNoSpaceLeftOnDevice : kUnknownIOError;
+  }
+  return kOk;
+}
+
+void PosixFileOutputStream::close() {
+  mount_.reset();
+  if (status_ != kOk && status_ != kEndOfStream) {
+    if (file_ != nullptr) trimPreallocated();
+    discardTemporary();
+    return;
+  }
+  Status status = trimPreallocated();
+  if (status == kOk && durability_ != kSyncNone) {
+    if (::fflush(file_) != 0) {
+      status = (errno == ENOSPC) ? kNoSpaceLeftOnDevice : kUnknownIOError;
+    } else {
+      status = SyncFile(fileno(file_), durability_);
+    }
+  }
+  int result = ::fclose(file_);
+  file_ = nullptr;
+  if (result != 0 && status == kOk) {
+    status = (errno == ENOSPC) ? kNoSpaceLeftOnDevice : kUnknownIOError;
+  }
+  if (status != kOk) {
+    status_ = status;
+    discardTemporary();
+    return;
+  }
+  const char* final_path = path_.get();
+  if (replace_target_ != nullptr) {
+    // Atomic on POSIX filesystems. Some (e.g. FAT) refuse to replace an
+    // existing file (with EEXIST); fall back to removing it first.
+    if (::rename(path_.get(), replace_target_.get()) != 0) {
+      if (errno != EEXIST) {
+        // The target is intact.
+        status_ = (errno == ENOSPC) ? kNoSpaceLeftOnDevice : kUnknownIOError;
+        discardTemporary();
+        return;
+      }
+      if (::unlink(replace_target_.get()) != 0) {
+        // The target is intact.
+        status_ = kUnknownIOError;
+        discardTemporary();
+        return;
+      }
+      if (::rename(path_.get(), replace_target_.get()) != 0) {
+        // Keep the temporary file; it holds the only copy of the data.
+        status_ = kUnknownIOError;
+        replace_target_ = nullptr;
+        return;
+      }
+    }
+    final_path = replace_target_.get();
+  }
+  if (durability_ == kSyncDataAndDirectory && final_path != nullptr) {
+    status = SyncParentDirectory(final_path);
   }
+  replace_target_ = nullptr;
+  status_ = (status == kOk) ? kClosed : status;
 }
 
 }  // namespace roo_io
@@ -7,13 +7,19 @@
 #include <stdio.h>
 #include <sys/stat.h>
 
-#include "roo_io/core/output_stream.h"
+#include <memory>
+
+#include "roo_io/core/multipass_output_stream.h"
+#include "roo_io/core/sync_level.h"
 #include "roo_io/fs/filesystem.h"
 
 namespace roo_io {
 
 /// Output stream wrapper around a POSIX `FILE*`.
-class PosixFileOutputStream : public OutputStream {
+///
+/// Seeking is only meaningful for files not opened in append mode, i.e. those
+/// opened with `Mount::fopenForRandomWrite()`.
+class PosixFileOutputStream : public MultipassOutputStream {
  public:
   /// Creates a detached stream that reports `error` from `status()`.
   PosixFileOutputStream(Status error);
@@ -21,23 +27,78 @@ class PosixFileOutputStream : public OutputStream {
   /// Wraps an already open POSIX file handle and retains the mount while open.
   PosixFileOutputStream(std::shared_ptr<MountImpl> mount, FILE* file);
 
+  /// Wraps an already open POSIX file handle, and syncs it on `close()` per
+  /// `durability`. `path` is the full path of the file; it is needed for
+  /// `kSyncDataAndDirectory`, and may otherwise be null.
+  ///
+  /// If `replace_target` is not null, `file` is a temporary file at `path`,
+  /// which, when the stream is closed successfully, is renamed to
+  /// `replace_target`, and otherwise removed.
+  PosixFileOutputStream(std::shared_ptr<MountImpl> mount, FILE* file,
+                        SyncLevel durability, std::unique_ptr<char[]> path,
+                        std::unique_ptr<char[]> replace_target = nullptr);
+
   /// Closes the file if needed.
   ~PosixFileOutputStream();
 
   /// Writes up to `count` bytes to the file.
   size_t write(const byte* buf, size_t count) override;
 
-  /// Closes the file and releases any retained mount reference.
+  /// Returns the file size, including buffered data.
+  uint64_t size() override;
+
+  /// Returns the current file offset.
+  uint64_t position() const override {
+    return file_ == nullptr ? 0 : ::ftell(file_);
+  }
+
+  /// Seeks to `offset` in the file.
+  void seek(uint64_t offset) override;
+
+  /// Reserves space for `bytes` more bytes past the current position. Uses
+  /// `fallocate()` on Linux. Elsewhere, extends the file with `ftruncate()`,
+  /// and cuts it back to the written extent on `close()`; until then (and
+  /// after a crash), the file appears to others padded with zeros. Files
+  /// opened in append mode are never extended, since their writes would land
+  /// past the padding; for them, only `fallocate()` is used.
+  void preallocate(uint64_t bytes) override;
+
+  /// Flushes libc buffers to the OS.
+  void flush() override;
+
+  /// Flushes, and then syncs the file with `fdatasync()` (for `kSyncData`,
+  /// where available) or `fsync()`. For `kSyncDataAndDirectory`, also syncs
+  /// the parent directory, where the filesystem allows opening it (ESP32 VFS
+  /// filesystems do not).
+  void sync(SyncLevel level) override;
+
+  /// Flushes, syncs per the requested durability, and closes the file (and
+  /// if it is a temporary file, renames it over its target). Releases any
+  /// retained mount reference.
   void close() override;
 
   /// Returns the current stream status.
   Status status() const override { return status_; }
 
  private:
+  // Closes and removes the temporary file, if any, leaving the target intact.
+  void discardTemporary();
+
+  // Cuts a pre-extended file back to the written extent.
+  Status trimPreallocated();
+
   std::shared_ptr<MountImpl> mount_;
   FILE* file_;
   mutable int64_t size_;
   mutable Status status_;
+  SyncLevel durability_;
+
+  // If the file has been pre-extended by `preallocate()`, the extent of data
+  // actually written; otherwise -1.
+  int64_t extent_;
+
+  std::unique_ptr<char[]> path_;
+  std::unique_ptr<char[]> replace_target_;
 };
 
 }  // namespace roo_io
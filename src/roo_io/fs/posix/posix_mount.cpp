@@ -3,9 +3,11 @@
 #if ROO_IO_FS_SUPPORT_POSIX
 
 #include <dirent.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#include <atomic>
 #include <cstring>
 
 #include "roo_io/fs/posix/posix_directory.h"
@@ -45,6 +47,26 @@ Status ResolveExistsError(const char* full_path) {
   }
 }
 
+// For kReplaceAtomically, checks that `full_path` is not a directory, and
+// replaces it with the path of the temporary file to write to, moving the
+// original to `replace_target`. The temporary file name is unique to the
+// process and the call, so that concurrent replacements of the same target do
+// not write to the same file.
+Status PrepareReplace(std::unique_ptr<char[]>& full_path,
+                      std::unique_ptr<char[]>& replace_target) {
+  struct stat st;
+  if (::stat(full_path.get(), &st) == 0 && S_ISDIR(st.st_mode)) {
+    return kNotFile;
+  }
+  static std::atomic<uint32_t> counter(0);
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".tmp.%ld.%u", (long)getpid(),
+           (unsigned)++counter);
+  replace_target = std::move(full_path);
+  full_path = cat(replace_target.get(), suffix);
+  return full_path == nullptr ? kOutOfMemory : kOk;
+}
+
 }  // namespace
 
 PosixMountImpl::PosixMountImpl(const char* mount_point, bool read_only,
@@ -138,6 +160,34 @@ Status PosixMountImpl::rename(const char* pathFrom, const char* pathTo) {
   }
 }
 
+Status PosixMountImpl::truncate(const char* path, uint64_t size) {
+  if (path == nullptr || path[0] != '/') {
+    return kInvalidPath;
+  }
+  if (mount_point_ == nullptr) return kNotMounted;
+  if (read_only_) return kReadOnlyFilesystem;
+  auto full_path = cat(mount_point_.get(), path);
+  if (full_path.get() == nullptr) return kOutOfMemory;
+  if (::truncate(full_path.get(), size) == 0) return kOk;
+  switch (errno) {
+    case ENAMETOOLONG:
+      return kInvalidPath;
+    case ENOENT:
+      return kNotFound;
+    case ENOTDIR:
+      return kNotDirectory;
+    case EISDIR:
+      return kNotFile;
+    case EACCES:
+      return kAccessDenied;
+    case EFBIG:
+    case ENOSPC:
+      return kNoSpaceLeftOnDevice;
+    default:
+      return kUnknownIOError;
+  }
+}
+
 Status PosixMountImpl::mkdir(const char* path) {
   if (path == nullptr || path[0] != '/') {
     return kInvalidPath;
@@ -255,6 +305,7 @@ const char* Policy2Mode(FileUpdatePolicy policy) {
     case kAppendIfExists:
       return "a";
     case kTruncateIfExists:
+    case kReplaceAtomically:
       return "w";
     default:
       return "wx";
@@ -264,7 +315,7 @@ const char* Policy2Mode(FileUpdatePolicy policy) {
 
 std::unique_ptr<OutputStream> PosixMountImpl::fopenForWrite(
     std::shared_ptr<MountImpl> mount, const char* path,
-    FileUpdatePolicy update_policy) {
+    FileUpdatePolicy update_policy, SyncLevel durability) {
   if (path == nullptr || path[0] != '/') {
     return OutputError(kInvalidPath);
   }
@@ -274,14 +325,25 @@ std::unique_ptr<OutputStream> PosixMountImpl::fopenForWrite(
   }
   auto full_path = cat(mount_point_.get(), path);
   if (full_path.get() == nullptr) return OutputError(kOutOfMemory);
+  std::unique_ptr<char[]> replace_target;
+  if (update_policy == kReplaceAtomically) {
+    Status status = PrepareReplace(full_path, replace_target);
+    if (status != kOk) return OutputError(status);
+  }
+  // In append mode, O_APPEND makes every write land at the current end of
+  // the file, even if other handles extend it concurrently.
   FILE* f = ::fopen(full_path.get(), Policy2Mode(update_policy));
   if (f != nullptr) {
     return std::unique_ptr<OutputStream>(
-        new PosixFileOutputStream(std::move(mount), f));
+        new PosixFileOutputStream(std::move(mount), f, durability,
+                                  std::move(full_path),
+                                  std::move(replace_target)));
   }
   switch (errno) {
     case ENAMETOOLONG:
       return OutputError(kInvalidPath);
+    case EEXIST:
+      return OutputError(ResolveExistsError(full_path.get()));
     case ENOENT:
       return OutputError(kNotFound);
     case ENOTDIR:
@@ -297,6 +359,75 @@ std::unique_ptr<OutputStream> PosixMountImpl::fopenForWrite(
   }
 }
 
+namespace {
+int Policy2OpenFlags(FileUpdatePolicy policy) {
+  switch (policy) {
+    case kAppendIfExists:
+      return O_WRONLY | O_CREAT;
+    case kTruncateIfExists:
+    case kReplaceAtomically:
+      return O_WRONLY | O_CREAT | O_TRUNC;
+    default:
+      return O_WRONLY | O_CREAT | O_EXCL;
+  }
+}
+}  // namespace
+
+std::unique_ptr<MultipassOutputStream> PosixMountImpl::fopenForRandomWrite(
+    std::shared_ptr<MountImpl> mount, const char* path,
+    FileUpdatePolicy update_policy, SyncLevel durability) {
+  if (path == nullptr || path[0] != '/') {
+    return MultipassOutputError(kInvalidPath);
+  }
+  if (mount_point_ == nullptr) return MultipassOutputError(kNotMounted);
+  if (read_only_) {
+    return MultipassOutputError(kReadOnlyFilesystem);
+  }
+  auto full_path = cat(mount_point_.get(), path);
+  if (full_path.get() == nullptr) return MultipassOutputError(kOutOfMemory);
+  std::unique_ptr<char[]> replace_target;
+  if (update_policy == kReplaceAtomically) {
+    Status status = PrepareReplace(full_path, replace_target);
+    if (status != kOk) return MultipassOutputError(status);
+  }
+  // Not using fopen(), since its only mode that preserves existing content
+  // ("a") forces all writes to the end of the file.
+  int fd = ::open(full_path.get(), Policy2OpenFlags(update_policy), 0666);
+  if (fd >= 0) {
+    FILE* f = ::fdopen(fd, "w");
+    if (f == nullptr) {
+      ::close(fd);
+      return MultipassOutputError(kOutOfMemory);
+    }
+    if (update_policy == kAppendIfExists) ::fseek(f, 0, SEEK_END);
+    return std::unique_ptr<MultipassOutputStream>(
+        new PosixFileOutputStream(std::move(mount), f, durability,
+                                  std::move(full_path),
+                                  std::move(replace_target)));
+  }
+  switch (errno) {
+    case ENAMETOOLONG:
+      return MultipassOutputError(kInvalidPath);
+    case EEXIST:
+      return MultipassOutputError(ResolveExistsError(full_path.get()));
+    case ENOENT:
+      return MultipassOutputError(kNotFound);
+    case ENOTDIR:
+      return MultipassOutputError(kNotDirectory);
+    case EISDIR:
+      return MultipassOutputError(kNotFile);
+    case ENFILE:
+    case EMFILE:
+      return MultipassOutputError(kTooManyFilesOpen);
+    case ENOMEM:
+      return MultipassOutputError(kOutOfMemory);
+    case EACCES:
+      return MultipassOutputError(kAccessDenied);
+    default:
+      return MultipassOutputError(kUnknownIOError);
+  }
+}
+
 void PosixMountImpl::deactivate() { mount_point_ = nullptr; }
 
 }  // namespace roo_io
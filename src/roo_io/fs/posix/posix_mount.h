@@ -29,6 +29,8 @@ class PosixMountImpl : public MountImpl {
   /// Renames or moves an entry.
   Status rename(const char* pathFrom, const char* pathTo) override;
 
+  Status truncate(const char* path, uint64_t size) override;
+
   /// Creates the directory at `path`.
   Status mkdir(const char* path) override;
 
@@ -46,7 +48,12 @@ class PosixMountImpl : public MountImpl {
   /// Opens the file at `path` for writing using `update_policy`.
   std::unique_ptr<OutputStream> fopenForWrite(
       std::shared_ptr<MountImpl> mount, const char* path,
-      FileUpdatePolicy update_policy) override;
+      FileUpdatePolicy update_policy, SyncLevel durability) override;
+
+  /// Opens the file at `path` for seekable writing using `update_policy`.
+  std::unique_ptr<MultipassOutputStream> fopenForRandomWrite(
+      std::shared_ptr<MountImpl> mount, const char* path,
+      FileUpdatePolicy update_policy, SyncLevel durability) override;
 
   /// Returns whether the mount implementation is still active.
   bool active() const override { return mount_point_ != nullptr; }
@@ -6,6 +6,7 @@
 
 #include "roo_io/base/byte.h"
 #include "roo_io/data/byte_order.h"
+#include "roo_io/data/half.h"
 #include "roo_io/data/ieee754.h"
 
 namespace roo_io {
@@ -162,6 +163,28 @@ inline double LoadLeDouble(const byte *source) {
   memcpy(&value, &bits, sizeof(value));
   return value;
 }
+
+/// Loads a big-endian half-precision (binary16) float from the first 2 bytes
+/// at `source`.
+inline float LoadBeHalf(const byte *source) {
+  return HalfToFloat(LoadBeU16(source));
+}
+
+/// Loads a little-endian half-precision (binary16) float from the first 2
+/// bytes at `source`.
+inline float LoadLeHalf(const byte *source) {
+  return HalfToFloat(LoadLeU16(source));
+}
+
+/// Loads a big-endian bfloat16 float from the first 2 bytes at `source`.
+inline float LoadBeBFloat16(const byte *source) {
+  return BFloat16ToFloat(LoadBeU16(source));
+}
+
+/// Loads a little-endian bfloat16 float from the first 2 bytes at `source`.
+inline float LoadLeBFloat16(const byte *source) {
+  return BFloat16ToFloat(LoadLeU16(source));
+}
 #endif  // ROO_IO_IEEE754
 
 /// Loads a host-native trivially copyable value from `source`.
@@ -177,6 +200,18 @@ inline constexpr T LoadHostNative(const byte *source) {
   return result;
 }
 
+/// Loads an array of `count` values of type `T`, stored in `byte_order` at
+/// `source`, into `result`.
+///
+/// `T` is an integer type, or `float`/`double` if `ROO_IO_IEEE754` is enabled.
+/// `source` need not be aligned. Byte swapping is vectorized where the
+/// hardware supports it, and skipped if `byte_order` is `kNativeEndian`.
+template <typename T, ByteOrder byte_order>
+inline void LoadArray(const byte *source, T *result, size_t count) {
+  byte_order::ConvertArray<T, byte_order, kNativeEndian>(
+      source, (byte *)result, count);
+}
+
 // Variants that can be used in code templated on the byte order.
 
 /// Loads a byte-order-selected unsigned 16-bit integer from the first 2 bytes
@@ -354,6 +389,20 @@ template <>
 inline double LoadDouble<kLittleEndian>(const byte *source) {
   return LoadLeDouble(source);
 }
+
+/// Loads a byte-order-selected half-precision float from the first 2 bytes at
+/// `source`.
+template <ByteOrder byte_order>
+inline float LoadHalf(const byte *source) {
+  return HalfToFloat(LoadU16<byte_order>(source));
+}
+
+/// Loads a byte-order-selected bfloat16 float from the first 2 bytes at
+/// `source`.
+template <ByteOrder byte_order>
+inline float LoadBFloat16(const byte *source) {
+  return BFloat16ToFloat(LoadU16<byte_order>(source));
+}
 #endif  // ROO_IO_IEEE754
 
 template <>
@@ -123,7 +123,9 @@ class SafeGenericMemoryIterator {
 
   /// Returns current pointer.
   PtrType ptr() const { return ptr_; }
-  // PtrType end() const { return end_; }
+
+  /// Returns the end pointer, or `nullptr` after EOS marker is set.
+  PtrType end() const { return end_; }
 
  private:
   PtrType ptr_;
@@ -248,6 +250,58 @@ struct MemoryIteratorTraits<MultipassGenericMemoryIterator<PtrType>> {
   static constexpr bool is_memory = true;
 };
 
+// Provides direct access to the upcoming `count` bytes of a memory iterator.
+// Returns nullptr if they are not known to be available (in particular, for
+// iterators that are not backed by bounded memory).
+//
+// `peekAll()` returns all the remaining bytes, setting `available` to their
+// count, or nullptr if there are none or they cannot be accessed directly.
+template <typename InputIterator>
+struct ContiguousLookahead {
+  static const byte* peek(const InputIterator&, size_t) { return nullptr; }
+
+  static const byte* peekAll(const InputIterator&, size_t& available) {
+    available = 0;
+    return nullptr;
+  }
+};
+
+template <typename PtrType>
+struct ContiguousLookahead<SafeGenericMemoryIterator<PtrType>> {
+  static const byte* peek(const SafeGenericMemoryIterator<PtrType>& in,
+                          size_t count) {
+    if (in.end() == nullptr || (size_t)(in.end() - in.ptr()) < count) {
+      return nullptr;
+    }
+    return (const byte*)in.ptr();
+  }
+
+  static const byte* peekAll(const SafeGenericMemoryIterator<PtrType>& in,
+                             size_t& available) {
+    if (in.end() == nullptr || in.ptr() == in.end()) return nullptr;
+    available = (size_t)(in.end() - in.ptr());
+    return (const byte*)in.ptr();
+  }
+};
+
+template <typename PtrType>
+struct ContiguousLookahead<MultipassGenericMemoryIterator<PtrType>> {
+  static const byte* peek(const MultipassGenericMemoryIterator<PtrType>& in,
+                          size_t count) {
+    if (in.position() >= in.size() || in.size() - in.position() < count) {
+      return nullptr;
+    }
+    return (const byte*)in.ptr();
+  }
+
+  static const byte* peekAll(const MultipassGenericMemoryIterator<PtrType>& in,
+                             size_t& available) {
+    if (in.position() >= in.size()) return nullptr;
+    available = (size_t)(in.size() - in.position());
+    return (const byte*)in.ptr();
+  }
+};
+
 }  // namespace internal
 
 }  // namespace roo_io
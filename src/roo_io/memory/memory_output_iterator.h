@@ -102,7 +102,7 @@ class MemoryOutputIterator {
   /// Returns current output pointer.
   ///
   /// @return Current pointer.
-  const byte* ptr() const { return ptr_; }
+  byte* ptr() const { return ptr_; }
 
   /// Flushes output (no-op).
   ///
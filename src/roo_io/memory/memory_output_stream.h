@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstring>
+
+#include "roo_io/core/multipass_output_stream.h"
 #include "roo_io/core/output_stream.h"
 
 namespace roo_io {
@@ -47,4 +50,83 @@ class MemoryOutputStream : public OutputStream {
   Status status_;
 };
 
-}  // namespace roo_io
\ No newline at end of file
+/// Multipass output stream backed directly by a caller-provided memory range.
+///
+/// The stream starts empty, and grows as data is written, up to the capacity
+/// of the range. Writing past the capacity fails with `kNoSpaceLeftOnDevice`.
+template <typename PtrType>
+class MultipassMemoryOutputStream : public MultipassOutputStream {
+ public:
+  /// Creates a detached memory stream with `kClosed` status.
+  MultipassMemoryOutputStream()
+      : begin_(nullptr),
+        capacity_(0),
+        position_(0),
+        size_(0),
+        status_(kClosed) {}
+
+  /// Opens a memory stream that writes into `[begin, end)`.
+  MultipassMemoryOutputStream(PtrType begin, PtrType end)
+      : begin_(begin),
+        capacity_(end - begin),
+        position_(0),
+        size_(0),
+        status_(kOk) {}
+
+  /// Writes up to `count` bytes at the current position.
+  size_t write(const byte* buf, size_t count) override {
+    if (status_ != kOk) return 0;
+    if (position_ >= capacity_) {
+      status_ = kNoSpaceLeftOnDevice;
+      return 0;
+    }
+    if (position_ > size_) {
+      // Zero-fill the gap left by seeking past the end.
+      memset(begin_ + size_, 0, position_ - size_);
+    }
+    const size_t available = capacity_ - position_;
+    if (count > available) {
+      count = available;
+      status_ = kNoSpaceLeftOnDevice;
+    }
+    memcpy(begin_ + position_, buf, count);
+    position_ += count;
+    if (position_ > size_) size_ = position_;
+    return count;
+  }
+
+  /// Returns the number of bytes written, i.e. the end of the furthest write.
+  uint64_t size() override { return size_; }
+
+  /// Returns the current byte offset from the start of the range.
+  uint64_t position() const override { return position_; }
+
+  /// Seeks to `offset`. Offsets past the capacity are accepted, but
+  /// subsequent writes fail.
+  void seek(uint64_t offset) override {
+    if (status_ != kOk) return;
+    position_ = offset;
+  }
+
+  /// Closes the stream when it is still healthy.
+  void close() override {
+    if (status_ == kOk) {
+      status_ = kClosed;
+    }
+  }
+
+  /// Returns the current stream status.
+  Status status() const override { return status_; }
+
+  /// Returns the beginning of the backing range.
+  byte* data() const { return begin_; }
+
+ private:
+  byte* begin_;
+  uint64_t capacity_;
+  uint64_t position_;
+  uint64_t size_;
+  Status status_;
+};
+
+}  // namespace roo_io
@@ -7,6 +7,7 @@
 
 #include "roo_io/base/byte.h"
 #include "roo_io/data/byte_order.h"
+#include "roo_io/data/half.h"
 #include "roo_io/data/ieee754.h"
 
 namespace roo_io {
@@ -163,6 +164,30 @@ inline void StoreLeDouble(double v, byte* target) {
   memcpy(&bits, &v, sizeof(bits));
   StoreLeU64(bits, target);
 }
+
+/// Stores a big-endian half-precision (binary16) float into the first 2 bytes
+/// at `target`, rounding to nearest even.
+inline void StoreBeHalf(float v, byte* target) {
+  StoreBeU16(FloatToHalf(v), target);
+}
+
+/// Stores a little-endian half-precision (binary16) float into the first 2
+/// bytes at `target`, rounding to nearest even.
+inline void StoreLeHalf(float v, byte* target) {
+  StoreLeU16(FloatToHalf(v), target);
+}
+
+/// Stores a big-endian bfloat16 float into the first 2 bytes at `target`,
+/// rounding to nearest even.
+inline void StoreBeBFloat16(float v, byte* target) {
+  StoreBeU16(FloatToBFloat16(v), target);
+}
+
+/// Stores a little-endian bfloat16 float into the first 2 bytes at `target`,
+/// rounding to nearest even.
+inline void StoreLeBFloat16(float v, byte* target) {
+  StoreLeU16(FloatToBFloat16(v), target);
+}
 #endif  // ROO_IO_IEEE754
 
 // Arbitrary types, native encoding.
@@ -178,6 +203,18 @@ inline void StoreHostNative(const T& v, byte* target) {
   memcpy((char*)target, (const char*)&v, sizeof(v));
 }
 
+/// Stores an array of `count` values of type `T` from `data` to `target`, in
+/// `byte_order`.
+///
+/// `T` is an integer type, or `float`/`double` if `ROO_IO_IEEE754` is enabled.
+/// `target` need not be aligned. Byte swapping is vectorized where the
+/// hardware supports it, and skipped if `byte_order` is `kNativeEndian`.
+template <typename T, ByteOrder byte_order>
+inline void StoreArray(const T* data, size_t count, byte* target) {
+  byte_order::ConvertArray<T, kNativeEndian, byte_order>((const byte*)data,
+                                                         target, count);
+}
+
 // Variants that can be used in code templated on byte order.
 
 /// Stores a byte-order-selected unsigned 16-bit integer into the first 2 bytes
@@ -344,6 +381,20 @@ template <>
 inline void StoreDouble<kLittleEndian>(double v, byte* target) {
   StoreLeDouble(v, target);
 }
+
+/// Stores a byte-order-selected half-precision float into the first 2 bytes
+/// at `target`.
+template <ByteOrder byte_order>
+inline void StoreHalf(float v, byte* target) {
+  StoreU16<byte_order>(FloatToHalf(v), target);
+}
+
+/// Stores a byte-order-selected bfloat16 float into the first 2 bytes at
+/// `target`.
+template <ByteOrder byte_order>
+inline void StoreBFloat16(float v, byte* target) {
+  StoreU16<byte_order>(FloatToBFloat16(v), target);
+}
 #endif  // ROO_IO_IEEE754
 
 template <>
@@ -55,6 +55,13 @@ roo_logging::Stream& operator<<(roo_logging::Stream& s,
   return s;
 }
 
+void Formatter<MacAddress>::format(FormatSink& sink, const FormatSpec& spec,
+                                   const MacAddress& addr) {
+  char buf[18];
+  addr.writeStringTo(buf);
+  sink.writePadded(spec, buf, 17);
+}
+
 std::string MacAddress::asString() const {
   return StringPrintf("%02X-%02X-%02X-%02X-%02X-%02X", (int)addr_[0],
                       (int)addr_[1], (int)addr_[2], (int)addr_[3],
@@ -6,6 +6,7 @@
 #include <string>
 
 #include "roo_io/base/byte.h"
+#include "roo_io/text/format.h"
 #include "roo_logging.h"
 
 namespace roo_io {
@@ -100,6 +101,13 @@ void WriteMacAddress(OutputIterator& itr, const MacAddress& addr) {
 /// Streams the printable MAC address representation into the logging sink.
 roo_logging::Stream& operator<<(roo_logging::Stream& s, const MacAddress& addr);
 
+/// Formats the MAC address as `XX-XX-XX-XX-XX-XX` (see `text/format.h`).
+template <>
+struct Formatter<MacAddress> {
+  static void format(FormatSink& sink, const FormatSpec& spec,
+                     const MacAddress& addr);
+};
+
 }  // namespace roo_io
 
 namespace std {
@@ -52,6 +52,10 @@ const char* StatusAsString(Status status) {
       return "no media";
     case kConnectionError:
       return "connection error";
+    case kInvalidFormat:
+      return "invalid format";
+    case kOutOfRange:
+      return "value out of range";
     default:
       return "unknown error";
   }
@@ -69,6 +69,13 @@ enum Status {
 
   // Write failed because the receiver has closed the connection.
   kBrokenPipe,
+
+  // The data read does not conform to the expected format.
+  kInvalidFormat,
+
+  // The value read is syntactically valid, but it does not fit the target
+  // type.
+  kOutOfRange,
 };
 
 /// Returns a stable string name for the specified status value.
@@ -0,0 +1,306 @@
+#include "roo_io/store/circular_log.h"
+
+#include "roo_io/data/crc32c.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/store.h"
+
+namespace roo_io {
+
+namespace {
+
+// Sector header: little-endian magic, little-endian 64-bit sequence number,
+// and the little-endian CRC-32C of the two.
+constexpr uint32_t kSectorMagic = 0x474C4352;  // "RCLG".
+constexpr size_t kSectorHeaderSize = 16;
+
+// Record header: little-endian payload length, followed by the little-endian
+// CRC-32C of the length field and the payload, seeded with the sequence
+// number of the sector.
+constexpr size_t kRecordHeaderSize = 8;
+
+void EncodeSectorHeader(uint64_t sequence, byte* header) {
+  StoreLeU32(kSectorMagic, header);
+  StoreLeU64(sequence, header + 4);
+  StoreLeU32(Crc32c(header, 12), header + 12);
+}
+
+// Returns whether the header is intact, and belongs to the sector with the
+// specified index.
+bool DecodeSectorHeader(const byte* header, uint32_t index,
+                        uint32_t sector_count, uint64_t& sequence) {
+  if (LoadLeU32(header) != kSectorMagic) return false;
+  if (Crc32c(header, 12) != LoadLeU32(header + 12)) return false;
+  sequence = LoadLeU64(header + 4);
+  return sequence % sector_count == index;
+}
+
+uint32_t RecordCrc(uint64_t sequence, const byte* header, const byte* data,
+                   size_t size) {
+  return Crc32c(data, size, Crc32c(header, 4, (uint32_t)sequence));
+}
+
+// Finds the intact record at `offset` in the sector. On success, sets
+// `size` to its payload size, and returns true.
+bool ParseRecord(const byte* sector, size_t sector_size, uint64_t sequence,
+                 size_t offset, size_t& size) {
+  if (sector_size - offset < kRecordHeaderSize) return false;
+  const byte* header = sector + offset;
+  uint32_t length = LoadLeU32(header);
+  if (length > sector_size - offset - kRecordHeaderSize) return false;
+  if (RecordCrc(sequence, header, header + kRecordHeaderSize, length) !=
+      LoadLeU32(header + 4)) {
+    return false;
+  }
+  size = length;
+  return true;
+}
+
+}  // namespace
+
+CircularLogReader::CircularLogReader(std::unique_ptr<MultipassInputStream> in,
+                                     const CircularLogOptions& options,
+                                     uint64_t first_sequence,
+                                     uint64_t end_sequence)
+    : in_(std::move(in)),
+      options_(options),
+      sector_(new byte[options.sector_size]),
+      next_sequence_(first_sequence),
+      end_sequence_(end_sequence),
+      sector_sequence_(0),
+      offset_(0),
+      record_offset_(0),
+      record_size_(0),
+      status_(in_->status()) {}
+
+CircularLogReader::CircularLogReader(Status error)
+    : next_sequence_(0),
+      end_sequence_(0),
+      sector_sequence_(0),
+      offset_(0),
+      record_offset_(0),
+      record_size_(0),
+      status_(error) {}
+
+bool CircularLogReader::loadSector(uint64_t sequence) {
+  uint32_t index = sequence % options_.sector_count;
+  in_->seek((uint64_t)index * options_.sector_size);
+  size_t n = in_->readFully(sector_.get(), options_.sector_size);
+  if (n < options_.sector_size) {
+    Status s = in_->status();
+    status_ = (s != kOk && s != kEndOfStream) ? s : kInvalidFormat;
+    return false;
+  }
+  uint64_t actual;
+  if (!DecodeSectorHeader(sector_.get(), index, options_.sector_count,
+                          actual) ||
+      actual != sequence) {
+    return false;
+  }
+  sector_sequence_ = sequence;
+  offset_ = kSectorHeaderSize;
+  return true;
+}
+
+bool CircularLogReader::next() {
+  while (status_ == kOk) {
+    if (offset_ == 0) {
+      if (next_sequence_ == end_sequence_) {
+        status_ = kEndOfStream;
+        break;
+      }
+      if (!loadSector(next_sequence_++)) continue;
+    }
+    size_t size;
+    if (ParseRecord(sector_.get(), options_.sector_size, sector_sequence_,
+                    offset_, size)) {
+      record_offset_ = offset_ + kRecordHeaderSize;
+      record_size_ = size;
+      offset_ = record_offset_ + size;
+      return true;
+    }
+    // End of the intact records in this sector.
+    offset_ = 0;
+  }
+  record_size_ = 0;
+  return false;
+}
+
+CircularLog::CircularLog(Mount& fs, const char* path,
+                         CircularLogOptions options)
+    : fs_(fs),
+      path_(path),
+      options_(options),
+      status_(kClosed),
+      empty_(true),
+      head_sequence_(0),
+      write_offset_(0) {}
+
+CircularLog::~CircularLog() { close(); }
+
+size_t CircularLog::maxRecordSize() const {
+  return options_.sector_size - kSectorHeaderSize - kRecordHeaderSize;
+}
+
+Status CircularLog::open() {
+  if (status_ == kOk) return kOk;
+  if (options_.sector_count == 0 ||
+      options_.sector_size < kSectorHeaderSize + kRecordHeaderSize) {
+    return kOutOfRange;
+  }
+  uint64_t file_size = (uint64_t)options_.sector_count * options_.sector_size;
+  out_ = fs_.fopenForRandomWrite(path_.c_str(), kAppendIfExists);
+  status_ = out_->status();
+  if (status_ == kOk) {
+    uint64_t size = out_->size();
+    if (size > file_size) {
+      // Created with a different geometry.
+      status_ = kInvalidFormat;
+    } else if (size < file_size) {
+      // New (or interrupted while being created); extend, zero-filled.
+      const byte zero[] = {byte{0}};
+      out_->seek(file_size - 1);
+      out_->writeFully(zero, 1);
+      out_->flush();
+      status_ = out_->status();
+    }
+  }
+  if (status_ == kOk) {
+    auto in = fs_.fopen(path_.c_str());
+    status_ = in->status();
+    if (status_ == kOk) status_ = locateHead(*in);
+  }
+  if (status_ != kOk) out_ = nullptr;
+  return status_;
+}
+
+Status CircularLog::locateHead(MultipassInputStream& in) {
+  const uint32_t n = options_.sector_count;
+  const uint32_t sector_size = options_.sector_size;
+  byte header[kSectorHeaderSize];
+  Status io_status = kOk;
+  // Reads the header of the sector at `index`, and returns whether it is
+  // intact. Sets `io_status` on I/O errors.
+  auto read_header = [&](uint32_t index, uint64_t& sequence) {
+    in.seek((uint64_t)index * sector_size);
+    if (in.readFully(header, kSectorHeaderSize) < kSectorHeaderSize) {
+      io_status = (in.status() == kEndOfStream) ? kInvalidFormat : in.status();
+      return false;
+    }
+    return DecodeSectorHeader(header, index, n, sequence);
+  };
+
+  // Sectors are written in order, so that the sector with sequence number
+  // s + i is at index i, for all the indexes up to the head, and the
+  // remaining ones are left over from the previous pass, or torn, or empty.
+  // Binary search for the boundary.
+  uint64_t first;
+  empty_ = false;
+  if (!read_header(0, first)) {
+    if (io_status != kOk) return io_status;
+    // Either the log is empty, or a crash tore the header of the first
+    // sector, as the log was wrapping around.
+    uint64_t last;
+    if (!read_header(n - 1, last)) {
+      if (io_status != kOk) return io_status;
+      empty_ = true;
+      return kOk;
+    }
+    head_sequence_ = last;
+  } else {
+    uint32_t lo = 0;
+    uint32_t hi = n;
+    while (hi - lo > 1) {
+      uint32_t mid = lo + (hi - lo) / 2;
+      uint64_t sequence;
+      if (read_header(mid, sequence) && sequence == first + mid) {
+        lo = mid;
+      } else {
+        if (io_status != kOk) return io_status;
+        hi = mid;
+      }
+    }
+    head_sequence_ = first + lo;
+  }
+
+  // Find the end of the intact records in the head sector.
+  std::unique_ptr<byte[]> sector(new byte[sector_size]);
+  in.seek((head_sequence_ % n) * sector_size);
+  if (in.readFully(sector.get(), sector_size) < sector_size) {
+    return (in.status() == kEndOfStream) ? kInvalidFormat : in.status();
+  }
+  write_offset_ = kSectorHeaderSize;
+  size_t size;
+  while (ParseRecord(sector.get(), sector_size, head_sequence_, write_offset_,
+                     size)) {
+    write_offset_ += kRecordHeaderSize + size;
+  }
+  return kOk;
+}
+
+Status CircularLog::startSector(uint64_t sequence) {
+  byte header[kSectorHeaderSize];
+  EncodeSectorHeader(sequence, header);
+  out_->seek((sequence % options_.sector_count) * options_.sector_size);
+  out_->writeFully(header, kSectorHeaderSize);
+  if (out_->status() != kOk) return out_->status();
+  empty_ = false;
+  head_sequence_ = sequence;
+  write_offset_ = kSectorHeaderSize;
+  return kOk;
+}
+
+Status CircularLog::append(const byte* data, size_t size) {
+  if (status_ != kOk) return status_;
+  if (size > maxRecordSize()) return kOutOfRange;
+  if (empty_) {
+    status_ = startSector(0);
+  } else if (write_offset_ + kRecordHeaderSize + size >
+             options_.sector_size) {
+    status_ = startSector(head_sequence_ + 1);
+  }
+  if (status_ != kOk) return status_;
+  byte header[kRecordHeaderSize];
+  StoreLeU32(size, header);
+  StoreLeU32(RecordCrc(head_sequence_, header, data, size), header + 4);
+  out_->seek((head_sequence_ % options_.sector_count) * options_.sector_size +
+             write_offset_);
+  out_->writeFully(header, kRecordHeaderSize);
+  out_->writeFully(data, size);
+  status_ = out_->status();
+  if (status_ != kOk) return status_;
+  write_offset_ += kRecordHeaderSize + size;
+  return kOk;
+}
+
+Status CircularLog::sync(SyncLevel level) {
+  if (status_ != kOk) return status_;
+  out_->sync(level);
+  status_ = out_->status();
+  return status_;
+}
+
+CircularLogReader CircularLog::read() {
+  if (status_ != kOk) return CircularLogReader(status_);
+  if (empty_) return CircularLogReader(kEndOfStream);
+  out_->flush();
+  status_ = out_->status();
+  if (status_ != kOk) return CircularLogReader(status_);
+  uint64_t end = head_sequence_ + 1;
+  uint64_t first =
+      (end > options_.sector_count) ? end - options_.sector_count : 0;
+  return CircularLogReader(fs_.fopen(path_.c_str()), options_, first, end);
+}
+
+Status CircularLog::close() {
+  if (out_ == nullptr) return status_ == kClosed ? kOk : status_;
+  Status status = status_;
+  if (status == kOk) {
+    out_->close();
+    status = out_->status() == kClosed ? kOk : out_->status();
+  }
+  out_ = nullptr;
+  status_ = (status == kOk) ? kClosed : status;
+  return status;
+}
+
+}  // namespace roo_io
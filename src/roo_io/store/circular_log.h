@@ -0,0 +1,157 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <memory>
+#include <string>
+
+#include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/multipass_output_stream.h"
+#include "roo_io/core/sync_level.h"
+#include "roo_io/fs/mount.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Geometry of a `CircularLog`. Must not change between runs, for a given
+/// log file.
+struct CircularLogOptions {
+  /// Size of a sector, in bytes. Records do not span sectors, so this also
+  /// bounds the record size (see `CircularLog::maxRecordSize()`).
+  uint32_t sector_size = 4096;
+
+  /// Number of sectors. The log file has a fixed size of `sector_count *
+  /// sector_size` bytes, and retains at least `sector_count - 1` sectors
+  /// worth of the most recent records.
+  uint32_t sector_count = 16;
+};
+
+/// Iterates over the records of a `CircularLog`, oldest first. Obtained from
+/// `CircularLog::read()`.
+class CircularLogReader {
+ public:
+  CircularLogReader(CircularLogReader&& other) = default;
+
+  /// Advances to the next record. Returns false if there are no more records,
+  /// or on error.
+  bool next();
+
+  /// Returns the payload of the current record, or null if `status()` is not
+  /// `kOk`.
+  const byte* data() const {
+    return status_ != kOk ? nullptr : &sector_[record_offset_];
+  }
+
+  /// Returns the size of the current record, in bytes.
+  size_t size() const { return record_size_; }
+
+  /// Returns `kOk` while records are being read, `kEndOfStream` once all of
+  /// them have been read, or an I/O error.
+  Status status() const { return status_; }
+
+ private:
+  friend class CircularLog;
+
+  CircularLogReader(std::unique_ptr<MultipassInputStream> in,
+                    const CircularLogOptions& options, uint64_t first_sequence,
+                    uint64_t end_sequence);
+
+  CircularLogReader(Status error);
+
+  // Loads the sector with the specified sequence number. Returns false if it
+  // has been lost (overwritten or torn).
+  bool loadSector(uint64_t sequence);
+
+  std::unique_ptr<MultipassInputStream> in_;
+  CircularLogOptions options_;
+  std::unique_ptr<byte[]> sector_;
+  uint64_t next_sequence_;
+  uint64_t end_sequence_;
+  uint64_t sector_sequence_;
+  size_t offset_;
+  size_t record_offset_;
+  size_t record_size_;
+  Status status_;
+};
+
+/// Log with bounded storage, kept in a single preallocated file that is
+/// divided into fixed-size sectors, used as a ring.
+///
+/// Rather than deleting and recreating files, as rotating logs do, the log
+/// overwrites its oldest sector in place when it runs out of space. This
+/// keeps the storage bounded, the write latency predictable, and avoids
+/// metadata churn and wear on flash filesystems (LittleFS, SPIFFS).
+///
+/// Each sector starts with a header carrying a sequence number; the sector
+/// with sequence number `s` is stored at index `s % sector_count`. Records
+/// are appended to the newest sector, each framed by its length and a
+/// CRC-32C checksum (seeded with the sector's sequence number, so that stale
+/// records left over from the previous pass around the ring are recognized
+/// without erasing them).
+///
+/// `open()` locates the newest sector by a binary search over sector headers
+/// (O(log n) reads), and then scans that single sector for the end of the
+/// intact records. A record or a header torn by a crash is discarded, and
+/// overwritten by the next append.
+///
+/// Not thread-safe.
+class CircularLog {
+ public:
+  /// Creates a log in the file at `path` of `fs`. Call `open()` before use.
+  CircularLog(Mount& fs, const char* path,
+              CircularLogOptions options = CircularLogOptions());
+
+  /// Closes the log.
+  ~CircularLog();
+
+  /// Creates and preallocates the file if needed, and locates the head.
+  Status open();
+
+  /// Appends a record. When the newest sector is full, moves on to the next
+  /// one, overwriting its previous contents.
+  ///
+  /// @return `kOk` on success; `kOutOfRange` if the record is larger than
+  /// `maxRecordSize()`; or the error that made the log fail.
+  Status append(const byte* data, size_t size);
+
+  /// Makes the records appended so far durable, as requested by `level`.
+  Status sync(SyncLevel level = kSyncData);
+
+  /// Returns a reader over all retained records. Do not append while
+  /// reading.
+  CircularLogReader read();
+
+  /// Flushes and closes the log. Returns `kOk` on success, or an error.
+  Status close();
+
+  /// Returns `kOk` if the log is open and healthy; `kClosed` if it is not
+  /// open; or the error that made it fail.
+  Status status() const { return status_; }
+
+  /// Returns the size of the largest record that fits in a sector.
+  size_t maxRecordSize() const;
+
+ private:
+  // Finds the newest sector, and the end of its records.
+  Status locateHead(MultipassInputStream& in);
+
+  // Starts the sector with the specified sequence number.
+  Status startSector(uint64_t sequence);
+
+  Mount& fs_;
+  std::string path_;
+  CircularLogOptions options_;
+  std::unique_ptr<MultipassOutputStream> out_;
+  Status status_;
+
+  // Whether no sector has been written yet.
+  bool empty_;
+
+  // Sequence number of the newest sector.
+  uint64_t head_sequence_;
+
+  // Offset, within the newest sector, at which the next record goes.
+  size_t write_offset_;
+};
+
+}  // namespace roo_io
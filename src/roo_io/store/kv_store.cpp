@@ -0,0 +1,658 @@
+#include "roo_io/store/kv_store.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "roo_io/fs/fsutil.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/store.h"
+#include "roo_io/store/wal.h"
+
+namespace roo_io {
+
+namespace {
+
+using internal::kWalRecordHeaderSize;
+
+// Each batch is a sequence of operations:
+// - op (1 byte): kPut or kRemove,
+// - key size (little-endian, 2 bytes),
+// - value size (little-endian, 4 bytes), for kPut only,
+// - key,
+// - value, for kPut only.
+constexpr uint8_t kPut = 1;
+constexpr uint8_t kRemove = 2;
+constexpr size_t kMaxKeySize = 0xFFFF;
+
+// Each hint record describes one entry of the data file: little-endian value
+// offset (8 bytes), little-endian value size (4 bytes), and the key. The last
+// record holds the number of entries (little-endian, 4 bytes), so that a
+// truncated hint file is never mistaken for a complete one.
+constexpr size_t kHintHeaderSize = 12;
+constexpr size_t kHintTrailerSize = 4;
+
+// Open files are scarce on some platforms (e.g. ESP32 VFS); keep few readers.
+constexpr size_t kMaxCachedReaders = 2;
+
+uint64_t EntryBytes(size_t key_size, size_t value_size) {
+  return 7 + key_size + value_size;
+}
+
+std::string FilePath(const std::string& dir, uint32_t file, const char* ext) {
+  char name[24];
+  snprintf(name, sizeof(name), "/%08" PRIx32 ".%s", file, ext);
+  return dir + name;
+}
+
+// Parses a file name ("0000002a.<ext>"). Returns 0 if it does not match.
+uint32_t ParseFileName(const char* name, const char* ext) {
+  if (strlen(name) != 9 + strlen(ext) || name[8] != '.' ||
+      strcmp(name + 9, ext) != 0) {
+    return 0;
+  }
+  uint32_t file = 0;
+  for (int i = 0; i < 8; ++i) {
+    char c = name[i];
+    int digit = (c >= '0' && c <= '9')   ? c - '0'
+                : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                         : -1;
+    if (digit < 0) return 0;
+    file = (file << 4) | digit;
+  }
+  return file;
+}
+
+// Calls `fn(op, key, key_size, value_offset, value_size)` for each operation
+// of the batch. Returns false if the batch is malformed.
+template <typename Fn>
+bool ForEachOp(const byte* payload, size_t size, Fn fn) {
+  size_t pos = 0;
+  while (pos < size) {
+    if (size - pos < 3) return false;
+    uint8_t op = (uint8_t)payload[pos];
+    size_t key_size = LoadLeU16(payload + pos + 1);
+    pos += 3;
+    size_t value_size = 0;
+    if (op == kPut) {
+      if (size - pos < 4) return false;
+      value_size = LoadLeU32(payload + pos);
+      pos += 4;
+    } else if (op != kRemove) {
+      return false;
+    }
+    if (size - pos < key_size || size - pos - key_size < value_size) {
+      return false;
+    }
+    fn(op, (const char*)payload + pos, key_size, pos + key_size, value_size);
+    pos += key_size + value_size;
+  }
+  return true;
+}
+
+}  // namespace
+
+void KvBatch::put(const std::string& key, const byte* data, size_t size) {
+  if (key.size() > kMaxKeySize) {
+    valid_ = false;
+    return;
+  }
+  size_t pos = payload_.size();
+  payload_.resize(pos + 7 + key.size() + size);
+  byte* target = &payload_[pos];
+  target[0] = (byte)kPut;
+  StoreLeU16(key.size(), target + 1);
+  StoreLeU32(size, target + 3);
+  memcpy(target + 7, key.data(), key.size());
+  if (size > 0) memcpy(target + 7 + key.size(), data, size);
+}
+
+void KvBatch::remove(const std::string& key) {
+  if (key.size() > kMaxKeySize) {
+    valid_ = false;
+    return;
+  }
+  size_t pos = payload_.size();
+  payload_.resize(pos + 3 + key.size());
+  byte* target = &payload_[pos];
+  target[0] = (byte)kRemove;
+  StoreLeU16(key.size(), target + 1);
+  memcpy(target + 3, key.data(), key.size());
+}
+
+void KvBatch::clear() {
+  payload_.clear();
+  valid_ = true;
+}
+
+KvIterator::KvIterator(KvStore& store, std::vector<std::string> keys,
+                       Status status)
+    : store_(&store), keys_(std::move(keys)), pos_(0), status_(status) {}
+
+bool KvIterator::next() {
+  while (status_ == kOk) {
+    if (pos_ == keys_.size()) {
+      status_ = kEndOfStream;
+      break;
+    }
+    Status status = store_->get(keys_[pos_++], value_);
+    if (status == kOk) return true;
+    // Skip keys removed since the iterator was created.
+    if (status != kNotFound) status_ = status;
+  }
+  value_.clear();
+  return false;
+}
+
+KvStore::KvStore(Mount& fs, const char* dir, KvStoreOptions options)
+    : fs_(fs),
+      dir_(dir),
+      options_(options),
+      active_size_(0),
+      status_(kClosed),
+      live_bytes_(0),
+      garbage_bytes_(0),
+      compacting_(false) {}
+
+KvStore::~KvStore() { close(); }
+
+Status KvStore::open() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ == kOk) return kOk;
+  status_ = recover();
+  if (status_ != kOk) {
+    out_ = nullptr;
+    readers_.clear();
+    index_.clear();
+  }
+  return status_;
+}
+
+Status KvStore::recover() {
+  Status status = MkDirRecursively(fs_, dir_.c_str());
+  if (status != kOk && status != kDirectoryExists) return status;
+  index_.clear();
+  files_.clear();
+  live_bytes_ = 0;
+  garbage_bytes_ = 0;
+  std::vector<uint32_t> hints;
+  std::vector<std::pair<uint32_t, std::string>> temps;
+  {
+    Directory dir = fs_.opendir(dir_.c_str());
+    while (dir.read()) {
+      if (dir.entry().isDirectory()) continue;
+      const char* name = dir.entry().name();
+      uint32_t file;
+      if ((file = ParseFileName(name, "dat")) != 0) {
+        files_.push_back(file);
+      } else if ((file = ParseFileName(name, "hint")) != 0) {
+        hints.push_back(file);
+      } else {
+        std::string target = internal::TempFileTarget(name);
+        if (target.empty()) continue;
+        if ((file = ParseFileName(target.c_str(), "dat")) != 0) {
+          temps.emplace_back(file, dir_ + "/" + name);
+        } else if (ParseFileName(target.c_str(), "hint") != 0) {
+          // Hints are rebuilt as needed.
+          temps.emplace_back(0, dir_ + "/" + name);
+        }
+      }
+    }
+    if (dir.failed()) return dir.status();
+  }
+  // Temporary data files are left by compactions that did not complete (the
+  // inputs are all still there), or by an interrupted truncation of the
+  // active file, which may have left the only copy.
+  status = internal::AdoptTempFiles(
+      fs_, std::move(temps), files_,
+      [this](uint32_t file) { return FilePath(dir_, file, "dat"); });
+  if (status != kOk) return status;
+  if (files_.empty()) return startFile(1);
+  std::sort(files_.begin(), files_.end());
+  std::sort(hints.begin(), hints.end());
+  uint64_t valid_end;
+  for (size_t i = 0; i + 1 < files_.size(); ++i) {
+    if (std::binary_search(hints.begin(), hints.end(), files_[i]) &&
+        loadHint(files_[i])) {
+      continue;
+    }
+    status = scan(files_[i], valid_end);
+    if (status != kOk) return status;
+  }
+
+  // Only the active file may have a torn tail; the others were synced before
+  // being closed.
+  uint32_t active = files_.back();
+  std::string path = FilePath(dir_, active, "dat");
+  status = scan(active, valid_end);
+  if (status != kOk) return status;
+  Stat stat = fs_.stat(path.c_str());
+  if (stat.status() != kOk) return stat.status();
+  if (valid_end < stat.size()) {
+    status = fs_.truncate(path.c_str(), valid_end);
+    if (status != kOk) return status;
+  }
+  out_ = fs_.fopenForWrite(path.c_str(), kAppendIfExists);
+  if (out_->status() != kOk) return out_->status();
+  active_size_ = valid_end;
+  return kOk;
+}
+
+bool KvStore::loadHint(uint32_t file) {
+  auto in = fs_.fopen(FilePath(dir_, file, "hint").c_str());
+  if (in->status() != kOk) return false;
+  internal::WalSegmentReader reader(std::move(in), options_.read_buffer_size,
+                                    kHintHeaderSize + kMaxKeySize);
+  std::vector<std::pair<std::string, Location>> entries;
+  std::vector<byte> record;
+  bool complete = false;
+  while (reader.next(record)) {
+    if (complete) return false;
+    if (record.size() == kHintTrailerSize) {
+      if (LoadLeU32(&record[0]) != entries.size()) return false;
+      complete = true;
+      continue;
+    }
+    if (record.size() < kHintHeaderSize) return false;
+    entries.emplace_back(
+        std::string((const char*)&record[kHintHeaderSize],
+                    record.size() - kHintHeaderSize),
+        Location{file, LoadLeU32(&record[8]), LoadLeU64(&record[0])});
+  }
+  // If the hint file is damaged or incomplete, fall back to scanning the data
+  // file.
+  if (reader.status() != kEndOfStream || !complete) return false;
+  for (const auto& entry : entries) {
+    update(entry.first, &entry.second);
+  }
+  return true;
+}
+
+Status KvStore::scan(uint32_t file, uint64_t& valid_end) {
+  auto in = fs_.fopen(FilePath(dir_, file, "dat").c_str());
+  if (in->status() != kOk) return in->status();
+  internal::WalSegmentReader reader(std::move(in), options_.read_buffer_size,
+                                    options_.max_batch_size);
+  std::vector<byte> record;
+  valid_end = 0;
+  while (reader.next(record)) {
+    if (!apply(record.data(), record.size(), file,
+               reader.validEnd() - record.size())) {
+      break;
+    }
+    valid_end = reader.validEnd();
+  }
+  if (reader.status() != kOk && reader.status() != kEndOfStream &&
+      reader.status() != kInvalidFormat) {
+    return reader.status();
+  }
+  return kOk;
+}
+
+bool KvStore::apply(const byte* payload, size_t size, uint32_t file,
+                    uint64_t offset) {
+  // Validate first, so that a malformed batch is not applied partially.
+  if (!ForEachOp(payload, size,
+                 [](uint8_t, const char*, size_t, size_t, size_t) {})) {
+    return false;
+  }
+  ForEachOp(payload, size,
+            [&](uint8_t op, const char* key, size_t key_size,
+                size_t value_offset, size_t value_size) {
+              std::string k(key, key_size);
+              if (op == kPut) {
+                Location location{file, (uint32_t)value_size,
+                                  offset + value_offset};
+                update(k, &location);
+              } else {
+                update(k, nullptr);
+                // The tombstone itself.
+                garbage_bytes_ += EntryBytes(key_size, 0);
+              }
+            });
+  return true;
+}
+
+void KvStore::update(const std::string& key, const Location* location) {
+  auto itr = index_.find(key);
+  if (itr != index_.end()) {
+    uint64_t bytes = EntryBytes(key.size(), itr->second.size);
+    live_bytes_ -= bytes;
+    garbage_bytes_ += bytes;
+  }
+  if (location == nullptr) {
+    if (itr != index_.end()) index_.erase(itr);
+    return;
+  }
+  if (itr == index_.end()) {
+    index_.emplace(key, *location);
+  } else {
+    itr->second = *location;
+  }
+  live_bytes_ += EntryBytes(key.size(), location->size);
+}
+
+Status KvStore::startFile(uint32_t file) {
+  out_ = fs_.fopenForWrite(FilePath(dir_, file, "dat").c_str(),
+                           kFailIfExists);
+  if (out_->status() != kOk) return out_->status();
+  // Writes only sync the data; make the new directory entry durable, too.
+  if (options_.sync_level != kSyncNone) {
+    out_->sync(kSyncDataAndDirectory);
+    if (out_->status() != kOk) return out_->status();
+  }
+  files_.push_back(file);
+  active_size_ = 0;
+  return kOk;
+}
+
+Status KvStore::closeActive() {
+  out_->sync(options_.sync_level);
+  out_->close();
+  Status status = out_->status() == kClosed ? kOk : out_->status();
+  out_ = nullptr;
+  return status;
+}
+
+MultipassInputStream* KvStore::reader(uint32_t file) {
+  auto itr = readers_.find(file);
+  if (itr != readers_.end()) {
+    Status status = itr->second->status();
+    if (status == kOk || status == kEndOfStream) return itr->second.get();
+    readers_.erase(itr);
+  }
+  if (readers_.size() >= kMaxCachedReaders) readers_.erase(readers_.begin());
+  auto& in = readers_[file];
+  in = fs_.fopen(FilePath(dir_, file, "dat").c_str());
+  return in.get();
+}
+
+Status KvStore::get(const std::string& key, std::vector<byte>& value) {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ != kOk) return status_;
+  auto itr = index_.find(key);
+  if (itr == index_.end()) return kNotFound;
+  const Location& location = itr->second;
+  MultipassInputStream* in = reader(location.file);
+  in->seek(location.offset);
+  value.resize(location.size);
+  if (in->readFully(value.data(), location.size) < location.size) {
+    Status status = in->status();
+    readers_.erase(location.file);
+    value.clear();
+    return (status == kOk || status == kEndOfStream) ? kReadError : status;
+  }
+  return kOk;
+}
+
+Status KvStore::put(const std::string& key, const byte* data, size_t size) {
+  KvBatch batch;
+  batch.put(key, data, size);
+  return write(batch);
+}
+
+Status KvStore::remove(const std::string& key) {
+  KvBatch batch;
+  batch.remove(key);
+  if (!batch.valid_) return kOutOfRange;
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ != kOk) return status_;
+  if (index_.find(key) == index_.end()) return kNotFound;
+  return append(batch);
+}
+
+Status KvStore::write(const KvBatch& batch) {
+  if (!batch.valid_) return kOutOfRange;
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ != kOk) return status_;
+  if (batch.empty()) return kOk;
+  return append(batch);
+}
+
+Status KvStore::append(const KvBatch& batch) {
+  const byte* payload = batch.payload_.data();
+  size_t size = batch.payload_.size();
+  if (size > options_.max_batch_size) return kOutOfRange;
+  if (active_size_ > 0 &&
+      active_size_ + kWalRecordHeaderSize + size > options_.max_file_size) {
+    status_ = closeActive();
+    if (status_ == kOk) status_ = startFile(files_.back() + 1);
+    if (status_ != kOk) return status_;
+  }
+  byte header[kWalRecordHeaderSize];
+  internal::EncodeWalRecordHeader(payload, size, header);
+  out_->writeFully(header, kWalRecordHeaderSize);
+  out_->writeFully(payload, size);
+  out_->sync(options_.sync_level);
+  status_ = out_->status();
+  if (status_ != kOk) return status_;
+  apply(payload, size, files_.back(), active_size_ + kWalRecordHeaderSize);
+  active_size_ += kWalRecordHeaderSize + size;
+  maybeCompact();
+  return kOk;
+}
+
+KvIterator KvStore::iterate() {
+  std::vector<std::string> keys;
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ == kOk) {
+    keys.reserve(index_.size());
+    for (const auto& entry : index_) {
+      keys.push_back(entry.first);
+    }
+    std::sort(keys.begin(), keys.end());
+  }
+  return KvIterator(*this, std::move(keys), status_);
+}
+
+void KvStore::maybeCompact() {
+  if (options_.compaction_threshold == 0 || compacting_) return;
+  if (garbage_bytes_ < options_.compaction_threshold ||
+      garbage_bytes_ < live_bytes_) {
+    return;
+  }
+  // The previous compaction thread, if any, has finished (it cleared
+  // `compacting_` while holding the mutex).
+  if (compactor_.joinable()) compactor_.join();
+  compacting_ = true;
+  compactor_ = roo::thread([this]() {
+    roo::unique_lock<roo::mutex> lock(mutex_);
+    runCompaction(lock);
+  });
+}
+
+Status KvStore::compact() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (compacting_) {
+    idle_.wait(lock);
+  }
+  compacting_ = true;
+  return runCompaction(lock);
+}
+
+void KvStore::waitForCompaction() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (compacting_) {
+    idle_.wait(lock);
+  }
+}
+
+Status KvStore::runCompaction(roo::unique_lock<roo::mutex>& lock) {
+  Status status = status_;
+  if (status != kOk || (files_.size() == 1 && active_size_ == 0)) {
+    compacting_ = false;
+    idle_.notify_all();
+    return status;
+  }
+  // The compacted file takes the next number, so that on recovery it is
+  // loaded after the files it replaces, and before the new active one.
+  std::vector<uint32_t> inputs = files_;
+  uint32_t output = files_.back() + 1;
+  status_ = closeActive();
+  if (status_ == kOk) status_ = startFile(output + 1);
+  if (status_ != kOk) {
+    compacting_ = false;
+    idle_.notify_all();
+    return status_;
+  }
+  // Copy in file order, for sequential reads.
+  std::vector<std::pair<std::string, Location>> entries(index_.begin(),
+                                                        index_.end());
+  std::sort(entries.begin(), entries.end(),
+            [](const std::pair<std::string, Location>& a,
+               const std::pair<std::string, Location>& b) {
+              return a.second.file != b.second.file
+                         ? a.second.file < b.second.file
+                         : a.second.offset < b.second.offset;
+            });
+  uint64_t garbage_bytes = garbage_bytes_;
+
+  lock.unlock();
+  std::vector<Location> locations;
+  status = writeCompacted(output, entries, locations);
+  lock.lock();
+
+  if (status == kOk) {
+    files_.insert(std::lower_bound(files_.begin(), files_.end(), output),
+                  output);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      auto itr = index_.find(entries[i].first);
+      if (itr != index_.end() && itr->second.file == entries[i].second.file &&
+          itr->second.offset == entries[i].second.offset) {
+        itr->second = locations[i];
+      } else {
+        // Overwritten or removed during compaction.
+        garbage_bytes_ +=
+            EntryBytes(entries[i].first.size(), locations[i].size);
+      }
+    }
+    // The garbage accumulated so far goes away with the input files.
+    garbage_bytes_ -= std::min(garbage_bytes_, garbage_bytes);
+    // Remove in order, so that a crash midway cannot resurrect an entry whose
+    // tombstone is in a later file.
+    for (uint32_t file : inputs) {
+      readers_.erase(file);
+      status = fs_.remove(FilePath(dir_, file, "hint").c_str());
+      if (status == kOk || status == kNotFound) {
+        status = fs_.remove(FilePath(dir_, file, "dat").c_str());
+      }
+      if (status != kOk && status != kNotFound) break;
+      files_.erase(std::find(files_.begin(), files_.end(), file));
+      status = kOk;
+    }
+  }
+  compacting_ = false;
+  idle_.notify_all();
+  return status;
+}
+
+Status KvStore::writeCompacted(
+    uint32_t file,
+    const std::vector<std::pair<std::string, Location>>& entries,
+    std::vector<Location>& locations) {
+  {
+    // Written to a temporary file, renamed once complete. The inputs get
+    // removed afterwards, so the rename must be durable by then.
+    auto out = fs_.fopenForWrite(
+        FilePath(dir_, file, "dat").c_str(), kReplaceAtomically,
+        std::max(options_.sync_level, kSyncDataAndDirectory));
+    if (out->status() != kOk) return out->status();
+    std::unique_ptr<MultipassInputStream> in;
+    uint32_t in_file = 0;
+    std::vector<byte> value;
+    KvBatch batch;
+    byte header[kWalRecordHeaderSize];
+    uint64_t offset = 0;
+    for (const auto& entry : entries) {
+      const Location& location = entry.second;
+      if (in == nullptr || in_file != location.file) {
+        in_file = location.file;
+        in = fs_.fopen(FilePath(dir_, in_file, "dat").c_str());
+        if (in->status() != kOk) return in->status();
+      }
+      value.resize(location.size);
+      in->seek(location.offset);
+      if (in->readFully(value.data(), location.size) < location.size) {
+        Status status = in->status();
+        return (status == kOk || status == kEndOfStream) ? kReadError : status;
+      }
+      batch.clear();
+      batch.put(entry.first, value.data(), value.size());
+      internal::EncodeWalRecordHeader(batch.payload_.data(),
+                                      batch.payload_.size(), header);
+      out->writeFully(header, kWalRecordHeaderSize);
+      out->writeFully(batch.payload_.data(), batch.payload_.size());
+      if (out->status() != kOk) return out->status();
+      locations.push_back(
+          Location{file, location.size,
+                   offset + kWalRecordHeaderSize +
+                       EntryBytes(entry.first.size(), 0)});
+      offset += kWalRecordHeaderSize + batch.payload_.size();
+    }
+    out->close();
+    if (out->status() != kClosed) return out->status();
+  }
+
+  // The hint file only speeds up recovery; if writing it fails, the data
+  // file gets scanned instead. It is replaced atomically, and synced first
+  // (whatever the sync level), so that a crash cannot leave a partial one.
+  std::string hint_path = FilePath(dir_, file, "hint");
+  auto hint =
+      fs_.fopenForWrite(hint_path.c_str(), kReplaceAtomically,
+                        std::max(options_.sync_level, kSyncData));
+  std::vector<byte> record;
+  byte header[kWalRecordHeaderSize];
+  for (size_t i = 0; i < entries.size() && hint->status() == kOk; ++i) {
+    const std::string& key = entries[i].first;
+    record.resize(kHintHeaderSize + key.size());
+    StoreLeU64(locations[i].offset, &record[0]);
+    StoreLeU32(locations[i].size, &record[8]);
+    memcpy(&record[kHintHeaderSize], key.data(), key.size());
+    internal::EncodeWalRecordHeader(record.data(), record.size(), header);
+    hint->writeFully(header, kWalRecordHeaderSize);
+    hint->writeFully(record.data(), record.size());
+  }
+  record.resize(kHintTrailerSize);
+  StoreLeU32(entries.size(), &record[0]);
+  internal::EncodeWalRecordHeader(record.data(), record.size(), header);
+  hint->writeFully(header, kWalRecordHeaderSize);
+  hint->writeFully(record.data(), record.size());
+  hint->close();
+  if (hint->status() != kClosed) fs_.remove(hint_path.c_str());
+  return kOk;
+}
+
+Status KvStore::close() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (compacting_) {
+    idle_.wait(lock);
+  }
+  if (compactor_.joinable()) compactor_.join();
+  if (out_ == nullptr) return status_ == kClosed ? kOk : status_;
+  Status status = status_;
+  if (status == kOk) status = closeActive();
+  out_ = nullptr;
+  readers_.clear();
+  index_.clear();
+  files_.clear();
+  status_ = (status == kOk) ? kClosed : status;
+  return status;
+}
+
+Status KvStore::status() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return status_;
+}
+
+size_t KvStore::size() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return index_.size();
+}
+
+size_t KvStore::fileCount() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return files_.size();
+}
+
+}  // namespace roo_io
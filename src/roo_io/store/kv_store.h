@@ -0,0 +1,263 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/output_stream.h"
+#include "roo_io/core/sync_level.h"
+#include "roo_io/fs/mount.h"
+#include "roo_io/status.h"
+#include "roo_threads.h"
+#include "roo_threads/condition_variable.h"
+#include "roo_threads/mutex.h"
+#include "roo_threads/thread.h"
+
+namespace roo_io {
+
+/// Configuration of a `KvStore`.
+struct KvStoreOptions {
+  /// Once the active data file reaches this size, the next write starts a new
+  /// one.
+  uint64_t max_file_size = 256 * 1024;
+
+  /// Larger batches (including single puts) are rejected.
+  uint32_t max_batch_size = 64 * 1024;
+
+  /// Durability of each write. (Compaction output is always synced along with
+  /// its directory entry, before the inputs get removed.)
+  SyncLevel sync_level = kSyncData;
+
+  /// Once the store accumulates this many bytes of overwritten and deleted
+  /// entries, and they outweigh the live ones, a write starts compaction in
+  /// a background thread. Zero disables automatic compaction; call
+  /// `compact()` instead.
+  uint64_t compaction_threshold = 64 * 1024;
+
+  /// Size of the buffer used for scanning data files on startup.
+  size_t read_buffer_size = 4096;
+};
+
+/// Group of puts and removals, applied by `KvStore::write()` atomically: after
+/// a crash, either all of them are in effect, or none.
+class KvBatch {
+ public:
+  KvBatch() : valid_(true) {}
+
+  /// Sets the value of `key`.
+  void put(const std::string& key, const byte* data, size_t size);
+
+  /// Removes `key`.
+  void remove(const std::string& key);
+
+  /// Removes all the operations from the batch.
+  void clear();
+
+  /// Returns whether the batch has no operations.
+  bool empty() const { return payload_.empty(); }
+
+ private:
+  friend class KvStore;
+
+  std::vector<byte> payload_;
+
+  // False if a key was too long.
+  bool valid_;
+};
+
+class KvStore;
+
+/// Iterates over the entries of a `KvStore`, in key order. Obtained from
+/// `KvStore::iterate()`.
+///
+/// The set of keys is captured when the iterator is created; values are read
+/// as the iterator advances. Keys removed in the meantime are skipped.
+class KvIterator {
+ public:
+  /// Advances to the next entry. Returns false if there are no more entries,
+  /// or on error.
+  bool next();
+
+  /// Returns the key of the current entry.
+  const std::string& key() const { return keys_[pos_ - 1]; }
+
+  /// Returns the value of the current entry.
+  const std::vector<byte>& value() const { return value_; }
+
+  /// Returns `kOk` while entries are being read, `kEndOfStream` once all of
+  /// them have been read, or an error.
+  Status status() const { return status_; }
+
+ private:
+  friend class KvStore;
+
+  KvIterator(KvStore& store, std::vector<std::string> keys, Status status);
+
+  KvStore* store_;
+  std::vector<std::string> keys_;
+  size_t pos_;
+  std::vector<byte> value_;
+  Status status_;
+};
+
+/// Log-structured (Bitcask-style) key-value store in a directory of a mounted
+/// filesystem.
+///
+/// Writes are appended to the active data file (`00000001.dat`,
+/// `00000002.dat`, and so on), as records framed like those of a `Wal`; each
+/// record holds one batch. An in-memory hash index maps every key to the
+/// location of its latest value, so that `get()` costs a single seek and
+/// read. Removals are recorded as tombstones.
+///
+/// Overwritten and removed entries leave garbage behind. Compaction copies
+/// the live entries of all the older data files into a new one, alongside a
+/// hint file (`.hint`) that lists its keys and value locations, and then
+/// deletes the old files. It runs concurrently with reads and writes. On
+/// startup, the index is rebuilt from hint files where available and
+/// complete, and by scanning the data files otherwise; a torn batch at the end of the active
+/// file is discarded.
+///
+/// Thread-safe.
+class KvStore {
+ public:
+  /// Creates a store in the directory `dir` of `fs`. Call `open()` before
+  /// use.
+  KvStore(Mount& fs, const char* dir,
+          KvStoreOptions options = KvStoreOptions());
+
+  /// Closes the store.
+  ~KvStore();
+
+  /// Creates the directory if needed, rebuilds the index, and opens the
+  /// active data file.
+  Status open();
+
+  /// Reads the value of `key` into `value`.
+  ///
+  /// @return `kOk` on success; `kNotFound` if there is no such key; or an
+  /// error.
+  Status get(const std::string& key, std::vector<byte>& value);
+
+  /// Sets the value of `key`.
+  Status put(const std::string& key, const byte* data, size_t size);
+
+  /// Removes `key`.
+  ///
+  /// @return `kOk` on success; `kNotFound` if there is no such key; or an
+  /// error.
+  Status remove(const std::string& key);
+
+  /// Applies all the operations of the batch, atomically.
+  ///
+  /// @return `kOk` on success; `kOutOfRange` if the batch is larger than
+  /// `max_batch_size`, or has a key longer than 65535 bytes; or the error
+  /// that made the store fail.
+  Status write(const KvBatch& batch);
+
+  /// Returns an iterator over all the entries.
+  KvIterator iterate();
+
+  /// Rewrites the live entries of all the data files but the active one, and
+  /// removes the old files. Blocks until done. Reads and writes may proceed
+  /// meanwhile.
+  Status compact();
+
+  /// Blocks until the compaction in progress, if any, finishes.
+  void waitForCompaction();
+
+  /// Waits for compaction to finish, and closes the store. Returns `kOk` on
+  /// success, or an error.
+  Status close();
+
+  /// Returns `kOk` if the store is open and healthy; `kClosed` if it is not
+  /// open; or the error that made it fail.
+  Status status() const;
+
+  /// Returns the number of keys.
+  size_t size() const;
+
+  /// Returns the number of data files.
+  size_t fileCount() const;
+
+ private:
+  struct Location {
+    uint32_t file;
+    uint32_t size;
+    uint64_t offset;
+  };
+
+  // Finds the data files, rebuilds the index, and recovers the active file.
+  Status recover();
+
+  // Loads the index from the hint file of the data file, if intact.
+  bool loadHint(uint32_t file);
+
+  // Loads the index from the data file. Returns the offset past its last
+  // intact record.
+  Status scan(uint32_t file, uint64_t& valid_end);
+
+  // Applies the batch, stored at `offset` of the data file, to the index.
+  // Returns false if the batch is malformed.
+  bool apply(const byte* payload, size_t size, uint32_t file, uint64_t offset);
+
+  // Sets the location of the key's value, or removes the key if `location`
+  // is null.
+  void update(const std::string& key, const Location* location);
+
+  // Creates a new data file, and opens it for appending. Called with the
+  // mutex held.
+  Status startFile(uint32_t file);
+
+  // Syncs and closes the active file. Called with the mutex held.
+  Status closeActive();
+
+  // Writes the batch to the active file, and applies it. Called with the
+  // mutex held.
+  Status append(const KvBatch& batch);
+
+  // Compacts the store. Called with the mutex held, and `compacting_` set;
+  // releases the mutex while copying.
+  Status runCompaction(roo::unique_lock<roo::mutex>& lock);
+
+  // Writes the live entries to the data file, and fills in their new
+  // locations. Called without the mutex held.
+  Status writeCompacted(uint32_t file,
+                        const std::vector<std::pair<std::string, Location>>&
+                            entries,
+                        std::vector<Location>& locations);
+
+  // Starts compaction in the background, if warranted. Called with the mutex
+  // held.
+  void maybeCompact();
+
+  // Returns a (cached) input stream for reading the data file. Called with
+  // the mutex held.
+  MultipassInputStream* reader(uint32_t file);
+
+  Mount& fs_;
+  std::string dir_;
+  KvStoreOptions options_;
+
+  mutable roo::mutex mutex_;
+  roo::condition_variable idle_;
+  std::unordered_map<std::string, Location> index_;
+  std::vector<uint32_t> files_;
+  std::map<uint32_t, std::unique_ptr<MultipassInputStream>> readers_;
+  std::unique_ptr<OutputStream> out_;
+  uint64_t active_size_;
+  Status status_;
+
+  // Approximate number of bytes taken by live, and by dead entries.
+  uint64_t live_bytes_;
+  uint64_t garbage_bytes_;
+
+  bool compacting_;
+  roo::thread compactor_;
+};
+
+}  // namespace roo_io
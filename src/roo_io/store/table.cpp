@@ -0,0 +1,393 @@
+#include "roo_io/store/table.h"
+
+#include <algorithm>
+
+#include "roo_io/data/crc32c.h"
+#include "roo_io/data/varint.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/store.h"
+
+namespace roo_io {
+
+namespace {
+
+// Each block (data, filter, or index) is followed by a trailer: the
+// compression type (1 byte; only kNoCompression is defined), and the
+// little-endian CRC-32C of the block contents and the compression type.
+constexpr size_t kBlockTrailerSize = 5;
+constexpr uint8_t kNoCompression = 0;
+
+// Footer: little-endian index offset (8 bytes) and size (4 bytes), filter
+// offset (8 bytes) and size (4 bytes; zero if there is no filter), and magic.
+constexpr size_t kFooterSize = 28;
+constexpr uint32_t kTableMagic = 0x4C425452;  // "RTBL".
+
+// Decodes the entry at `pos` of the block, advancing `pos`. `key` must hold
+// the previous key (empty at the start of the block), and receives the
+// current one. Returns false if the entry is malformed.
+bool DecodeEntry(const byte* data, size_t size, size_t& pos, std::string& key,
+                 size_t& value_offset, size_t& value_size) {
+  uint64_t shared;
+  uint64_t unshared;
+  uint64_t length;
+  size_t n = internal::DecodeVarintU64(data + pos, size - pos, shared);
+  if (n == 0) return false;
+  pos += n;
+  n = internal::DecodeVarintU64(data + pos, size - pos, unshared);
+  if (n == 0) return false;
+  pos += n;
+  n = internal::DecodeVarintU64(data + pos, size - pos, length);
+  if (n == 0) return false;
+  pos += n;
+  if (shared > key.size() || unshared > size - pos ||
+      length > size - pos - unshared) {
+    return false;
+  }
+  key.resize(shared);
+  key.append((const char*)data + pos, unshared);
+  pos += unshared;
+  value_offset = pos;
+  value_size = length;
+  pos += length;
+  return true;
+}
+
+void AppendVarint(uint64_t v, std::vector<byte>& target) {
+  byte buf[10];
+  size_t n = EncodeVarintU64(v, buf);
+  target.insert(target.end(), buf, buf + n);
+}
+
+// FNV-1a, followed by the MurmurHash3 finalizer for better bit dispersion.
+uint32_t BloomHash(const std::string& key) {
+  uint32_t h = 2166136261u;
+  for (char c : key) {
+    h = (h ^ (uint8_t)c) * 16777619u;
+  }
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  return h;
+}
+
+// The filter sets `probes` bits per key, chosen by double hashing.
+void BloomAdd(byte* filter, size_t filter_size, int probes, uint32_t h) {
+  size_t bits = filter_size * 8;
+  uint32_t delta = (h >> 17) | (h << 15);
+  for (int i = 0; i < probes; ++i) {
+    size_t bit = h % bits;
+    filter[bit / 8] |= (byte)(1 << (bit % 8));
+    h += delta;
+  }
+}
+
+bool BloomMayContain(const byte* filter, size_t filter_size, int probes,
+                     uint32_t h) {
+  size_t bits = filter_size * 8;
+  uint32_t delta = (h >> 17) | (h << 15);
+  for (int i = 0; i < probes; ++i) {
+    size_t bit = h % bits;
+    if ((filter[bit / 8] & (byte)(1 << (bit % 8))) == byte{0}) return false;
+    h += delta;
+  }
+  return true;
+}
+
+}  // namespace
+
+TableWriter::TableWriter(OutputStream& out, TableOptions options)
+    : out_(out),
+      options_(options),
+      offset_(0),
+      entry_count_(0),
+      status_(out.status()) {}
+
+Status TableWriter::add(const std::string& key, const byte* value,
+                        size_t size) {
+  if (status_ != kOk) return status_;
+  if (entry_count_ > 0 && key <= last_key_) return kInvalidFormat;
+  size_t shared = 0;
+  if (!block_.empty()) {
+    size_t limit = std::min(key.size(), last_key_.size());
+    while (shared < limit && key[shared] == last_key_[shared]) ++shared;
+  }
+  AppendVarint(shared, block_);
+  AppendVarint(key.size() - shared, block_);
+  AppendVarint(size, block_);
+  block_.insert(block_.end(), (const byte*)key.data() + shared,
+                (const byte*)key.data() + key.size());
+  block_.insert(block_.end(), value, value + size);
+  last_key_ = key;
+  if (options_.bloom_bits_per_key > 0) hashes_.push_back(BloomHash(key));
+  ++entry_count_;
+  if (block_.size() >= options_.block_size) flushBlock();
+  return status_;
+}
+
+void TableWriter::flushBlock() {
+  if (block_.empty()) return;
+  index_.push_back(
+      IndexEntry{last_key_, offset_,
+                 (uint32_t)(block_.size() + kBlockTrailerSize)});
+  writeBlock(block_);
+  block_.clear();
+}
+
+void TableWriter::writeBlock(std::vector<byte>& block) {
+  block.push_back((byte)kNoCompression);
+  uint32_t crc = Crc32c(block.data(), block.size());
+  block.resize(block.size() + 4);
+  StoreLeU32(crc, &block[block.size() - 4]);
+  out_.writeFully(block.data(), block.size());
+  offset_ += block.size();
+  status_ = out_.status();
+}
+
+Status TableWriter::finish() {
+  if (status_ != kOk) return status_;
+  flushBlock();
+
+  uint64_t filter_offset = 0;
+  uint32_t filter_size = 0;
+  if (!hashes_.empty()) {
+    size_t bits =
+        std::max<size_t>(64, hashes_.size() * options_.bloom_bits_per_key);
+    size_t bytes = (bits + 7) / 8;
+    // ln(2) * bits per key minimizes the false positive rate.
+    int probes = std::min(std::max(options_.bloom_bits_per_key * 69 / 100, 1),
+                          30);
+    std::vector<byte> filter(bytes + 1, byte{0});
+    for (uint32_t h : hashes_) {
+      BloomAdd(filter.data(), bytes, probes, h);
+    }
+    filter[bytes] = (byte)probes;
+    filter_offset = offset_;
+    filter_size = filter.size() + kBlockTrailerSize;
+    writeBlock(filter);
+  }
+
+  std::vector<byte> index;
+  for (const IndexEntry& entry : index_) {
+    AppendVarint(entry.last_key.size(), index);
+    index.insert(index.end(), (const byte*)entry.last_key.data(),
+                 (const byte*)entry.last_key.data() + entry.last_key.size());
+    AppendVarint(entry.offset, index);
+    AppendVarint(entry.size, index);
+  }
+  uint64_t index_offset = offset_;
+  uint32_t index_size = index.size() + kBlockTrailerSize;
+  writeBlock(index);
+
+  byte footer[kFooterSize];
+  StoreLeU64(index_offset, footer);
+  StoreLeU32(index_size, footer + 8);
+  StoreLeU64(filter_offset, footer + 12);
+  StoreLeU32(filter_size, footer + 20);
+  StoreLeU32(kTableMagic, footer + 24);
+  out_.writeFully(footer, kFooterSize);
+  status_ = out_.status();
+  if (status_ != kOk) return status_;
+  status_ = kClosed;
+  return kOk;
+}
+
+TableIterator::TableIterator(TableReader& reader)
+    : reader_(&reader),
+      next_block_(0),
+      pos_(0),
+      value_offset_(0),
+      value_size_(0),
+      status_(reader.status()) {}
+
+void TableIterator::seek(const std::string& key) {
+  if (status_ != kOk && status_ != kEndOfStream) return;
+  status_ = kOk;
+  block_.clear();
+  pos_ = 0;
+  key_.clear();
+  next_block_ = reader_->findBlock(key);
+  if (next_block_ == reader_->index_.size()) return;
+  const TableReader::IndexEntry& entry = reader_->index_[next_block_++];
+  status_ = reader_->readBlock(entry.offset, entry.size, block_);
+  if (status_ != kOk) return;
+  // Stop right before the first entry not less than `key`.
+  size_t pos = 0;
+  std::string previous;
+  while (pos < block_.size()) {
+    size_t start = pos;
+    std::string current = previous;
+    size_t value_offset;
+    size_t value_size;
+    if (!DecodeEntry(block_.data(), block_.size(), pos, current, value_offset,
+                     value_size)) {
+      status_ = kInvalidFormat;
+      return;
+    }
+    if (current >= key) {
+      pos_ = start;
+      key_ = std::move(previous);
+      return;
+    }
+    previous = std::move(current);
+  }
+  pos_ = block_.size();
+}
+
+bool TableIterator::next() {
+  while (status_ == kOk) {
+    if (pos_ < block_.size()) {
+      if (!DecodeEntry(block_.data(), block_.size(), pos_, key_,
+                       value_offset_, value_size_)) {
+        status_ = kInvalidFormat;
+        break;
+      }
+      return true;
+    }
+    if (next_block_ == reader_->index_.size()) {
+      status_ = kEndOfStream;
+      break;
+    }
+    const TableReader::IndexEntry& entry = reader_->index_[next_block_++];
+    status_ = reader_->readBlock(entry.offset, entry.size, block_);
+    pos_ = 0;
+    key_.clear();
+  }
+  value_size_ = 0;
+  return false;
+}
+
+TableReader::TableReader(std::unique_ptr<MultipassInputStream> in)
+    : in_(std::move(in)), filter_probes_(0), status_(kClosed) {}
+
+Status TableReader::open() {
+  if (status_ == kOk) return kOk;
+  index_.clear();
+  filter_.clear();
+  status_ = in_->status();
+  if (status_ != kOk) return status_;
+  uint64_t size = in_->size();
+  status_ = in_->status();
+  if (status_ != kOk) return status_;
+  if (size < kFooterSize) return status_ = kInvalidFormat;
+  byte footer[kFooterSize];
+  in_->seek(size - kFooterSize);
+  if (in_->readFully(footer, kFooterSize) < kFooterSize) {
+    status_ = in_->status() == kEndOfStream ? kInvalidFormat : in_->status();
+    return status_;
+  }
+  uint64_t index_offset = LoadLeU64(footer);
+  uint32_t index_size = LoadLeU32(footer + 8);
+  uint64_t filter_offset = LoadLeU64(footer + 12);
+  uint32_t filter_size = LoadLeU32(footer + 20);
+  uint64_t data_end = size - kFooterSize;
+  if (LoadLeU32(footer + 24) != kTableMagic || index_offset > data_end ||
+      index_size > data_end - index_offset || filter_offset > data_end ||
+      filter_size > data_end - filter_offset) {
+    return status_ = kInvalidFormat;
+  }
+
+  std::vector<byte> index;
+  status_ = readBlock(index_offset, index_size, index);
+  if (status_ != kOk) return status_;
+  size_t pos = 0;
+  while (pos < index.size()) {
+    uint64_t key_size;
+    uint64_t offset;
+    uint64_t block_size;
+    size_t n =
+        internal::DecodeVarintU64(&index[pos], index.size() - pos, key_size);
+    if (n == 0 || key_size > index.size() - pos - n) break;
+    pos += n;
+    std::string key((const char*)&index[pos], key_size);
+    pos += key_size;
+    n = internal::DecodeVarintU64(&index[pos], index.size() - pos, offset);
+    if (n == 0) break;
+    pos += n;
+    n = internal::DecodeVarintU64(&index[pos], index.size() - pos, block_size);
+    if (n == 0) break;
+    pos += n;
+    if (offset > index_offset || block_size > index_offset - offset) break;
+    index_.push_back(IndexEntry{std::move(key), offset, (uint32_t)block_size});
+  }
+  if (pos < index.size()) {
+    index_.clear();
+    return status_ = kInvalidFormat;
+  }
+
+  if (filter_size > 0) {
+    status_ = readBlock(filter_offset, filter_size, filter_);
+    if (status_ != kOk) return status_;
+    if (filter_.size() < 2) return status_ = kInvalidFormat;
+    filter_probes_ = (int)filter_.back();
+    filter_.pop_back();
+    if (filter_probes_ < 1 || filter_probes_ > 30) {
+      filter_.clear();
+      return status_ = kInvalidFormat;
+    }
+  }
+  return status_ = kOk;
+}
+
+Status TableReader::readBlock(uint64_t offset, uint32_t size,
+                              std::vector<byte>& block) {
+  if (size < kBlockTrailerSize) return kInvalidFormat;
+  block.resize(size);
+  in_->seek(offset);
+  if (in_->readFully(block.data(), size) < size) {
+    Status status = in_->status();
+    return (status == kOk || status == kEndOfStream) ? kInvalidFormat : status;
+  }
+  size_t contents = size - kBlockTrailerSize;
+  if (Crc32c(block.data(), contents + 1) != LoadLeU32(&block[contents + 1])) {
+    return kInvalidFormat;
+  }
+  // Compressed blocks are reserved for future versions of the format.
+  if ((uint8_t)block[contents] != kNoCompression) return kInvalidFormat;
+  block.resize(contents);
+  return kOk;
+}
+
+size_t TableReader::findBlock(const std::string& key) const {
+  return std::lower_bound(index_.begin(), index_.end(), key,
+                          [](const IndexEntry& entry, const std::string& key) {
+                            return entry.last_key < key;
+                          }) -
+         index_.begin();
+}
+
+bool TableReader::mayContain(const std::string& key) const {
+  if (filter_.empty()) return true;
+  return BloomMayContain(filter_.data(), filter_.size(), filter_probes_,
+                         BloomHash(key));
+}
+
+Status TableReader::get(const std::string& key, std::vector<byte>& value) {
+  if (status_ != kOk) return status_;
+  if (!mayContain(key)) return kNotFound;
+  size_t i = findBlock(key);
+  if (i == index_.size()) return kNotFound;
+  Status status = readBlock(index_[i].offset, index_[i].size, block_);
+  if (status != kOk) return status;
+  std::string current;
+  size_t pos = 0;
+  while (pos < block_.size()) {
+    size_t value_offset;
+    size_t value_size;
+    if (!DecodeEntry(block_.data(), block_.size(), pos, current, value_offset,
+                     value_size)) {
+      return kInvalidFormat;
+    }
+    int cmp = current.compare(key);
+    if (cmp == 0) {
+      value.assign(block_.begin() + value_offset,
+                   block_.begin() + value_offset + value_size);
+      return kOk;
+    }
+    if (cmp > 0) break;
+  }
+  return kNotFound;
+}
+
+}  // namespace roo_io
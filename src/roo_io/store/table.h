@@ -0,0 +1,207 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/output_stream.h"
+#include "roo_io/status.h"
+
+namespace roo_io {
+
+/// Configuration of a `TableWriter`.
+struct TableOptions {
+  /// Approximate size of data blocks, before their trailer. Each lookup reads
+  /// one block; smaller blocks mean less data read per lookup, but a larger
+  /// index (kept in memory by `TableReader`).
+  size_t block_size = 4096;
+
+  /// Size of the bloom filter, in bits per key. 10 bits give about 1% false
+  /// positives. Zero omits the filter.
+  int bloom_bits_per_key = 10;
+};
+
+/// Writes a sorted, immutable key-value table (SSTable), for reading with
+/// `TableReader`.
+///
+/// Entries must be added in strictly increasing key order (as compared by
+/// `std::string`, i.e. bytewise). They are grouped into data blocks, in which
+/// each key is stored as the length of the prefix it shares with the previous
+/// key, followed by the rest. After the data blocks, `finish()` writes the
+/// bloom filter, the block index (the last key, offset, and size of each
+/// block), and a fixed-size footer pointing at both. Blocks and the index
+/// carry CRC-32C checksums.
+///
+/// Example:
+///
+/// ```
+/// auto out = fs.fopenForWrite("/calibration.tbl", kTruncateIfExists);
+/// TableWriter writer(*out);
+/// for (const auto& entry : sorted_entries) {
+///   writer.add(entry.key, entry.data, entry.size);
+/// }
+/// writer.finish();
+/// out->close();
+/// ```
+class TableWriter {
+ public:
+  /// Creates a writer appending the table to `out`, which must stay valid
+  /// until `finish()`. The writer does not close `out`.
+  TableWriter(OutputStream& out, TableOptions options = TableOptions());
+
+  /// Adds an entry.
+  ///
+  /// @return `kOk` on success; `kInvalidFormat` if the key does not follow the
+  /// previous one in order (the entry is then not added); or the error that
+  /// made the writer fail.
+  Status add(const std::string& key, const byte* value, size_t size);
+
+  /// Writes the remaining data, the filter, the index, and the footer.
+  ///
+  /// @return `kOk` on success, or an error.
+  Status finish();
+
+  /// Returns the number of entries added so far.
+  uint64_t entryCount() const { return entry_count_; }
+
+  /// Returns `kOk` while entries can be added; `kClosed` after `finish()`;
+  /// or the error that made the writer fail.
+  Status status() const { return status_; }
+
+ private:
+  struct IndexEntry {
+    std::string last_key;
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  // Writes the current data block, and adds it to the index.
+  void flushBlock();
+
+  // Writes the block, followed by its trailer.
+  void writeBlock(std::vector<byte>& block);
+
+  OutputStream& out_;
+  TableOptions options_;
+  std::vector<byte> block_;
+  std::string last_key_;
+  std::vector<IndexEntry> index_;
+  std::vector<uint32_t> hashes_;
+  uint64_t offset_;
+  uint64_t entry_count_;
+  Status status_;
+};
+
+class TableReader;
+
+/// Iterates over the entries of a table, in key order. Obtained from
+/// `TableReader::iterate()`.
+class TableIterator {
+ public:
+  TableIterator(TableIterator&& other) = default;
+
+  /// Positions the iterator so that the next call to `next()` returns the
+  /// first entry with a key not less than `key`.
+  void seek(const std::string& key);
+
+  /// Advances to the next entry. Returns false if there are no more entries,
+  /// or on error.
+  bool next();
+
+  /// Returns the key of the current entry.
+  const std::string& key() const { return key_; }
+
+  /// Returns the value of the current entry, or null if there is none.
+  const byte* value() const {
+    return status_ != kOk || block_.empty() ? nullptr : &block_[value_offset_];
+  }
+
+  /// Returns the size of the value of the current entry.
+  size_t size() const { return value_size_; }
+
+  /// Returns `kOk` while entries are being read, `kEndOfStream` once all of
+  /// them have been read, or an error.
+  Status status() const { return status_; }
+
+ private:
+  friend class TableReader;
+
+  TableIterator(TableReader& reader);
+
+  TableReader* reader_;
+  size_t next_block_;
+  std::vector<byte> block_;
+  size_t pos_;
+  std::string key_;
+  size_t value_offset_;
+  size_t value_size_;
+  Status status_;
+};
+
+/// Reads a table written by `TableWriter`.
+///
+/// `open()` loads the footer, the block index, and the bloom filter into
+/// memory. After that, `get()` costs a filter probe, a binary search of the
+/// index, and (unless the filter rules the key out) a single positional read
+/// of one data block.
+///
+/// Not thread-safe; use a separate reader per thread.
+class TableReader {
+ public:
+  /// Creates a reader of the table in `in`. Call `open()` before use.
+  TableReader(std::unique_ptr<MultipassInputStream> in);
+
+  /// Loads the table metadata.
+  ///
+  /// @return `kOk` on success; `kInvalidFormat` if the stream does not
+  /// contain a valid table; or an I/O error.
+  Status open();
+
+  /// Reads the value of `key` into `value`.
+  ///
+  /// @return `kOk` on success; `kNotFound` if there is no such key;
+  /// `kInvalidFormat` if the block is corrupted; or an I/O error.
+  Status get(const std::string& key, std::vector<byte>& value);
+
+  /// Returns false if the table definitely does not contain `key`, per the
+  /// bloom filter. Returns true if it might (or if there is no filter).
+  bool mayContain(const std::string& key) const;
+
+  /// Returns an iterator over the entries, starting at the first one.
+  TableIterator iterate() { return TableIterator(*this); }
+
+  /// Returns the number of data blocks.
+  size_t blockCount() const { return index_.size(); }
+
+  /// Returns `kOk` if the table is open; `kClosed` if it is not; or the
+  /// error that made `open()` fail.
+  Status status() const { return status_; }
+
+ private:
+  friend class TableIterator;
+
+  struct IndexEntry {
+    std::string last_key;
+    uint64_t offset;
+    uint32_t size;
+  };
+
+  // Returns the index of the first block that may contain `key`, or
+  // `blockCount()` if none.
+  size_t findBlock(const std::string& key) const;
+
+  // Reads the contents of the block at `offset`, verifying its trailer.
+  Status readBlock(uint64_t offset, uint32_t size, std::vector<byte>& block);
+
+  std::unique_ptr<MultipassInputStream> in_;
+  std::vector<IndexEntry> index_;
+  std::vector<byte> filter_;
+  int filter_probes_;
+  std::vector<byte> block_;
+  Status status_;
+};
+
+}  // namespace roo_io
@@ -0,0 +1,425 @@
+#include "roo_io/store/wal.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "roo_io/data/crc32c.h"
+#include "roo_io/fs/fsutil.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/store.h"
+
+namespace roo_io {
+
+namespace {
+
+constexpr size_t kHeaderSize = internal::kWalRecordHeaderSize;
+
+uint32_t RecordCrc(const byte* header, const byte* data, size_t size) {
+  return Crc32c(data, size, Crc32c(header, 4));
+}
+
+std::string SegmentPath(const std::string& dir, uint32_t segment) {
+  char name[16];
+  snprintf(name, sizeof(name), "/%08" PRIx32 ".wal", segment);
+  return dir + name;
+}
+
+// Parses a segment file name ("0000002a.wal"). Returns 0 if not a segment.
+uint32_t ParseSegmentName(const char* name) {
+  if (strlen(name) != 12 || strcmp(name + 8, ".wal") != 0) return 0;
+  uint32_t segment = 0;
+  for (int i = 0; i < 8; ++i) {
+    char c = name[i];
+    int digit = (c >= '0' && c <= '9')   ? c - '0'
+                : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                                         : -1;
+    if (digit < 0) return 0;
+    segment = (segment << 4) | digit;
+  }
+  return segment;
+}
+
+}  // namespace
+
+namespace internal {
+
+void EncodeWalRecordHeader(const byte* data, size_t size, byte* header) {
+  StoreLeU32(size, header);
+  StoreLeU32(RecordCrc(header, data, size), header + 4);
+}
+
+WalSegmentReader::WalSegmentReader(std::unique_ptr<MultipassInputStream> in,
+                                   size_t buffer_size,
+                                   uint32_t max_record_size)
+    : in_(std::move(in)),
+      buffer_(new byte[buffer_size]),
+      buffer_size_(buffer_size),
+      buffer_pos_(0),
+      buffer_end_(0),
+      max_record_size_(max_record_size),
+      valid_end_(0),
+      status_(in_->status()) {}
+
+size_t WalSegmentReader::read(byte* target, size_t count) {
+  size_t total = 0;
+  while (total < count) {
+    if (buffer_pos_ == buffer_end_) {
+      if (count - total >= buffer_size_) {
+        // Large payload; bypass the buffer.
+        size_t n = in_->readFully(target + total, count - total);
+        total += n;
+        break;
+      }
+      buffer_pos_ = 0;
+      buffer_end_ = in_->readFully(buffer_.get(), buffer_size_);
+      if (buffer_end_ == 0) break;
+    }
+    size_t n = std::min(count - total, buffer_end_ - buffer_pos_);
+    memcpy(target + total, &buffer_[buffer_pos_], n);
+    buffer_pos_ += n;
+    total += n;
+  }
+  return total;
+}
+
+bool WalSegmentReader::next(std::vector<byte>& record) {
+  if (status_ != kOk) return false;
+  byte header[kHeaderSize];
+  size_t n = read(header, kHeaderSize);
+  if (n < kHeaderSize) {
+    Status s = in_->status();
+    status_ = (s != kOk && s != kEndOfStream) ? s
+              : (n == 0)                      ? kEndOfStream
+                                              : kInvalidFormat;
+    return false;
+  }
+  uint32_t size = LoadLeU32(header);
+  if (size > max_record_size_) {
+    status_ = kInvalidFormat;
+    return false;
+  }
+  record.resize(size);
+  if (read(record.data(), size) < size) {
+    Status s = in_->status();
+    status_ = (s != kOk && s != kEndOfStream) ? s : kInvalidFormat;
+    return false;
+  }
+  if (RecordCrc(header, record.data(), size) != LoadLeU32(header + 4)) {
+    status_ = kInvalidFormat;
+    return false;
+  }
+  valid_end_ += kHeaderSize + size;
+  return true;
+}
+
+std::string TempFileTarget(const char* name) {
+  for (const char* tmp = strstr(name, ".tmp"); tmp != nullptr;
+       tmp = strstr(tmp + 1, ".tmp")) {
+    if (tmp != name && (tmp[4] == '\0' || tmp[4] == '.')) {
+      return std::string(name, tmp - name);
+    }
+  }
+  return std::string();
+}
+
+Status AdoptTempFiles(Mount& fs,
+                      std::vector<std::pair<uint32_t, std::string>> temps,
+                      std::vector<uint32_t>& files,
+                      const std::function<std::string(uint32_t)>& target_path) {
+  uint32_t last = files.empty()
+                      ? 0
+                      : *std::max_element(files.begin(), files.end());
+  int adopted = -1;
+  uint64_t adopted_size = 0;
+  for (size_t i = 0; i < temps.size(); ++i) {
+    if (temps[i].first <= last) continue;
+    Stat stat = fs.stat(temps[i].second.c_str());
+    if (stat.status() != kOk) return stat.status();
+    if (adopted < 0 || temps[i].first > temps[adopted].first ||
+        (temps[i].first == temps[adopted].first &&
+         stat.size() > adopted_size)) {
+      adopted = i;
+      adopted_size = stat.size();
+    }
+  }
+  for (size_t i = 0; i < temps.size(); ++i) {
+    if ((int)i == adopted) continue;
+    Status status = fs.remove(temps[i].second.c_str());
+    if (status != kOk && status != kNotFound) return status;
+  }
+  if (adopted < 0) return kOk;
+  uint32_t file = temps[adopted].first;
+  Status status =
+      fs.rename(temps[adopted].second.c_str(), target_path(file).c_str());
+  if (status != kOk) return status;
+  files.push_back(file);
+  return kOk;
+}
+
+}  // namespace internal
+
+WalReader::WalReader(Mount& fs, std::string dir,
+                     std::vector<uint32_t> segments, const WalOptions& options)
+    : fs_(&fs),
+      dir_(std::move(dir)),
+      segments_(std::move(segments)),
+      read_buffer_size_(options.read_buffer_size),
+      max_record_size_(options.max_record_size),
+      next_segment_(0),
+      status_(kOk) {}
+
+WalReader::WalReader(Status error)
+    : fs_(nullptr),
+      read_buffer_size_(0),
+      max_record_size_(0),
+      next_segment_(0),
+      status_(error) {}
+
+bool WalReader::next() {
+  while (status_ == kOk) {
+    if (segment_ == nullptr) {
+      if (next_segment_ == segments_.size()) {
+        status_ = kEndOfStream;
+        break;
+      }
+      auto in =
+          fs_->fopen(SegmentPath(dir_, segments_[next_segment_++]).c_str());
+      if (in->status() != kOk) {
+        status_ = in->status();
+        break;
+      }
+      segment_.reset(new internal::WalSegmentReader(
+          std::move(in), read_buffer_size_, max_record_size_));
+    }
+    if (segment_->next(record_)) return true;
+    Status s = segment_->status();
+    segment_ = nullptr;
+    if (s == kEndOfStream) continue;
+    if (s == kInvalidFormat && next_segment_ == segments_.size()) {
+      // Torn tail of the last segment, left by a crash.
+      status_ = kEndOfStream;
+    } else {
+      status_ = s;
+    }
+  }
+  record_.clear();
+  return false;
+}
+
+Wal::Wal(Mount& fs, const char* dir, WalOptions options)
+    : fs_(fs),
+      dir_(dir),
+      options_(options),
+      segment_size_(0),
+      status_(kClosed),
+      appended_(0),
+      synced_(0),
+      syncing_(false) {}
+
+Wal::~Wal() { close(); }
+
+Status Wal::open() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  if (status_ == kOk) return kOk;
+  status_ = recover();
+  if (status_ != kOk) out_ = nullptr;
+  return status_;
+}
+
+Status Wal::recover() {
+  Status status = MkDirRecursively(fs_, dir_.c_str());
+  if (status != kOk && status != kDirectoryExists) return status;
+  segments_.clear();
+  std::vector<std::pair<uint32_t, std::string>> temps;
+  {
+    Directory dir = fs_.opendir(dir_.c_str());
+    while (dir.read()) {
+      if (dir.entry().isDirectory()) continue;
+      const char* name = dir.entry().name();
+      uint32_t segment = ParseSegmentName(name);
+      if (segment != 0) {
+        segments_.push_back(segment);
+        continue;
+      }
+      segment = ParseSegmentName(internal::TempFileTarget(name).c_str());
+      if (segment != 0) temps.emplace_back(segment, dir_ + "/" + name);
+    }
+    if (dir.failed()) return dir.status();
+  }
+  status = internal::AdoptTempFiles(
+      fs_, std::move(temps), segments_,
+      [this](uint32_t segment) { return SegmentPath(dir_, segment); });
+  if (status != kOk) return status;
+  std::sort(segments_.begin(), segments_.end());
+  if (segments_.empty()) return startSegment();
+
+  // Only the last segment may have a torn tail; the earlier ones were synced
+  // before the log rolled over.
+  std::string path = SegmentPath(dir_, segments_.back());
+  uint64_t file_size;
+  uint64_t valid_end;
+  {
+    auto in = fs_.fopen(path.c_str());
+    if (in->status() != kOk) return in->status();
+    file_size = in->size();
+    internal::WalSegmentReader reader(std::move(in), options_.read_buffer_size,
+                                      options_.max_record_size);
+    std::vector<byte> record;
+    while (reader.next(record)) {
+    }
+    if (reader.status() != kEndOfStream && reader.status() != kInvalidFormat) {
+      return reader.status();
+    }
+    valid_end = reader.validEnd();
+  }
+  if (valid_end < file_size) {
+    status = fs_.truncate(path.c_str(), valid_end);
+    if (status != kOk) return status;
+  }
+  out_ = fs_.fopenForWrite(path.c_str(), kAppendIfExists);
+  if (out_->status() != kOk) return out_->status();
+  segment_size_ = valid_end;
+  if (segment_size_ < options_.segment_size) {
+    out_->preallocate(options_.segment_size - segment_size_);
+  }
+  return kOk;
+}
+
+Status Wal::startSegment() {
+  uint32_t segment = segments_.empty() ? 1 : segments_.back() + 1;
+  out_ = fs_.fopenForWrite(SegmentPath(dir_, segment).c_str(), kFailIfExists);
+  if (out_->status() != kOk) return out_->status();
+  // Commits only sync the data; make the new directory entry durable, too.
+  if (options_.sync_level != kSyncNone) {
+    out_->sync(kSyncDataAndDirectory);
+    if (out_->status() != kOk) return out_->status();
+  }
+  segments_.push_back(segment);
+  segment_size_ = 0;
+  out_->preallocate(options_.segment_size);
+  return kOk;
+}
+
+Status Wal::rollOver() {
+  out_->sync(options_.sync_level);
+  out_->close();
+  if (out_->status() != kClosed) return out_->status();
+  // Everything appended so far is now durable.
+  synced_ = appended_;
+  return startSegment();
+}
+
+WalReader Wal::replay() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (syncing_) {
+    idle_.wait(lock);
+  }
+  if (status_ != kOk) return WalReader(status_);
+  out_->flush();
+  return WalReader(fs_, dir_, segments_, options_);
+}
+
+uint64_t Wal::append(const byte* data, size_t size) {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  // The stream is not thread-safe; stay off it while it is being synced.
+  while (syncing_) {
+    idle_.wait(lock);
+  }
+  if (status_ != kOk || size > options_.max_record_size) return 0;
+  if (segment_size_ > 0 &&
+      segment_size_ + kHeaderSize + size > options_.segment_size) {
+    status_ = rollOver();
+    if (status_ != kOk) return 0;
+  }
+  byte header[kHeaderSize];
+  internal::EncodeWalRecordHeader(data, size, header);
+  out_->writeFully(header, kHeaderSize);
+  out_->writeFully(data, size);
+  status_ = out_->status();
+  if (status_ != kOk) return 0;
+  segment_size_ += kHeaderSize + size;
+  return ++appended_;
+}
+
+Status Wal::commit(uint64_t ticket) {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (true) {
+    if (status_ != kOk) return status_;
+    if (synced_ >= ticket) return kOk;
+    if (!syncing_) break;
+    idle_.wait(lock);
+  }
+  // Become the leader: sync everything appended so far, on behalf of all
+  // waiting writers.
+  syncing_ = true;
+  uint64_t target = appended_;
+  lock.unlock();
+  out_->sync(options_.sync_level);
+  Status status = out_->status();
+  lock.lock();
+  syncing_ = false;
+  status_ = status;
+  if (status == kOk && synced_ < target) synced_ = target;
+  idle_.notify_all();
+  return status;
+}
+
+Status Wal::appendAndCommit(const byte* data, size_t size) {
+  uint64_t ticket = append(data, size);
+  if (ticket == 0) {
+    Status s = status();
+    return s != kOk ? s : kOutOfRange;
+  }
+  return commit(ticket);
+}
+
+Status Wal::checkpoint() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (syncing_) {
+    idle_.wait(lock);
+  }
+  if (status_ != kOk) return status_;
+  if (segment_size_ > 0) {
+    status_ = rollOver();
+    if (status_ != kOk) return status_;
+  }
+  while (segments_.size() > 1) {
+    Status status = fs_.remove(SegmentPath(dir_, segments_.front()).c_str());
+    if (status != kOk && status != kNotFound) return status;
+    segments_.erase(segments_.begin());
+  }
+  return kOk;
+}
+
+Status Wal::close() {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  while (syncing_) {
+    idle_.wait(lock);
+  }
+  if (out_ == nullptr) return status_ == kClosed ? kOk : status_;
+  Status status = status_;
+  if (status == kOk) {
+    out_->sync(options_.sync_level);
+    out_->close();
+    status = out_->status() == kClosed ? kOk : out_->status();
+    if (status == kOk) synced_ = appended_;
+  }
+  out_ = nullptr;
+  status_ = (status == kOk) ? kClosed : status;
+  idle_.notify_all();
+  return status;
+}
+
+Status Wal::status() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return status_;
+}
+
+size_t Wal::segmentCount() const {
+  roo::unique_lock<roo::mutex> lock(mutex_);
+  return segments_.size();
+}
+
+}  // namespace roo_io
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "roo_io/core/multipass_input_stream.h"
+#include "roo_io/core/output_stream.h"
+#include "roo_io/core/sync_level.h"
+#include "roo_io/fs/mount.h"
+#include "roo_io/status.h"
+#include "roo_threads.h"
+#include "roo_threads/condition_variable.h"
+#include "roo_threads/mutex.h"
+
+namespace roo_io {
+
+/// Configuration of a `Wal`.
+struct WalOptions {
+  /// Once a segment file reaches this size, the next record starts a new one.
+  /// Each new segment is preallocated to this size.
+  uint64_t segment_size = 1024 * 1024;
+
+  /// Durability of `commit()`.
+  SyncLevel sync_level = kSyncData;
+
+  /// Larger records are rejected by `append()`, and treated as corruption by
+  /// recovery and replay.
+  uint32_t max_record_size = 64 * 1024;
+
+  /// Size of the buffer used by recovery and replay. Bigger buffers mean
+  /// fewer, larger reads.
+  size_t read_buffer_size = 4096;
+};
+
+namespace internal {
+
+// Size of the header that frames each record: the little-endian payload
+// length, followed by the little-endian CRC-32C of the length field and the
+// payload.
+constexpr size_t kWalRecordHeaderSize = 8;
+
+// Fills in the header of the record with the specified payload.
+void EncodeWalRecordHeader(const byte* data, size_t size, byte* header);
+
+// Sequentially reads the records of a single WAL segment.
+class WalSegmentReader {
+ public:
+  WalSegmentReader(std::unique_ptr<MultipassInputStream> in,
+                   size_t buffer_size, uint32_t max_record_size);
+
+  // Reads the next record into `record`. Returns false if there are no more
+  // valid records; `status()` then tells why: `kEndOfStream` if the segment
+  // ends cleanly, `kInvalidFormat` if the next record is torn or corrupted,
+  // or an I/O error.
+  bool next(std::vector<byte>& record);
+
+  // Returns the offset past the last valid record read so far.
+  uint64_t validEnd() const { return valid_end_; }
+
+  Status status() const { return status_; }
+
+ private:
+  // Reads up to `count` bytes, and returns the number read (less at the end
+  // of the segment, or on error).
+  size_t read(byte* target, size_t count);
+
+  std::unique_ptr<MultipassInputStream> in_;
+  std::unique_ptr<byte[]> buffer_;
+  size_t buffer_size_;
+  size_t buffer_pos_;
+  size_t buffer_end_;
+  uint32_t max_record_size_;
+  uint64_t valid_end_;
+  Status status_;
+};
+
+// If `name` is that of a temporary file left behind by an interrupted
+// replacement or truncation ("<target>.tmp", possibly followed by a unique
+// suffix), returns the target name. Otherwise, returns an empty string.
+std::string TempFileTarget(const char* name);
+
+// Resolves the temporary files found while recovering a directory of numbered
+// files. `temps` lists their paths, along with the numbers of their targets;
+// `files` lists the numbers of the existing files. A temporary file numbered
+// past all the existing files is a complete copy of the last file, whose
+// truncation got interrupted after the file was removed; it gets renamed to
+// `target_path(number)`, and the number appended to `files`. (If there are
+// several, the one with the highest number, then the largest one, wins.) The
+// others are removed.
+Status AdoptTempFiles(Mount& fs,
+                      std::vector<std::pair<uint32_t, std::string>> temps,
+                      std::vector<uint32_t>& files,
+                      const std::function<std::string(uint32_t)>& target_path);
+
+}  // namespace internal
+
+/// Iterates over the records of a `Wal`, oldest first. Obtained from
+/// `Wal::replay()`.
+///
+/// Example:
+///
+/// ```
+/// WalReader reader = wal.replay();
+/// while (reader.next()) {
+///   apply(reader.data(), reader.size());
+/// }
+/// if (reader.status() != kEndOfStream) { /* handle error */ }
+/// ```
+class WalReader {
+ public:
+  WalReader(WalReader&& other) = default;
+
+  /// Advances to the next record. Returns false if there are no more records,
+  /// or on error.
+  bool next();
+
+  /// Returns the payload of the current record.
+  const byte* data() const { return record_.data(); }
+
+  /// Returns the size of the current record, in bytes.
+  size_t size() const { return record_.size(); }
+
+  /// Returns `kOk` while records are being read, `kEndOfStream` once all of
+  /// them have been read, `kInvalidFormat` if a segment other than the last
+  /// one is corrupted, or an I/O error.
+  Status status() const { return status_; }
+
+ private:
+  friend class Wal;
+
+  WalReader(Mount& fs, std::string dir, std::vector<uint32_t> segments,
+            const WalOptions& options);
+
+  WalReader(Status error);
+
+  Mount* fs_;
+  std::string dir_;
+  std::vector<uint32_t> segments_;
+  size_t read_buffer_size_;
+  uint32_t max_record_size_;
+  size_t next_segment_;
+  std::unique_ptr<internal::WalSegmentReader> segment_;
+  std::vector<byte> record_;
+  Status status_;
+};
+
+/// Append-only, crash-safe write-ahead log (journal) in a directory of a
+/// mounted filesystem.
+///
+/// The log is a sequence of segment files, named `00000001.wal`,
+/// `00000002.wal`, and so on. Each record is framed by its length and a
+/// CRC-32C checksum. When a segment fills up, the log rolls over to a new one.
+///
+/// `append()` adds a record and returns a ticket; `commit(ticket)` blocks
+/// until the record is durable. Several threads may append and commit
+/// concurrently; a single sync then covers all the records appended while the
+/// previous one was in progress (see `GroupCommit`).
+///
+/// `open()` recovers the log after a crash: it scans the last segment (the
+/// earlier ones were synced when rolled over), stops at the first torn or
+/// corrupted record, and truncates the segment there, so that new records are
+/// appended right after the last intact one.
+class Wal {
+ public:
+  /// Creates a log in the directory `dir` of `fs`. Call `open()` before use.
+  Wal(Mount& fs, const char* dir, WalOptions options = WalOptions());
+
+  /// Closes the log.
+  ~Wal();
+
+  /// Creates the directory if needed, recovers the log, and opens the last
+  /// segment for appending.
+  Status open();
+
+  /// Returns a reader over all the records in the log. Use it after `open()`,
+  /// before appending, to replay the log.
+  WalReader replay();
+
+  /// Appends a record, buffered; call `commit()` to make it durable.
+  ///
+  /// @return Ticket to pass to `commit()`, or 0 if the record could not be
+  /// appended, because it is larger than `max_record_size`, or because the
+  /// log is not open, or failed (see `status()`).
+  uint64_t append(const byte* data, size_t size);
+
+  /// Blocks until the record that got `ticket`, and all records appended
+  /// before it, are durable.
+  ///
+  /// @return `kOk` on success, or the error that made the log fail.
+  Status commit(uint64_t ticket);
+
+  /// Appends a record, and waits until it is durable.
+  ///
+  /// @return `kOk` on success; `kOutOfRange` if the record is too large; or
+  /// the error that made the log fail.
+  Status appendAndCommit(const byte* data, size_t size);
+
+  /// Starts a new segment, and removes all the older ones. Call once the
+  /// effects of all the records logged so far have been persisted elsewhere.
+  Status checkpoint();
+
+  /// Syncs and closes the log. Returns `kOk` on success, or an error.
+  Status close();
+
+  /// Returns `kOk` if the log is open and healthy; `kClosed` if it is not
+  /// open; or the error that made it fail.
+  Status status() const;
+
+  /// Returns the number of segment files.
+  size_t segmentCount() const;
+
+ private:
+  // Finds the existing segments, and recovers the last one.
+  Status recover();
+
+  // Creates a new segment, and opens it for appending. Called with the
+  // mutex held.
+  Status startSegment();
+
+  // Syncs and closes the current segment, and starts a new one. Called with
+  // the mutex held, while not syncing.
+  Status rollOver();
+
+  Mount& fs_;
+  std::string dir_;
+  WalOptions options_;
+
+  mutable roo::mutex mutex_;
+  roo::condition_variable idle_;
+  std::vector<uint32_t> segments_;
+  std::unique_ptr<OutputStream> out_;
+  uint64_t segment_size_;
+  Status status_;
+  uint64_t appended_;
+  uint64_t synced_;
+  bool syncing_;
+};
+
+}  // namespace roo_io
@@ -0,0 +1,321 @@
+#include "roo_io/text/format.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace roo_io {
+
+namespace {
+
+// Floating-point precision is capped, to bound the size of the stack buffer.
+constexpr int kMaxFloatPrecision = 64;
+
+size_t CountCodePoints(const char* data, size_t size) {
+  size_t count = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (((uint8_t)data[i] & 0xC0) != 0x80) ++count;
+  }
+  return count;
+}
+
+// Returns the size, in bytes, of the longest prefix of `data` that contains at
+// most `max_code_points` code points.
+size_t CodePointPrefixSize(const char* data, size_t size,
+                           size_t max_code_points) {
+  size_t count = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (((uint8_t)data[i] & 0xC0) != 0x80) {
+      if (count == max_code_points) return i;
+      ++count;
+    }
+  }
+  return size;
+}
+
+// Writes a number, consisting of the `prefix` (sign and base indicator) and the
+// `body` (digits), padded according to `spec`. Numbers are right-aligned by
+// default.
+void WriteNumber(FormatSink& sink, const FormatSpec& spec, const char* prefix,
+                 size_t prefix_size, const char* body, size_t body_size,
+                 bool allow_zero_pad) {
+  size_t content = prefix_size + body_size;
+  if ((size_t)spec.width <= content) {
+    sink.write(prefix, prefix_size);
+    sink.write(body, body_size);
+    return;
+  }
+  size_t padding = spec.width - content;
+  if (spec.zero_pad && spec.align == 0 && allow_zero_pad) {
+    static const char kZeros[] = "0000000000000000";
+    sink.write(prefix, prefix_size);
+    while (padding > 0) {
+      size_t n = padding < 16 ? padding : 16;
+      sink.write(kZeros, n);
+      padding -= n;
+    }
+    sink.write(body, body_size);
+    return;
+  }
+  char align = spec.align == 0 ? '>' : spec.align;
+  size_t left = align == '<' ? 0 : align == '^' ? padding / 2 : padding;
+  sink.writeFill(spec, left);
+  sink.write(prefix, prefix_size);
+  sink.write(body, body_size);
+  sink.writeFill(spec, padding - left);
+}
+
+// Returns the number of bytes in the sign prefix written to `prefix`.
+size_t WriteSign(const FormatSpec& spec, bool negative, char* prefix) {
+  if (negative) {
+    prefix[0] = '-';
+  } else if (spec.sign == '+' || spec.sign == ' ') {
+    prefix[0] = spec.sign;
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+// Writes the digits of `value` in the specified base, backwards, ending just
+// before `end`. Returns the number of digits.
+size_t WriteDigitsBackwards(uint64_t value, unsigned base, bool upper,
+                            char* end) {
+  const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char* p = end;
+  do {
+    *--p = digits[value % base];
+    value /= base;
+  } while (value != 0);
+  return end - p;
+}
+
+void FormatInteger(FormatSink& sink, const FormatSpec& spec,
+                   uint64_t magnitude, bool negative) {
+  if (spec.type == 'c') {
+    char c = (char)magnitude;
+    sink.writePadded(spec, &c, 1);
+    return;
+  }
+  char prefix[3];
+  size_t prefix_size = WriteSign(spec, negative, prefix);
+  unsigned base = 10;
+  switch (spec.type) {
+    case 'x':
+    case 'X':
+      base = 16;
+      break;
+    case 'b':
+    case 'B':
+      base = 2;
+      break;
+    case 'o':
+      base = 8;
+      break;
+    default:
+      break;
+  }
+  if (spec.alternate && base != 10) {
+    if (base == 8) {
+      if (magnitude != 0) prefix[prefix_size++] = '0';
+    } else {
+      prefix[prefix_size++] = '0';
+      prefix[prefix_size++] = spec.type;
+    }
+  }
+  char digits[64];
+  size_t count = WriteDigitsBackwards(magnitude, base, spec.type == 'X',
+                                      digits + sizeof(digits));
+  WriteNumber(sink, spec, prefix, prefix_size, digits + sizeof(digits) - count,
+              count, true);
+}
+
+void FormatSigned(FormatSink& sink, const FormatSpec& spec, int64_t value) {
+  bool negative = value < 0;
+  uint64_t magnitude = negative ? 0 - (uint64_t)value : (uint64_t)value;
+  FormatInteger(sink, spec, magnitude, negative);
+}
+
+// Formats with the large buffer; kept out of line, so that the common case
+// does not pay for the stack space.
+__attribute__((noinline)) void FormatLongDouble(FormatSink& sink,
+                                                const FormatSpec& spec,
+                                                const char* printf_format,
+                                                int precision, double value,
+                                                const char* prefix,
+                                                size_t prefix_size) {
+  char buf[320 + kMaxFloatPrecision];
+  int len = snprintf(buf, sizeof(buf), printf_format, precision, value);
+  if (len < 0) return;
+  if ((size_t)len >= sizeof(buf)) len = sizeof(buf) - 1;
+  WriteNumber(sink, spec, prefix, prefix_size, buf, len, true);
+}
+
+void FormatDouble(FormatSink& sink, const FormatSpec& spec, double value) {
+  char prefix[1];
+  size_t prefix_size = WriteSign(spec, signbit(value), prefix);
+  value = fabs(value);
+  char type = spec.type;
+  bool upper = (type == 'F' || type == 'E' || type == 'G');
+  if (isinf(value) || isnan(value)) {
+    const char* body =
+        isinf(value) ? (upper ? "INF" : "inf") : (upper ? "NAN" : "nan");
+    WriteNumber(sink, spec, prefix, prefix_size, body, 3, false);
+    return;
+  }
+  char printf_format[8];
+  char* p = printf_format;
+  *p++ = '%';
+  if (spec.alternate) *p++ = '#';
+  *p++ = '.';
+  *p++ = '*';
+  *p++ = (type == 0 ? 'g' : type);
+  *p = 0;
+  int precision = spec.precision;
+  if (precision > kMaxFloatPrecision) precision = kMaxFloatPrecision;
+  char buf[48];
+  int len;
+  if (precision >= 0 || type != 0) {
+    if (precision < 0) precision = 6;
+    len = snprintf(buf, sizeof(buf), printf_format, precision, value);
+  } else {
+    // Shortest representation that reads back as the same value.
+    precision = 15;
+    while (true) {
+      len = snprintf(buf, sizeof(buf), printf_format, precision, value);
+      if (precision == 17 || strtod(buf, nullptr) == value) break;
+      ++precision;
+    }
+  }
+  if (len < 0) return;
+  if ((size_t)len >= sizeof(buf)) {
+    FormatLongDouble(sink, spec, printf_format, precision, value, prefix,
+                     prefix_size);
+    return;
+  }
+  WriteNumber(sink, spec, prefix, prefix_size, buf, len, true);
+}
+
+void FormatPointer(FormatSink& sink, const FormatSpec& spec,
+                   const void* value) {
+  char digits[16];
+  size_t count = WriteDigitsBackwards((uint64_t)(uintptr_t)value, 16, false,
+                                      digits + sizeof(digits));
+  WriteNumber(sink, spec, "0x", 2, digits + sizeof(digits) - count, count,
+              true);
+}
+
+}  // namespace
+
+void FormatSink::writeFill(const FormatSpec& spec, size_t count) {
+  while (count-- > 0) write(spec.fill, spec.fill_size);
+}
+
+void FormatSink::writePadded(const FormatSpec& spec, const char* data,
+                             size_t size) {
+  if (spec.precision >= 0) {
+    size = CodePointPrefixSize(data, size, spec.precision);
+  }
+  size_t width = CountCodePoints(data, size);
+  if ((size_t)spec.width <= width) {
+    write(data, size);
+    return;
+  }
+  size_t padding = spec.width - width;
+  size_t left = spec.align == '>'   ? padding
+                : spec.align == '^' ? padding / 2
+                                    : 0;
+  writeFill(spec, left);
+  write(data, size);
+  writeFill(spec, padding - left);
+}
+
+void Formatter<Status>::format(FormatSink& sink, const FormatSpec& spec,
+                               Status status) {
+  const char* name = StatusAsString(status);
+  sink.writePadded(spec, name, strlen(name));
+}
+
+namespace internal {
+
+void VFormat(FormatSink& sink, const char* format,
+             const FormatSegment* segments, size_t segment_count,
+             const FormatArg* args) {
+  for (size_t i = 0; i < segment_count; ++i) {
+    const FormatSegment& segment = segments[i];
+    if (segment.arg_index < 0) {
+      sink.write(format + segment.offset, segment.size);
+      continue;
+    }
+    const FormatArg& arg = args[segment.arg_index];
+    const FormatSpec& spec = segment.spec;
+    switch (arg.kind) {
+      case FormatArg::kSigned: {
+        FormatSigned(sink, spec, arg.s);
+        break;
+      }
+      case FormatArg::kUnsigned: {
+        FormatInteger(sink, spec, arg.u, false);
+        break;
+      }
+      case FormatArg::kChar: {
+        if (spec.type == 0 || spec.type == 'c') {
+          char c = (char)arg.u;
+          sink.writePadded(spec, &c, 1);
+        } else {
+          FormatInteger(sink, spec, arg.u, false);
+        }
+        break;
+      }
+      case FormatArg::kBool: {
+        if (spec.type == 0 || spec.type == 's') {
+          sink.writePadded(spec, arg.u ? "true" : "false", arg.u ? 4 : 5);
+        } else {
+          FormatInteger(sink, spec, arg.u, false);
+        }
+        break;
+      }
+      case FormatArg::kDouble: {
+        FormatDouble(sink, spec, arg.d);
+        break;
+      }
+      case FormatArg::kString: {
+        sink.writePadded(spec, arg.str.data, arg.str.size);
+        break;
+      }
+      case FormatArg::kPointer: {
+        FormatPointer(sink, spec, arg.p);
+        break;
+      }
+      case FormatArg::kCustom: {
+        arg.custom.fn(sink, spec, arg.custom.value);
+        break;
+      }
+    }
+  }
+}
+
+void WriteToOutputStream(void* context, const char* data, size_t size) {
+  StreamFormatBuffer& buffer = *static_cast<StreamFormatBuffer*>(context);
+  if (buffer.size + size > StreamFormatBuffer::kCapacity) {
+    buffer.flush();
+    if (size >= StreamFormatBuffer::kCapacity) {
+      buffer.os.writeFully((const byte*)data, size);
+      return;
+    }
+  }
+  memcpy(buffer.data + buffer.size, data, size);
+  buffer.size += size;
+}
+
+void WriteToBuffer(void* context, const char* data, size_t size) {
+  FormatBuffer& buffer = *static_cast<FormatBuffer*>(context);
+  if (size > buffer.remaining) size = buffer.remaining;
+  memcpy(buffer.ptr, data, size);
+  buffer.ptr += size;
+  buffer.remaining -= size;
+}
+
+}  // namespace internal
+
+}  // namespace roo_io
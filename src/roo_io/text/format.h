@@ -0,0 +1,691 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/core/output_stream.h"
+#include "roo_io/status.h"
+
+// Type-safe formatting with `{}`-style replacement fields, writing directly to
+// output iterators, output streams, or character buffers, without allocating.
+//
+// Format strings must be wrapped in `ROO_IO_FMT(...)`. They are parsed, and
+// checked against the argument types, at compile time:
+//
+//   roo_io::FormatTo(out, ROO_IO_FMT("{} bytes in {:.3f} s"), n, seconds);
+//
+// Replacement field syntax (a subset of `std::format`):
+//
+//   {[index][:[[fill]align][sign][#][0][width][.precision][type]]}
+//
+// * index: zero-based argument index; either all fields specify it, or none,
+// * fill: any character other than '{' or '}' (may be multi-byte UTF-8),
+// * align: '<' (left), '>' (right), or '^' (center),
+// * sign: '+', '-', or ' ',
+// * '#': alternate form ('0x', '0b', or '0' prefix; decimal point for floats),
+// * '0': pad numbers with zeros after the sign and the prefix,
+// * width, precision: decimal numbers (floating-point precision is capped at
+//   64),
+// * type: 'd', 'x', 'X', 'b', 'B', 'o', 'c' for integers, chars, and bools;
+//   'f', 'F', 'e', 'E', 'g', 'G' for floating-point; 's' for strings, bools,
+//   and custom types; 'p' for pointers.
+//
+// Use "{{" and "}}" to emit literal braces.
+//
+// To make a custom type formattable, specialize `roo_io::Formatter`:
+//
+//   namespace roo_io {
+//   template <>
+//   struct Formatter<Point> {
+//     static void format(FormatSink& sink, const FormatSpec& spec,
+//                        const Point& p) {
+//       char buf[32];
+//       size_t len = FormatToBuffer(buf, sizeof(buf), ROO_IO_FMT("({}, {})"),
+//                                   p.x, p.y);
+//       sink.writePadded(spec, buf, len);
+//     }
+//   };
+//   }  // namespace roo_io
+
+/// Wraps a string literal, so that it can be used as a compile-time format
+/// string in `FormatTo()`, `FormatToStream()`, and `FormatToBuffer()`.
+#define ROO_IO_FMT(s)                                          \
+  [] {                                                         \
+    struct RooIoFormatString                                   \
+        : ::roo_io::internal::CompileTimeFormatString {        \
+      static constexpr const char* data() { return s; }        \
+      static constexpr size_t size() { return sizeof(s) - 1; } \
+    };                                                         \
+    return RooIoFormatString();                                \
+  }()
+
+namespace roo_io {
+
+/// Parsed replacement field specification.
+struct FormatSpec {
+  /// Fill character, as (up to 4 bytes of) UTF-8.
+  char fill[4] = {' ', 0, 0, 0};
+
+  /// Number of bytes in `fill`.
+  uint8_t fill_size = 1;
+
+  /// '<', '>', '^', or 0 if unspecified (type-specific default).
+  char align = 0;
+
+  /// '+', '-', ' ', or 0 if unspecified (same as '-').
+  char sign = 0;
+
+  /// Whether '#' has been specified.
+  bool alternate = false;
+
+  /// Whether '0' has been specified.
+  bool zero_pad = false;
+
+  /// Minimum field width, in characters.
+  int width = 0;
+
+  /// Precision, or -1 if unspecified.
+  int precision = -1;
+
+  /// Presentation type, or 0 if unspecified.
+  char type = 0;
+};
+
+/// Destination of formatted output.
+///
+/// Custom `Formatter` specializations write their output via this class.
+class FormatSink {
+ public:
+  using WriteFn = void (*)(void* context, const char* data, size_t size);
+
+  FormatSink(WriteFn write_fn, void* context)
+      : write_fn_(write_fn), context_(context), count_(0) {}
+
+  /// Writes `size` bytes from `data`.
+  void write(const char* data, size_t size) {
+    if (size == 0) return;
+    write_fn_(context_, data, size);
+    count_ += size;
+  }
+
+  /// Writes `count` copies of the fill character from `spec`.
+  void writeFill(const FormatSpec& spec, size_t count);
+
+  /// Writes `size` bytes from `data`, padded according to the width, fill, and
+  /// alignment from `spec` (left-aligned by default). Width is measured in
+  /// UTF-8 code points.
+  void writePadded(const FormatSpec& spec, const char* data, size_t size);
+
+  /// Returns the total number of bytes written so far.
+  size_t count() const { return count_; }
+
+ private:
+  WriteFn write_fn_;
+  void* context_;
+  size_t count_;
+};
+
+/// Extension point for formatting custom types. Specializations must provide:
+///
+///   static void format(FormatSink& sink, const FormatSpec& spec,
+///                      const T& value);
+template <typename T>
+struct Formatter {
+  static_assert(sizeof(T) == 0,
+                "Type not formattable; specialize roo_io::Formatter<T>");
+};
+
+/// Formats `Status` as its `StatusAsString()` name.
+template <>
+struct Formatter<Status> {
+  static void format(FormatSink& sink, const FormatSpec& spec, Status status);
+};
+
+namespace internal {
+
+// Base class of format string types produced by ROO_IO_FMT.
+struct CompileTimeFormatString {};
+
+// Called from constexpr functions on errors. Since it is not constexpr, such
+// calls fail compilation, with the name of this function in the error message.
+inline void FormatStringError(const char*) {}
+
+// A fragment of a parsed format string: either a literal, or a replacement
+// field.
+struct FormatSegment {
+  // For literals, `arg_index` is -1, and `offset` and `size` locate the text
+  // within the format string.
+  size_t offset = 0;
+  size_t size = 0;
+  int arg_index = -1;
+  FormatSpec spec;
+};
+
+constexpr bool IsFormatDigit(char c) { return c >= '0' && c <= '9'; }
+
+constexpr bool IsFormatAlign(char c) {
+  return c == '<' || c == '>' || c == '^';
+}
+
+constexpr int Utf8SequenceLength(char lead) {
+  return ((uint8_t)lead < 0x80)          ? 1
+         : ((uint8_t)lead & 0xE0) == 0xC0 ? 2
+         : ((uint8_t)lead & 0xF0) == 0xE0 ? 3
+         : ((uint8_t)lead & 0xF8) == 0xF0 ? 4
+                                           : 1;
+}
+
+constexpr int ParseFormatInt(const char* s, size_t n, size_t& pos) {
+  int value = 0;
+  while (pos < n && IsFormatDigit(s[pos])) {
+    value = value * 10 + (s[pos] - '0');
+    if (value > 0xFFFF) FormatStringError("width or precision too large");
+    ++pos;
+  }
+  return value;
+}
+
+// Parses the part after ':' (up to, and excluding, the closing '}').
+constexpr void ParseFormatSpec(const char* s, size_t n, size_t& pos,
+                               FormatSpec& spec) {
+  // [[fill]align]
+  int fill_len = pos < n ? Utf8SequenceLength(s[pos]) : 1;
+  if (pos + fill_len < n && IsFormatAlign(s[pos + fill_len]) &&
+      s[pos] != '{' && s[pos] != '}') {
+    for (int i = 0; i < fill_len; ++i) spec.fill[i] = s[pos + i];
+    spec.fill_size = fill_len;
+    pos += fill_len;
+    spec.align = s[pos++];
+  } else if (pos < n && IsFormatAlign(s[pos])) {
+    spec.align = s[pos++];
+  }
+  if (pos < n && (s[pos] == '+' || s[pos] == '-' || s[pos] == ' ')) {
+    spec.sign = s[pos++];
+  }
+  if (pos < n && s[pos] == '#') {
+    spec.alternate = true;
+    ++pos;
+  }
+  if (pos < n && s[pos] == '0') {
+    spec.zero_pad = true;
+    ++pos;
+  }
+  spec.width = ParseFormatInt(s, n, pos);
+  if (pos < n && s[pos] == '.') {
+    ++pos;
+    if (pos >= n || !IsFormatDigit(s[pos])) {
+      FormatStringError("missing precision");
+    }
+    spec.precision = ParseFormatInt(s, n, pos);
+  }
+  if (pos < n && s[pos] != '}') spec.type = s[pos++];
+  if (pos >= n || s[pos] != '}') FormatStringError("invalid format spec");
+}
+
+// Parses the format string, storing the segments in `out` (if not null).
+// Returns the number of segments.
+constexpr size_t ParseFormatSegments(const char* s, size_t n,
+                                     FormatSegment* out) {
+  size_t count = 0;
+  size_t pos = 0;
+  size_t literal_start = 0;
+  int next_auto_index = 0;
+  bool auto_indexing = false;
+  bool manual_indexing = false;
+  while (pos <= n) {
+    bool at_end = (pos == n);
+    char c = at_end ? 0 : s[pos];
+    if (!at_end && c != '{' && c != '}') {
+      ++pos;
+      continue;
+    }
+    // Flush the literal accumulated so far. For an escaped brace, include the
+    // first brace of the pair in the literal.
+    bool escaped = !at_end && pos + 1 < n && s[pos + 1] == c;
+    size_t literal_end = escaped ? pos + 1 : pos;
+    if (literal_end > literal_start) {
+      if (out != nullptr) {
+        out[count].offset = literal_start;
+        out[count].size = literal_end - literal_start;
+      }
+      ++count;
+    }
+    if (at_end) break;
+    if (escaped) {
+      pos += 2;
+      literal_start = pos;
+      continue;
+    }
+    if (c == '}') FormatStringError("unmatched '}'");
+    // Replacement field.
+    ++pos;
+    FormatSegment field;
+    if (pos < n && IsFormatDigit(s[pos])) {
+      manual_indexing = true;
+      field.arg_index = ParseFormatInt(s, n, pos);
+    } else {
+      auto_indexing = true;
+      field.arg_index = next_auto_index++;
+    }
+    if (auto_indexing && manual_indexing) {
+      FormatStringError("cannot mix automatic and manual field numbering");
+    }
+    if (pos < n && s[pos] == ':') {
+      ++pos;
+      ParseFormatSpec(s, n, pos, field.spec);
+    } else if (pos >= n || s[pos] != '}') {
+      FormatStringError("unterminated replacement field");
+    }
+    ++pos;  // Closing '}'.
+    if (out != nullptr) out[count] = field;
+    ++count;
+    literal_start = pos;
+  }
+  return count;
+}
+
+template <size_t N>
+struct ParsedFormatSegments {
+  FormatSegment segments[N == 0 ? 1 : N];
+};
+
+template <size_t N>
+constexpr ParsedFormatSegments<N> ParseFormatString(const char* s, size_t n) {
+  ParsedFormatSegments<N> result{};
+  ParseFormatSegments(s, n, result.segments);
+  return result;
+}
+
+// Compile-time parsed form of the format string type `S`.
+template <typename S>
+struct ParsedFormat {
+  static constexpr size_t kCount =
+      ParseFormatSegments(S::data(), S::size(), nullptr);
+  static constexpr ParsedFormatSegments<kCount> kParsed =
+      ParseFormatString<kCount>(S::data(), S::size());
+};
+
+// Type-erased argument.
+struct FormatArg {
+  enum Kind {
+    kSigned,
+    kUnsigned,
+    kChar,
+    kBool,
+    kDouble,
+    kString,
+    kPointer,
+    kCustom,
+  };
+
+  using CustomFn = void (*)(FormatSink& sink, const FormatSpec& spec,
+                            const void* value);
+
+  Kind kind;
+  union {
+    int64_t s;
+    uint64_t u;
+    double d;
+    const void* p;
+    struct {
+      const char* data;
+      size_t size;
+    } str;
+    struct {
+      const void* value;
+      CustomFn fn;
+    } custom;
+  };
+};
+
+template <typename T>
+void FormatCustomArg(FormatSink& sink, const FormatSpec& spec,
+                     const void* value) {
+  Formatter<T>::format(sink, spec, *static_cast<const T*>(value));
+}
+
+template <typename T, typename Enable = void>
+struct FormatArgMaker {
+  static constexpr FormatArg::Kind kKind = FormatArg::kCustom;
+  static FormatArg make(const T& v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.custom.value = &v;
+    arg.custom.fn = &FormatCustomArg<T>;
+    return arg;
+  }
+};
+
+template <>
+struct FormatArgMaker<bool> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kBool;
+  static FormatArg make(bool v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.u = v;
+    return arg;
+  }
+};
+
+template <>
+struct FormatArgMaker<char> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kChar;
+  static FormatArg make(char v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.u = (uint8_t)v;
+    return arg;
+  }
+};
+
+template <typename T>
+struct FormatArgMaker<
+    T, typename std::enable_if<std::is_integral<T>::value &&
+                               std::is_signed<T>::value &&
+                               !std::is_same<T, char>::value>::type> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kSigned;
+  static FormatArg make(T v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.s = v;
+    return arg;
+  }
+};
+
+template <typename T>
+struct FormatArgMaker<
+    T, typename std::enable_if<std::is_integral<T>::value &&
+                               std::is_unsigned<T>::value &&
+                               !std::is_same<T, bool>::value &&
+                               !std::is_same<T, char>::value>::type> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kUnsigned;
+  static FormatArg make(T v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.u = v;
+    return arg;
+  }
+};
+
+template <typename T>
+struct FormatArgMaker<
+    T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kDouble;
+  static FormatArg make(T v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.d = v;
+    return arg;
+  }
+};
+
+template <typename T>
+struct FormatArgMaker<
+    T, typename std::enable_if<std::is_enum<T>::value &&
+                               !std::is_same<T, Status>::value>::type> {
+  using Underlying = typename std::underlying_type<T>::type;
+  static constexpr FormatArg::Kind kKind =
+      FormatArgMaker<Underlying>::kKind;
+  static FormatArg make(T v) {
+    return FormatArgMaker<Underlying>::make((Underlying)v);
+  }
+};
+
+template <>
+struct FormatArgMaker<const char*> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kString;
+  static FormatArg make(const char* v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.str.data = (v == nullptr ? "(null)" : v);
+    arg.str.size = strlen(arg.str.data);
+    return arg;
+  }
+};
+
+template <>
+struct FormatArgMaker<char*> : public FormatArgMaker<const char*> {};
+
+template <size_t N>
+struct FormatArgMaker<char[N]> : public FormatArgMaker<const char*> {};
+
+template <>
+struct FormatArgMaker<std::string> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kString;
+  static FormatArg make(const std::string& v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.str.data = v.data();
+    arg.str.size = v.size();
+    return arg;
+  }
+};
+
+template <>
+struct FormatArgMaker<roo::string_view> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kString;
+  static FormatArg make(roo::string_view v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.str.data = v.data();
+    arg.str.size = v.size();
+    return arg;
+  }
+};
+
+template <typename T>
+struct FormatArgMaker<T*, typename std::enable_if<
+                              !std::is_same<T, char>::value &&
+                              !std::is_same<T, const char>::value>::type> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kPointer;
+  static FormatArg make(const T* v) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.p = v;
+    return arg;
+  }
+};
+
+template <>
+struct FormatArgMaker<std::nullptr_t> {
+  static constexpr FormatArg::Kind kKind = FormatArg::kPointer;
+  static FormatArg make(std::nullptr_t) {
+    FormatArg arg;
+    arg.kind = kKind;
+    arg.p = nullptr;
+    return arg;
+  }
+};
+
+template <typename T>
+using FormatArgMakerFor = FormatArgMaker<typename std::remove_cv<T>::type>;
+
+constexpr bool IsFormatIntegerType(char t) {
+  return t == 'd' || t == 'x' || t == 'X' || t == 'b' || t == 'B' ||
+         t == 'o' || t == 'c';
+}
+
+constexpr bool IsFormatFloatType(char t) {
+  return t == 'f' || t == 'F' || t == 'e' || t == 'E' || t == 'g' || t == 'G';
+}
+
+// Verifies that the specification is applicable to the argument kind.
+constexpr bool CheckFormatSpec(const FormatSpec& spec, FormatArg::Kind kind) {
+  const char t = spec.type;
+  switch (kind) {
+    case FormatArg::kSigned:
+    case FormatArg::kUnsigned:
+    case FormatArg::kChar:
+      if (t != 0 && !IsFormatIntegerType(t)) {
+        FormatStringError("invalid type for an integer or char argument");
+      }
+      if (spec.precision >= 0) {
+        FormatStringError("precision not allowed for an integer argument");
+      }
+      break;
+    case FormatArg::kBool:
+      if (t != 0 && t != 's' && !IsFormatIntegerType(t)) {
+        FormatStringError("invalid type for a bool argument");
+      }
+      if (spec.precision >= 0) {
+        FormatStringError("precision not allowed for a bool argument");
+      }
+      break;
+    case FormatArg::kDouble:
+      if (t != 0 && !IsFormatFloatType(t)) {
+        FormatStringError("invalid type for a floating-point argument");
+      }
+      break;
+    case FormatArg::kString:
+      if (t != 0 && t != 's') {
+        FormatStringError("invalid type for a string argument");
+      }
+      if (spec.sign != 0 || spec.alternate || spec.zero_pad) {
+        FormatStringError("numeric flags not allowed for a string argument");
+      }
+      break;
+    case FormatArg::kPointer:
+      if (t != 0 && t != 'p') {
+        FormatStringError("invalid type for a pointer argument");
+      }
+      break;
+    case FormatArg::kCustom:
+      break;
+  }
+  return true;
+}
+
+// Verifies that all replacement fields of `S` refer to existing arguments, with
+// compatible specifications.
+template <typename S, typename... Args>
+constexpr bool CheckFormatArgs() {
+  constexpr size_t kArgCount = sizeof...(Args);
+  constexpr FormatArg::Kind kinds[kArgCount == 0 ? 1 : kArgCount] = {
+      FormatArgMakerFor<Args>::kKind...};
+  for (size_t i = 0; i < ParsedFormat<S>::kCount; ++i) {
+    const FormatSegment& segment = ParsedFormat<S>::kParsed.segments[i];
+    if (segment.arg_index < 0) continue;
+    if ((size_t)segment.arg_index >= kArgCount) {
+      FormatStringError("argument index out of range");
+      continue;
+    }
+    CheckFormatSpec(segment.spec, kinds[segment.arg_index]);
+  }
+  return true;
+}
+
+// Formats the (parsed) format string with the (type-erased) arguments.
+void VFormat(FormatSink& sink, const char* format,
+             const FormatSegment* segments, size_t segment_count,
+             const FormatArg* args);
+
+template <typename OutputIterator>
+void WriteToOutputIterator(void* context, const char* data, size_t size) {
+  OutputIterator& out = *static_cast<OutputIterator*>(context);
+  while (size > 0) {
+    size_t written = out.write((const byte*)data, size);
+    if (written == 0) return;
+    data += written;
+    size -= written;
+  }
+}
+
+void WriteToOutputStream(void* context, const char* data, size_t size);
+
+void WriteToBuffer(void* context, const char* data, size_t size);
+
+struct FormatBuffer {
+  char* ptr;
+  size_t remaining;
+};
+
+template <typename S, typename... Args>
+size_t FormatToSink(FormatSink& sink, const Args&... args) {
+  static_assert(std::is_base_of<CompileTimeFormatString, S>::value,
+                "Format strings must be wrapped in ROO_IO_FMT(...)");
+  static_assert(CheckFormatArgs<S, Args...>(), "");
+  const FormatArg arg_array[sizeof...(Args) == 0 ? 1 : sizeof...(Args)] = {
+      FormatArgMakerFor<Args>::make(args)...};
+  VFormat(sink, S::data(), ParsedFormat<S>::kParsed.segments,
+          ParsedFormat<S>::kCount, arg_array);
+  return sink.count();
+}
+
+}  // namespace internal
+
+/// Formats `args` according to `format`, writing the result to the output
+/// iterator `out` (e.g. `BufferedOutputStreamIterator`,
+/// `MemoryOutputIterator`).
+///
+/// Returns the number of bytes formatted. On write errors, check
+/// `out.status()`.
+template <typename OutputIterator, typename S, typename... Args>
+size_t FormatTo(OutputIterator& out, S format, const Args&... args) {
+  (void)format;
+  FormatSink sink(&internal::WriteToOutputIterator<OutputIterator>, &out);
+  return internal::FormatToSink<S>(sink, args...);
+}
+
+/// Formats `args` according to `format`, writing the result to `os`.
+///
+/// Output is staged in a small stack buffer, so that `os` sees few, larger
+/// writes. Returns the number of bytes formatted. On write errors, check
+/// `os.status()`.
+template <typename S, typename... Args>
+size_t FormatToStream(OutputStream& os, S format, const Args&... args);
+
+/// Formats `args` according to `format` into `buf`, `snprintf`-style.
+///
+/// Writes at most `capacity - 1` bytes, followed by a terminating zero (if
+/// `capacity > 0`). Returns the number of bytes that the full result would
+/// take, not counting the terminating zero; if that is `>= capacity`, the
+/// result has been truncated.
+template <typename S, typename... Args>
+size_t FormatToBuffer(char* buf, size_t capacity, S format,
+                      const Args&... args) {
+  (void)format;
+  internal::FormatBuffer buffer{buf, capacity == 0 ? 0 : capacity - 1};
+  FormatSink sink(&internal::WriteToBuffer, &buffer);
+  size_t count = internal::FormatToSink<S>(sink, args...);
+  if (capacity > 0) *buffer.ptr = 0;
+  return count;
+}
+
+namespace internal {
+
+// Stages writes to an output stream.
+struct StreamFormatBuffer {
+  static constexpr size_t kCapacity = 64;
+
+  explicit StreamFormatBuffer(OutputStream& os) : os(os), size(0) {}
+
+  void flush() {
+    if (size > 0) os.writeFully((const byte*)data, size);
+    size = 0;
+  }
+
+  OutputStream& os;
+  size_t size;
+  char data[kCapacity];
+};
+
+}  // namespace internal
+
+template <typename S, typename... Args>
+size_t FormatToStream(OutputStream& os, S format, const Args&... args) {
+  (void)format;
+  internal::StreamFormatBuffer buffer(os);
+  FormatSink sink(&internal::WriteToOutputStream, &buffer);
+  size_t count = internal::FormatToSink<S>(sink, args...);
+  buffer.flush();
+  return count;
+}
+
+}  // namespace roo_io
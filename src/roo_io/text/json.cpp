@@ -0,0 +1,89 @@
+#include "roo_io/text/json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace roo_io {
+namespace internal {
+
+namespace {
+
+constexpr uint64_t kOnes = 0x0101010101010101ULL;
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+// Returns a word with the high bit set in (at least) the lowest byte of `w`
+// that needs escaping, and in no byte below it; zero if there is none.
+inline uint64_t SpecialBytes(uint64_t w) {
+  uint64_t quote = w ^ (kOnes * '"');
+  uint64_t backslash = w ^ (kOnes * '\\');
+  return (((quote - kOnes) & ~quote) | ((backslash - kOnes) & ~backslash) |
+          ((w - kOnes * 0x20) & ~w)) &
+         kHighBits;
+}
+
+}  // namespace
+
+size_t JsonPlainPrefixLength(const char* data, size_t size) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i max_control = _mm_set1_epi8(0x1F);
+  for (; i + 16 <= size; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+        _mm_cmpeq_epi8(_mm_max_epu8(v, max_control), max_control));
+    int mask = _mm_movemask_epi8(special);
+    if (mask != 0) return i + __builtin_ctz(mask);
+  }
+#elif defined(__ARM_NEON)
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t space = vdupq_n_u8(0x20);
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)(data + i));
+    uint8x16_t special =
+        vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)),
+                 vcltq_u8(v, space));
+    uint64x2_t halves = vreinterpretq_u64_u8(special);
+    if ((vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1)) != 0) break;
+  }
+#else
+  for (; i + 8 <= size; i += 8) {
+    uint64_t w;
+    memcpy(&w, data + i, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t special = SpecialBytes(w);
+    if (special != 0) return i + (__builtin_ctzll(special) >> 3);
+#else
+    if (SpecialBytes(__builtin_bswap64(w)) != 0) break;
+#endif
+  }
+#endif
+  for (; i < size; ++i) {
+    uint8_t c = (uint8_t)data[i];
+    if (c == '"' || c == '\\' || c < 0x20) break;
+  }
+  return i;
+}
+
+size_t FormatJsonDouble(double value, char* buf) {
+  // Shortest representation that reads back as the same value.
+  int len;
+  for (int precision = 15;; ++precision) {
+    len = snprintf(buf, kJsonMaxDoubleLength, "%.*g", precision, value);
+    if (precision == 17 || strtod(buf, nullptr) == value) break;
+  }
+  return (size_t)len;
+}
+
+}  // namespace internal
+}  // namespace roo_io
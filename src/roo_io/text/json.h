@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Internal helpers shared by `JsonWriter` (`json_writer.h`) and `JsonReader`
+// (`json_reader.h`).
+
+namespace roo_io {
+namespace internal {
+
+// Returns the length of the longest prefix of [`data`, `data + size`) that
+// contains no '"', '\\', or control characters (below 0x20). These are exactly
+// the characters that must be escaped in JSON strings, and that end a run of
+// literal characters when parsing them.
+//
+// Scans 16 bytes per step (with SSE2 or NEON where available).
+size_t JsonPlainPrefixLength(const char* data, size_t size);
+
+// Writes the shortest decimal representation of a finite `value` that reads
+// back as the same double, as a JSON number, to `buf` (which must hold at
+// least `kJsonMaxDoubleLength` characters). Returns its length.
+size_t FormatJsonDouble(double value, char* buf);
+
+static constexpr size_t kJsonMaxDoubleLength = 32;
+
+}  // namespace internal
+}  // namespace roo_io
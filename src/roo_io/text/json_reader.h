@@ -0,0 +1,532 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/data/decimal.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/status.h"
+#include "roo_io/text/json.h"
+#include "roo_io/text/unicode.h"
+
+namespace roo_io {
+
+/// Token types reported by `JsonReader`.
+enum class JsonToken {
+  /// No current token (before the first `next()`, or after an error).
+  kNone,
+  kBeginObject,
+  kEndObject,
+  kBeginArray,
+  kEndArray,
+  /// An object key. Its content is read like that of a string.
+  kKey,
+  kString,
+  kNumber,
+  kTrue,
+  kFalse,
+  kNull,
+};
+
+/// Pull-style JSON tokenizer over an input iterator.
+///
+/// Each call to `next()` advances to the next token, validating the JSON
+/// grammar along the way. Input may contain a sequence of top-level values
+/// separated by whitespace (e.g. newline-delimited JSON); `next()` returns
+/// false with status `kEndOfStream` after the last one.
+///
+/// The content of strings and keys is not consumed by `next()`; read it, with
+/// escape sequences decoded, with `readString()`, or, for memory iterators
+/// and strings without escapes, access it in place with `readStringView()`.
+/// Any unread content is skipped by the following `next()`. When the input is
+/// in memory, string bodies are scanned 16 bytes at a time.
+///
+/// Numbers are captured as text (up to `kMaxNumberLength` characters), and
+/// converted on request with `intValue()` or `doubleValue()`.
+///
+/// The reader never allocates. Malformed or truncated input sets the status to
+/// `kInvalidFormat`; nesting deeper than `kMaxDepth`, or a too long number,
+/// sets it to `kOutOfRange`; an error reading the input sets it to that error.
+/// String contents are not validated as UTF-8.
+template <typename InputIterator>
+class JsonReader {
+ public:
+  static constexpr int kMaxDepth = 64;
+  static constexpr size_t kMaxNumberLength = 63;
+
+  explicit JsonReader(InputIterator& in)
+      : in_(in),
+        status_(kOk),
+        token_(JsonToken::kNone),
+        expect_(kTopValue),
+        depth_(0),
+        objects_(0),
+        lookahead_(-1),
+        in_string_(false),
+        pending_size_(0),
+        pending_pos_(0),
+        number_length_(0),
+        number_is_integer_(false) {}
+
+  /// Advances to the next token. Returns false at the end of input (status
+  /// `kEndOfStream`) or on error.
+  bool next() {
+    if (status_ != kOk) return false;
+    if (in_string_ && !finishString()) return false;
+    token_ = JsonToken::kNone;
+    int c = readNonWhitespace();
+    switch (expect_) {
+      case kTopValue: {
+        if (c < 0) return fail(kEndOfStream);
+        return value(c);
+      }
+      case kValue: {
+        return value(c);
+      }
+      case kValueOrEnd: {
+        if (c == ']') return endContainer(false);
+        return value(c);
+      }
+      case kKeyOrEnd: {
+        if (c == '}') return endContainer(true);
+        return key(c);
+      }
+      case kKey: {
+        return key(c);
+      }
+      case kColon: {
+        if (c != ':') return fail(kInvalidFormat);
+        expect_ = kValue;
+        return value(readNonWhitespace());
+      }
+      default: {
+        // kCommaOrEnd.
+        bool in_object = inObject();
+        if (c == ',') {
+          if (in_object) {
+            expect_ = kKey;
+            return key(readNonWhitespace());
+          }
+          expect_ = kValue;
+          return value(readNonWhitespace());
+        }
+        if (c == (in_object ? '}' : ']')) return endContainer(in_object);
+        return fail(kInvalidFormat);
+      }
+    }
+  }
+
+  /// Returns the current token.
+  JsonToken token() const { return token_; }
+
+  /// Returns the current nesting depth (the number of enclosing objects and
+  /// arrays, including the one just begun).
+  int depth() const { return depth_; }
+
+  /// Reads up to `max` bytes of the (unescaped, UTF-8) content of the current
+  /// string or key into `buf`. Returns the number of bytes read; zero once the
+  /// whole string has been read.
+  size_t readString(char* buf, size_t max) {
+    if (status_ != kOk || !in_string_) return 0;
+    return scanString(buf, max);
+  }
+
+  /// If the rest of the current string or key is contiguous in memory and has
+  /// no escape sequences, sets `result` to it, consumes it, and returns true.
+  /// Otherwise, returns false, and the content can still be read with
+  /// `readString()`.
+  bool readStringView(roo::string_view& result) {
+    if (status_ != kOk || !in_string_ || pending_pos_ < pending_size_) {
+      return false;
+    }
+    size_t available;
+    const byte* p =
+        internal::ContiguousLookahead<InputIterator>::peekAll(in_, available);
+    if (p == nullptr) return false;
+    size_t n = internal::JsonPlainPrefixLength((const char*)p, available);
+    if (n == available || p[n] != byte{'"'}) return false;
+    result = roo::string_view((const char*)p, n);
+    in_.skip(n + 1);
+    in_string_ = false;
+    return true;
+  }
+
+  /// Returns the text of the current number.
+  roo::string_view numberText() const {
+    return roo::string_view(number_, number_length_);
+  }
+
+  /// Returns whether the current number has no fraction or exponent.
+  bool isInteger() const { return number_is_integer_; }
+
+  /// Returns the value of the current number as an integer. Sets `status` to
+  /// `kInvalidFormat` if the number has a fraction or exponent, and to
+  /// `kOutOfRange` (saturating the result) if it does not fit.
+  int64_t intValue(Status& status) const {
+    if (!number_is_integer_) {
+      status = kInvalidFormat;
+      return 0;
+    }
+    MemoryIterator itr((const byte*)number_,
+                       (const byte*)number_ + number_length_);
+    return ReadDecimalS64(itr, status);
+  }
+
+#if ROO_IO_IEEE754
+
+  /// Returns the value of the current number, correctly rounded.
+  double doubleValue() const {
+    MemoryIterator itr((const byte*)number_,
+                       (const byte*)number_ + number_length_);
+    Status status;
+    return ReadDecimalDouble(itr, status);
+  }
+
+#endif  // ROO_IO_IEEE754
+
+  /// Skips the rest of the current value: the content of a string, or all
+  /// tokens up to and including the end of an object or array that has just
+  /// begun. Returns false on error.
+  bool skip() {
+    if (status_ != kOk) return false;
+    if (in_string_) return finishString();
+    if (token_ != JsonToken::kBeginObject && token_ != JsonToken::kBeginArray) {
+      return true;
+    }
+    int target = depth_ - 1;
+    while (next()) {
+      if (depth_ == target) return true;
+    }
+    if (status_ == kEndOfStream) status_ = kInvalidFormat;
+    return false;
+  }
+
+  /// Returns `kOk`, `kEndOfStream`, `kInvalidFormat`, `kOutOfRange`, or the
+  /// error (other than `kEndOfStream`) reported by the input iterator.
+  Status status() const { return status_; }
+
+ private:
+  enum Expect {
+    kTopValue,
+    kValue,
+    kValueOrEnd,
+    kKeyOrEnd,
+    kKey,
+    kColon,
+    kCommaOrEnd,
+  };
+
+  bool fail(Status status) {
+    // An input error, recorded by read(), explains the failure better.
+    if (status_ == kOk) status_ = status;
+    token_ = JsonToken::kNone;
+    return false;
+  }
+
+  bool inObject() const { return (objects_ >> (depth_ - 1)) & 1; }
+
+  // Returns the next character, or -1 at the end of input or on error. An
+  // input error is recorded as the status.
+  int read() {
+    if (lookahead_ >= 0) {
+      int c = lookahead_;
+      lookahead_ = -1;
+      return c;
+    }
+    byte b = in_.read();
+    Status status = in_.status();
+    if (status != kOk) {
+      if (status != kEndOfStream && status_ == kOk) status_ = status;
+      return -1;
+    }
+    return (uint8_t)b;
+  }
+
+  int readNonWhitespace() {
+    while (true) {
+      int c = read();
+      if (c != ' ' && c != '\n' && c != '\r' && c != '\t') return c;
+    }
+  }
+
+  void afterValue() { expect_ = (depth_ == 0) ? kTopValue : kCommaOrEnd; }
+
+  bool value(int c) {
+    switch (c) {
+      case '{': {
+        return beginContainer(true);
+      }
+      case '[': {
+        return beginContainer(false);
+      }
+      case '"': {
+        token_ = JsonToken::kString;
+        startString();
+        afterValue();
+        return true;
+      }
+      case 't': {
+        return literal("rue", 3, JsonToken::kTrue);
+      }
+      case 'f': {
+        return literal("alse", 4, JsonToken::kFalse);
+      }
+      case 'n': {
+        return literal("ull", 3, JsonToken::kNull);
+      }
+      default: {
+        if (c == '-' || (c >= '0' && c <= '9')) return number(c);
+        return fail(kInvalidFormat);
+      }
+    }
+  }
+
+  bool key(int c) {
+    if (c != '"') return fail(kInvalidFormat);
+    token_ = JsonToken::kKey;
+    startString();
+    expect_ = kColon;
+    return true;
+  }
+
+  bool beginContainer(bool object) {
+    if (depth_ == kMaxDepth) return fail(kOutOfRange);
+    uint64_t bit = (uint64_t)1 << depth_;
+    objects_ = object ? (objects_ | bit) : (objects_ & ~bit);
+    ++depth_;
+    token_ = object ? JsonToken::kBeginObject : JsonToken::kBeginArray;
+    expect_ = object ? kKeyOrEnd : kValueOrEnd;
+    return true;
+  }
+
+  bool endContainer(bool object) {
+    --depth_;
+    token_ = object ? JsonToken::kEndObject : JsonToken::kEndArray;
+    afterValue();
+    return true;
+  }
+
+  bool literal(const char* rest, int size, JsonToken token) {
+    for (int i = 0; i < size; ++i) {
+      if (read() != rest[i]) return fail(kInvalidFormat);
+    }
+    token_ = token;
+    afterValue();
+    return true;
+  }
+
+  // Captures a number starting with `c`, and checks its syntax:
+  // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+  bool number(int c) {
+    size_t n = 0;
+    while ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+           c == 'e' || c == 'E') {
+      if (n == kMaxNumberLength) return fail(kOutOfRange);
+      number_[n++] = (char)c;
+      c = read();
+    }
+    // The number may have been cut short.
+    if (status_ != kOk) return fail(status_);
+    lookahead_ = c;
+    number_length_ = n;
+    size_t i = 0;
+    if (number_[i] == '-') ++i;
+    if (i < n && number_[i] == '0') {
+      ++i;
+    } else if (!skipDigits(i)) {
+      return fail(kInvalidFormat);
+    }
+    number_is_integer_ = true;
+    if (i < n && number_[i] == '.') {
+      ++i;
+      if (!skipDigits(i)) return fail(kInvalidFormat);
+      number_is_integer_ = false;
+    }
+    if (i < n && (number_[i] == 'e' || number_[i] == 'E')) {
+      ++i;
+      if (i < n && (number_[i] == '+' || number_[i] == '-')) ++i;
+      if (!skipDigits(i)) return fail(kInvalidFormat);
+      number_is_integer_ = false;
+    }
+    if (i != n) return fail(kInvalidFormat);
+    token_ = JsonToken::kNumber;
+    afterValue();
+    return true;
+  }
+
+  // Advances `i` past digits in the number buffer. Returns false if there
+  // are none.
+  bool skipDigits(size_t& i) const {
+    size_t start = i;
+    while (i < number_length_ && number_[i] >= '0' && number_[i] <= '9') ++i;
+    return i > start;
+  }
+
+  void startString() {
+    in_string_ = true;
+    pending_size_ = 0;
+    pending_pos_ = 0;
+  }
+
+  bool finishString() {
+    while (in_string_) {
+      scanString(nullptr, (size_t)-1);
+      if (status_ != kOk) return false;
+    }
+    return true;
+  }
+
+  // Reads up to `max` bytes of string content into `out` (or discards them,
+  // if `out` is null). Sets `in_string_` to false at the closing quote.
+  size_t scanString(char* out, size_t max) {
+    size_t written = 0;
+    while (written < max) {
+      if (pending_pos_ < pending_size_) {
+        // Rest of a decoded escape sequence.
+        if (out != nullptr) out[written] = pending_[pending_pos_];
+        ++written;
+        ++pending_pos_;
+        continue;
+      }
+      if (!in_string_) break;
+      size_t available;
+      const byte* p =
+          internal::ContiguousLookahead<InputIterator>::peekAll(in_, available);
+      if (p != nullptr) {
+        if (available > max - written) available = max - written;
+        size_t n = internal::JsonPlainPrefixLength((const char*)p, available);
+        if (out != nullptr) memcpy(out + written, p, n);
+        in_.skip(n);
+        written += n;
+        if (n == available) continue;
+      }
+      int c = read();
+      if (c < 0x20) {
+        // Also covers the end of input.
+        fail(kInvalidFormat);
+        break;
+      }
+      if (c == '"') {
+        in_string_ = false;
+        break;
+      }
+      if (c == '\\') {
+        if (!readEscape()) break;
+        continue;
+      }
+      if (out != nullptr) out[written] = (char)c;
+      ++written;
+    }
+    return written;
+  }
+
+  // Decodes an escape sequence (after the backslash) into `pending_`.
+  bool readEscape() {
+    int c = read();
+    char decoded;
+    switch (c) {
+      case '"':
+      case '\\':
+      case '/': {
+        decoded = (char)c;
+        break;
+      }
+      case 'b': {
+        decoded = '\b';
+        break;
+      }
+      case 'f': {
+        decoded = '\f';
+        break;
+      }
+      case 'n': {
+        decoded = '\n';
+        break;
+      }
+      case 'r': {
+        decoded = '\r';
+        break;
+      }
+      case 't': {
+        decoded = '\t';
+        break;
+      }
+      case 'u': {
+        return readUnicodeEscape();
+      }
+      default: {
+        return fail(kInvalidFormat);
+      }
+    }
+    pending_[0] = decoded;
+    pending_size_ = 1;
+    pending_pos_ = 0;
+    return true;
+  }
+
+  bool readHex4(uint32_t& result) {
+    result = 0;
+    for (int i = 0; i < 4; ++i) {
+      int c = read();
+      int digit;
+      if (c >= '0' && c <= '9') {
+        digit = c - '0';
+      } else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        digit = (c | 0x20) - 'a' + 10;
+      } else {
+        return fail(kInvalidFormat);
+      }
+      result = (result << 4) | digit;
+    }
+    return true;
+  }
+
+  // Decodes a \uXXXX escape (after the 'u'), including a following low
+  // surrogate escape if needed.
+  bool readUnicodeEscape() {
+    uint32_t cp;
+    if (!readHex4(cp)) return false;
+    if (cp >= 0xDC00 && cp <= 0xDFFF) return fail(kInvalidFormat);
+    if (cp >= 0xD800 && cp <= 0xDBFF) {
+      uint32_t low;
+      if (read() != '\\' || read() != 'u' || !readHex4(low)) {
+        return fail(kInvalidFormat);
+      }
+      if (low < 0xDC00 || low > 0xDFFF) return fail(kInvalidFormat);
+      cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+    }
+    pending_size_ = WriteUtf8Char(pending_, (char32_t)cp);
+    pending_pos_ = 0;
+    return true;
+  }
+
+  InputIterator& in_;
+  Status status_;
+  JsonToken token_;
+  Expect expect_;
+
+  // Nesting depth, and a bit per level: 1 for objects, 0 for arrays.
+  int depth_;
+  uint64_t objects_;
+
+  // A character read ahead (after a number), or -1.
+  int lookahead_;
+
+  // Whether the content of the current string has not been fully read yet.
+  bool in_string_;
+
+  // The UTF-8 encoding of the escape sequence being read.
+  char pending_[4];
+  int pending_size_;
+  int pending_pos_;
+
+  char number_[kMaxNumberLength];
+  size_t number_length_;
+  bool number_is_integer_;
+};
+
+}  // namespace roo_io
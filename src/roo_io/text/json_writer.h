@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+#include "roo_io/base/byte.h"
+#include "roo_io/data/write.h"
+#include "roo_io/status.h"
+#include "roo_io/text/json.h"
+
+namespace roo_io {
+
+/// Streaming JSON writer over an output iterator.
+///
+/// Produces compact JSON, inserting commas and colons as needed:
+///
+///   JsonWriter<Itr> json(out);
+///   json.beginObject();
+///   json.key("id");
+///   json.writeUInt(42);
+///   json.key("tags");
+///   json.beginArray();
+///   json.writeString("a");
+///   json.writeString("b");
+///   json.endArray();
+///   json.endObject();  // {"id":42,"tags":["a","b"]}
+///
+/// Consecutive top-level values are separated by newlines, so that a
+/// sequence of records forms newline-delimited JSON.
+///
+/// The writer never allocates. Strings are copied in runs of characters that
+/// need no escaping, located 16 bytes at a time. Strings are expected to be
+/// valid UTF-8; only '"', '\\', and control characters are escaped. The
+/// writer does not check that calls are properly nested; nesting deeper than
+/// `kMaxDepth` is reported as `kOutOfRange`.
+template <typename OutputIterator>
+class JsonWriter {
+ public:
+  static constexpr int kMaxDepth = 64;
+
+  explicit JsonWriter(OutputIterator& out)
+      : out_(out),
+        status_(kOk),
+        depth_(0),
+        overflow_(0),
+        needs_separator_(false),
+        after_key_(false) {}
+
+  /// Starts an object.
+  void beginObject() { beginContainer('{'); }
+
+  /// Ends the current object.
+  void endObject() { endContainer('}'); }
+
+  /// Starts an array.
+  void beginArray() { beginContainer('['); }
+
+  /// Ends the current array.
+  void endArray() { endContainer(']'); }
+
+  /// Writes an object key; follow with its value.
+  void key(roo::string_view name) {
+    if (needs_separator_) put(',');
+    writeQuoted(name);
+    put(':');
+    needs_separator_ = false;
+    after_key_ = true;
+  }
+
+  /// Writes a string value.
+  void writeString(roo::string_view value) {
+    beforeValue();
+    writeQuoted(value);
+  }
+
+  /// Writes a signed integer value.
+  void writeInt(int64_t value) {
+    beforeValue();
+    char buf[20];
+    char* end = buf + sizeof(buf);
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    char* p = formatDigits(magnitude, end);
+    if (value < 0) *--p = '-';
+    WriteByteArray(out_, (const byte*)p, end - p);
+  }
+
+  /// Writes an unsigned integer value.
+  void writeUInt(uint64_t value) {
+    beforeValue();
+    char buf[20];
+    char* end = buf + sizeof(buf);
+    char* p = formatDigits(value, end);
+    WriteByteArray(out_, (const byte*)p, end - p);
+  }
+
+  /// Writes a floating-point value, in the shortest form that reads back as
+  /// the same double. JSON has no representation for infinities and NaN;
+  /// they are written as null.
+  void writeDouble(double value) {
+    if (!std::isfinite(value)) {
+      writeNull();
+      return;
+    }
+    beforeValue();
+    char buf[internal::kJsonMaxDoubleLength];
+    size_t len = internal::FormatJsonDouble(value, buf);
+    WriteByteArray(out_, (const byte*)buf, len);
+  }
+
+  /// Writes a boolean value.
+  void writeBool(bool value) {
+    if (value) {
+      writeRaw("true");
+    } else {
+      writeRaw("false");
+    }
+  }
+
+  /// Writes null.
+  void writeNull() { writeRaw("null"); }
+
+  /// Writes a value that is already JSON-encoded, as is.
+  void writeRaw(roo::string_view json) {
+    beforeValue();
+    WriteByteArray(out_, (const byte*)json.data(), json.size());
+  }
+
+  /// Returns the current nesting depth.
+  int depth() const { return depth_; }
+
+  /// Returns `kOutOfRange` if the nesting got too deep, or otherwise the
+  /// status of the underlying iterator.
+  Status status() const { return status_ != kOk ? status_ : out_.status(); }
+
+ private:
+  void put(char c) { out_.write((byte)c); }
+
+  void beforeValue() {
+    if (after_key_) {
+      after_key_ = false;
+    } else if (needs_separator_) {
+      put(depth_ == 0 ? '\n' : ',');
+    }
+    needs_separator_ = true;
+  }
+
+  void beginContainer(char open) {
+    beforeValue();
+    put(open);
+    if (depth_ == kMaxDepth) {
+      status_ = kOutOfRange;
+      ++overflow_;
+    } else {
+      ++depth_;
+    }
+    needs_separator_ = false;
+  }
+
+  void endContainer(char close) {
+    put(close);
+    if (overflow_ > 0) {
+      --overflow_;
+    } else if (depth_ > 0) {
+      --depth_;
+    }
+    needs_separator_ = true;
+    after_key_ = false;
+  }
+
+  // Writes the decimal digits of `value` backwards, ending just before `end`.
+  // Returns the pointer to the first digit.
+  static char* formatDigits(uint64_t value, char* end) {
+    static const char kPairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233"
+        "34353637383940414243444546474849505152535455565758596061626364656667"
+        "6869707172737475767778798081828384858687888990919293949596979899";
+    char* p = end;
+    while (value >= 100) {
+      const char* pair = kPairs + (value % 100) * 2;
+      value /= 100;
+      *--p = pair[1];
+      *--p = pair[0];
+    }
+    if (value >= 10) {
+      const char* pair = kPairs + value * 2;
+      *--p = pair[1];
+      *--p = pair[0];
+    } else {
+      *--p = (char)('0' + value);
+    }
+    return p;
+  }
+
+  void writeQuoted(roo::string_view s) {
+    static const char kHex[] = "0123456789abcdef";
+    put('"');
+    const char* data = s.data();
+    size_t size = s.size();
+    while (size > 0) {
+      size_t n = internal::JsonPlainPrefixLength(data, size);
+      WriteByteArray(out_, (const byte*)data, n);
+      if (n == size) break;
+      uint8_t c = (uint8_t)data[n];
+      char escaped[6] = {'\\', 0, 0, 0, 0, 0};
+      size_t len = 2;
+      switch (c) {
+        case '"':
+        case '\\': {
+          escaped[1] = (char)c;
+          break;
+        }
+        case '\n': {
+          escaped[1] = 'n';
+          break;
+        }
+        case '\r': {
+          escaped[1] = 'r';
+          break;
+        }
+        case '\t': {
+          escaped[1] = 't';
+          break;
+        }
+        case '\b': {
+          escaped[1] = 'b';
+          break;
+        }
+        case '\f': {
+          escaped[1] = 'f';
+          break;
+        }
+        default: {
+          escaped[1] = 'u';
+          escaped[2] = '0';
+          escaped[3] = '0';
+          escaped[4] = kHex[c >> 4];
+          escaped[5] = kHex[c & 0xF];
+          len = 6;
+          break;
+        }
+      }
+      WriteByteArray(out_, (const byte*)escaped, len);
+      data += n + 1;
+      size -= n + 1;
+    }
+    put('"');
+  }
+
+  OutputIterator& out_;
+  Status status_;
+  int depth_;
+
+  // Number of containers opened past `kMaxDepth`, and not yet closed. They do
+  // not count towards `depth_`.
+  int overflow_;
+
+  // Whether a comma (or, at the top level, a newline) is needed before the
+  // next value or key.
+  bool needs_separator_;
+
+  // Whether a key has just been written.
+  bool after_key_;
+};
+
+}  // namespace roo_io
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "roo_io/base/byte.h"
+#include "roo_io/status.h"
+#include "roo_io/text/unicode.h"
+#include "roo_io/text/utf_transcode.h"
+
+// Streaming UTF-8 decoding and encoding.
+//
+// Unlike `Utf8Decoder`, which needs the entire input in a contiguous buffer,
+// `Utf8StreamDecoder` pulls bytes from a stream in chunks, and handles
+// multi-byte sequences that straddle chunk boundaries.
+
+namespace roo_io {
+
+/// Determines how streaming UTF-8 codecs handle invalid input.
+enum class Utf8ErrorPolicy {
+  /// Substitutes the replacement character (U+FFFD by default) for each
+  /// maximal invalid subpart of the input.
+  kReplace,
+
+  /// Silently drops invalid input.
+  kSkip,
+
+  /// Stops at the first invalid input, setting status to `kInvalidFormat`.
+  kStop,
+};
+
+/// Decodes UTF-8 from a byte source into code points.
+///
+/// `Source` is either an `InputStream` or an input iterator (anything with
+/// `size_t read(byte*, size_t)` and `Status status()`). The decoder reads the
+/// source in chunks into a small internal buffer, so it is efficient even for
+/// unbuffered streams.
+///
+/// Decoding is strict: overlongs, encoded surrogates, and code points above
+/// U+10FFFF are treated as invalid, as are sequences truncated by the end of
+/// the stream.
+///
+/// Example:
+/// @code
+/// Utf8StreamDecoder<InputStream> decoder(uart_stream);
+/// char32_t buf[32];
+/// size_t n;
+/// while ((n = decoder.decode(buf, 32)) > 0) {
+///   ...
+/// }
+/// if (decoder.status() != kEndOfStream) { ... }
+/// @endcode
+template <typename Source>
+class Utf8StreamDecoder {
+ public:
+  /// Size of the internal read buffer.
+  static constexpr size_t kBufferSize = 64;
+
+  explicit Utf8StreamDecoder(Source& in,
+                             Utf8ErrorPolicy policy = Utf8ErrorPolicy::kReplace,
+                             char32_t replacement = 0xFFFD)
+      : in_(in),
+        policy_(policy),
+        replacement_(replacement),
+        pos_(0),
+        end_(0),
+        status_(kOk) {}
+
+  /// Decodes the next code point into `ch`.
+  ///
+  /// Returns false when no more code points are available; `status()` then
+  /// tells why (`kEndOfStream`, `kInvalidFormat`, or a source error).
+  bool next(char32_t& ch) {
+    if (status_ != kOk) return false;
+    while (true) {
+      if (pos_ == end_ && !fill()) return false;
+      uint8_t lead = (uint8_t)buf_[pos_];
+      if (lead < 0x80) {
+        ch = lead;
+        ++pos_;
+        return true;
+      }
+      int len = internal::DecodeUtf8Sequence((const uint8_t*)buf_ + pos_,
+                                             end_ - pos_, ch);
+      if (len > 0) {
+        pos_ += len;
+        return true;
+      }
+      if (len == 0) {
+        // Sequence straddles the end of the buffer.
+        if (refill()) continue;
+        // Truncated by the end of the stream (or by a source error).
+        len = -(int)(end_ - pos_);
+      }
+      pos_ -= len;
+      switch (policy_) {
+        case Utf8ErrorPolicy::kReplace: {
+          ch = replacement_;
+          return true;
+        }
+        case Utf8ErrorPolicy::kSkip: {
+          continue;
+        }
+        default: {
+          status_ = kInvalidFormat;
+          return false;
+        }
+      }
+    }
+  }
+
+  /// Decodes up to `max` code points into `out`. Returns the number of code
+  /// points decoded; zero indicates that no more are available, and
+  /// `status()` tells why.
+  size_t decode(char32_t* out, size_t max) {
+    if (status_ != kOk) return 0;
+    size_t count = 0;
+    while (count < max) {
+      if (pos_ == end_ && !fill()) break;
+      // ASCII fast path, straight from the buffer.
+      const byte* p = buf_ + pos_;
+      size_t n = end_ - pos_;
+      if (n > max - count) n = max - count;
+      size_t i = 0;
+      while (i < n && (uint8_t)p[i] < 0x80) {
+        out[count++] = (uint8_t)p[i++];
+      }
+      pos_ += i;
+      if (i == n) continue;
+      if (!next(out[count])) break;
+      ++count;
+    }
+    return count;
+  }
+
+  /// Returns `kOk` while code points may still be available. Otherwise,
+  /// returns `kEndOfStream`, `kInvalidFormat` (with `kStop` policy), or the
+  /// error reported by the source.
+  Status status() const { return status_; }
+
+ private:
+  // Refills the (empty) buffer. On failure, updates status.
+  bool fill() {
+    if (status_ != kOk) return false;
+    pos_ = 0;
+    end_ = in_.read(buf_, kBufferSize);
+    if (end_ == 0) {
+      status_ = in_.status();
+      return false;
+    }
+    return true;
+  }
+
+  // Moves the remaining (incomplete) bytes to the front of the buffer, and
+  // appends more data after them. Returns false if no more data is available.
+  bool refill() {
+    if (in_.status() != kOk) return false;
+    size_t remaining = end_ - pos_;
+    memmove(buf_, buf_ + pos_, remaining);
+    pos_ = 0;
+    end_ = remaining + in_.read(buf_ + remaining, kBufferSize - remaining);
+    return end_ > remaining;
+  }
+
+  Source& in_;
+  Utf8ErrorPolicy policy_;
+  char32_t replacement_;
+  byte buf_[kBufferSize];
+  size_t pos_;
+  size_t end_;
+  Status status_;
+};
+
+/// Encodes code points as UTF-8 into an output iterator.
+///
+/// Batches the encoded bytes in a small internal buffer, writing them to the
+/// iterator in chunks. Call `flush()` (or destroy the encoder) to write out
+/// the remaining data; note that this does not flush the iterator itself.
+///
+/// Code points that cannot be encoded (surrogates, and values above
+/// U+10FFFF) are handled according to the error policy.
+template <typename OutputIterator>
+class Utf8StreamEncoder {
+ public:
+  /// Size of the internal write buffer.
+  static constexpr size_t kBufferSize = 64;
+
+  explicit Utf8StreamEncoder(OutputIterator& out,
+                             Utf8ErrorPolicy policy = Utf8ErrorPolicy::kReplace,
+                             char32_t replacement = 0xFFFD)
+      : out_(out),
+        policy_(policy),
+        replacement_(replacement),
+        pos_(0),
+        status_(kOk) {}
+
+  ~Utf8StreamEncoder() { flush(); }
+
+  /// Encodes a single code point.
+  void write(char32_t ch) {
+    if (status_ != kOk) return;
+    if (ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)) {
+      if (policy_ == Utf8ErrorPolicy::kSkip) return;
+      if (policy_ == Utf8ErrorPolicy::kStop) {
+        status_ = kInvalidFormat;
+        return;
+      }
+      ch = replacement_;
+    }
+    if (pos_ + 4 > kBufferSize) flush();
+    pos_ += WriteUtf8Char(buf_ + pos_, ch);
+  }
+
+  /// Encodes `count` code points.
+  void write(const char32_t* data, size_t count) {
+    while (count > 0 && status_ == kOk) {
+      char32_t ch = *data;
+      if (ch < 0x80 && pos_ < kBufferSize) {
+        buf_[pos_++] = (byte)ch;
+      } else {
+        write(ch);
+      }
+      ++data;
+      --count;
+    }
+  }
+
+  /// Writes the buffered bytes to the output iterator.
+  void flush() {
+    size_t written = 0;
+    while (written < pos_ && out_.status() == kOk) {
+      written += out_.write(buf_ + written, pos_ - written);
+    }
+    pos_ = 0;
+  }
+
+  /// Returns `kInvalidFormat` if stopped on an invalid code point (with
+  /// `kStop` policy), and the status of the output iterator otherwise.
+  Status status() const { return status_ != kOk ? status_ : out_.status(); }
+
+ private:
+  OutputIterator& out_;
+  Utf8ErrorPolicy policy_;
+  char32_t replacement_;
+  byte buf_[kBufferSize];
+  size_t pos_;
+  Status status_;
+};
+
+}  // namespace roo_io
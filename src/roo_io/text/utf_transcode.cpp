@@ -0,0 +1,287 @@
+#include "roo_io/text/utf_transcode.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace roo_io {
+
+namespace {
+
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+// Returns whether the 16 bytes at `data` are all ASCII.
+inline bool IsAscii16(const char* data) {
+#if defined(__SSE2__)
+  __m128i v = _mm_loadu_si128((const __m128i*)data);
+  return _mm_movemask_epi8(v) == 0;
+#else
+  uint64_t a, b;
+  memcpy(&a, data, 8);
+  memcpy(&b, data + 8, 8);
+  return ((a | b) & kHighBits) == 0;
+#endif
+}
+
+// Widens 16 ASCII bytes to 16 code units of the output type.
+template <typename Out>
+inline void WidenAscii16(const char* data, Out* out) {
+  for (int i = 0; i < 16; ++i) out[i] = (Out)(uint8_t)data[i];
+}
+
+#if defined(__SSE2__)
+template <>
+inline void WidenAscii16<char16_t>(const char* data, char16_t* out) {
+  __m128i v = _mm_loadu_si128((const __m128i*)data);
+  __m128i zero = _mm_setzero_si128();
+  _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi8(v, zero));
+  _mm_storeu_si128((__m128i*)(out + 8), _mm_unpackhi_epi8(v, zero));
+}
+
+template <>
+inline void WidenAscii16<char32_t>(const char* data, char32_t* out) {
+  __m128i v = _mm_loadu_si128((const __m128i*)data);
+  __m128i zero = _mm_setzero_si128();
+  __m128i lo = _mm_unpacklo_epi8(v, zero);
+  __m128i hi = _mm_unpackhi_epi8(v, zero);
+  _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi16(lo, zero));
+  _mm_storeu_si128((__m128i*)(out + 4), _mm_unpackhi_epi16(lo, zero));
+  _mm_storeu_si128((__m128i*)(out + 8), _mm_unpacklo_epi16(hi, zero));
+  _mm_storeu_si128((__m128i*)(out + 12), _mm_unpackhi_epi16(hi, zero));
+}
+#endif
+
+inline bool IsSurrogate(char32_t c) { return c >= 0xD800 && c <= 0xDFFF; }
+
+inline bool IsHighSurrogate(char32_t c) { return c >= 0xD800 && c <= 0xDBFF; }
+
+inline bool IsLowSurrogate(char32_t c) { return c >= 0xDC00 && c <= 0xDFFF; }
+
+// Writes the UTF-8 encoding of a valid code point. Returns its length.
+inline size_t EncodeUtf8(char32_t cp, char* out) {
+  if (cp < 0x80) {
+    out[0] = (char)cp;
+    return 1;
+  }
+  if (cp < 0x800) {
+    out[0] = (char)(0xC0 | (cp >> 6));
+    out[1] = (char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+  if (cp < 0x10000) {
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+  }
+  out[0] = (char)(0xF0 | (cp >> 18));
+  out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+  out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+  out[3] = (char)(0x80 | (cp & 0x3F));
+  return 4;
+}
+
+// Counts bytes in the 8-byte word that are not UTF-8 continuation bytes.
+inline size_t CountNonContinuation(uint64_t word) {
+  // A byte is a continuation byte iff its top bits are 10.
+  uint64_t continuation = word & ~(word << 1) & kHighBits;
+  return 8 - __builtin_popcountll(continuation);
+}
+
+// Counts bytes in the 8-byte word that are 4-byte sequence leads (>= 0xF0).
+inline size_t CountFourByteLeads(uint64_t word) {
+  uint64_t leads = word & (word << 1) & (word << 2) & (word << 3) & kHighBits;
+  return __builtin_popcountll(leads);
+}
+
+template <typename Out>
+UtfResult Utf8ToUtfN(const char* data, size_t size, Out* out) {
+  const uint8_t* p = (const uint8_t*)data;
+  size_t i = 0;
+  Out* o = out;
+  while (i < size) {
+    if (i + 16 <= size && IsAscii16(data + i)) {
+      WidenAscii16(data + i, o);
+      i += 16;
+      o += 16;
+      continue;
+    }
+    uint8_t c = p[i];
+    if (c < 0x80) {
+      *o++ = c;
+      ++i;
+      continue;
+    }
+    char32_t cp;
+    int len = internal::DecodeUtf8Sequence(p + i, size - i, cp);
+    if (len <= 0) return UtfResult{false, i};
+    if (sizeof(Out) == 2 && cp >= 0x10000) {
+      cp -= 0x10000;
+      *o++ = (Out)(0xD800 + (cp >> 10));
+      *o++ = (Out)(0xDC00 + (cp & 0x3FF));
+    } else {
+      *o++ = (Out)cp;
+    }
+    i += len;
+  }
+  return UtfResult{true, (size_t)(o - out)};
+}
+
+}  // namespace
+
+UtfResult ValidateUtf8WithErrors(const char* data, size_t size) {
+  const uint8_t* p = (const uint8_t*)data;
+  size_t i = 0;
+  while (i < size) {
+    if (i + 32 <= size && IsAscii16(data + i) && IsAscii16(data + i + 16)) {
+      i += 32;
+      continue;
+    }
+    if (p[i] < 0x80) {
+      ++i;
+      continue;
+    }
+    char32_t cp;
+    int len = internal::DecodeUtf8Sequence(p + i, size - i, cp);
+    if (len <= 0) return UtfResult{false, i};
+    i += len;
+  }
+  return UtfResult{true, size};
+}
+
+bool ValidateUtf8(const char* data, size_t size) {
+  return ValidateUtf8WithErrors(data, size).valid;
+}
+
+bool ValidateUtf16(const char16_t* data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    char16_t c = data[i];
+    if (!IsSurrogate(c)) continue;
+    if (!IsHighSurrogate(c) || i + 1 >= size || !IsLowSurrogate(data[i + 1])) {
+      return false;
+    }
+    ++i;
+  }
+  return true;
+}
+
+bool ValidateUtf32(const char32_t* data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if (data[i] > 0x10FFFF || IsSurrogate(data[i])) return false;
+  }
+  return true;
+}
+
+size_t Utf32LengthFromUtf8(const char* data, size_t size) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    count += CountNonContinuation(word);
+  }
+  for (; i < size; ++i) {
+    if (!internal::IsUtf8Continuation((uint8_t)data[i])) ++count;
+  }
+  return count;
+}
+
+size_t Utf16LengthFromUtf8(const char* data, size_t size) {
+  size_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    count += CountNonContinuation(word) + CountFourByteLeads(word);
+  }
+  for (; i < size; ++i) {
+    uint8_t b = (uint8_t)data[i];
+    if (!internal::IsUtf8Continuation(b)) ++count;
+    if (b >= 0xF0) ++count;
+  }
+  return count;
+}
+
+size_t Utf8LengthFromUtf16(const char16_t* data, size_t size) {
+  size_t count = 0;
+  for (size_t i = 0; i < size; ++i) {
+    char16_t c = data[i];
+    // Each half of a surrogate pair contributes 2 of the 4 bytes.
+    count += (c < 0x80) ? 1 : (c < 0x800 || IsSurrogate(c)) ? 2 : 3;
+  }
+  return count;
+}
+
+size_t Utf8LengthFromUtf32(const char32_t* data, size_t size) {
+  size_t count = 0;
+  for (size_t i = 0; i < size; ++i) {
+    char32_t c = data[i];
+    count += (c < 0x80) ? 1 : (c < 0x800) ? 2 : (c < 0x10000) ? 3 : 4;
+  }
+  return count;
+}
+
+UtfResult Utf8ToUtf32(const char* data, size_t size, char32_t* out) {
+  return Utf8ToUtfN(data, size, out);
+}
+
+UtfResult Utf8ToUtf16(const char* data, size_t size, char16_t* out) {
+  return Utf8ToUtfN(data, size, out);
+}
+
+UtfResult Utf32ToUtf8(const char32_t* data, size_t size, char* out) {
+  char* o = out;
+  size_t i = 0;
+  while (i < size) {
+    // ASCII fast path, 4 code points at a time.
+    if (i + 4 <= size && (data[i] | data[i + 1] | data[i + 2] | data[i + 3]) <
+                             0x80) {
+      o[0] = (char)data[i];
+      o[1] = (char)data[i + 1];
+      o[2] = (char)data[i + 2];
+      o[3] = (char)data[i + 3];
+      o += 4;
+      i += 4;
+      continue;
+    }
+    char32_t c = data[i];
+    if (c > 0x10FFFF || IsSurrogate(c)) return UtfResult{false, i};
+    o += EncodeUtf8(c, o);
+    ++i;
+  }
+  return UtfResult{true, (size_t)(o - out)};
+}
+
+UtfResult Utf16ToUtf8(const char16_t* data, size_t size, char* out) {
+  char* o = out;
+  size_t i = 0;
+  while (i < size) {
+    if (i + 4 <= size && (data[i] | data[i + 1] | data[i + 2] | data[i + 3]) <
+                             0x80) {
+      o[0] = (char)data[i];
+      o[1] = (char)data[i + 1];
+      o[2] = (char)data[i + 2];
+      o[3] = (char)data[i + 3];
+      o += 4;
+      i += 4;
+      continue;
+    }
+    char32_t c = data[i];
+    if (IsSurrogate(c)) {
+      if (!IsHighSurrogate(c) || i + 1 >= size ||
+          !IsLowSurrogate(data[i + 1])) {
+        return UtfResult{false, i};
+      }
+      c = 0x10000 + ((c - 0xD800) << 10) + (data[i + 1] - 0xDC00);
+      ++i;
+    }
+    o += EncodeUtf8(c, o);
+    ++i;
+  }
+  return UtfResult{true, (size_t)(o - out)};
+}
+
+}  // namespace roo_io
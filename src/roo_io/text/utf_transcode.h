@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "roo_backport.h"
+#include "roo_backport/string_view.h"
+
+// Bulk validation and conversion between UTF-8, UTF-16, and UTF-32.
+//
+// These functions operate on whole buffers, and are considerably faster than
+// decoding one code point at a time with `Utf8Decoder`. Runs of ASCII are
+// processed 16 bytes per step (using SSE2 on hosts that support it, and
+// 64-bit word operations elsewhere).
+//
+// Validation is strict: overlong encodings, encoded surrogates, code points
+// above U+10FFFF, and unpaired UTF-16 surrogates are all rejected. (Note that
+// this is stricter than `Utf8Decoder`, which accepts 'modified UTF-8' C0 80
+// as U+0000.)
+//
+// The conversion functions do not check output capacity. Use the
+// `...LengthFrom...()` functions to compute the exact output size first.
+
+namespace roo_io {
+
+namespace internal {
+
+inline bool IsUtf8Continuation(uint8_t b) { return (b & 0xC0) == 0x80; }
+
+// Decodes one multi-byte UTF-8 sequence, whose lead byte p[0] is >= 0x80, from
+// `remaining` available bytes. Returns:
+// * > 0: the length of the valid sequence; `cp` is set to the code point,
+// * 0: the available bytes are a valid, but incomplete, prefix,
+// * < 0: the sequence is invalid; its negation is the length of the maximal
+//   invalid subpart, which should be skipped (and, typically, replaced by a
+//   single U+FFFD).
+inline int DecodeUtf8Sequence(const uint8_t* p, size_t remaining,
+                              char32_t& cp) {
+  uint8_t lead = p[0];
+  int len;
+  // Bounds of the second byte; they exclude overlongs, surrogates, and code
+  // points above U+10FFFF.
+  uint8_t min = 0x80;
+  uint8_t max = 0xBF;
+  if (lead < 0xC2) {
+    return -1;
+  } else if (lead < 0xE0) {
+    len = 2;
+  } else if (lead < 0xF0) {
+    len = 3;
+    if (lead == 0xE0) min = 0xA0;
+    if (lead == 0xED) max = 0x9F;
+  } else if (lead < 0xF5) {
+    len = 4;
+    if (lead == 0xF0) min = 0x90;
+    if (lead == 0xF4) max = 0x8F;
+  } else {
+    return -1;
+  }
+  if (remaining < 2) return 0;
+  if (p[1] < min || p[1] > max) return -1;
+  for (int i = 2; i < len; ++i) {
+    if (remaining <= (size_t)i) return 0;
+    if (!IsUtf8Continuation(p[i])) return -i;
+  }
+  cp = lead & (0x7F >> len);
+  for (int i = 1; i < len; ++i) cp = (cp << 6) | (p[i] & 0x3F);
+  return len;
+}
+
+}  // namespace internal
+
+/// Outcome of a bulk UTF conversion or validation.
+struct UtfResult {
+  /// Whether the input was valid.
+  bool valid;
+
+  /// If `valid`, the number of code units written to the output. Otherwise,
+  /// the offset (in input code units) of the first invalid sequence.
+  size_t count;
+};
+
+/// Returns whether [`data`, `data + size`) is valid UTF-8.
+bool ValidateUtf8(const char* data, size_t size);
+
+/// Returns whether `s` is valid UTF-8.
+inline bool ValidateUtf8(roo::string_view s) {
+  return ValidateUtf8(s.data(), s.size());
+}
+
+/// Validates UTF-8, returning the offset of the first invalid sequence on
+/// failure, and the length of the input on success.
+UtfResult ValidateUtf8WithErrors(const char* data, size_t size);
+
+/// Returns whether [`data`, `data + size`) is valid UTF-16.
+bool ValidateUtf16(const char16_t* data, size_t size);
+
+/// Returns whether [`data`, `data + size`) is valid UTF-32.
+bool ValidateUtf32(const char32_t* data, size_t size);
+
+/// Returns the number of UTF-32 code units (i.e. code points) that
+/// `Utf8ToUtf32()` writes for the specified valid UTF-8 input.
+size_t Utf32LengthFromUtf8(const char* data, size_t size);
+
+/// Returns the number of UTF-16 code units that `Utf8ToUtf16()` writes for the
+/// specified valid UTF-8 input.
+size_t Utf16LengthFromUtf8(const char* data, size_t size);
+
+/// Returns the number of bytes that `Utf16ToUtf8()` writes for the specified
+/// valid UTF-16 input.
+size_t Utf8LengthFromUtf16(const char16_t* data, size_t size);
+
+/// Returns the number of bytes that `Utf32ToUtf8()` writes for the specified
+/// valid UTF-32 input.
+size_t Utf8LengthFromUtf32(const char32_t* data, size_t size);
+
+/// Converts UTF-8 to UTF-32.
+///
+/// `out` must have room for `Utf32LengthFromUtf8(data, size)` code units. On
+/// invalid input, stops at the first invalid sequence; the output written so
+/// far is valid, but its length is not reported.
+UtfResult Utf8ToUtf32(const char* data, size_t size, char32_t* out);
+
+/// Converts UTF-8 to UTF-16.
+///
+/// `out` must have room for `Utf16LengthFromUtf8(data, size)` code units.
+UtfResult Utf8ToUtf16(const char* data, size_t size, char16_t* out);
+
+/// Converts UTF-32 to UTF-8.
+///
+/// `out` must have room for `Utf8LengthFromUtf32(data, size)` bytes.
+UtfResult Utf32ToUtf8(const char32_t* data, size_t size, char* out);
+
+/// Converts UTF-16 to UTF-8.
+///
+/// `out` must have room for `Utf8LengthFromUtf16(data, size)` bytes.
+UtfResult Utf16ToUtf8(const char16_t* data, size_t size, char* out);
+
+}  // namespace roo_io
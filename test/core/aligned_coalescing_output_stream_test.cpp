@@ -0,0 +1,195 @@
+#include "roo_io/core/aligned_coalescing_output_stream.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace roo_io {
+
+namespace {
+
+// Records written data, and the offset and size of each write.
+class FakeDevice : public OutputStream {
+ public:
+  explicit FakeDevice(size_t capacity = 1000000)
+      : status_(kOk), capacity_(capacity), flush_count_(0) {}
+
+  size_t write(const byte* buf, size_t count) override {
+    if (status_ != kOk) return 0;
+    if (count > capacity_ - data_.size()) {
+      count = capacity_ - data_.size();
+      status_ = kNoSpaceLeftOnDevice;
+      if (count == 0) return 0;
+    }
+    writes_.push_back(std::make_pair(data_.size(), count));
+    data_.append((const char*)buf, count);
+    return count;
+  }
+
+  void flush() override { ++flush_count_; }
+
+  void close() override {
+    if (status_ == kOk) status_ = kClosed;
+  }
+
+  Status status() const override { return status_; }
+
+  const std::string& data() const { return data_; }
+  const std::vector<std::pair<size_t, size_t>>& writes() const {
+    return writes_;
+  }
+  int flush_count() const { return flush_count_; }
+
+ private:
+  Status status_;
+  size_t capacity_;
+  std::string data_;
+  std::vector<std::pair<size_t, size_t>> writes_;
+  int flush_count_;
+};
+
+std::string TestData(size_t size) {
+  std::string data;
+  for (size_t i = 0; i < size; ++i) {
+    data.push_back('a' + (i * 7) % 26);
+  }
+  return data;
+}
+
+AlignedCoalescingOptions Options(size_t sector_size, size_t buffer_size,
+                                 uint64_t start_offset = 0) {
+  AlignedCoalescingOptions options;
+  options.sector_size = sector_size;
+  options.buffer_size = buffer_size;
+  options.start_offset = start_offset;
+  return options;
+}
+
+}  // namespace
+
+TEST(AlignedCoalescingOutputStream, CoalescesSmallWrites) {
+  FakeDevice* device = new FakeDevice();
+  AlignedCoalescingOutputStream out((std::unique_ptr<OutputStream>(device)),
+                                    Options(16, 32));
+  std::string data = TestData(100);
+  for (size_t i = 0; i < data.size(); i += 5) {
+    ASSERT_EQ(5, out.writeFully((const byte*)&data[i], 5));
+  }
+  // Three full buffers; the rest stays buffered.
+  ASSERT_EQ(3, device->writes().size());
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(i * 32, device->writes()[i].first);
+    EXPECT_EQ(32, device->writes()[i].second);
+  }
+  EXPECT_EQ(6, out.stats().full_sectors);
+  EXPECT_EQ(0, out.stats().partial_sectors);
+  out.close();
+  EXPECT_EQ(kClosed, out.status());
+  EXPECT_EQ(data, device->data());
+  ASSERT_EQ(4, device->writes().size());
+  EXPECT_EQ(4, device->writes()[3].second);
+  EXPECT_EQ(1, out.stats().partial_sectors);
+  EXPECT_EQ(4, out.stats().writes);
+  EXPECT_EQ(0, out.stats().bypass_writes);
+}
+
+TEST(AlignedCoalescingOutputStream, BypassesLargeAlignedWrites) {
+  FakeDevice* device = new FakeDevice();
+  AlignedCoalescingOutputStream out((std::unique_ptr<OutputStream>(device)),
+                                    Options(16, 32));
+  std::string data = TestData(100);
+  // Aligned; all but the last 4 bytes go directly to the device.
+  EXPECT_EQ(100, out.writeFully((const byte*)data.data(), 100));
+  ASSERT_EQ(1, device->writes().size());
+  EXPECT_EQ(96, device->writes()[0].second);
+  EXPECT_EQ(1, out.stats().bypass_writes);
+  EXPECT_EQ(6, out.stats().full_sectors);
+
+  // Unaligned now; gets buffered.
+  EXPECT_EQ(40, out.writeFully((const byte*)data.data(), 40));
+  ASSERT_EQ(2, device->writes().size());
+  EXPECT_EQ(96, device->writes()[1].first);
+  EXPECT_EQ(32, device->writes()[1].second);
+  EXPECT_EQ(1, out.stats().bypass_writes);
+  out.close();
+  EXPECT_EQ(data + data.substr(0, 40), device->data());
+  EXPECT_EQ(0, (device->writes()[1].first + device->writes()[1].second) % 16);
+}
+
+TEST(AlignedCoalescingOutputStream, FlushWritesPartialSector) {
+  FakeDevice* device = new FakeDevice();
+  AlignedCoalescingOutputStream out((std::unique_ptr<OutputStream>(device)),
+                                    Options(16, 64));
+  std::string data = TestData(200);
+  out.writeFully((const byte*)data.data(), 10);
+  out.flush();
+  EXPECT_EQ(kOk, out.status());
+  EXPECT_EQ(1, device->flush_count());
+  ASSERT_EQ(1, device->writes().size());
+  EXPECT_EQ(10, device->writes()[0].second);
+  EXPECT_EQ(1, out.stats().partial_sectors);
+
+  // The next buffer is shortened, so that it ends on a sector boundary.
+  for (size_t i = 10; i < 200; i += 10) {
+    out.writeFully((const byte*)&data[i], 10);
+  }
+  ASSERT_LE(2, device->writes().size());
+  EXPECT_EQ(10, device->writes()[1].first);
+  EXPECT_EQ(54, device->writes()[1].second);
+  for (size_t i = 2; i < device->writes().size(); ++i) {
+    EXPECT_EQ(0, device->writes()[i].first % 16);
+    EXPECT_EQ(64, device->writes()[i].second);
+  }
+  EXPECT_EQ(2, out.stats().partial_sectors);
+  out.close();
+  EXPECT_EQ(data, device->data());
+}
+
+TEST(AlignedCoalescingOutputStream, UnalignedStartOffset) {
+  FakeDevice* device = new FakeDevice();
+  AlignedCoalescingOutputStream out((std::unique_ptr<OutputStream>(device)),
+                                    Options(16, 32, 100));
+  std::string data = TestData(100);
+  EXPECT_EQ(100, out.writeFully((const byte*)data.data(), 100));
+  // 100 % 16 = 4; the first write fills up to offset 128.
+  ASSERT_LE(1, device->writes().size());
+  EXPECT_EQ(28, device->writes()[0].second);
+  // The rest is aligned, and bypasses the buffer.
+  EXPECT_EQ(2, device->writes().size());
+  EXPECT_EQ(1, out.stats().bypass_writes);
+  EXPECT_EQ(1, out.stats().partial_sectors);
+  EXPECT_EQ(5, out.stats().full_sectors);
+  out.close();
+  EXPECT_EQ(data, device->data());
+}
+
+TEST(AlignedCoalescingOutputStream, RoundsUpBufferSize) {
+  FakeDevice* device = new FakeDevice();
+  AlignedCoalescingOutputStream out((std::unique_ptr<OutputStream>(device)),
+                                    Options(16, 20));
+  std::string data = TestData(64);
+  for (size_t i = 0; i < data.size(); ++i) {
+    out.writeFully((const byte*)&data[i], 1);
+  }
+  ASSERT_EQ(2, device->writes().size());
+  EXPECT_EQ(32, device->writes()[0].second);
+  EXPECT_EQ(32, device->writes()[1].second);
+}
+
+TEST(AlignedCoalescingOutputStream, PropagatesErrors) {
+  FakeDevice* device = new FakeDevice(40);
+  AlignedCoalescingOutputStream out((std::unique_ptr<OutputStream>(device)),
+                                    Options(16, 32));
+  std::string data = TestData(100);
+  out.writeFully((const byte*)data.data(), 10);
+  EXPECT_EQ(kOk, out.status());
+  out.writeFully((const byte*)data.data(), 90);
+  EXPECT_EQ(kNoSpaceLeftOnDevice, out.status());
+  EXPECT_EQ(0, out.write((const byte*)data.data(), 10));
+  out.close();
+  EXPECT_EQ(kNoSpaceLeftOnDevice, out.status());
+}
+
+}  // namespace roo_io
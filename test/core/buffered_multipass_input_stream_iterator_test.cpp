@@ -56,6 +56,53 @@ class BufferedMultipassInputStreamIteratorFixture {
   std::unique_ptr<MultipassInputStream> is_;
 };
 
+class WindowedMultipassInputStreamIteratorFixture {
+ public:
+  using Iterator = BufferedMultipassInputStreamIterator;
+
+  BufferedMultipassInputStreamIterator createIterator(const byte* beg,
+                                                      size_t size) {
+    is_ = std::unique_ptr<MultipassInputStream>(
+        new MemoryInputStream<const byte*>(beg, beg + size));
+    return BufferedMultipassInputStreamIterator(*is_, 200, 50);
+  }
+
+ private:
+  std::unique_ptr<MultipassInputStream> is_;
+};
+
+class GrowingMultipassInputStreamIteratorFixture {
+ public:
+  using Iterator = BufferedMultipassInputStreamIterator;
+
+  BufferedMultipassInputStreamIterator createIterator(const byte* beg,
+                                                      size_t size) {
+    is_ = std::unique_ptr<MultipassInputStream>(
+        new MemoryInputStream<const byte*>(beg, beg + size));
+    return BufferedMultipassInputStreamIterator(*is_, 16, 8, 1000);
+  }
+
+ private:
+  std::unique_ptr<MultipassInputStream> is_;
+};
+
+// Memory stream that counts the reads that reach it.
+class CountingInputStream : public MemoryInputStream<const byte*> {
+ public:
+  CountingInputStream(const byte* beg, const byte* end)
+      : MemoryInputStream<const byte*>(beg, end), reads_(0) {}
+
+  size_t read(byte* buf, size_t count) override {
+    ++reads_;
+    return MemoryInputStream<const byte*>::read(buf, count);
+  }
+
+  int reads() const { return reads_; }
+
+ private:
+  int reads_;
+};
+
 INSTANTIATE_TYPED_TEST_SUITE_P(BufferedMultipassInputStreamIterator,
                                InputIteratorTest,
                                BufferedMultipassInputStreamIteratorFixture);
@@ -64,6 +111,22 @@ INSTANTIATE_TYPED_TEST_SUITE_P(BufferedMultipassInputStreamIterator,
                                MultipassInputIteratorTest,
                                BufferedMultipassInputStreamIteratorFixture);
 
+INSTANTIATE_TYPED_TEST_SUITE_P(WindowedMultipassInputStreamIterator,
+                               InputIteratorTest,
+                               WindowedMultipassInputStreamIteratorFixture);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(WindowedMultipassInputStreamIterator,
+                               MultipassInputIteratorTest,
+                               WindowedMultipassInputStreamIteratorFixture);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(GrowingMultipassInputStreamIterator,
+                               InputIteratorTest,
+                               GrowingMultipassInputStreamIteratorFixture);
+
+INSTANTIATE_TYPED_TEST_SUITE_P(GrowingMultipassInputStreamIterator,
+                               MultipassInputIteratorTest,
+                               GrowingMultipassInputStreamIteratorFixture);
+
 TEST(BufferedMultipassInputStreamIterator, DefaultConstructibleAndClosed) {
   BufferedMultipassInputStreamIterator itr;
   EXPECT_EQ(kClosed, itr.status());
@@ -100,4 +163,119 @@ TEST(BufferedMultipassInputStreamIterator, SeekPreservesUnderlyingFailure) {
   EXPECT_EQ(kSeekError, itr.status());
 }
 
-}  // namespace roo_io
\ No newline at end of file
+TEST(BufferedMultipassInputStreamIterator, SeeksWithinWindow) {
+  byte data[1000];
+  for (int i = 0; i < 1000; ++i) data[i] = (byte)(i % 251);
+  CountingInputStream input(data, data + 1000);
+  BufferedMultipassInputStreamIterator itr(input, 256);
+  itr.seek(100);
+  EXPECT_EQ(data[100], itr.read());
+  EXPECT_EQ(1, input.reads());
+  // Backward and forward, within the 256 bytes read.
+  for (int pos : {355, 110, 300, 101, 100, 200}) {
+    itr.seek(pos);
+    EXPECT_EQ(pos, itr.position());
+    EXPECT_EQ(data[pos], itr.read());
+  }
+  EXPECT_EQ(1, input.reads());
+  EXPECT_EQ(6, itr.seekHits());
+  EXPECT_EQ(1, itr.seekMisses());
+  itr.seek(400);
+  EXPECT_EQ(data[400], itr.read());
+  EXPECT_EQ(2, input.reads());
+  EXPECT_EQ(2, itr.seekMisses());
+}
+
+TEST(BufferedMultipassInputStreamIterator, ReadBehind) {
+  byte data[1000];
+  for (int i = 0; i < 1000; ++i) data[i] = (byte)(i % 251);
+  CountingInputStream input(data, data + 1000);
+  BufferedMultipassInputStreamIterator itr(input, 100, 40);
+  itr.seek(900);
+  EXPECT_EQ(data[900], itr.read());
+  // Walk backwards, like a parser reading a trailer and then the preceding
+  // records.
+  int reads = input.reads();
+  itr.seek(500);
+  EXPECT_EQ(500, itr.position());
+  EXPECT_EQ(data[500], itr.read());
+  EXPECT_EQ(reads + 1, input.reads());
+  itr.seek(470);
+  EXPECT_EQ(data[470], itr.read());
+  itr.seek(460);
+  EXPECT_EQ(data[460], itr.read());
+  EXPECT_EQ(reads + 1, input.reads());
+  EXPECT_EQ(2, itr.seekHits());
+
+  // Near the start of the stream, read-behind is cut short.
+  itr.seek(10);
+  EXPECT_EQ(10, itr.position());
+  byte buf[20];
+  EXPECT_EQ(20, itr.read(buf, 20));
+  EXPECT_EQ(0, memcmp(buf, data + 10, 20));
+  itr.seek(0);
+  EXPECT_EQ(data[0], itr.read());
+  EXPECT_EQ(3, itr.seekHits());
+}
+
+TEST(BufferedMultipassInputStreamIterator, ReadBehindPastEnd) {
+  byte data[100];
+  for (int i = 0; i < 100; ++i) data[i] = (byte)i;
+  MemoryInputStream<const byte*> input(data, data + 100);
+  BufferedMultipassInputStreamIterator itr(input, 32, 16);
+  itr.seek(90);
+  byte buf[32];
+  EXPECT_EQ(10, itr.read(buf, 32));
+  // Backward seek; the refill starts 16 bytes earlier.
+  itr.seek(40);
+  itr.skip(5);
+  EXPECT_EQ(45, itr.position());
+  EXPECT_EQ(data[45], itr.read());
+  // Seek to the end, via a read-behind refill that falls short of it.
+  itr.seek(0);
+  itr.seek(200);
+  EXPECT_EQ(byte{0}, itr.read());
+  EXPECT_EQ(kEndOfStream, itr.status());
+}
+
+TEST(BufferedMultipassInputStreamIterator, SeekAfterDirectRead) {
+  byte data[300];
+  for (int i = 0; i < 300; ++i) data[i] = (byte)i;
+  MemoryInputStream<const byte*> input(data, data + 300);
+  BufferedMultipassInputStreamIterator itr(input);
+  byte buf[100];
+  EXPECT_EQ(data[0], itr.read());
+  itr.skip(63);
+  // Bypasses the buffer.
+  EXPECT_EQ(100, itr.read(buf, 100));
+  EXPECT_EQ(0, memcmp(buf, data + 64, 100));
+  itr.seek(150);
+  EXPECT_EQ(data[150], itr.read());
+}
+
+TEST(BufferedMultipassInputStreamIterator, GrowsDuringSequentialReads) {
+  byte data[10000];
+  for (int i = 0; i < 10000; ++i) data[i] = (byte)(i % 251);
+  CountingInputStream input(data, data + 10000);
+  BufferedMultipassInputStreamIterator itr(input, 64, 0, 1024);
+  for (int i = 0; i < 5000; ++i) {
+    ASSERT_EQ(data[i], itr.read());
+  }
+  EXPECT_EQ(1024, itr.readAheadStats().peak_size);
+  // 64 + 128 + 256 + 512 + 1024 + 3 * 1024.
+  EXPECT_EQ(8, input.reads());
+
+  // After a seek, reads are small again.
+  itr.seek(100);
+  EXPECT_EQ(data[100], itr.read());
+  EXPECT_EQ(64, itr.readAheadStats().last_size);
+  EXPECT_EQ(2, itr.readAheadStats().random_reads);
+  byte buf[100];
+  EXPECT_EQ(63, itr.read(buf, 100));
+  EXPECT_EQ(0, memcmp(buf, data + 101, 63));
+  EXPECT_EQ(100, itr.read(buf, 100));
+  EXPECT_EQ(0, memcmp(buf, data + 164, 100));
+  EXPECT_EQ(128, itr.readAheadStats().last_size);
+}
+
+}  // namespace roo_io
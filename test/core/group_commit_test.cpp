@@ -0,0 +1,183 @@
+#include "roo_io/core/group_commit.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_threads/condition_variable.h"
+#include "roo_threads/mutex.h"
+#include "roo_threads/thread.h"
+
+namespace roo_io {
+
+namespace {
+
+// Records written data, and how much of it has been synced. Syncs are slow,
+// to give concurrent writers a chance to pile up, and can be held until
+// released by the test.
+class FakeDevice : public OutputStream {
+ public:
+  FakeDevice() : status_(kOk), synced_size_(0), sync_count_(0) {}
+
+  size_t write(const byte* buf, size_t count) override {
+    if (status_ != kOk) return 0;
+    data_.append((const char*)buf, count);
+    return count;
+  }
+
+  void sync(SyncLevel level) override {
+    if (status_ != kOk) return;
+    EXPECT_EQ(kSyncFull, level);
+    {
+      roo::unique_lock<roo::mutex> lock(gate_mutex_);
+      sync_started_ = true;
+      gate_.notify_all();
+      while (hold_syncs_) gate_.wait(lock);
+    }
+    roo::this_thread::sleep_for(roo_time::Millis(2));
+    if (fail_sync_) {
+      status_ = kWriteError;
+      return;
+    }
+    synced_size_ = data_.size();
+    ++sync_count_;
+  }
+
+  Status status() const override { return status_; }
+
+  const std::string& data() const { return data_; }
+  size_t synced_size() const { return synced_size_; }
+  int sync_count() const { return sync_count_; }
+
+  void set_fail_sync() { fail_sync_ = true; }
+
+  // Makes syncs block until `releaseSyncs()`.
+  void holdSyncs() {
+    roo::unique_lock<roo::mutex> lock(gate_mutex_);
+    hold_syncs_ = true;
+  }
+
+  void releaseSyncs() {
+    roo::unique_lock<roo::mutex> lock(gate_mutex_);
+    hold_syncs_ = false;
+    gate_.notify_all();
+  }
+
+  // Blocks until a sync has started.
+  void awaitSync() {
+    roo::unique_lock<roo::mutex> lock(gate_mutex_);
+    while (!sync_started_) gate_.wait(lock);
+  }
+
+ private:
+  Status status_;
+  std::string data_;
+  size_t synced_size_;
+  int sync_count_;
+  bool fail_sync_ = false;
+
+  roo::mutex gate_mutex_;
+  roo::condition_variable gate_;
+  bool hold_syncs_ = false;
+  bool sync_started_ = false;
+};
+
+}  // namespace
+
+TEST(GroupCommit, SingleWriter) {
+  FakeDevice device;
+  GroupCommit log(device, kSyncFull);
+  uint64_t t1 = log.write((const byte*)"foo", 3);
+  uint64_t t2 = log.write((const byte*)"bar", 3);
+  EXPECT_LT(t1, t2);
+  EXPECT_EQ(0, device.synced_size());
+  EXPECT_EQ(kOk, log.commit(t2));
+  EXPECT_EQ(6, device.synced_size());
+  EXPECT_EQ(1, log.syncCount());
+  // Already covered by the previous sync.
+  EXPECT_EQ(kOk, log.commit(t1));
+  EXPECT_EQ(1, log.syncCount());
+  EXPECT_EQ(kOk, log.writeAndCommit((const byte*)"baz", 3));
+  EXPECT_EQ(2, log.syncCount());
+  EXPECT_EQ("foobarbaz", device.data());
+  EXPECT_EQ(9, device.synced_size());
+}
+
+TEST(GroupCommit, SyncError) {
+  FakeDevice device;
+  GroupCommit log(device, kSyncFull);
+  device.set_fail_sync();
+  EXPECT_EQ(kWriteError, log.writeAndCommit((const byte*)"foo", 3));
+  EXPECT_EQ(kWriteError, log.status());
+  EXPECT_EQ(kWriteError, log.writeAndCommit((const byte*)"bar", 3));
+  EXPECT_EQ("foo", device.data());
+}
+
+TEST(GroupCommit, WritesDuringSyncShareTheNextSync) {
+  static const int kWriters = 8;
+  FakeDevice device;
+  device.holdSyncs();
+  GroupCommit log(device, kSyncFull);
+  roo::thread leader([&log]() {
+    EXPECT_EQ(kOk, log.writeAndCommit((const byte*)"<leader>", 8));
+  });
+  device.awaitSync();
+
+  // Writes do not wait for the sync in progress; they get queued.
+  std::string expected = "<leader>";
+  std::vector<uint64_t> tickets;
+  for (int i = 0; i < kWriters; ++i) {
+    std::string record = "<" + std::to_string(i) + ">";
+    tickets.push_back(log.write((const byte*)record.data(), record.size()));
+    expected += record;
+  }
+  EXPECT_EQ("<leader>", device.data());
+
+  std::vector<roo::thread> committers;
+  for (uint64_t ticket : tickets) {
+    committers.emplace_back(
+        [&log, ticket]() { EXPECT_EQ(kOk, log.commit(ticket)); });
+  }
+  device.releaseSyncs();
+  leader.join();
+  for (auto& t : committers) t.join();
+
+  // A single sync, after the first one, covered all the queued records.
+  EXPECT_EQ(2, log.syncCount());
+  EXPECT_EQ(expected, device.data());
+  EXPECT_EQ(expected.size(), device.synced_size());
+}
+
+TEST(GroupCommit, ConcurrentWritersShareSyncs) {
+  static const int kThreads = 8;
+  static const int kRecordsPerThread = 20;
+  FakeDevice device;
+  GroupCommit log(device, kSyncFull);
+  std::vector<roo::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&log, i]() {
+      for (int j = 0; j < kRecordsPerThread; ++j) {
+        std::string record = "<" + std::to_string(i) + ":" +
+                             std::to_string(j) + ">";
+        EXPECT_EQ(kOk,
+                  log.writeAndCommit((const byte*)record.data(), record.size()));
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  // All records present, and none interleaved.
+  const std::string& data = device.data();
+  for (int i = 0; i < kThreads; ++i) {
+    for (int j = 0; j < kRecordsPerThread; ++j) {
+      std::string record =
+          "<" + std::to_string(i) + ":" + std::to_string(j) + ">";
+      EXPECT_NE(std::string::npos, data.find(record)) << record;
+    }
+  }
+  EXPECT_EQ(data.size(), device.synced_size());
+  EXPECT_EQ(device.sync_count(), log.syncCount());
+  EXPECT_LE(log.syncCount(), kThreads * kRecordsPerThread);
+}
+
+}  // namespace roo_io
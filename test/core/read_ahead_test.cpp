@@ -0,0 +1,56 @@
+#include "roo_io/core/read_ahead.h"
+
+#include "gtest/gtest.h"
+
+namespace roo_io {
+
+TEST(ReadAhead, GrowsWhileSequential) {
+  ReadAhead read_ahead(64, 1000);
+  uint64_t pos = 0;
+  for (size_t expected : {64, 128, 256, 512, 1000, 1000}) {
+    size_t size = read_ahead.next(pos);
+    EXPECT_EQ(expected, size);
+    pos += size;
+    read_ahead.advance(pos);
+  }
+  EXPECT_EQ(5, read_ahead.stats().sequential_reads);
+  EXPECT_EQ(1, read_ahead.stats().random_reads);
+  EXPECT_EQ(1000, read_ahead.stats().last_size);
+  EXPECT_EQ(1000, read_ahead.stats().peak_size);
+}
+
+TEST(ReadAhead, ResetsAfterSeek) {
+  ReadAhead read_ahead(64, 4096);
+  EXPECT_EQ(64, read_ahead.next(0));
+  read_ahead.advance(64);
+  EXPECT_EQ(128, read_ahead.next(64));
+  read_ahead.advance(192);
+  // Seek.
+  EXPECT_EQ(64, read_ahead.next(5000));
+  read_ahead.advance(5064);
+  EXPECT_EQ(128, read_ahead.next(5064));
+  // Short read, e.g. at the end of the file.
+  read_ahead.advance(5100);
+  EXPECT_EQ(256, read_ahead.next(5100));
+  EXPECT_EQ(3, read_ahead.stats().sequential_reads);
+  EXPECT_EQ(2, read_ahead.stats().random_reads);
+  EXPECT_EQ(256, read_ahead.stats().peak_size);
+}
+
+TEST(ReadAhead, DirectReadsContinueRun) {
+  ReadAhead read_ahead(64, 4096);
+  EXPECT_EQ(64, read_ahead.next(0));
+  // A read that bypassed the buffer.
+  read_ahead.advance(10000);
+  EXPECT_EQ(128, read_ahead.next(10000));
+}
+
+TEST(ReadAhead, FixedSize) {
+  ReadAhead read_ahead(64, 0);
+  EXPECT_EQ(64, read_ahead.maxSize());
+  EXPECT_EQ(64, read_ahead.next(0));
+  read_ahead.advance(64);
+  EXPECT_EQ(64, read_ahead.next(64));
+}
+
+}  // namespace roo_io
@@ -0,0 +1,200 @@
+#include "roo_io/data/bit_reader.h"
+
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_io/data/bit_writer.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+namespace roo_io {
+
+namespace {
+
+// Hides the memory iterator type, so that the reader falls back to
+// byte-at-a-time refills.
+class OpaqueIterator {
+ public:
+  OpaqueIterator(const byte* begin, const byte* end) : itr_(begin, end) {}
+
+  byte read() { return itr_.read(); }
+  size_t read(byte* result, size_t count) { return itr_.read(result, count); }
+  void skip(size_t count) { itr_.skip(count); }
+  Status status() const { return itr_.status(); }
+
+ private:
+  MemoryIterator itr_;
+};
+
+template <typename Itr>
+class BitReaderTest : public testing::Test {};
+
+using Iterators = testing::Types<MemoryIterator, MultipassMemoryIterator,
+                                 OpaqueIterator>;
+TYPED_TEST_SUITE(BitReaderTest, Iterators);
+
+}  // namespace
+
+TYPED_TEST(BitReaderTest, MsbFirst) {
+  const byte in[] = {byte{0b10111110}, byte{0xAB}, byte{0xC0}};
+  TypeParam itr(in, in + 3);
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(0b101u, reader.read(3));
+  EXPECT_EQ(0b11110u, reader.read(5));
+  EXPECT_EQ(0xABCu, reader.read(12));
+  EXPECT_EQ(0u, reader.read(4));
+  EXPECT_EQ(kOk, reader.status());
+  EXPECT_EQ(0u, reader.read(1));
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(BitReaderTest, LsbFirst) {
+  const byte in[] = {byte{0b11110101}, byte{0xBC}, byte{0x0A}};
+  TypeParam itr(in, in + 3);
+  BitReader<TypeParam, kLsbFirst> reader(itr);
+  EXPECT_EQ(0b101u, reader.read(3));
+  EXPECT_EQ(0b11110u, reader.read(5));
+  EXPECT_EQ(0xABCu, reader.read(12));
+  EXPECT_EQ(0u, reader.read(4));
+  EXPECT_EQ(kOk, reader.status());
+}
+
+TYPED_TEST(BitReaderTest, Wide) {
+  const byte in[] = {byte{0x10}, byte{0x12}, byte{0x34}, byte{0x56},
+                     byte{0x78}, byte{0x9A}, byte{0xBC}, byte{0xDE},
+                     byte{0xFF}, byte{0x01}, byte{0x02}, byte{0x03}};
+  TypeParam itr(in, in + sizeof(in));
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(1u, reader.read(4));
+  EXPECT_EQ(0x0123456789ABCDEFULL, reader.read(64));
+  EXPECT_EQ(0xFu, reader.read(4));
+  EXPECT_EQ(0x010203u, reader.read(24));
+  EXPECT_EQ(kOk, reader.status());
+}
+
+TYPED_TEST(BitReaderTest, Signed) {
+  const byte in[] = {byte{0xE4}};
+  TypeParam itr(in, in + 1);
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(-2, reader.readSigned(4));
+  EXPECT_EQ(4, reader.readSigned(4));
+}
+
+TYPED_TEST(BitReaderTest, AlignToByte) {
+  const byte in[] = {byte{0xC0}, byte{0xFF}};
+  TypeParam itr(in, in + 2);
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(3u, reader.read(2));
+  EXPECT_FALSE(reader.isByteAligned());
+  reader.alignToByte();
+  EXPECT_TRUE(reader.isByteAligned());
+  EXPECT_EQ(0xFFu, reader.read(8));
+}
+
+TYPED_TEST(BitReaderTest, ExpGolomb) {
+  const byte in[] = {byte{0b10100110}, byte{0b01000010}, byte{0b10011100}};
+  TypeParam itr(in, in + 3);
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(0u, reader.readExpGolomb());
+  EXPECT_EQ(1u, reader.readExpGolomb());
+  EXPECT_EQ(2u, reader.readExpGolomb());
+  EXPECT_EQ(3u, reader.readExpGolomb());
+  EXPECT_EQ(4u, reader.readExpGolomb());
+  EXPECT_EQ(-3, reader.readSignedExpGolomb());
+  EXPECT_EQ(kOk, reader.status());
+}
+
+TYPED_TEST(BitReaderTest, UnaryAcrossRefills) {
+  std::vector<byte> in(10, byte{0});
+  in[0] = byte{0b00011000};
+  in[9] = byte{0b00010000};
+  TypeParam itr(in.data(), in.data() + in.size());
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(3u, reader.readUnary());
+  EXPECT_EQ(0u, reader.readUnary());
+  EXPECT_EQ(70u, reader.readUnary());
+  EXPECT_EQ(kOk, reader.status());
+  reader.readUnary();
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(BitReaderTest, InvalidExpGolomb) {
+  std::vector<byte> in(12, byte{0});
+  in[11] = byte{1};
+  TypeParam itr(in.data(), in.data() + in.size());
+  BitReader<TypeParam> reader(itr);
+  EXPECT_EQ(0u, reader.readExpGolomb());
+  EXPECT_EQ(kInvalidFormat, reader.status());
+}
+
+template <BitOrder bit_order>
+void RoundTrip() {
+  std::mt19937_64 rng(42);
+  struct Field {
+    int kind;
+    int width;
+    uint64_t value;
+  };
+  std::vector<Field> fields;
+  for (int i = 0; i < 2000; ++i) {
+    Field f;
+    f.kind = rng() % 4;
+    f.width = 1 + rng() % 64;
+    f.value = rng();
+    if (f.kind == 0) {
+      f.value &= f.width == 64 ? ~0ULL : (1ULL << f.width) - 1;
+    } else if (f.kind == 1) {
+      f.value >>= rng() % 64;
+    } else if (f.kind == 2) {
+      f.value = rng() % 100;
+    }
+    fields.push_back(f);
+  }
+  std::vector<byte> data;
+  BackInsertingIterator<std::vector<byte>> out(data);
+  {
+    BitWriter<BackInsertingIterator<std::vector<byte>>, bit_order> writer(out);
+    for (const Field& f : fields) {
+      switch (f.kind) {
+        case 0:
+          writer.write(f.value, f.width);
+          break;
+        case 1:
+          writer.writeExpGolomb(f.value >> 1);
+          break;
+        case 2:
+          writer.writeUnary(f.value);
+          break;
+        default:
+          writer.writeSignedExpGolomb((int64_t)f.value >> 2);
+          break;
+      }
+    }
+  }
+  MemoryIterator in(data.data(), data.data() + data.size());
+  BitReader<MemoryIterator, bit_order> reader(in);
+  for (const Field& f : fields) {
+    switch (f.kind) {
+      case 0:
+        ASSERT_EQ(f.value, reader.read(f.width));
+        break;
+      case 1:
+        ASSERT_EQ(f.value >> 1, reader.readExpGolomb());
+        break;
+      case 2:
+        ASSERT_EQ(f.value, reader.readUnary());
+        break;
+      default:
+        ASSERT_EQ((int64_t)f.value >> 2, reader.readSignedExpGolomb());
+        break;
+    }
+  }
+  EXPECT_EQ(kOk, reader.status());
+}
+
+TEST(BitReader, RoundTripMsbFirst) { RoundTrip<kMsbFirst>(); }
+
+TEST(BitReader, RoundTripLsbFirst) { RoundTrip<kLsbFirst>(); }
+
+}  // namespace roo_io
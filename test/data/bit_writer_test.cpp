@@ -0,0 +1,108 @@
+#include "roo_io/data/bit_writer.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+using testing::ElementsAre;
+
+namespace roo_io {
+
+TEST(BitWriter, MsbFirst) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  BitWriter<BackInsertingIterator<std::vector<uint8_t>>> writer(itr);
+  writer.write(0b101, 3);
+  writer.write(0b11110, 5);
+  writer.write(0xABC, 12);
+  writer.flush();
+  EXPECT_THAT(out, ElementsAre(0b10111110, 0xAB, 0xC0));
+}
+
+TEST(BitWriter, LsbFirst) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  BitWriter<BackInsertingIterator<std::vector<uint8_t>>, kLsbFirst> writer(
+      itr);
+  writer.write(0b101, 3);
+  writer.write(0b11110, 5);
+  writer.write(0xABC, 12);
+  writer.flush();
+  EXPECT_THAT(out, ElementsAre(0b11110101, 0xBC, 0x0A));
+}
+
+TEST(BitWriter, FlushesOnDestruction) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  {
+    BitWriter<BackInsertingIterator<std::vector<uint8_t>>> writer(itr);
+    writer.writeBit(true);
+  }
+  EXPECT_THAT(out, ElementsAre(0x80));
+}
+
+TEST(BitWriter, Wide) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  BitWriter<BackInsertingIterator<std::vector<uint8_t>>> writer(itr);
+  writer.write(1, 4);
+  writer.write(0x0123456789ABCDEFULL, 64);
+  writer.write(0xF, 4);
+  writer.flush();
+  EXPECT_THAT(out, ElementsAre(0x10, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE,
+                               0xFF));
+}
+
+TEST(BitWriter, AlignToByte) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  BitWriter<BackInsertingIterator<std::vector<uint8_t>>> writer(itr);
+  writer.write(0b11, 2);
+  EXPECT_FALSE(writer.isByteAligned());
+  writer.alignToByte();
+  EXPECT_TRUE(writer.isByteAligned());
+  writer.write(0xFF, 8);
+  writer.flush();
+  EXPECT_THAT(out, ElementsAre(0xC0, 0xFF));
+}
+
+TEST(BitWriter, ExpGolomb) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  BitWriter<BackInsertingIterator<std::vector<uint8_t>>> writer(itr);
+  // 1, 010, 011, 00100, 00101 (ue 0..4), 00111 (se -3).
+  writer.writeExpGolomb(0);
+  writer.writeExpGolomb(1);
+  writer.writeExpGolomb(2);
+  writer.writeExpGolomb(3);
+  writer.writeExpGolomb(4);
+  writer.writeSignedExpGolomb(-3);
+  writer.flush();
+  EXPECT_THAT(out, ElementsAre(0b10100110, 0b01000010, 0b10011100));
+}
+
+TEST(BitWriter, Unary) {
+  std::vector<uint8_t> out;
+  BackInsertingIterator<std::vector<uint8_t>> itr(out);
+  BitWriter<BackInsertingIterator<std::vector<uint8_t>>> writer(itr);
+  writer.writeUnary(3);
+  writer.writeUnary(0);
+  writer.writeUnary(70);
+  writer.flush();
+  ASSERT_EQ(10u, out.size());
+  EXPECT_EQ(0b00011000, out[0]);
+  EXPECT_EQ(0b00010000, out[9]);
+}
+
+TEST(BitWriter, Overflow) {
+  byte buf[2];
+  MemoryOutputIterator itr(buf, buf + 2);
+  BitWriter<MemoryOutputIterator> writer(itr);
+  writer.write(0xABCDEF, 24);
+  writer.flush();
+  EXPECT_EQ(kNoSpaceLeftOnDevice, writer.status());
+}
+
+}  // namespace roo_io
@@ -1,5 +1,9 @@
 #include "roo_io/data/byte_order.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include "gtest/gtest.h"
 
 namespace roo_io {
@@ -23,4 +27,44 @@ TEST(ByteOrder, Converts32) {
   EXPECT_EQ(0x44332211, (Convert<uint32_t, kLittleEndian, kBigEndian>(i32)));
 }
 
+template <typename T>
+void CheckConvertArray(size_t count, size_t offset) {
+  std::vector<byte> src(count * sizeof(T) + offset);
+  for (size_t i = 0; i < src.size(); ++i) src[i] = (byte)(i * 7 + 1);
+  std::vector<byte> dst(src.size());
+  byte_order::ConvertArray<T, kBigEndian, kLittleEndian>(
+      src.data() + offset, dst.data() + offset, count);
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j < sizeof(T); ++j) {
+      ASSERT_EQ(src[offset + i * sizeof(T) + j],
+                dst[offset + i * sizeof(T) + sizeof(T) - 1 - j]);
+    }
+  }
+  // Converting back, in place, restores the original.
+  byte_order::ConvertArray<T, kLittleEndian, kBigEndian>(
+      dst.data() + offset, dst.data() + offset, count);
+  EXPECT_TRUE(std::equal(src.begin() + offset, src.end(),
+                         dst.begin() + offset));
+}
+
+TEST(ByteOrder, ConvertsArrays) {
+  for (size_t count : {0, 1, 7, 8, 9, 31, 100}) {
+    for (size_t offset : {0, 1, 3}) {
+      SCOPED_TRACE(count);
+      SCOPED_TRACE(offset);
+      CheckConvertArray<uint16_t>(count, offset);
+      CheckConvertArray<int32_t>(count, offset);
+      CheckConvertArray<uint64_t>(count, offset);
+    }
+  }
+}
+
+TEST(ByteOrder, ConvertArrayNoOp) {
+  const uint16_t src[] = {0x1122, 0x3344, 0x5566};
+  uint16_t dst[3];
+  byte_order::ConvertArray<uint16_t, kBigEndian, kBigEndian>(
+      (const byte*)src, (byte*)dst, 3);
+  EXPECT_EQ(0, memcmp(src, dst, sizeof(src)));
+}
+
 }  // namespace roo_io
\ No newline at end of file
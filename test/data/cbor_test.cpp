@@ -0,0 +1,412 @@
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_io/data/cbor_reader.h"
+#include "roo_io/data/cbor_writer.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+namespace roo_io {
+
+namespace {
+
+std::vector<byte> Bytes(std::initializer_list<uint8_t> values) {
+  std::vector<byte> result;
+  for (uint8_t v : values) result.push_back((byte)v);
+  return result;
+}
+
+// Encodes with `fn`, and returns the encoded bytes.
+template <typename Fn>
+std::vector<byte> Encode(Fn fn) {
+  byte buf[256];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  CborWriter<MemoryOutputIterator> writer(out);
+  fn(writer);
+  EXPECT_EQ(kOk, writer.status());
+  return std::vector<byte>(buf, (byte*)out.ptr());
+}
+
+// Hides the memory iterator type, so that the reader takes the generic path.
+class OpaqueIterator {
+ public:
+  OpaqueIterator(const byte* begin, const byte* end) : itr_(begin, end) {}
+
+  byte read() { return itr_.read(); }
+  size_t read(byte* result, size_t count) { return itr_.read(result, count); }
+  void skip(size_t count) { itr_.skip(count); }
+  Status status() const { return itr_.status(); }
+
+ private:
+  MemoryIterator itr_;
+};
+
+template <typename Itr>
+class CborReaderTest : public testing::Test {};
+
+using Iterators = testing::Types<MemoryIterator, MultipassMemoryIterator,
+                                 OpaqueIterator>;
+TYPED_TEST_SUITE(CborReaderTest, Iterators);
+
+}  // namespace
+
+// Examples from RFC 8949, Appendix A.
+
+TEST(CborWriter, Integers) {
+  using W = CborWriter<MemoryOutputIterator>;
+  EXPECT_EQ(Bytes({0x00}), Encode([](W& w) { w.writeUInt(0); }));
+  EXPECT_EQ(Bytes({0x17}), Encode([](W& w) { w.writeUInt(23); }));
+  EXPECT_EQ(Bytes({0x18, 0x18}), Encode([](W& w) { w.writeUInt(24); }));
+  EXPECT_EQ(Bytes({0x18, 0x64}), Encode([](W& w) { w.writeUInt(100); }));
+  EXPECT_EQ(Bytes({0x19, 0x03, 0xE8}), Encode([](W& w) { w.writeUInt(1000); }));
+  EXPECT_EQ(Bytes({0x1A, 0x00, 0x0F, 0x42, 0x40}),
+            Encode([](W& w) { w.writeUInt(1000000); }));
+  EXPECT_EQ(Bytes({0x1B, 0x00, 0x00, 0x00, 0xE8, 0xD4, 0xA5, 0x10, 0x00}),
+            Encode([](W& w) { w.writeUInt(1000000000000ULL); }));
+  EXPECT_EQ(Bytes({0x1B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}),
+            Encode([](W& w) { w.writeUInt(18446744073709551615ULL); }));
+  EXPECT_EQ(Bytes({0x20}), Encode([](W& w) { w.writeInt(-1); }));
+  EXPECT_EQ(Bytes({0x29}), Encode([](W& w) { w.writeInt(-10); }));
+  EXPECT_EQ(Bytes({0x38, 0x63}), Encode([](W& w) { w.writeInt(-100); }));
+  EXPECT_EQ(Bytes({0x39, 0x03, 0xE7}), Encode([](W& w) { w.writeInt(-1000); }));
+  EXPECT_EQ(Bytes({0x3B, 0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}),
+            Encode([](W& w) {
+              w.writeInt(std::numeric_limits<int64_t>::min());
+            }));
+}
+
+TEST(CborWriter, Simple) {
+  using W = CborWriter<MemoryOutputIterator>;
+  EXPECT_EQ(Bytes({0xF4}), Encode([](W& w) { w.writeBool(false); }));
+  EXPECT_EQ(Bytes({0xF5}), Encode([](W& w) { w.writeBool(true); }));
+  EXPECT_EQ(Bytes({0xF6}), Encode([](W& w) { w.writeNull(); }));
+  EXPECT_EQ(Bytes({0xF7}), Encode([](W& w) { w.writeUndefined(); }));
+  EXPECT_EQ(Bytes({0xF0}), Encode([](W& w) { w.writeSimple(16); }));
+  EXPECT_EQ(Bytes({0xF8, 0xFF}), Encode([](W& w) { w.writeSimple(255); }));
+}
+
+TEST(CborWriter, Floats) {
+  using W = CborWriter<MemoryOutputIterator>;
+  EXPECT_EQ(Bytes({0xF9, 0x3E, 0x00}), Encode([](W& w) { w.writeHalf(1.5f); }));
+  EXPECT_EQ(Bytes({0xF9, 0x7B, 0xFF}),
+            Encode([](W& w) { w.writeHalf(65504.0f); }));
+  EXPECT_EQ(Bytes({0xFA, 0x47, 0xC3, 0x50, 0x00}),
+            Encode([](W& w) { w.writeFloat(100000.0f); }));
+  EXPECT_EQ(Bytes({0xFB, 0x3F, 0xF1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A}),
+            Encode([](W& w) { w.writeDouble(1.1); }));
+}
+
+TEST(CborWriter, StringsAndContainers) {
+  using W = CborWriter<MemoryOutputIterator>;
+  EXPECT_EQ(Bytes({0x60}), Encode([](W& w) { w.writeString(""); }));
+  EXPECT_EQ(Bytes({0x64, 0x49, 0x45, 0x54, 0x46}),
+            Encode([](W& w) { w.writeString("IETF"); }));
+  EXPECT_EQ(Bytes({0x44, 0x01, 0x02, 0x03, 0x04}), Encode([](W& w) {
+              const byte data[] = {byte{1}, byte{2}, byte{3}, byte{4}};
+              w.writeBytes(data, 4);
+            }));
+  // [1, [2, 3], [4, 5]]
+  EXPECT_EQ(Bytes({0x83, 0x01, 0x82, 0x02, 0x03, 0x82, 0x04, 0x05}),
+            Encode([](W& w) {
+              w.beginArray(3);
+              w.writeUInt(1);
+              w.beginArray(2);
+              w.writeUInt(2);
+              w.writeUInt(3);
+              w.beginArray(2);
+              w.writeUInt(4);
+              w.writeUInt(5);
+            }));
+  // {"a": 1, "b": [2, 3]}
+  EXPECT_EQ(Bytes({0xA2, 0x61, 0x61, 0x01, 0x61, 0x62, 0x82, 0x02, 0x03}),
+            Encode([](W& w) {
+              w.beginMap(2);
+              w.writeString("a");
+              w.writeUInt(1);
+              w.writeString("b");
+              w.beginArray(2);
+              w.writeUInt(2);
+              w.writeUInt(3);
+            }));
+  // {_ "a": 1, "b": [_ 2, 3]}
+  EXPECT_EQ(Bytes({0xBF, 0x61, 0x61, 0x01, 0x61, 0x62, 0x9F, 0x02, 0x03, 0xFF,
+                   0xFF}),
+            Encode([](W& w) {
+              w.beginIndefiniteMap();
+              w.writeString("a");
+              w.writeUInt(1);
+              w.writeString("b");
+              w.beginIndefiniteArray();
+              w.writeUInt(2);
+              w.writeUInt(3);
+              w.endIndefinite();
+              w.endIndefinite();
+            }));
+  // 1(1363896240)
+  EXPECT_EQ(Bytes({0xC1, 0x1A, 0x51, 0x4B, 0x67, 0xB0}), Encode([](W& w) {
+              w.writeTag(1);
+              w.writeUInt(1363896240);
+            }));
+}
+
+TEST(CborWriter, Overflow) {
+  byte buf[4];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  CborWriter<MemoryOutputIterator> writer(out);
+  writer.writeString("hello");
+  EXPECT_EQ(kNoSpaceLeftOnDevice, writer.status());
+}
+
+TYPED_TEST(CborReaderTest, Integers) {
+  auto data = Bytes({0x00, 0x17, 0x18, 0x18, 0x19, 0x03, 0xE8, 0x1A, 0x00,
+                     0x0F, 0x42, 0x40, 0x1B, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                     0xFF, 0xFF, 0xFF, 0x20, 0x39, 0x03, 0xE7, 0x3B, 0xFF,
+                     0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF});
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  CborReader<TypeParam> reader(in);
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kUnsignedInt, reader.type());
+  EXPECT_EQ(0u, reader.uintValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(23, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(24, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1000, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1000000, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(18446744073709551615ULL, reader.uintValue());
+  EXPECT_FALSE(reader.fitsInt64());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kNegativeInt, reader.type());
+  EXPECT_EQ(-1, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(-1000, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kNegativeInt, reader.type());
+  EXPECT_FALSE(reader.fitsInt64());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(CborReaderTest, SimpleAndFloats) {
+  auto data = Bytes({0xF4, 0xF5, 0xF6, 0xF7, 0xF0, 0xF8, 0xFF, 0xF9, 0x3E,
+                     0x00, 0xF9, 0x7C, 0x00, 0xFA, 0x47, 0xC3, 0x50, 0x00,
+                     0xFB, 0x3F, 0xF1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9A});
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  CborReader<TypeParam> reader(in);
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kBool, reader.type());
+  EXPECT_FALSE(reader.boolValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kBool, reader.type());
+  EXPECT_TRUE(reader.boolValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kNull, reader.type());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kUndefined, reader.type());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kSimple, reader.type());
+  EXPECT_EQ(16, reader.simpleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kSimple, reader.type());
+  EXPECT_EQ(255, reader.simpleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kFloat, reader.type());
+  EXPECT_EQ(1.5, reader.doubleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_TRUE(std::isinf(reader.doubleValue()));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(100000.0, reader.doubleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1.1, reader.doubleValue());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(CborReaderTest, Strings) {
+  // "IETF", h'01020304', "", (_ "strea", "ming"), "xyz"
+  auto data = Bytes({0x64, 0x49, 0x45, 0x54, 0x46, 0x44, 0x01, 0x02, 0x03,
+                     0x04, 0x60, 0x7F, 0x65, 0x73, 0x74, 0x72, 0x65, 0x61,
+                     0x64, 0x6D, 0x69, 0x6E, 0x67, 0xFF, 0x63, 0x78, 0x79,
+                     0x7A});
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  CborReader<TypeParam> reader(in);
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kString, reader.type());
+  EXPECT_EQ(4u, reader.length());
+  char buf[8];
+  EXPECT_EQ(2u, reader.readContent((byte*)buf, 2));
+  EXPECT_EQ(2u, reader.contentRemaining());
+  EXPECT_EQ(2u, reader.readContent((byte*)buf + 2, 8));
+  EXPECT_EQ("IETF", std::string(buf, 4));
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kBytes, reader.type());
+  EXPECT_EQ(4u, reader.length());
+  // Content left unread; skipped by next().
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kString, reader.type());
+  EXPECT_EQ(0u, reader.length());
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kString, reader.type());
+  EXPECT_TRUE(reader.isIndefinite());
+  std::string chunks;
+  while (true) {
+    ASSERT_TRUE(reader.next());
+    if (reader.type() == CborType::kBreak) break;
+    ASSERT_EQ(CborType::kString, reader.type());
+    size_t n = reader.readContent((byte*)buf, sizeof(buf));
+    chunks.append(buf, n);
+  }
+  EXPECT_EQ("streaming", chunks);
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kString, reader.type());
+  roo::string_view view;
+  bool in_place = reader.readStringView(view);
+  bool memory_backed = !std::is_same<TypeParam, OpaqueIterator>::value;
+  EXPECT_EQ(memory_backed, in_place);
+  if (in_place) {
+    EXPECT_EQ("xyz", std::string(view.data(), view.size()));
+  }
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(CborReaderTest, Skip) {
+  // [1, {"a": [_ 2, 1(3)], "b": h'0102'}, (_ "x")], 7
+  auto data = Bytes({0x83, 0x01, 0xA2, 0x61, 0x61, 0x9F, 0x02, 0xC1, 0x03,
+                     0xFF, 0x61, 0x62, 0x42, 0x01, 0x02, 0x7F, 0x61, 0x78,
+                     0xFF, 0x07});
+  {
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(CborType::kArray, reader.type());
+    EXPECT_EQ(3u, reader.length());
+    ASSERT_TRUE(reader.skip());
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(7, reader.intValue());
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kEndOfStream, reader.status());
+  }
+  {
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(1, reader.intValue());
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(CborType::kMap, reader.type());
+    EXPECT_EQ(2u, reader.length());
+    ASSERT_TRUE(reader.skip());
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(CborType::kString, reader.type());
+    EXPECT_TRUE(reader.isIndefinite());
+    ASSERT_TRUE(reader.skip());
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(7, reader.intValue());
+  }
+}
+
+TYPED_TEST(CborReaderTest, Malformed) {
+  {
+    // Reserved additional information.
+    auto data = Bytes({0x1C});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Indefinite-length integer.
+    auto data = Bytes({0x1F});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Truncated argument.
+    auto data = Bytes({0x19, 0x01});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kEndOfStream, reader.status());
+  }
+  {
+    // Break inside a definite-length array.
+    auto data = Bytes({0x82, 0x01, 0xFF});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    EXPECT_FALSE(reader.skip());
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Too deeply nested.
+    std::vector<byte> data(CborReader<TypeParam>::kMaxSkipDepth + 2,
+                           byte{0x81});
+    data.push_back(byte{0x00});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    CborReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    EXPECT_FALSE(reader.skip());
+    EXPECT_EQ(kOutOfRange, reader.status());
+  }
+}
+
+TEST(Cbor, RoundTrip) {
+  byte buf[256];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  {
+    CborWriter<MemoryOutputIterator> writer(out);
+    writer.beginMap(3);
+    writer.writeString("temp");
+    writer.writeFloat(21.5f);
+    writer.writeString("seq");
+    writer.writeInt(-123456789012LL);
+    writer.writeString("raw");
+    writer.beginBytes(3);
+    out.write(byte{7});
+    out.write(byte{8});
+    out.write(byte{9});
+    EXPECT_EQ(kOk, writer.status());
+  }
+  MemoryIterator in(buf, out.ptr());
+  CborReader<MemoryIterator> reader(in);
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kMap, reader.type());
+  EXPECT_EQ(3u, reader.length());
+  roo::string_view key;
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.readStringView(key));
+  EXPECT_EQ("temp", std::string(key.data(), key.size()));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(21.5, reader.doubleValue());
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.readStringView(key));
+  EXPECT_EQ("seq", std::string(key.data(), key.size()));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(-123456789012LL, reader.intValue());
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.readStringView(key));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(CborType::kBytes, reader.type());
+  const byte* content;
+  ASSERT_TRUE(reader.readContentInPlace(content));
+  EXPECT_EQ(byte{7}, content[0]);
+  EXPECT_EQ(byte{9}, content[2]);
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+}  // namespace roo_io
@@ -0,0 +1,29 @@
+#include "roo_io/data/crc32c.h"
+
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+namespace roo_io {
+
+TEST(Crc32c, Empty) { EXPECT_EQ(0u, Crc32c(nullptr, 0)); }
+
+TEST(Crc32c, KnownValues) {
+  EXPECT_EQ(0xE3069283u, Crc32c((const byte*)"123456789", 9));
+  byte zeros[32] = {};
+  EXPECT_EQ(0x8A9136AAu, Crc32c(zeros, 32));
+  byte ones[32];
+  memset(ones, 0xFF, 32);
+  EXPECT_EQ(0x62A8AB43u, Crc32c(ones, 32));
+}
+
+TEST(Crc32c, Chained) {
+  const byte* data = (const byte*)"The quick brown fox jumps over the lazy dog";
+  size_t size = strlen((const char*)data);
+  uint32_t whole = Crc32c(data, size);
+  for (size_t split = 0; split <= size; ++split) {
+    EXPECT_EQ(whole, Crc32c(data + split, size - split, Crc32c(data, split)));
+  }
+}
+
+}  // namespace roo_io
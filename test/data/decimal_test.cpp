@@ -0,0 +1,349 @@
+#include "roo_io/data/decimal.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "roo_io/core/buffered_input_stream_iterator.h"
+#include "roo_io/data/input_stream_reader.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_input_stream.h"
+
+namespace roo_io {
+
+namespace {
+
+const byte* Begin(const std::string& s) { return (const byte*)s.data(); }
+
+const byte* End(const std::string& s) {
+  return (const byte*)s.data() + s.size();
+}
+
+uint64_t ParseU64(const std::string& s, Status& status, char* term = nullptr) {
+  MemoryIterator itr(Begin(s), End(s));
+  return ReadDecimalU64(itr, status, term);
+}
+
+int64_t ParseS64(const std::string& s, Status& status, char* term = nullptr) {
+  MemoryIterator itr(Begin(s), End(s));
+  return ReadDecimalS64(itr, status, term);
+}
+
+#if ROO_IO_IEEE754
+double ParseDouble(const std::string& s, Status& status) {
+  MemoryIterator itr(Begin(s), End(s));
+  return ReadDecimalDouble(itr, status);
+}
+
+// Parses through a non-contiguous (buffered stream) iterator.
+double ParseDoubleFromStream(const std::string& s, Status& status) {
+  MemoryInputStream<const byte*> is(Begin(s), End(s));
+  BufferedInputStreamIterator itr(is);
+  return ReadDecimalDouble(itr, status);
+}
+
+uint64_t Bits(double d) {
+  uint64_t bits;
+  memcpy(&bits, &d, sizeof(bits));
+  return bits;
+}
+#endif  // ROO_IO_IEEE754
+
+}  // namespace
+
+TEST(Decimal, EightDigitsHelpers) {
+  EXPECT_TRUE(internal::IsEightDecimalDigits(LoadLeU64(Begin("12345678"))));
+  EXPECT_FALSE(internal::IsEightDecimalDigits(LoadLeU64(Begin("1234567a"))));
+  EXPECT_FALSE(internal::IsEightDecimalDigits(LoadLeU64(Begin("/2345678"))));
+  EXPECT_FALSE(internal::IsEightDecimalDigits(LoadLeU64(Begin("123:5678"))));
+  EXPECT_EQ(12345678u,
+            internal::ParseEightDecimalDigits(LoadLeU64(Begin("12345678"))));
+  EXPECT_EQ(99999999u,
+            internal::ParseEightDecimalDigits(LoadLeU64(Begin("99999999"))));
+  EXPECT_EQ(7u,
+            internal::ParseEightDecimalDigits(LoadLeU64(Begin("00000007"))));
+}
+
+TEST(Decimal, U64Simple) {
+  Status status;
+  EXPECT_EQ(0u, ParseU64("0", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(42u, ParseU64("42", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(1234567890123u, ParseU64("1234567890123", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(18446744073709551615u, ParseU64("18446744073709551615", status));
+  EXPECT_EQ(kOk, status);
+}
+
+TEST(Decimal, U64Terminator) {
+  Status status;
+  char term = 'x';
+  EXPECT_EQ(123u, ParseU64("123,456", status, &term));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(',', term);
+  EXPECT_EQ(123u, ParseU64("123", status, &term));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ('\0', term);
+}
+
+// Verifies that consecutive numbers can be read from a single iterator, with
+// the separators consumed along the way.
+TEST(Decimal, U64Sequence) {
+  std::string s = "1 22 333333333333 4";
+  MemoryIterator itr(Begin(s), End(s));
+  Status status;
+  EXPECT_EQ(1u, ReadDecimalU64(itr, status));
+  EXPECT_EQ(22u, ReadDecimalU64(itr, status));
+  EXPECT_EQ(333333333333u, ReadDecimalU64(itr, status));
+  EXPECT_EQ(4u, ReadDecimalU64(itr, status));
+  EXPECT_EQ(kOk, status);
+  ReadDecimalU64(itr, status);
+  EXPECT_EQ(kEndOfStream, status);
+}
+
+TEST(Decimal, U64Errors) {
+  Status status;
+  EXPECT_EQ(0u, ParseU64("", status));
+  EXPECT_EQ(kEndOfStream, status);
+  EXPECT_EQ(0u, ParseU64("abc", status));
+  EXPECT_EQ(kInvalidFormat, status);
+  EXPECT_EQ(0u, ParseU64("-1", status));
+  EXPECT_EQ(kInvalidFormat, status);
+  EXPECT_EQ(0u, ParseU64(" 1", status));
+  EXPECT_EQ(kInvalidFormat, status);
+}
+
+// Verifies that overflow saturates, and that the remaining digits are still
+// consumed.
+TEST(Decimal, U64Overflow) {
+  Status status;
+  char term;
+  EXPECT_EQ(UINT64_MAX, ParseU64("18446744073709551616", status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(UINT64_MAX,
+            ParseU64("1234567890123456789012345678901234567890;", status,
+                     &term));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(';', term);
+}
+
+TEST(Decimal, S64) {
+  Status status;
+  EXPECT_EQ(0, ParseS64("-0", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(-42, ParseS64("-42", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(42, ParseS64("+42", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(INT64_MAX, ParseS64("9223372036854775807", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(INT64_MIN, ParseS64("-9223372036854775808", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(INT64_MAX, ParseS64("9223372036854775808", status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(INT64_MIN, ParseS64("-9223372036854775809", status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(0, ParseS64("-", status));
+  EXPECT_EQ(kInvalidFormat, status);
+  EXPECT_EQ(0, ParseS64("-x", status));
+  EXPECT_EQ(kInvalidFormat, status);
+}
+
+// Verifies that results do not depend on whether the eight-digit fast path
+// (memory iterators) or the byte-by-byte path (stream iterators) is used.
+TEST(Decimal, U64MemoryAndStreamAgree) {
+  std::mt19937_64 rng(1234);
+  for (int i = 0; i < 1000; ++i) {
+    uint64_t expected = rng() >> (rng() % 64);
+    std::string s = std::to_string(expected) + " ";
+    Status status;
+    EXPECT_EQ(expected, ParseU64(s, status));
+    EXPECT_EQ(kOk, status);
+    MemoryInputStream<const byte*> is(Begin(s), End(s));
+    BufferedInputStreamIterator itr(is);
+    EXPECT_EQ(expected, ReadDecimalU64(itr, status));
+    EXPECT_EQ(kOk, status);
+  }
+}
+
+TEST(Decimal, MultipassMemoryIterator) {
+  std::string s = "12345678901234567890x";
+  MultipassMemoryIterator itr(Begin(s), End(s));
+  Status status;
+  char term;
+  EXPECT_EQ(12345678901234567890u, ReadDecimalU64(itr, status, &term));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ('x', term);
+  EXPECT_EQ(s.size(), itr.position());
+}
+
+TEST(Decimal, InputStreamReader) {
+  std::string s = "17 -5 2.5";
+  MemoryInputStream<const byte*> is(Begin(s), End(s));
+  InputStreamReader reader(is);
+  Status status;
+  EXPECT_EQ(17u, reader.readDecimalU64(status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(-5, reader.readDecimalS64(status));
+  EXPECT_EQ(kOk, status);
+#if ROO_IO_IEEE754
+  EXPECT_EQ(2.5, reader.readDecimalDouble(status));
+  EXPECT_EQ(kOk, status);
+#endif  // ROO_IO_IEEE754
+}
+
+#if ROO_IO_IEEE754
+
+TEST(Decimal, DoubleSimple) {
+  Status status;
+  EXPECT_EQ(0.0, ParseDouble("0", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(1.5, ParseDouble("1.5", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(-0.25, ParseDouble("-.25", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(3.0, ParseDouble("3.", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(1e10, ParseDouble("1E10", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(1.25e-7, ParseDouble("125e-9", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(0.1, ParseDouble("0.1", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(123.0, ParseDouble("000123.000", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(Bits(-0.0), Bits(ParseDouble("-0.0", status)));
+  EXPECT_EQ(kOk, status);
+}
+
+TEST(Decimal, DoubleSpecial) {
+  Status status;
+  EXPECT_EQ(INFINITY, ParseDouble("inf", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(-INFINITY, ParseDouble("-Infinity", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_TRUE(std::isnan(ParseDouble("NaN", status)));
+  EXPECT_EQ(kOk, status);
+  ParseDouble("infinit", status);
+  EXPECT_EQ(kInvalidFormat, status);
+  ParseDouble("na", status);
+  EXPECT_EQ(kInvalidFormat, status);
+}
+
+TEST(Decimal, DoubleErrors) {
+  Status status;
+  ParseDouble("", status);
+  EXPECT_EQ(kEndOfStream, status);
+  ParseDouble(".", status);
+  EXPECT_EQ(kInvalidFormat, status);
+  ParseDouble("-", status);
+  EXPECT_EQ(kInvalidFormat, status);
+  ParseDouble("e5", status);
+  EXPECT_EQ(kInvalidFormat, status);
+  ParseDouble("1e", status);
+  EXPECT_EQ(kInvalidFormat, status);
+  ParseDouble("1e+x", status);
+  EXPECT_EQ(kInvalidFormat, status);
+}
+
+TEST(Decimal, DoubleOutOfRange) {
+  Status status;
+  EXPECT_EQ(INFINITY, ParseDouble("1e309", status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(-INFINITY, ParseDouble("-1e99999999999999999999", status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(0.0, ParseDouble("1e-400", status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(0.0, ParseDouble("0e999999", status));
+  EXPECT_EQ(kOk, status);
+}
+
+// Verifies boundary values: the largest and smallest normal and subnormal
+// doubles, and a value that rounds up to the smallest normal.
+TEST(Decimal, DoubleBoundaries) {
+  Status status;
+  EXPECT_EQ(1.7976931348623157e308,
+            ParseDouble("1.7976931348623157e308", status));
+  EXPECT_EQ(2.2250738585072014e-308,
+            ParseDouble("2.2250738585072014e-308", status));
+  EXPECT_EQ(4.9406564584124654e-324,
+            ParseDouble("4.9406564584124654e-324", status));
+  EXPECT_EQ(kOk, status);
+  EXPECT_EQ(2.2250738585072011e-308,
+            ParseDouble("2.2250738585072011e-308", status));
+}
+
+// Verifies correct rounding in the hard cases: exact halfway points (which
+// require round-to-even), and long mantissas that exceed 19 digits.
+TEST(Decimal, DoubleHardCases) {
+  const char* cases[] = {
+      "9007199254740993",
+      "9007199254740995",
+      "2.0000000000000002220446049250313080847263336181640625",
+      "2.0000000000000002220446049250313080847263336181640624",
+      "2.0000000000000002220446049250313080847263336181640626",
+      "7.3177701707893310e+15",
+      "1.00000000000000011102230246251565404236316680908203125",
+      "1.00000000000000011102230246251565404236316680908203124",
+      "1.00000000000000011102230246251565404236316680908203125000000001",
+      "123456789012345678901234567890",
+      "0.000000000000000000000000000000000000000000001234567890123",
+      "1448997445238699",
+      "3.14159265358979323846264338327950288419716939937510",
+  };
+  for (const char* c : cases) {
+    Status status;
+    EXPECT_EQ(Bits(strtod(c, nullptr)), Bits(ParseDouble(c, status))) << c;
+    EXPECT_EQ(kOk, status) << c;
+  }
+}
+
+// Verifies agreement with strtod on random inputs with a variety of mantissa
+// lengths and exponents, via both memory and stream iterators.
+TEST(Decimal, DoubleRandomAgainstStrtod) {
+  std::mt19937_64 rng(42);
+  for (int i = 0; i < 20000; ++i) {
+    std::string s;
+    if (rng() % 2) s += '-';
+    int int_digits = rng() % 25;
+    int frac_digits = rng() % 25;
+    if (int_digits == 0 && frac_digits == 0) int_digits = 1;
+    for (int j = 0; j < int_digits; ++j) s += (char)('0' + rng() % 10);
+    if (frac_digits > 0) {
+      s += '.';
+      for (int j = 0; j < frac_digits; ++j) s += (char)('0' + rng() % 10);
+    }
+    if (rng() % 2) {
+      s += 'e';
+      s += std::to_string((int)(rng() % 700) - 350);
+    }
+    double expected = strtod(s.c_str(), nullptr);
+    Status status;
+    EXPECT_EQ(Bits(expected), Bits(ParseDouble(s, status))) << s;
+    EXPECT_EQ(Bits(expected), Bits(ParseDoubleFromStream(s, status))) << s;
+  }
+}
+
+// Verifies that printing a random double with full precision and parsing it
+// back yields the same bits.
+TEST(Decimal, DoubleRoundTrip) {
+  std::mt19937_64 rng(7);
+  for (int i = 0; i < 20000; ++i) {
+    uint64_t bits = rng();
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    if (std::isnan(d) || std::isinf(d)) continue;
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.17g", d);
+    Status status;
+    EXPECT_EQ(bits, Bits(ParseDouble(buf, status))) << buf;
+  }
+}
+
+#endif  // ROO_IO_IEEE754
+
+}  // namespace roo_io
@@ -0,0 +1,251 @@
+#include "roo_io/data/half.h"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_io/data/read.h"
+#include "roo_io/data/write.h"
+#include "roo_io/memory/load.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+#include "roo_io/memory/store.h"
+
+namespace roo_io {
+
+TEST(Half, KnownValues) {
+  EXPECT_EQ(0x3C00, FloatToHalf(1.0f));
+  EXPECT_EQ(0xC000, FloatToHalf(-2.0f));
+  EXPECT_EQ(0x3555, FloatToHalf(1.0f / 3.0f));
+  EXPECT_EQ(0x7BFF, FloatToHalf(65504.0f));
+  EXPECT_EQ(0x0000, FloatToHalf(0.0f));
+  EXPECT_EQ(0x8000, FloatToHalf(-0.0f));
+  EXPECT_EQ(0x0001, FloatToHalf(std::ldexp(1.0f, -24)));
+  EXPECT_EQ(0x0400, FloatToHalf(std::ldexp(1.0f, -14)));
+
+  EXPECT_EQ(1.0f, HalfToFloat(0x3C00));
+  EXPECT_EQ(65504.0f, HalfToFloat(0x7BFF));
+  EXPECT_EQ(std::ldexp(1.0f, -24), HalfToFloat(0x0001));
+  EXPECT_EQ(std::ldexp(1023.0f, -24), HalfToFloat(0x03FF));
+  EXPECT_TRUE(std::signbit(HalfToFloat(0x8000)));
+}
+
+TEST(Half, Overflow) {
+  EXPECT_EQ(0x7BFF, FloatToHalf(65519.0f));
+  EXPECT_EQ(0x7C00, FloatToHalf(65520.0f));
+  EXPECT_EQ(0xFC00, FloatToHalf(-1e10f));
+  EXPECT_EQ(0x7C00, FloatToHalf(std::numeric_limits<float>::infinity()));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), HalfToFloat(0x7C00));
+  EXPECT_EQ(-std::numeric_limits<float>::infinity(), HalfToFloat(0xFC00));
+}
+
+TEST(Half, Underflow) {
+  // Exactly half of the smallest subnormal ties to even (zero).
+  EXPECT_EQ(0x0000, FloatToHalf(std::ldexp(1.0f, -25)));
+  EXPECT_EQ(0x0001, FloatToHalf(std::ldexp(1.5f, -25)));
+  EXPECT_EQ(0x8000, FloatToHalf(-1e-30f));
+  // 1.5 and 2.5 times the smallest subnormal tie to 2 in both cases.
+  EXPECT_EQ(0x0002, FloatToHalf(std::ldexp(1.5f, -24)));
+  EXPECT_EQ(0x0002, FloatToHalf(std::ldexp(2.5f, -24)));
+}
+
+TEST(Half, TiesToEven) {
+  // The spacing of halves in [1, 2) is 2^-10.
+  EXPECT_EQ(0x3C00, FloatToHalf(1.0f + std::ldexp(1.0f, -11)));
+  EXPECT_EQ(0x3C02, FloatToHalf(1.0f + std::ldexp(3.0f, -11)));
+  EXPECT_EQ(0x3C01,
+            FloatToHalf(1.0f + std::ldexp(1.0f, -11) + std::ldexp(1.0f, -20)));
+  // Rounding carries into the exponent.
+  EXPECT_EQ(0x4000, FloatToHalf(2.0f - std::ldexp(1.0f, -12)));
+}
+
+TEST(Half, NaN) {
+  float nan = std::numeric_limits<float>::quiet_NaN();
+  uint16_t h = FloatToHalf(nan);
+  EXPECT_EQ(0x7C00, h & 0x7C00);
+  EXPECT_NE(0, h & 0x3FF);
+  EXPECT_TRUE(std::isnan(HalfToFloat(h)));
+  // A signaling NaN whose payload does not fit must not become infinity.
+  float snan;
+  uint32_t bits = 0x7F800001;
+  memcpy(&snan, &bits, sizeof(snan));
+  EXPECT_TRUE(std::isnan(HalfToFloat(FloatToHalf(snan))));
+  EXPECT_TRUE(std::isnan(HalfToFloat(0x7C01)));
+}
+
+TEST(Half, ExhaustiveRoundTrip) {
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    uint16_t h = (uint16_t)i;
+    float f = HalfToFloat(h);
+    if ((h & 0x7C00) == 0x7C00 && (h & 0x3FF) != 0) {
+      EXPECT_TRUE(std::isnan(f)) << i;
+      EXPECT_TRUE(std::isnan(HalfToFloat(FloatToHalf(f)))) << i;
+    } else {
+      EXPECT_EQ(h, FloatToHalf(f)) << i;
+    }
+  }
+}
+
+TEST(Half, RoundsToNearest) {
+  // Compares against the neighbouring halves for random floats in range.
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> dist(-70000.0f, 70000.0f);
+  for (int i = 0; i < 10000; ++i) {
+    float f = dist(rng) * std::ldexp(1.0f, -(int)(rng() % 30));
+    uint16_t h = FloatToHalf(f);
+    float r = HalfToFloat(h);
+    if (std::isinf(r)) {
+      EXPECT_GE(std::fabs(f), 65520.0f);
+      continue;
+    }
+    float err = std::fabs(r - f);
+    EXPECT_LE(err, std::fabs(HalfToFloat(h + 1) - f)) << f;
+    if ((h & 0x7FFF) != 0) {
+      EXPECT_LE(err, std::fabs(HalfToFloat(h - 1) - f)) << f;
+    }
+  }
+}
+
+TEST(BFloat16, KnownValues) {
+  EXPECT_EQ(0x3F80, FloatToBFloat16(1.0f));
+  EXPECT_EQ(0xC000, FloatToBFloat16(-2.0f));
+  EXPECT_EQ(0x8000, FloatToBFloat16(-0.0f));
+  EXPECT_EQ(0x7F80,
+            FloatToBFloat16(std::numeric_limits<float>::infinity()));
+  EXPECT_EQ(1.0f, BFloat16ToFloat(0x3F80));
+  EXPECT_EQ(-2.0f, BFloat16ToFloat(0xC000));
+}
+
+TEST(BFloat16, Rounding) {
+  // The spacing of bfloat16 values in [1, 2) is 2^-7.
+  EXPECT_EQ(0x3F80, FloatToBFloat16(1.0f + std::ldexp(1.0f, -8)));
+  EXPECT_EQ(0x3F82, FloatToBFloat16(1.0f + std::ldexp(3.0f, -8)));
+  EXPECT_EQ(0x3F81,
+            FloatToBFloat16(1.0f + std::ldexp(1.0f, -8) +
+                            std::ldexp(1.0f, -20)));
+  // The largest finite float rounds to infinity.
+  EXPECT_EQ(0x7F80, FloatToBFloat16(std::numeric_limits<float>::max()));
+}
+
+TEST(BFloat16, NaN) {
+  float snan;
+  uint32_t bits = 0x7F800001;
+  memcpy(&snan, &bits, sizeof(snan));
+  EXPECT_TRUE(std::isnan(BFloat16ToFloat(FloatToBFloat16(snan))));
+  EXPECT_TRUE(std::isnan(BFloat16ToFloat(
+      FloatToBFloat16(std::numeric_limits<float>::quiet_NaN()))));
+}
+
+TEST(BFloat16, ExhaustiveRoundTrip) {
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    uint16_t b = (uint16_t)i;
+    float f = BFloat16ToFloat(b);
+    if (std::isnan(f)) {
+      EXPECT_TRUE(std::isnan(BFloat16ToFloat(FloatToBFloat16(f)))) << i;
+    } else {
+      EXPECT_EQ(b, FloatToBFloat16(f)) << i;
+    }
+  }
+}
+
+TEST(Half, BulkMatchesScalar) {
+  std::mt19937 rng(5);
+  std::vector<float> floats(1027);
+  for (float& f : floats) {
+    uint32_t bits = rng();
+    memcpy(&f, &bits, sizeof(f));
+  }
+  std::vector<uint16_t> halves(floats.size());
+  ConvertFloatToHalf(floats.data(), halves.data(), floats.size());
+  for (size_t i = 0; i < floats.size(); ++i) {
+    if (std::isnan(floats[i])) {
+      EXPECT_TRUE(std::isnan(HalfToFloat(halves[i]))) << i;
+    } else {
+      EXPECT_EQ(FloatToHalf(floats[i]), halves[i]) << i;
+    }
+  }
+  std::vector<uint16_t> all(0x10000);
+  for (uint32_t i = 0; i < 0x10000; ++i) all[i] = (uint16_t)i;
+  std::vector<float> back(all.size());
+  ConvertHalfToFloat(all.data(), back.data(), all.size());
+  for (uint32_t i = 0; i < 0x10000; ++i) {
+    float expected = HalfToFloat(all[i]);
+    if (std::isnan(expected)) {
+      EXPECT_TRUE(std::isnan(back[i])) << i;
+    } else {
+      EXPECT_EQ(expected, back[i]) << i;
+    }
+  }
+}
+
+TEST(BFloat16, BulkMatchesScalar) {
+  std::mt19937 rng(6);
+  std::vector<float> floats(1027);
+  for (float& f : floats) {
+    uint32_t bits = rng();
+    memcpy(&f, &bits, sizeof(f));
+  }
+  std::vector<uint16_t> b(floats.size());
+  ConvertFloatToBFloat16(floats.data(), b.data(), floats.size());
+  std::vector<float> back(floats.size());
+  ConvertBFloat16ToFloat(b.data(), back.data(), b.size());
+  for (size_t i = 0; i < floats.size(); ++i) {
+    EXPECT_EQ(FloatToBFloat16(floats[i]), b[i]) << i;
+    float expected = BFloat16ToFloat(b[i]);
+    EXPECT_EQ(0, memcmp(&expected, &back[i], sizeof(float))) << i;
+  }
+}
+
+TEST(Half, LoadStore) {
+  byte buf[2];
+  StoreBeHalf(1.0f, buf);
+  EXPECT_EQ(byte{0x3C}, buf[0]);
+  EXPECT_EQ(byte{0x00}, buf[1]);
+  EXPECT_EQ(1.0f, LoadBeHalf(buf));
+  StoreLeHalf(-2.0f, buf);
+  EXPECT_EQ(byte{0x00}, buf[0]);
+  EXPECT_EQ(byte{0xC0}, buf[1]);
+  EXPECT_EQ(-2.0f, LoadLeHalf(buf));
+  StoreHalf<kBigEndian>(0.5f, buf);
+  EXPECT_EQ(0.5f, LoadHalf<kBigEndian>(buf));
+  EXPECT_EQ(0.5f, LoadBeHalf(buf));
+
+  StoreBeBFloat16(1.0f, buf);
+  EXPECT_EQ(byte{0x3F}, buf[0]);
+  EXPECT_EQ(byte{0x80}, buf[1]);
+  EXPECT_EQ(1.0f, LoadBeBFloat16(buf));
+  StoreLeBFloat16(1.0f, buf);
+  EXPECT_EQ(byte{0x80}, buf[0]);
+  EXPECT_EQ(byte{0x3F}, buf[1]);
+  EXPECT_EQ(1.0f, LoadLeBFloat16(buf));
+  StoreBFloat16<kLittleEndian>(3.0f, buf);
+  EXPECT_EQ(3.0f, LoadBFloat16<kLittleEndian>(buf));
+}
+
+TEST(Half, ReadWrite) {
+  byte buf[16];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  WriteBeHalf(out, 1.5f);
+  WriteLeHalf(out, -0.25f);
+  WriteBeBFloat16(out, 2.0f);
+  WriteLeBFloat16(out, -4.0f);
+  WriteHalf<MemoryOutputIterator, kLittleEndian>(out, 8.0f);
+  WriteBFloat16<MemoryOutputIterator, kBigEndian>(out, 16.0f);
+  EXPECT_EQ(kOk, out.status());
+  EXPECT_EQ(buf + 12, out.ptr());
+
+  MemoryIterator in(buf, buf + 12);
+  EXPECT_EQ(1.5f, ReadBeHalf(in));
+  EXPECT_EQ(-0.25f, ReadLeHalf(in));
+  EXPECT_EQ(2.0f, ReadBeBFloat16(in));
+  EXPECT_EQ(-4.0f, ReadLeBFloat16(in));
+  EXPECT_EQ(8.0f, (ReadHalf<MemoryIterator, kLittleEndian>(in)));
+  EXPECT_EQ(16.0f, (ReadBFloat16<MemoryIterator, kBigEndian>(in)));
+  EXPECT_EQ(kOk, in.status());
+  ReadBeHalf(in);
+  EXPECT_EQ(kEndOfStream, in.status());
+}
+
+}  // namespace roo_io
@@ -193,4 +193,23 @@ TEST(Read, ShortStringUnderBuf) {
   EXPECT_EQ(kOk, reader.status());
 }
 
-}  // namespace roo_io
\ No newline at end of file
+TEST(Reader, SeeksWithinWindow) {
+  byte data[512];
+  for (int i = 0; i < 512; ++i) data[i] = (byte)(i / 2);
+  MultipassInputStreamReader reader(
+      std::unique_ptr<MultipassInputStream>(
+          new MemoryInputStream<const byte*>(data, data + 512)),
+      256, 32);
+  reader.seek(300);
+  EXPECT_EQ(150, reader.readU8());
+  reader.seek(280);
+  EXPECT_EQ(140, reader.readU8());
+  reader.seek(400);
+  EXPECT_EQ(200, reader.readU8());
+  reader.seek(302);
+  EXPECT_EQ(151, reader.readU8());
+  EXPECT_EQ(2, reader.seekHits());
+  EXPECT_EQ(2, reader.seekMisses());
+}
+
+}  // namespace roo_io
@@ -0,0 +1,353 @@
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_io/data/protobuf_reader.h"
+#include "roo_io/data/protobuf_writer.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+namespace roo_io {
+
+namespace {
+
+std::vector<byte> Bytes(std::initializer_list<uint8_t> values) {
+  std::vector<byte> result;
+  for (uint8_t v : values) result.push_back((byte)v);
+  return result;
+}
+
+template <typename Fn>
+std::vector<byte> Encode(Fn fn) {
+  byte buf[512];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  ProtoWriter<MemoryOutputIterator> writer(out);
+  fn(writer);
+  EXPECT_EQ(kOk, writer.status());
+  return std::vector<byte>(buf, out.ptr());
+}
+
+// Hides the memory iterator type, so that the reader takes the generic path.
+class OpaqueIterator {
+ public:
+  OpaqueIterator(const byte* begin, const byte* end) : itr_(begin, end) {}
+
+  byte read() { return itr_.read(); }
+  size_t read(byte* result, size_t count) { return itr_.read(result, count); }
+  void skip(size_t count) { itr_.skip(count); }
+  Status status() const { return itr_.status(); }
+
+ private:
+  MemoryIterator itr_;
+};
+
+template <typename Itr>
+class ProtoReaderTest : public testing::Test {};
+
+using Iterators = testing::Types<MemoryIterator, MultipassMemoryIterator,
+                                 OpaqueIterator>;
+TYPED_TEST_SUITE(ProtoReaderTest, Iterators);
+
+// message Point { sint32 x = 1; sint32 y = 2; string label = 3; }
+template <typename Writer>
+void WritePoint(Writer& w, int x, int y, const char* label) {
+  w.writeSInt64(1, x);
+  w.writeSInt64(2, y);
+  w.writeString(3, label);
+}
+
+}  // namespace
+
+TEST(ProtoSize, Helpers) {
+  EXPECT_EQ(1u, ProtoTagSize(1));
+  EXPECT_EQ(1u, ProtoTagSize(15));
+  EXPECT_EQ(2u, ProtoTagSize(16));
+  EXPECT_EQ(3u, ProtoVarintFieldSize(1, 150));
+  EXPECT_EQ(5u, ProtoFixed32FieldSize(1));
+  EXPECT_EQ(9u, ProtoFixed64FieldSize(1));
+  EXPECT_EQ(9u, ProtoLengthDelimitedFieldSize(2, 7));
+}
+
+TEST(ProtoWriter, Scalars) {
+  using W = ProtoWriter<MemoryOutputIterator>;
+  // Examples from the protobuf encoding guide.
+  EXPECT_EQ(Bytes({0x08, 0x96, 0x01}),
+            Encode([](W& w) { w.writeVarint(1, 150); }));
+  EXPECT_EQ(Bytes({0x12, 0x07, 't', 'e', 's', 't', 'i', 'n', 'g'}),
+            Encode([](W& w) { w.writeString(2, "testing"); }));
+  EXPECT_EQ(Bytes({0x08, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                   0x01}),
+            Encode([](W& w) { w.writeInt64(1, -1); }));
+  EXPECT_EQ(Bytes({0x08, 0x03}), Encode([](W& w) { w.writeSInt64(1, -2); }));
+  EXPECT_EQ(Bytes({0x80, 0x01, 0x01}),
+            Encode([](W& w) { w.writeBool(16, true); }));
+  EXPECT_EQ(Bytes({0x0D, 0x78, 0x56, 0x34, 0x12}),
+            Encode([](W& w) { w.writeFixed32(1, 0x12345678); }));
+  EXPECT_EQ(Bytes({0x11, 0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01}),
+            Encode([](W& w) { w.writeFixed64(2, 0x0102030405060708ULL); }));
+  EXPECT_EQ(Bytes({0x0D, 0x00, 0x00, 0xC0, 0x3F}),
+            Encode([](W& w) { w.writeFloat(1, 1.5f); }));
+  EXPECT_EQ(Bytes({0x09, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xF8, 0x3F}),
+            Encode([](W& w) { w.writeDouble(1, 1.5); }));
+}
+
+TEST(ProtoWriter, Packed) {
+  using W = ProtoWriter<MemoryOutputIterator>;
+  // repeated int32 d = 4 [packed = true]: [3, 270, 86942].
+  EXPECT_EQ(Bytes({0x22, 0x06, 0x03, 0x8E, 0x02, 0x9E, 0xA7, 0x05}),
+            Encode([](W& w) {
+              const uint64_t values[] = {3, 270, 86942};
+              w.writePackedVarints(4, values, 3);
+            }));
+  EXPECT_EQ(Bytes({0x2A, 0x08, 0x01, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF,
+                   0xFF}),
+            Encode([](W& w) {
+              const int32_t values[] = {1, -1};
+              w.writePackedFixed(5, values, 2);
+            }));
+  EXPECT_EQ(Bytes({}), Encode([](W& w) {
+              w.writePackedVarints(4, nullptr, 0);
+            }));
+}
+
+TEST(ProtoWriter, SubmessagePrecomputedAndPatched) {
+  using W = ProtoWriter<MemoryOutputIterator>;
+  std::vector<byte> precomputed = Encode([](W& w) {
+    ProtoSizeCounter counter;
+    ProtoWriter<ProtoSizeCounter> sizer(counter);
+    WritePoint(sizer, 3, -4, "p");
+    EXPECT_EQ(7u, counter.size());
+    w.beginMessage(1, counter.size());
+    WritePoint(w, 3, -4, "p");
+  });
+  EXPECT_EQ(Bytes({0x0A, 0x07, 0x08, 0x06, 0x10, 0x07, 0x1A, 0x01, 'p'}),
+            precomputed);
+
+  std::vector<byte> patched = Encode([](W& w) {
+    byte* marker = w.beginPatchedMessage(1);
+    WritePoint(w, 3, -4, "p");
+    w.endPatchedMessage(marker);
+  });
+  EXPECT_EQ(Bytes({0x0A, 0x87, 0x80, 0x80, 0x80, 0x00, 0x08, 0x06, 0x10, 0x07,
+                   0x1A, 0x01, 'p'}),
+            patched);
+}
+
+TYPED_TEST(ProtoReaderTest, Scalars) {
+  auto data = Encode([](ProtoWriter<MemoryOutputIterator>& w) {
+    w.writeVarint(1, 150);
+    w.writeInt64(2, -1);
+    w.writeSInt64(3, -123456789);
+    w.writeBool(4, true);
+    w.writeFixed32(5, 0x12345678);
+    w.writeFixed64(6, 0x0102030405060708ULL);
+    w.writeFloat(7, 1.5f);
+    w.writeDouble(8, -2.25);
+    w.writeString(9, "hello");
+    w.writeVarint(536870911, 1);
+  });
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  ProtoReader<TypeParam> reader(in);
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1u, reader.fieldNumber());
+  EXPECT_EQ(ProtoWireType::kVarint, reader.wireType());
+  EXPECT_EQ(150u, reader.readVarint());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(-1, reader.readInt64());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(-123456789, reader.readSInt64());
+  ASSERT_TRUE(reader.next());
+  EXPECT_TRUE(reader.readBool());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(ProtoWireType::kFixed32, reader.wireType());
+  EXPECT_EQ(0x12345678u, reader.readFixed32());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(0x0102030405060708ULL, reader.readFixed64());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1.5f, reader.readFloat());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(-2.25, reader.readDouble());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(9u, reader.fieldNumber());
+  EXPECT_EQ(ProtoWireType::kLengthDelimited, reader.wireType());
+  EXPECT_EQ(5u, reader.contentRemaining());
+  char buf[8];
+  EXPECT_EQ(5u, reader.readContent((byte*)buf, sizeof(buf)));
+  EXPECT_EQ("hello", std::string(buf, 5));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(536870911u, reader.fieldNumber());
+  EXPECT_EQ(1u, reader.readVarint());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(ProtoReaderTest, SkipsUnreadValues) {
+  auto data = Encode([](ProtoWriter<MemoryOutputIterator>& w) {
+    w.writeVarint(1, 1000000);
+    w.writeFixed32(2, 5);
+    w.writeFixed64(3, 6);
+    w.writeString(4, "ignored");
+    w.writeVarint(5, 42);
+  });
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  ProtoReader<TypeParam> reader(in);
+  for (int i = 1; i <= 4; ++i) {
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ((uint32_t)i, reader.fieldNumber());
+  }
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(5u, reader.fieldNumber());
+  EXPECT_EQ(42u, reader.readVarint());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(ProtoReaderTest, Submessages) {
+  // message Shape { Point a = 1; Point b = 2; uint32 color = 3; }
+  auto data = Encode([](ProtoWriter<MemoryOutputIterator>& w) {
+    byte* marker = w.beginPatchedMessage(1);
+    WritePoint(w, 1, 2, "first");
+    w.endPatchedMessage(marker);
+    marker = w.beginPatchedMessage(2);
+    WritePoint(w, -3, -4, "second");
+    w.endPatchedMessage(marker);
+    w.writeVarint(3, 0xFF0000);
+  });
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  ProtoReader<TypeParam> reader(in);
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1u, reader.fieldNumber());
+  uint64_t saved = reader.enterMessage();
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(1, reader.readSInt64());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(2, reader.readSInt64());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(3u, reader.fieldNumber());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kOk, reader.status());
+  ASSERT_TRUE(reader.exitMessage(saved));
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(2u, reader.fieldNumber());
+  saved = reader.enterMessage();
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(-3, reader.readSInt64());
+  // Rest of the submessage skipped.
+  ASSERT_TRUE(reader.exitMessage(saved));
+
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(3u, reader.fieldNumber());
+  EXPECT_EQ(0xFF0000u, reader.readVarint());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(ProtoReaderTest, Packed) {
+  std::vector<uint64_t> values;
+  for (uint64_t i = 0; i < 100; ++i) values.push_back(i * i * i * 1000);
+  const float floats[] = {1.0f, -2.5f, 3.25f};
+  auto data = Encode([&](ProtoWriter<MemoryOutputIterator>& w) {
+    w.writePackedVarints(1, values.data(), values.size());
+    w.writePackedFixed(2, floats, 3);
+  });
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  ProtoReader<TypeParam> reader(in);
+
+  ASSERT_TRUE(reader.next());
+  std::vector<uint64_t> decoded;
+  uint64_t buf[16];
+  while (reader.contentRemaining() > 0) {
+    size_t n = reader.readPackedVarints(buf, 16);
+    ASSERT_GT(n, 0u);
+    decoded.insert(decoded.end(), buf, buf + n);
+  }
+  EXPECT_EQ(values, decoded);
+
+  ASSERT_TRUE(reader.next());
+  float f[4];
+  EXPECT_EQ(3u, reader.readPackedFixed(f, 4));
+  EXPECT_EQ(1.0f, f[0]);
+  EXPECT_EQ(-2.5f, f[1]);
+  EXPECT_EQ(3.25f, f[2]);
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(ProtoReaderTest, StringView) {
+  auto data = Encode([](ProtoWriter<MemoryOutputIterator>& w) {
+    w.writeString(1, "abc");
+  });
+  TypeParam in(&*data.begin(), &*data.begin() + data.size());
+  ProtoReader<TypeParam> reader(in);
+  ASSERT_TRUE(reader.next());
+  roo::string_view view;
+  bool memory_backed = !std::is_same<TypeParam, OpaqueIterator>::value;
+  EXPECT_EQ(memory_backed, reader.readStringView(view));
+  if (memory_backed) {
+    EXPECT_EQ("abc", std::string(view.data(), view.size()));
+  }
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(ProtoReaderTest, Malformed) {
+  {
+    // Wire type mismatch.
+    auto data = Bytes({0x08, 0x01});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    ProtoReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    reader.readFixed32();
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Group wire type.
+    auto data = Bytes({0x0B, 0x0C});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    ProtoReader<TypeParam> reader(in);
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Field number zero.
+    auto data = Bytes({0x00, 0x01});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    ProtoReader<TypeParam> reader(in);
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Varint longer than 10 bytes.
+    auto data = Bytes({0x08, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                       0xFF, 0xFF, 0x01});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    ProtoReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    reader.readVarint();
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Submessage field extends past the enclosing message.
+    auto data = Bytes({0x0A, 0x02, 0x12, 0x05, 0x00, 0x00});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    ProtoReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    reader.enterMessage();
+    EXPECT_FALSE(reader.next());
+    EXPECT_EQ(kInvalidFormat, reader.status());
+  }
+  {
+    // Truncated value.
+    auto data = Bytes({0x0D, 0x01, 0x02});
+    TypeParam in(&*data.begin(), &*data.begin() + data.size());
+    ProtoReader<TypeParam> reader(in);
+    ASSERT_TRUE(reader.next());
+    reader.readFixed32();
+    EXPECT_EQ(kEndOfStream, reader.status());
+  }
+}
+
+}  // namespace roo_io
@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 #include <cstring>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -343,4 +344,50 @@ TEST(Read, ShortStringViewOverflow) {
   EXPECT_EQ(kEndOfStream, itr.status());
 }
 
+TEST(Read, ArrayBeU16) {
+  const byte in[] = {byte{0x11}, byte{0x22}, byte{0x33}, byte{0x44},
+                     byte{0x55}, byte{0x66}};
+  MemoryIterator itr{in, in + 6};
+  uint16_t result[3];
+  EXPECT_EQ(3u, (ReadArray<uint16_t, kBigEndian>(itr, result, 3)));
+  EXPECT_THAT(result, ElementsAre(0x1122, 0x3344, 0x5566));
+  EXPECT_EQ(kOk, itr.status());
+}
+
+TEST(Read, ArrayLeS32) {
+  std::vector<byte> in;
+  for (int32_t i = -20; i < 20; ++i) {
+    uint32_t v = (uint32_t)(i * 1000003);
+    for (int j = 0; j < 4; ++j) in.push_back((byte)(v >> (8 * j)));
+  }
+  MemoryIterator itr{in.data(), in.data() + in.size()};
+  int32_t result[40];
+  EXPECT_EQ(40u, (ReadArray<int32_t, kLittleEndian>(itr, result, 40)));
+  for (int32_t i = -20; i < 20; ++i) {
+    EXPECT_EQ(i * 1000003, result[i + 20]);
+  }
+}
+
+TEST(Read, ArrayShort) {
+  const byte in[] = {byte{0x11}, byte{0x22}, byte{0x33}, byte{0x44},
+                     byte{0x55}};
+  MemoryIterator itr{in, in + 5};
+  uint16_t result[3];
+  EXPECT_EQ(2u, (ReadArray<uint16_t, kBigEndian>(itr, result, 3)));
+  EXPECT_EQ(0x1122, result[0]);
+  EXPECT_EQ(0x3344, result[1]);
+  EXPECT_EQ(kEndOfStream, itr.status());
+}
+
+#if ROO_IO_IEEE754
+TEST(Read, ArrayBeFloat) {
+  const byte in[] = {byte{0x3F}, byte{0x80}, byte{0x00}, byte{0x00},
+                     byte{0xC0}, byte{0x00}, byte{0x00}, byte{0x00}};
+  MemoryIterator itr{in, in + 8};
+  float result[2];
+  EXPECT_EQ(2u, (ReadArray<float, kBigEndian>(itr, result, 2)));
+  EXPECT_THAT(result, ElementsAre(1.0f, -2.0f));
+}
+#endif  // ROO_IO_IEEE754
+
 }  // namespace roo_io
\ No newline at end of file
@@ -0,0 +1,169 @@
+#include "roo_io/data/record.h"
+
+#include "gtest/gtest.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+namespace roo_io {
+
+namespace {
+
+enum class Kind : uint8_t { kNone = 0, kData = 1, kAck = 2 };
+
+struct Header {
+  uint32_t magic;
+  uint16_t version;
+  Kind kind;
+  int32_t offset;
+  float scale;
+  int64_t timestamp;
+  int count;
+};
+
+using HeaderLayout = RecordLayout<
+    Header, ROO_IO_RECORD_FIELD(Header, magic, record::BeU32),
+    ROO_IO_RECORD_FIELD(Header, version, record::LeU16),
+    ROO_IO_RECORD_FIELD(Header, kind, record::U8), record::Padding<1>,
+    ROO_IO_RECORD_FIELD(Header, offset, record::BeS24),
+    ROO_IO_RECORD_FIELD(Header, scale, record::LeFloat),
+    ROO_IO_RECORD_FIELD(Header, timestamp, record::BeS64),
+    ROO_IO_RECORD_FIELD(Header, count, record::LeU16)>;
+
+static_assert(HeaderLayout::kSize == 25, "Unexpected record size");
+
+const byte kEncoded[] = {
+    byte{0x52}, byte{0x4F}, byte{0x4F}, byte{0x21},  // magic
+    byte{0x02}, byte{0x01},                          // version
+    byte{0x02},                                      // kind
+    byte{0x00},                                      // padding
+    byte{0xFF}, byte{0xFF}, byte{0xFE},              // offset
+    byte{0x00}, byte{0x00}, byte{0xC0}, byte{0x3F},  // scale
+    byte{0x00}, byte{0x00}, byte{0x01}, byte{0x02},  // timestamp
+    byte{0x03}, byte{0x04}, byte{0x05}, byte{0x06},  //
+    byte{0x34}, byte{0x12},                          // count
+};
+
+Header MakeHeader() {
+  Header h;
+  h.magic = 0x524F4F21;
+  h.version = 0x0102;
+  h.kind = Kind::kAck;
+  h.offset = -2;
+  h.scale = 1.5f;
+  h.timestamp = 0x0000010203040506LL;
+  h.count = 0x1234;
+  return h;
+}
+
+void ExpectEq(const Header& expected, const Header& actual) {
+  EXPECT_EQ(expected.magic, actual.magic);
+  EXPECT_EQ(expected.version, actual.version);
+  EXPECT_EQ(expected.kind, actual.kind);
+  EXPECT_EQ(expected.offset, actual.offset);
+  EXPECT_EQ(expected.scale, actual.scale);
+  EXPECT_EQ(expected.timestamp, actual.timestamp);
+  EXPECT_EQ(expected.count, actual.count);
+}
+
+// Hides the memory iterator type, so that the layout reads via a buffer.
+class OpaqueIterator {
+ public:
+  OpaqueIterator(const byte* begin, const byte* end) : itr_(begin, end) {}
+
+  byte read() { return itr_.read(); }
+  size_t read(byte* result, size_t count) { return itr_.read(result, count); }
+  void skip(size_t count) { itr_.skip(count); }
+  Status status() const { return itr_.status(); }
+
+ private:
+  MemoryIterator itr_;
+};
+
+template <typename Itr>
+class RecordReadTest : public testing::Test {};
+
+using Iterators = testing::Types<MemoryIterator, MultipassMemoryIterator,
+                                 OpaqueIterator>;
+TYPED_TEST_SUITE(RecordReadTest, Iterators);
+
+}  // namespace
+
+TEST(Record, Store) {
+  byte buf[HeaderLayout::kSize];
+  memset(buf, 0xEE, sizeof(buf));
+  HeaderLayout::store(MakeHeader(), buf);
+  EXPECT_EQ(0, memcmp(kEncoded, buf, sizeof(kEncoded)));
+}
+
+TEST(Record, Load) {
+  Header h;
+  HeaderLayout::load(kEncoded, h);
+  ExpectEq(MakeHeader(), h);
+}
+
+TEST(Record, Write) {
+  byte buf[30];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  HeaderLayout::write(out, MakeHeader());
+  EXPECT_EQ(kOk, out.status());
+  EXPECT_EQ(buf + HeaderLayout::kSize, out.ptr());
+  EXPECT_EQ(0, memcmp(kEncoded, buf, sizeof(kEncoded)));
+}
+
+TEST(Record, WriteOverflow) {
+  byte buf[10];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  HeaderLayout::write(out, MakeHeader());
+  EXPECT_EQ(kNoSpaceLeftOnDevice, out.status());
+}
+
+TYPED_TEST(RecordReadTest, Read) {
+  byte buf[2 * sizeof(kEncoded)];
+  memcpy(buf, kEncoded, sizeof(kEncoded));
+  memcpy(buf + sizeof(kEncoded), kEncoded, sizeof(kEncoded));
+  TypeParam in(buf, buf + sizeof(buf));
+  Header h;
+  HeaderLayout::read(in, h);
+  EXPECT_EQ(kOk, in.status());
+  ExpectEq(MakeHeader(), h);
+  h = Header();
+  HeaderLayout::read(in, h);
+  EXPECT_EQ(kOk, in.status());
+  ExpectEq(MakeHeader(), h);
+  in.read();
+  EXPECT_EQ(kEndOfStream, in.status());
+}
+
+TYPED_TEST(RecordReadTest, ReadTruncated) {
+  TypeParam in(kEncoded, kEncoded + sizeof(kEncoded) - 1);
+  Header h = Header();
+  HeaderLayout::read(in, h);
+  EXPECT_EQ(kEndOfStream, in.status());
+  EXPECT_EQ(0u, h.magic);
+}
+
+TEST(Record, NativeAndHalfFields) {
+  struct Sample {
+    double value;
+    float reduced;
+    uint64_t id;
+  };
+  using SampleLayout =
+      RecordLayout<Sample, ROO_IO_RECORD_FIELD(Sample, value, record::BeDouble),
+                   ROO_IO_RECORD_FIELD(Sample, reduced, record::LeHalf),
+                   ROO_IO_RECORD_FIELD(Sample, id, record::LeU64)>;
+  static_assert(SampleLayout::kSize == 18, "Unexpected record size");
+  Sample s{-0.125, 3.0f, 0x0102030405060708ULL};
+  byte buf[SampleLayout::kSize];
+  SampleLayout::store(s, buf);
+  EXPECT_EQ(-0.125, LoadBeDouble(buf));
+  EXPECT_EQ(3.0f, LoadLeHalf(buf + 8));
+  EXPECT_EQ(0x0102030405060708ULL, LoadLeU64(buf + 10));
+  Sample r;
+  SampleLayout::load(buf, r);
+  EXPECT_EQ(s.value, r.value);
+  EXPECT_EQ(s.reduced, r.reduced);
+  EXPECT_EQ(s.id, r.id);
+}
+
+}  // namespace roo_io
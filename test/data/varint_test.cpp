@@ -0,0 +1,160 @@
+#include "roo_io/data/varint.h"
+
+#include <random>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "roo_io/data/read.h"
+#include "roo_io/data/write.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+using testing::ElementsAre;
+
+namespace roo_io {
+
+namespace {
+
+std::vector<uint64_t> RandomValues(size_t count) {
+  std::mt19937_64 rng(7);
+  std::vector<uint64_t> values;
+  for (size_t i = 0; i < count; ++i) {
+    // Mix of magnitudes, with plenty of single-byte runs.
+    int bits = (rng() % 3 == 0) ? 7 : 1 + rng() % 64;
+    uint64_t v = rng();
+    if (bits < 64) v &= (uint64_t(1) << bits) - 1;
+    values.push_back(v);
+  }
+  return values;
+}
+
+std::vector<byte> Encode(const std::vector<uint64_t>& values) {
+  std::vector<byte> data;
+  BackInsertingIterator<std::vector<byte>> itr(data);
+  for (uint64_t v : values) WriteVarU64(itr, v);
+  return data;
+}
+
+}  // namespace
+
+TEST(Varint, ZigZag) {
+  EXPECT_EQ(0u, ZigZagEncode64(0));
+  EXPECT_EQ(1u, ZigZagEncode64(-1));
+  EXPECT_EQ(2u, ZigZagEncode64(1));
+  EXPECT_EQ(3u, ZigZagEncode64(-2));
+  EXPECT_EQ(0xFFFFFFFFFFFFFFFEULL, ZigZagEncode64(INT64_MAX));
+  EXPECT_EQ(0xFFFFFFFFFFFFFFFFULL, ZigZagEncode64(INT64_MIN));
+  for (int64_t v : {(int64_t)0, (int64_t)-1, (int64_t)1, (int64_t)-12345,
+                    INT64_MAX, INT64_MIN}) {
+    EXPECT_EQ(v, ZigZagDecode64(ZigZagEncode64(v)));
+  }
+}
+
+TEST(Varint, Size) {
+  static_assert(VarintSize(0) == 1, "");
+  static_assert(VarintSize(127) == 1, "");
+  static_assert(VarintSize(128) == 2, "");
+  static_assert(VarintSize(16383) == 2, "");
+  static_assert(VarintSize(16384) == 3, "");
+  static_assert(VarintSize(UINT64_MAX) == 10, "");
+  static_assert(VarintSizeS64(-64) == 1, "");
+  static_assert(VarintSizeS64(64) == 2, "");
+  for (uint64_t v : RandomValues(1000)) {
+    EXPECT_EQ(Encode({v}).size(), VarintSize(v));
+  }
+}
+
+TEST(Varint, SignedRoundTrip) {
+  std::vector<byte> data;
+  BackInsertingIterator<std::vector<byte>> out(data);
+  WriteVarS64(out, -1);
+  WriteVarS64(out, 63);
+  WriteVarS64(out, -64);
+  WriteVarS64(out, INT64_MIN);
+  EXPECT_EQ(1 + 1 + 1 + 10, data.size());
+  MemoryIterator in(data.data(), data.data() + data.size());
+  EXPECT_EQ(-1, ReadVarS64(in));
+  EXPECT_EQ(63, ReadVarS64(in));
+  EXPECT_EQ(-64, ReadVarS64(in));
+  EXPECT_EQ(INT64_MIN, ReadVarS64(in));
+  EXPECT_EQ(kOk, in.status());
+}
+
+TEST(Varint, ReadU32) {
+  std::vector<byte> data;
+  BackInsertingIterator<std::vector<byte>> out(data);
+  WriteVarU64(out, 300);
+  // A negative int32, encoded the way protobuf does (sign-extended to 64 bits).
+  WriteVarU64(out, (uint64_t)(int64_t)-2);
+  WriteVarU64(out, 5);
+  MemoryIterator in(data.data(), data.data() + data.size());
+  EXPECT_EQ(300u, ReadVarU32(in));
+  EXPECT_EQ(0xFFFFFFFEu, ReadVarU32(in));
+  EXPECT_EQ(5u, ReadVarU32(in));
+  EXPECT_EQ(kOk, in.status());
+}
+
+TEST(Varint, ReadAcrossIteratorKinds) {
+  std::vector<uint64_t> values = RandomValues(500);
+  std::vector<byte> data = Encode(values);
+  MemoryIterator in(data.data(), data.data() + data.size());
+  UnsafeMemoryIterator unsafe(data.data());
+  for (uint64_t v : values) {
+    ASSERT_EQ(v, ReadVarU64(in));
+    ASSERT_EQ(v, ReadVarU64(unsafe));
+  }
+  EXPECT_EQ(kOk, in.status());
+  ReadVarU64(in);
+  EXPECT_EQ(kEndOfStream, in.status());
+}
+
+TEST(Varint, DecodeBatch) {
+  std::vector<uint64_t> values = RandomValues(5000);
+  std::vector<byte> data = Encode(values);
+  std::vector<uint64_t> decoded(values.size());
+  size_t consumed;
+  EXPECT_EQ(values.size(), DecodeVarintsU64(data.data(), data.size(),
+                                            decoded.data(), decoded.size(),
+                                            &consumed));
+  EXPECT_EQ(data.size(), consumed);
+  EXPECT_EQ(values, decoded);
+}
+
+TEST(Varint, DecodeBatchSingleBytes) {
+  std::vector<uint64_t> values;
+  for (int i = 0; i < 37; ++i) values.push_back(i * 3);
+  std::vector<byte> data = Encode(values);
+  std::vector<uint64_t> decoded(values.size());
+  EXPECT_EQ(values.size(), DecodeVarintsU64(data.data(), data.size(),
+                                            decoded.data(), decoded.size()));
+  EXPECT_EQ(values, decoded);
+}
+
+TEST(Varint, DecodeBatchLimitedCount) {
+  std::vector<byte> data = Encode({1, 2, 300, 4, 5});
+  uint64_t decoded[3];
+  size_t consumed;
+  EXPECT_EQ(3u, DecodeVarintsU64(data.data(), data.size(), decoded, 3,
+                                 &consumed));
+  EXPECT_THAT(decoded, ElementsAre(1, 2, 300));
+  EXPECT_EQ(4u, consumed);
+}
+
+TEST(Varint, DecodeBatchTruncated) {
+  std::vector<byte> data = Encode({1, 1u << 20});
+  data.pop_back();
+  uint64_t decoded[2];
+  size_t consumed;
+  EXPECT_EQ(1u, DecodeVarintsU64(data.data(), data.size(), decoded, 2,
+                                 &consumed));
+  EXPECT_EQ(1u, consumed);
+}
+
+TEST(Varint, DecodeBatchMalformed) {
+  std::vector<byte> data(12, byte{0x80});
+  uint64_t decoded[1];
+  EXPECT_EQ(0u, DecodeVarintsU64(data.data(), data.size(), decoded, 1));
+}
+
+}  // namespace roo_io
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include <cstring>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -324,4 +325,41 @@ TEST(Write, ArduinoString) {
   EXPECT_THAT(result, ElementsAre(3, 'f', 'o', 'o', 9, 9, 9, 9));
 }
 
+TEST(Write, ArrayBeU16) {
+  uint8_t result[] = {9, 9, 9, 9, 9, 9, 9, 9};
+  MemoryOutputIterator itr{(byte*)result, (byte*)result + 8};
+  const uint16_t data[] = {0x1122, 0x3344, 0x5566};
+  EXPECT_EQ(3u, (WriteArray<uint16_t, kBigEndian>(itr, data, 3)));
+  ASSERT_EQ(kOk, itr.status());
+  EXPECT_THAT(result, ElementsAre(0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 9, 9));
+}
+
+TEST(Write, ArrayLargerThanChunk) {
+  std::vector<uint32_t> data;
+  for (uint32_t i = 0; i < 100; ++i) data.push_back(i * 0x01020304);
+  for (ByteOrder order : {kBigEndian, kLittleEndian}) {
+    std::vector<byte> result;
+    BackInsertingIterator<std::vector<byte>> itr(result);
+    size_t written =
+        (order == kBigEndian)
+            ? WriteArray<uint32_t, kBigEndian>(itr, data.data(), data.size())
+            : WriteArray<uint32_t, kLittleEndian>(itr, data.data(),
+                                                  data.size());
+    EXPECT_EQ(100u, written);
+    ASSERT_EQ(400u, result.size());
+    for (size_t i = 0; i < 100; ++i) {
+      EXPECT_EQ(data[i], order == kBigEndian ? LoadBeU32(&result[i * 4])
+                                             : LoadLeU32(&result[i * 4]));
+    }
+  }
+}
+
+TEST(Write, ArrayOverflow) {
+  uint8_t result[] = {9, 9, 9, 9, 9};
+  MemoryOutputIterator itr{(byte*)result, (byte*)result + 5};
+  const uint16_t data[] = {0x1122, 0x3344, 0x5566};
+  EXPECT_EQ(2u, (WriteArray<uint16_t, kLittleEndian>(itr, data, 3)));
+  EXPECT_EQ(kNoSpaceLeftOnDevice, itr.status());
+}
+
 }  // namespace roo_io
\ No newline at end of file
@@ -108,6 +108,7 @@ bool FakeArduinoFsImpl::rmdir(const char* path) {
   if (strcmp(mode, FILE_WRITE) == 0)
     flags |= (FakeFs::kWrite | FakeFs::kTruncate);
   if (strcmp(mode, FILE_APPEND) == 0) flags |= FakeFs::kAppend;
+  if (strcmp(mode, "r+") == 0) flags |= (FakeFs::kRead | FakeFs::kWrite);
   std::shared_ptr<FakeArduinoFile> f(new FakeArduinoFile());
   std::string p(path);
   ResolvedPath resolved = fs_.resolvePath(path, (create && mode[0] != 'r'));
@@ -0,0 +1,315 @@
+#include "roo_io/fs/block_cache.h"
+
+#include <string.h>
+
+#include <string>
+
+#include "fakefs_test_fixture.h"
+#include "gtest/gtest.h"
+#include "roo_io/fs/mount.h"
+#include "roo_io/memory/memory_input_stream.h"
+
+namespace roo_io {
+
+namespace {
+
+// Memory stream that counts the reads that reach it.
+class CountingInputStream : public MemoryInputStream<const byte*> {
+ public:
+  CountingInputStream(const std::string& data, int& reads)
+      : MemoryInputStream<const byte*>(
+            (const byte*)data.data(), (const byte*)data.data() + data.size()),
+        reads_(reads) {}
+
+  size_t read(byte* buf, size_t count) override {
+    ++reads_;
+    return MemoryInputStream<const byte*>::read(buf, count);
+  }
+
+ private:
+  int& reads_;
+};
+
+std::string TestData(size_t size) {
+  std::string data;
+  for (size_t i = 0; i < size; ++i) {
+    data.push_back('a' + (i * 7) % 26);
+  }
+  return data;
+}
+
+std::unique_ptr<MultipassInputStream> Cached(
+    const std::string& data, int& reads, std::shared_ptr<BlockCache> cache,
+    const char* name) {
+  return std::unique_ptr<MultipassInputStream>(new CachedMultipassInputStream(
+      std::unique_ptr<MultipassInputStream>(
+          new CountingInputStream(data, reads)),
+      cache, cache->fileId(0, name)));
+}
+
+std::string ReadAll(MultipassInputStream& in) {
+  std::string result;
+  char buf[100];
+  while (true) {
+    size_t n = in.read((byte*)buf, sizeof(buf));
+    if (n == 0) break;
+    result.append(buf, n);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST(BlockCache, ReadsThrough) {
+  auto cache = std::make_shared<BlockCache>(4096, 64, 2);
+  std::string data = TestData(1000);
+  int reads = 0;
+  auto in = Cached(data, reads, cache, "f");
+  ASSERT_EQ(kOk, in->status());
+  EXPECT_EQ(1000, in->size());
+  EXPECT_EQ(data, ReadAll(*in));
+  EXPECT_EQ(kEndOfStream, in->status());
+  EXPECT_EQ(1000, in->position());
+  EXPECT_EQ(1000, cache->usage());
+  in->close();
+  EXPECT_EQ(kClosed, in->status());
+}
+
+TEST(BlockCache, ServesRepeatedReadsFromMemory) {
+  auto cache = std::make_shared<BlockCache>(4096, 64, 2);
+  std::string data = TestData(1000);
+  int reads = 0;
+  auto in = Cached(data, reads, cache, "f");
+  EXPECT_EQ(data, ReadAll(*in));
+  int initial_reads = reads;
+  for (int pass = 0; pass < 3; ++pass) {
+    for (uint64_t pos = 0; pos < 1000; pos += 97) {
+      in->seek(pos);
+      byte buf[10];
+      size_t n = in->readFully(buf, 10);
+      ASSERT_EQ(std::min<uint64_t>(10, 1000 - pos), n);
+      ASSERT_EQ(0, memcmp(buf, &data[pos], n));
+    }
+  }
+  EXPECT_EQ(initial_reads, reads);
+
+  // Other streams, with the same file ID, share the cached blocks.
+  auto other = Cached(data, reads, cache, "f");
+  EXPECT_EQ(data, ReadAll(*other));
+  EXPECT_EQ(initial_reads, reads);
+}
+
+TEST(BlockCache, EvictsLeastRecentlyUsed) {
+  // One shard, holding 4 blocks.
+  auto cache = std::make_shared<BlockCache>(256, 64, 1);
+  std::string data = TestData(640);
+  int reads = 0;
+  auto in = Cached(data, reads, cache, "f");
+  byte buf[64];
+  for (int block : {0, 1, 2, 3}) {
+    in->seek(block * 64);
+    ASSERT_EQ(64, in->readFully(buf, 64));
+  }
+  EXPECT_EQ(256, cache->usage());
+  // Touch block 0, so that block 1 becomes the least recently used.
+  in->seek(0);
+  in->readFully(buf, 64);
+  int before = reads;
+  in->seek(4 * 64);
+  ASSERT_EQ(64, in->readFully(buf, 64));
+  EXPECT_LT(before, reads);
+  EXPECT_EQ(256, cache->usage());
+
+  before = reads;
+  for (int block : {0, 2, 3, 4}) {
+    in->seek(block * 64);
+    ASSERT_EQ(64, in->readFully(buf, 64));
+    ASSERT_EQ(0, memcmp(buf, &data[block * 64], 64));
+  }
+  EXPECT_EQ(before, reads);
+  in->seek(64);
+  ASSERT_EQ(64, in->readFully(buf, 64));
+  EXPECT_LT(before, reads);
+}
+
+TEST(BlockCache, SeekPastEnd) {
+  auto cache = std::make_shared<BlockCache>(4096, 64);
+  std::string data = TestData(100);
+  int reads = 0;
+  auto in = Cached(data, reads, cache, "f");
+  in->seek(1000);
+  EXPECT_EQ(kOk, in->status());
+  byte buf[10];
+  EXPECT_EQ(0, in->read(buf, 10));
+  EXPECT_EQ(kEndOfStream, in->status());
+  in->seek(95);
+  EXPECT_EQ(5, in->readFully(buf, 10));
+  EXPECT_EQ(kEndOfStream, in->status());
+  // Now from the cached, short last block.
+  in->seek(100);
+  EXPECT_EQ(0, in->read(buf, 10));
+  EXPECT_EQ(kEndOfStream, in->status());
+}
+
+TEST(BlockCache, FileIds) {
+  BlockCache cache(4096);
+  uint64_t a = 1, b = 2;
+  uint64_t id = cache.fileId(a, "/foo");
+  EXPECT_EQ(id, cache.fileId(a, "/foo"));
+  EXPECT_NE(id, cache.fileId(b, "/foo"));
+  EXPECT_NE(id, cache.fileId(a, "/bar"));
+  cache.invalidate(a, "/foo");
+  EXPECT_NE(id, cache.fileId(a, "/foo"));
+}
+
+TEST(BlockCache, PrunesFileIds) {
+  // Holds 4 blocks.
+  BlockCache cache(256, 64, 1);
+  uint64_t a = 1;
+  cache.beginWrite(a, "/written");
+  for (int i = 0; i < 1000; ++i) {
+    cache.fileId(a, ("/file" + std::to_string(i)).c_str());
+  }
+  EXPECT_GE(10, cache.fileCount());
+  EXPECT_TRUE(cache.isBeingWritten(a, "/written"));
+  cache.endWrite(a, "/written");
+  EXPECT_FALSE(cache.isBeingWritten(a, "/written"));
+}
+
+TEST(BlockCache, PruningKeepsCachedFiles) {
+  auto cache = std::make_shared<BlockCache>(256, 64, 1);
+  std::string data = TestData(64);
+  int reads = 0;
+  auto in = Cached(data, reads, cache, "f");
+  EXPECT_EQ(data, ReadAll(*in));
+  uint64_t a = 1;
+  for (int i = 0; i < 1000; ++i) {
+    cache->fileId(a, ("/file" + std::to_string(i)).c_str());
+  }
+  int before = reads;
+  byte buf[64];
+  EXPECT_EQ(64, Cached(data, reads, cache, "f")->readFully(buf, 64));
+  EXPECT_EQ(before, reads);
+}
+
+class BlockCacheMountTest : public FakeFsTest {
+ public:
+  BlockCacheMountTest() : cache_(std::make_shared<BlockCache>(8192, 128)) {}
+
+  void writeFile(const char* path, const std::string& data) {
+    auto out = mount_.fopenForWrite(path, kTruncateIfExists);
+    out->writeFully((const byte*)data.data(), data.size());
+    out->close();
+    ASSERT_EQ(kClosed, out->status());
+  }
+
+  std::string readFile(const char* path) {
+    auto in = mount_.fopen(path);
+    EXPECT_EQ(kOk, in->status());
+    return ReadAll(*in);
+  }
+
+  std::shared_ptr<BlockCache> cache_;
+};
+
+TEST_F(BlockCacheMountTest, CachesSelectedPaths) {
+  mount_.setBlockCache(cache_, [](const char* path) {
+    return strncmp(path, "/hot/", 5) == 0;
+  });
+  ASSERT_EQ(kOk, mount_.mkdir("/hot"));
+  std::string data = TestData(1000);
+  writeFile("/hot/index", data);
+  writeFile("/cold", data);
+  EXPECT_EQ(data, readFile("/cold"));
+  EXPECT_EQ(0, cache_->usage());
+  EXPECT_EQ(data, readFile("/hot/index"));
+  EXPECT_EQ(1000, cache_->usage());
+  EXPECT_EQ(data, readFile("/hot/index"));
+}
+
+TEST_F(BlockCacheMountTest, MissingFile) {
+  mount_.setBlockCache(cache_);
+  auto in = mount_.fopen("/missing");
+  EXPECT_EQ(kNotFound, in->status());
+}
+
+TEST_F(BlockCacheMountTest, InvalidatesOnWrite) {
+  mount_.setBlockCache(cache_);
+  writeFile("/file", "old contents");
+  EXPECT_EQ("old contents", readFile("/file"));
+  writeFile("/file", "new, longer contents");
+  EXPECT_EQ("new, longer contents", readFile("/file"));
+
+  ASSERT_EQ(kOk, mount_.truncate("/file", 3));
+  EXPECT_EQ("new", readFile("/file"));
+
+  writeFile("/other", "other contents");
+  EXPECT_EQ("other contents", readFile("/other"));
+  ASSERT_EQ(kOk, mount_.remove("/file"));
+  ASSERT_EQ(kOk, mount_.rename("/other", "/file"));
+  EXPECT_EQ("other contents", readFile("/file"));
+  EXPECT_EQ(kNotFound, mount_.fopen("/other")->status());
+}
+
+TEST_F(BlockCacheMountTest, ReadsWithoutCacheWhileWriting) {
+  mount_.setBlockCache(cache_);
+  auto out = mount_.fopenForWrite("/file", kTruncateIfExists);
+  out->writeFully((const byte*)"partial", 7);
+  out->flush();
+  EXPECT_EQ("partial", readFile("/file"));
+  EXPECT_EQ(0, cache_->usage());
+  out->writeFully((const byte*)" and more", 9);
+  out->close();
+  EXPECT_EQ("partial and more", readFile("/file"));
+  EXPECT_EQ(16, cache_->usage());
+}
+
+TEST_F(BlockCacheMountTest, InvalidatesOnReplace) {
+  mount_.setBlockCache(cache_);
+  writeFile("/file", "old contents");
+  EXPECT_EQ("old contents", readFile("/file"));
+  auto out = mount_.fopenForRandomWrite("/file", kReplaceAtomically);
+  out->writeFully((const byte*)"new contents", 12);
+  EXPECT_EQ("old contents", readFile("/file"));
+  out->close();
+  ASSERT_EQ(kClosed, out->status());
+  EXPECT_EQ("new contents", readFile("/file"));
+}
+
+TEST_F(BlockCacheMountTest, RemountsAreDistinguished) {
+  mount_.setBlockCache(cache_);
+  writeFile("/file", "first medium");
+  EXPECT_EQ("first medium", readFile("/file"));
+  uint64_t key = mount_.cacheKey();
+  mount_.close();
+  ASSERT_FALSE(fs_.isMounted());
+
+  // E.g. another SD card, with the same paths.
+  fakefs::FileStream f = fakefs_.open(
+      "/file", fakefs::FakeFs::kWrite | fakefs::FakeFs::kTruncate);
+  ASSERT_TRUE(f.isOpen());
+  f.write((const byte*)"second medium", 13);
+  f.close();
+
+  mount_ = fs_.mount();
+  mount_.setBlockCache(cache_);
+  EXPECT_NE(key, mount_.cacheKey());
+  EXPECT_EQ("second medium", readFile("/file"));
+}
+
+TEST_F(BlockCacheMountTest, MountsAreDistinguished) {
+  fakefs::FakeFs other_fakefs;
+  fakefs::FakeReferenceFs other_fs(other_fakefs);
+  Mount other_mount = other_fs.mount();
+  mount_.setBlockCache(cache_);
+  other_mount.setBlockCache(cache_);
+  writeFile("/file", "first");
+  auto out = other_mount.fopenForWrite("/file", kTruncateIfExists);
+  out->writeFully((const byte*)"second", 6);
+  out->close();
+  EXPECT_EQ("first", readFile("/file"));
+  auto in = other_mount.fopen("/file");
+  EXPECT_EQ("second", ReadAll(*in));
+}
+
+}  // namespace roo_io
@@ -1,5 +1,7 @@
 #include "fakefs.h"
 
+#include <algorithm>
+
 namespace roo_io {
 namespace fakefs {
 
@@ -15,7 +17,8 @@ size_t File::write(size_t pos, const byte* buf, size_t size) {
     uint64_t requested = pos + size - data_.size();
     uint64_t obtained = totals_.reserve(requested);
     data_.resize(data_.size() + obtained);
-    size -= (requested - obtained);
+    // When short of space, the write may not even reach `pos`.
+    size = (data_.size() > pos) ? std::min(size, data_.size() - pos) : 0;
   }
   if (size > 0) memcpy(&data_[pos], buf, size);
   return size;
@@ -26,6 +29,21 @@ void File::truncate() {
   data_.clear();
 }
 
+bool File::resize(size_t size) {
+  if (size < data_.size()) {
+    totals_.release(data_.size() - size);
+  } else if (size > data_.size()) {
+    uint64_t requested = size - data_.size();
+    uint64_t obtained = totals_.reserve(requested);
+    if (obtained < requested) {
+      totals_.release(obtained);
+      return false;
+    }
+  }
+  data_.resize(size);
+  return true;
+}
+
 Entry* Dir::find(const std::string& name) {
   std::list<std::unique_ptr<Entry>>::iterator itr = lookup(name);
   if (itr == entries_.end()) return nullptr;
@@ -261,6 +279,7 @@ void FileStream::skip(size_t offset) {
 }
 
 StatResult FakeFs::stat(const char* path) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   Entry* entry;
   Status status = findEntryByPath(path, &entry, false);
   if (status != kOk) {
@@ -276,6 +295,7 @@ StatResult FakeFs::stat(const char* path) const {
 }
 
 Status FakeFs::remove(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ResolvedPath resolved = resolvePath(path);
   if (resolved.status != kOk) return resolved.status;
   if (resolved.parent == nullptr) return kInvalidPath;
@@ -283,6 +303,7 @@ Status FakeFs::remove(const char* path) {
 }
 
 Status FakeFs::rename(const char* pathFrom, const char* pathTo) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ResolvedPath resolvedFrom = resolvePath(pathFrom);
   if (resolvedFrom.status != kOk) return resolvedFrom.status;
   if (resolvedFrom.parent == nullptr) return kInvalidPath;
@@ -315,7 +336,19 @@ Status FakeFs::rename(const char* pathFrom, const char* pathTo) {
   return kOk;
 }
 
+Status FakeFs::truncate(const char* path, uint64_t size) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
+  ResolvedPath resolved = resolvePath(path);
+  if (resolved.status != kOk) return resolved.status;
+  if (resolved.parent == nullptr) return kNotFile;
+  Entry* entry = resolved.parent->dir().find(resolved.basename);
+  if (entry == nullptr) return kNotFound;
+  if (!entry->isFile()) return kNotFile;
+  return entry->file().resize(size) ? kOk : kNoSpaceLeftOnDevice;
+}
+
 Status FakeFs::mkdir(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ResolvedPath resolved = resolvePath(path);
   if (resolved.status != kOk) return resolved.status;
   if (resolved.parent == nullptr) return kInvalidPath;
@@ -325,6 +358,7 @@ Status FakeFs::mkdir(const char* path) {
 }
 
 Status FakeFs::rmdir(const char* path) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ResolvedPath resolved = resolvePath(path);
   if (resolved.status != kOk) return resolved.status;
   if (resolved.parent == nullptr) return kInvalidPath;
@@ -332,6 +366,7 @@ Status FakeFs::rmdir(const char* path) {
 }
 
 Status FakeFs::opendir(const char* path, DirIterator& itr) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   Entry* entry;
   Status status = findEntryByPath(path, &entry, false);
   if (status != kOk) {
@@ -345,6 +380,7 @@ Status FakeFs::opendir(const char* path, DirIterator& itr) {
 }
 
 FileStream FakeFs::open(const char* path, int flags) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   ResolvedPath resolved = resolvePath(path);
   if (resolved.status != kOk) {
     return FileStream(resolved.status);
@@ -377,6 +413,7 @@ FileStream FakeFs::open(const char* path, int flags) {
 
 Status FakeFs::findEntryByPath(const char* name, Entry** out,
                                bool create_subdirs) const {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   if (out != nullptr) *out = nullptr;
   if (name[0] != '/') return kInvalidPath;
   Entry* dir = root_.get();
@@ -414,6 +451,7 @@ Status FakeFs::findEntryByPath(const char* name, Entry** out,
 }
 
 ResolvedPath FakeFs::resolvePath(const char* path, bool create_subdirs) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   std::string s(path);
   if (s.empty() || s[0] != '/') {
     return ResolvedPath{.status = kInvalidPath};
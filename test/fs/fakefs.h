@@ -4,6 +4,7 @@
 #include <limits>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -19,18 +20,30 @@ class FsTotals {
   FsTotals(uint64_t capacity) : usage_(0), capacity_(capacity) {}
 
   uint64_t reserve(uint64_t requested) {
-    if (requested > free()) requested = free();
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t available = usage_ > capacity_ ? 0 : capacity_ - usage_;
+    if (requested > available) requested = available;
     usage_ += requested;
     return requested;
   }
 
-  void release(uint64_t released) { usage_ -= released; }
+  void release(uint64_t released) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    usage_ -= released;
+  }
 
-  uint64_t free() const { return usage_ > capacity_ ? 0 : capacity_ - usage_; }
+  uint64_t free() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return usage_ > capacity_ ? 0 : capacity_ - usage_;
+  }
 
-  void setCapacity(uint64_t capacity) { capacity_ = capacity; }
+  void setCapacity(uint64_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+  }
 
  private:
+  mutable std::mutex mutex_;
   uint64_t usage_;
   uint64_t capacity_;
 };
@@ -48,6 +61,10 @@ class File {
 
   void truncate();
 
+  // Shrinks the file, or extends it with zeros. Returns false if there is not
+  // enough space.
+  bool resize(size_t size);
+
  private:
   friend class FileStream;
 
@@ -212,7 +229,8 @@ struct StatResult {
   size_t size;
 };
 
-// Fake in-memory filesystem.
+// Fake in-memory filesystem. Operations on paths are thread-safe; a single
+// file must not be written concurrently with other accesses to it.
 class FakeFs {
  public:
   enum OpenFlags { kRead = 1, kWrite = 2, kTruncate = 4, kAppend = 8 };
@@ -228,6 +246,8 @@ class FakeFs {
 
   Status rename(const char* pathFrom, const char* pathTo);
 
+  Status truncate(const char* path, uint64_t size);
+
   Status mkdir(const char* path);
 
   Status rmdir(const char* path);
@@ -244,6 +264,7 @@ class FakeFs {
   void setCapacity(uint64_t capacity) { totals_.setCapacity(capacity); }
 
  private:
+  mutable std::recursive_mutex mutex_;
   FsTotals totals_;
   std::unique_ptr<Entry> root_;
 };
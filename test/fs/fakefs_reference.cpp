@@ -76,10 +76,31 @@ class FakeInputStream : public MultipassInputStream {
   FileStream f_;
 };
 
-class FakeOutputStream : public OutputStream {
+class FakeOutputStream : public MultipassOutputStream {
  public:
   FakeOutputStream(std::shared_ptr<MountImpl> mount, FileStream f)
-      : mount_(std::move(mount)), f_(std::move(f)) {}
+      : mount_(std::move(mount)),
+        f_(std::move(f)),
+        fs_(nullptr),
+        status_(kOk) {}
+
+  // Writes to the temporary file `temp_path`, and renames it to
+  // `replace_target` on successful close.
+  FakeOutputStream(std::shared_ptr<MountImpl> mount, FileStream f, FakeFs& fs,
+                   std::string temp_path, std::string replace_target)
+      : mount_(std::move(mount)),
+        f_(std::move(f)),
+        fs_(&fs),
+        temp_path_(std::move(temp_path)),
+        replace_target_(std::move(replace_target)),
+        status_(kOk) {}
+
+  ~FakeOutputStream() {
+    if (fs_ != nullptr) {
+      f_.close();
+      fs_->remove(temp_path_.c_str());
+    }
+  }
 
   size_t write(const byte* buf, size_t count) override {
     return f_.write(buf, count);
@@ -87,14 +108,47 @@ class FakeOutputStream : public OutputStream {
 
   void close() override {
     mount_.reset();
+    if (fs_ == nullptr) {
+      f_.close();
+      return;
+    }
+    FakeFs* fs = fs_;
+    fs_ = nullptr;
+    status_ = f_.status();
     f_.close();
+    if (status_ != kOk) {
+      fs->remove(temp_path_.c_str());
+      return;
+    }
+    // The fake does not rename over existing files.
+    Status status = fs->remove(replace_target_.c_str());
+    if (status != kOk && status != kNotFound) {
+      status_ = status;
+      fs->remove(temp_path_.c_str());
+      return;
+    }
+    status_ = fs->rename(temp_path_.c_str(), replace_target_.c_str());
+    if (status_ == kOk) status_ = kClosed;
   }
 
-  Status status() const override { return f_.status(); }
+  Status status() const override {
+    // Once a replacing stream is closed, reports the outcome of the rename.
+    return (replace_target_.empty() || fs_ != nullptr) ? f_.status() : status_;
+  }
+
+  uint64_t size() override { return f_.size(); }
+
+  uint64_t position() const override { return f_.position(); }
+
+  void seek(uint64_t position) override { f_.seek(position); }
 
  private:
   std::shared_ptr<MountImpl> mount_;
   FileStream f_;
+  FakeFs* fs_;
+  std::string temp_path_;
+  std::string replace_target_;
+  Status status_;
 };
 
 class FakeMount : public MountImpl {
@@ -127,6 +181,12 @@ class FakeMount : public MountImpl {
     return fs_.rename(pathFrom, pathTo);
   }
 
+  Status truncate(const char* path, uint64_t size) override {
+    if (!active_) return kNotMounted;
+    if (read_only_) return kReadOnlyFilesystem;
+    return fs_.truncate(path, size);
+  }
+
   Status mkdir(const char* path) override {
     if (!active_) return kNotMounted;
     if (read_only_) return kReadOnlyFilesystem;
@@ -162,7 +222,24 @@ class FakeMount : public MountImpl {
 
   std::unique_ptr<OutputStream> fopenForWrite(
       std::shared_ptr<MountImpl> mount, const char* path,
-      FileUpdatePolicy update_policy) override {
+      FileUpdatePolicy update_policy, SyncLevel durability) override {
+    return openOutput(std::move(mount), path, update_policy);
+  }
+
+  std::unique_ptr<MultipassOutputStream> fopenForRandomWrite(
+      std::shared_ptr<MountImpl> mount, const char* path,
+      FileUpdatePolicy update_policy, SyncLevel durability) override {
+    return openOutput(std::move(mount), path, update_policy);
+  }
+
+  bool active() const override { return active_; }
+
+  void deactivate() override { active_ = false; }
+
+ private:
+  std::unique_ptr<MultipassOutputStream> openOutput(
+      std::shared_ptr<MountImpl> mount, const char* path,
+      FileUpdatePolicy update_policy) {
     int flags = FakeFs::kWrite;
     switch (update_policy) {
       case kAppendIfExists: {
@@ -176,21 +253,29 @@ class FakeMount : public MountImpl {
       default: {
       }
     }
-    if (!active_) return OutputError(kNotMounted);
-    if (read_only_) return OutputError(kReadOnlyFilesystem);
+    if (!active_) return MultipassOutputError(kNotMounted);
+    if (read_only_) return MultipassOutputError(kReadOnlyFilesystem);
+    if (update_policy == kReplaceAtomically) {
+      StatResult s = fs_.stat(path);
+      if (s.status == kOk && s.type == StatResult::kDir) {
+        return MultipassOutputError(kNotFile);
+      }
+      std::string temp_path = std::string(path) + ".tmp";
+      FileStream f = fs_.open(temp_path.c_str(), flags | FakeFs::kTruncate);
+      if (!f.isOpen()) {
+        return MultipassOutputError(f.status());
+      }
+      return std::unique_ptr<MultipassOutputStream>(new FakeOutputStream(
+          std::move(mount), std::move(f), fs_, std::move(temp_path), path));
+    }
     FileStream f = fs_.open(path, flags);
     if (!f.isOpen()) {
-      return OutputError(f.status());
+      return MultipassOutputError(f.status());
     }
-    return std::unique_ptr<OutputStream>(
+    return std::unique_ptr<MultipassOutputStream>(
         new FakeOutputStream(std::move(mount), std::move(f)));
   }
 
-  bool active() const override { return active_; }
-
-  void deactivate() override { active_ = false; }
-
- private:
   FakeFs& fs_;
   bool active_;
   bool read_only_;
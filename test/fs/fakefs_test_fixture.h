@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+
+#include "fakefs.h"
+#include "fakefs_reference.h"
+#include "gtest/gtest.h"
+#include "roo_io/fs/mount.h"
+
+namespace roo_io {
+
+// Test fixture providing a mount of a fresh fake filesystem.
+class FakeFsTest : public testing::Test {
+ public:
+  FakeFsTest() : fakefs_(), fs_(fakefs_), mount_(fs_.mount()) {}
+
+  uint64_t fileSize(const char* path) { return mount_.stat(path).size(); }
+
+  // Appends raw bytes to a file, bypassing the mount.
+  void appendRaw(const char* path, const std::string& data) {
+    fakefs::FileStream f =
+        fakefs_.open(path, fakefs::FakeFs::kWrite | fakefs::FakeFs::kAppend);
+    ASSERT_TRUE(f.isOpen());
+    f.write((const byte*)data.data(), data.size());
+    f.close();
+  }
+
+  // Overwrites bytes of a file.
+  void writeRaw(const char* path, uint64_t offset, const std::string& data) {
+    auto out = mount_.fopenForRandomWrite(path, kAppendIfExists);
+    ASSERT_EQ(kOk, out->status());
+    out->seek(offset);
+    out->writeFully((const byte*)data.data(), data.size());
+    out->close();
+    ASSERT_EQ(kClosed, out->status());
+  }
+
+  fakefs::FakeFs fakefs_;
+  fakefs::FakeReferenceFs fs_;
+  Mount mount_;
+};
+
+}  // namespace roo_io
@@ -0,0 +1,242 @@
+#include "roo_io/fs/file_handle_pool.h"
+
+#include <string>
+
+#include "fakefs_test_fixture.h"
+#include "gtest/gtest.h"
+#include "roo_io/fs/file_resource.h"
+#include "roo_io/fs/mount.h"
+#include "roo_threads/thread.h"
+
+namespace roo_io {
+
+namespace {
+
+std::string ReadAll(MultipassInputStream& in) {
+  std::string result;
+  char buf[100];
+  while (true) {
+    size_t n = in.read((byte*)buf, sizeof(buf));
+    if (n == 0) break;
+    result.append(buf, n);
+  }
+  return result;
+}
+
+}  // namespace
+
+class FileHandlePoolTest : public FakeFsTest {
+ public:
+  void setPool(size_t max_open_files, bool wait_if_exhausted = false) {
+    pool_ = std::make_shared<FileHandlePool>(max_open_files,
+                                             wait_if_exhausted);
+    fs_.setHandlePool(pool_);
+    mount_ = fs_.mount();
+  }
+
+  void writeFile(const char* path, const std::string& data) {
+    auto out = mount_.fopenForWrite(path, kTruncateIfExists);
+    out->writeFully((const byte*)data.data(), data.size());
+    out->close();
+    ASSERT_EQ(kClosed, out->status());
+  }
+
+  std::string readFile(const char* path) {
+    auto in = mount_.fopen(path);
+    EXPECT_EQ(kOk, in->status());
+    return ReadAll(*in);
+  }
+
+  std::shared_ptr<FileHandlePool> pool_;
+};
+
+TEST_F(FileHandlePoolTest, ReusesClosedHandles) {
+  setPool(4);
+  writeFile("/a", "contents of a");
+  for (int i = 0; i < 3; ++i) {
+    auto in = mount_.fopen("/a");
+    ASSERT_EQ(kOk, in->status());
+    EXPECT_EQ(0, in->position());
+    EXPECT_EQ("contents of a", ReadAll(*in));
+    EXPECT_EQ(1, pool_->inUseCount());
+    in->close();
+    EXPECT_EQ(kClosed, in->status());
+    EXPECT_EQ(0, pool_->inUseCount());
+    EXPECT_EQ(1, pool_->idleCount());
+  }
+  FileHandlePoolStats stats = pool_->stats();
+  EXPECT_EQ(2, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_FLOAT_EQ(2.0f / 3, stats.hitRate());
+}
+
+TEST_F(FileHandlePoolTest, SharedByFileResources) {
+  setPool(4);
+  writeFile("/asset", "asset data");
+  FileResource resource(fs_, "/asset");
+  for (int i = 0; i < 5; ++i) {
+    auto in = resource.open();
+    ASSERT_EQ(kOk, in->status());
+    EXPECT_EQ("asset data", ReadAll(*in));
+  }
+  EXPECT_EQ(4, pool_->stats().hits);
+  EXPECT_EQ(1, pool_->stats().misses);
+}
+
+TEST_F(FileHandlePoolTest, EvictsLeastRecentlyUsed) {
+  setPool(2);
+  writeFile("/a", "a");
+  writeFile("/b", "b");
+  writeFile("/c", "c");
+  EXPECT_EQ("a", readFile("/a"));
+  EXPECT_EQ("b", readFile("/b"));
+  EXPECT_EQ(2, pool_->idleCount());
+  EXPECT_EQ("c", readFile("/c"));
+  EXPECT_EQ(2, pool_->idleCount());
+  EXPECT_EQ(1, pool_->stats().evictions);
+  EXPECT_EQ("b", readFile("/b"));
+  EXPECT_EQ(1, pool_->stats().hits);
+  EXPECT_EQ("a", readFile("/a"));
+  EXPECT_EQ(1, pool_->stats().hits);
+  EXPECT_EQ(2, pool_->stats().evictions);
+}
+
+TEST_F(FileHandlePoolTest, FailsFastWhenExhausted) {
+  setPool(2);
+  writeFile("/a", "a");
+  auto in1 = mount_.fopen("/a");
+  auto in2 = mount_.fopen("/a");
+  ASSERT_EQ(kOk, in2->status());
+  auto in3 = mount_.fopen("/a");
+  EXPECT_EQ(kTooManyFilesOpen, in3->status());
+  EXPECT_EQ(1, pool_->stats().rejections);
+  in1->close();
+  in3 = mount_.fopen("/a");
+  EXPECT_EQ(kOk, in3->status());
+  EXPECT_EQ(1, pool_->stats().hits);
+}
+
+TEST_F(FileHandlePoolTest, WaitsWhenExhausted) {
+  setPool(1, true);
+  writeFile("/a", "a");
+  writeFile("/b", "b");
+  auto in = mount_.fopen("/a");
+  std::string result;
+  roo::thread reader([&]() { result = readFile("/b"); });
+  roo::this_thread::sleep_for(roo_time::Millis(20));
+  EXPECT_EQ("", result);
+  in->close();
+  reader.join();
+  EXPECT_EQ("b", result);
+  EXPECT_EQ(1, pool_->stats().waits);
+  EXPECT_EQ(1, pool_->stats().evictions);
+}
+
+TEST_F(FileHandlePoolTest, MissingFile) {
+  setPool(2);
+  auto in = mount_.fopen("/missing");
+  EXPECT_EQ(kNotFound, in->status());
+  EXPECT_EQ(0, pool_->inUseCount());
+  EXPECT_EQ(0, pool_->idleCount());
+}
+
+TEST_F(FileHandlePoolTest, ClosesHandlesOfChangedFiles) {
+  setPool(4);
+  writeFile("/a", "old");
+  EXPECT_EQ("old", readFile("/a"));
+  EXPECT_EQ(1, pool_->idleCount());
+  writeFile("/a", "new contents");
+  EXPECT_EQ(0, pool_->idleCount());
+  EXPECT_EQ("new contents", readFile("/a"));
+
+  // Handles in use while the file changes do not return to the pool.
+  auto in = mount_.fopen("/a");
+  ASSERT_EQ(kOk, mount_.truncate("/a", 3));
+  in->close();
+  EXPECT_EQ(0, pool_->idleCount());
+  EXPECT_EQ("new", readFile("/a"));
+
+  ASSERT_EQ(kOk, mount_.remove("/a"));
+  EXPECT_EQ(0, pool_->idleCount());
+  EXPECT_EQ(kNotFound, mount_.fopen("/a")->status());
+}
+
+TEST_F(FileHandlePoolTest, ClosesHandlesOpenedWhileWriting) {
+  setPool(4);
+  writeFile("/a", "old");
+  auto out = mount_.fopenForWrite("/a", kReplaceAtomically);
+  out->writeFully((const byte*)"new", 3);
+  EXPECT_EQ("old", readFile("/a"));
+  EXPECT_EQ(1, pool_->idleCount());
+  out->close();
+  ASSERT_EQ(kClosed, out->status());
+  EXPECT_EQ(0, pool_->idleCount());
+  EXPECT_EQ("new", readFile("/a"));
+}
+
+TEST_F(FileHandlePoolTest, IdleHandlesDoNotKeepTheMount) {
+  setPool(4);
+  writeFile("/a", "a");
+  EXPECT_EQ("a", readFile("/a"));
+  EXPECT_EQ(1, pool_->idleCount());
+  mount_.close();
+  EXPECT_FALSE(fs_.isMounted());
+  EXPECT_EQ(0, pool_->idleCount());
+  mount_ = fs_.mount();
+  EXPECT_EQ("a", readFile("/a"));
+  EXPECT_EQ(0, pool_->stats().hits);
+}
+
+TEST_F(FileHandlePoolTest, Clear) {
+  setPool(4);
+  writeFile("/a", "a");
+  EXPECT_EQ("a", readFile("/a"));
+  EXPECT_EQ(1, pool_->idleCount());
+  auto in = mount_.fopen("/a");
+  pool_->clear();
+  EXPECT_EQ(0, pool_->idleCount());
+  // Cleared while in use; not pooled again.
+  in->close();
+  EXPECT_EQ(0, pool_->idleCount());
+  EXPECT_EQ("a", readFile("/a"));
+  EXPECT_EQ(1, pool_->stats().hits);
+  EXPECT_EQ(2, pool_->stats().misses);
+}
+
+TEST(FileHandlePool, DestroyFilesystemWithIdleHandles) {
+  fakefs::FakeFs fake;
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fake, "/a", "a"));
+  std::weak_ptr<FileHandlePool> weak_pool;
+  {
+    // The filesystem holds the only reference to the pool.
+    fakefs::FakeReferenceFs fs(fake);
+    fs.setHandlePool(std::make_shared<FileHandlePool>(4));
+    weak_pool = fs.handlePool();
+    Mount mount = fs.mount();
+    auto in = mount.fopen("/a");
+    EXPECT_EQ("a", ReadAll(*in));
+    in->close();
+    EXPECT_EQ(1, fs.handlePool()->idleCount());
+  }
+  EXPECT_TRUE(weak_pool.expired());
+}
+
+TEST(FileHandlePool, OutlivesFilesystems) {
+  fakefs::FakeFs fake;
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fake, "/a", "a"));
+  auto pool = std::make_shared<FileHandlePool>(4);
+  for (int i = 0; i < 3; ++i) {
+    fakefs::FakeReferenceFs fs(fake);
+    fs.setHandlePool(pool);
+    Mount mount = fs.mount();
+    auto in = mount.fopen("/a");
+    EXPECT_EQ("a", ReadAll(*in));
+    in->close();
+    EXPECT_EQ(1, pool->idleCount());
+  }
+  EXPECT_EQ(0, pool->idleCount());
+  EXPECT_EQ(0, pool->inUseCount());
+  EXPECT_EQ(0, pool->stats().hits);
+}
+
+}  // namespace roo_io
@@ -358,6 +358,169 @@ TYPED_TEST_P(FsTest, SuccessfulAppendToFile) {
             fakefs::ReadTextFile(this->fake(), "/a/b/foo.txt"));
 }
 
+TYPED_TEST_P(FsTest, RandomWritePatchesHeader) {
+  this->RecursiveMkDir("/a");
+  auto stream =
+      this->mount().fopenForRandomWrite("/a/foo.dat", kFailIfExists);
+  ASSERT_EQ(kOk, stream->status());
+  stream->writeFully((const byte*)"????", 4);
+  stream->writeFully((const byte*)"body", 4);
+  EXPECT_EQ(8, stream->position());
+  EXPECT_EQ(8, stream->size());
+  stream->seek(0);
+  ASSERT_EQ(kOk, stream->status());
+  EXPECT_EQ(0, stream->position());
+  stream->writeFully((const byte*)"HEAD", 4);
+  EXPECT_EQ(8, stream->size());
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ("HEADbody", fakefs::ReadTextFile(this->fake(), "/a/foo.dat"));
+}
+
+TYPED_TEST_P(FsTest, RandomWriteAppendKeepsContents) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  auto stream =
+      this->mount().fopenForRandomWrite("/a/foo.txt", kAppendIfExists);
+  ASSERT_EQ(kOk, stream->status());
+  EXPECT_EQ(17, stream->position());
+  stream->writeFully((const byte*)"!", 1);
+  stream->seek(0);
+  stream->writeFully((const byte*)"p", 1);
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ("previous contents!",
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+}
+
+TYPED_TEST_P(FsTest, RandomWriteSeekPastEnd) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  auto stream =
+      this->mount().fopenForRandomWrite("/a/foo.txt", kTruncateIfExists);
+  ASSERT_EQ(kOk, stream->status());
+  EXPECT_EQ(0, stream->size());
+  stream->writeFully((const byte*)"ab", 2);
+  stream->seek(5);
+  ASSERT_EQ(kOk, stream->status());
+  stream->writeFully((const byte*)"cd", 2);
+  EXPECT_EQ(7, stream->size());
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ(std::string("ab\0\0\0cd", 7),
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+}
+
+TYPED_TEST_P(FsTest, UnsuccessfulRandomWrite) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  EXPECT_EQ(kNotFile, this->mount()
+                          .fopenForRandomWrite("/a", kTruncateIfExists)
+                          ->status());
+  EXPECT_EQ(kNotFound, this->mount()
+                           .fopenForRandomWrite("/b/foo.txt", kFailIfExists)
+                           ->status());
+  EXPECT_EQ("Previous contents",
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+}
+
+TYPED_TEST_P(FsTest, Truncate) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  EXPECT_EQ(kOk, this->mount().truncate("/a/foo.txt", 8));
+  EXPECT_EQ("Previous", fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+  EXPECT_EQ(kOk, this->mount().truncate("/a/foo.txt", 10));
+  EXPECT_EQ(std::string("Previous\0\0", 10),
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+  EXPECT_EQ(kOk, this->mount().truncate("/a/foo.txt", 0));
+  EXPECT_EQ(0, this->mount().stat("/a/foo.txt").size());
+}
+
+TYPED_TEST_P(FsTest, UnsuccessfulTruncate) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  EXPECT_EQ(kNotFile, this->mount().truncate("/a", 0));
+  EXPECT_EQ(kNotFound, this->mount().truncate("/a/bar.txt", 0));
+  EXPECT_EQ(kNotFound, this->mount().truncate("/b/foo.txt", 0));
+  EXPECT_EQ("Previous contents",
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+}
+
+TYPED_TEST_P(FsTest, PreallocateKeepsContents) {
+  this->CreateTextFile("/a/foo.txt", "Previous");
+  auto stream = this->mount().fopenForWrite("/a/foo.txt", kAppendIfExists);
+  ASSERT_EQ(kOk, stream->status());
+  stream->preallocate(4096);
+  ASSERT_EQ(kOk, stream->status());
+  stream->writeFully((const byte*)" contents", 9);
+  stream->preallocate(4096);
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ("Previous contents",
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+}
+
+TYPED_TEST_P(FsTest, SyncKeepsStreamOpen) {
+  this->RecursiveMkDir("/a");
+  auto stream = this->mount().fopenForWrite("/a/foo.txt", kFailIfExists);
+  ASSERT_EQ(kOk, stream->status());
+  stream->writeFully((const byte*)"foo", 3);
+  stream->sync(kSyncDataAndDirectory);
+  ASSERT_EQ(kOk, stream->status());
+  EXPECT_EQ("foo", fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+  stream->writeFully((const byte*)"bar", 3);
+  stream->sync(kSyncData);
+  ASSERT_EQ(kOk, stream->status());
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ("foobar", fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+}
+
+TYPED_TEST_P(FsTest, ReplaceAtomically) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  auto stream =
+      this->mount().fopenForWrite("/a/foo.txt", kReplaceAtomically, kSyncData);
+  ASSERT_EQ(kOk, stream->status());
+  stream->writeFully((const byte*)"New", 3);
+  EXPECT_EQ("Previous contents",
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ("New", fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+  EXPECT_EQ(kNotFound, this->mount().stat("/a/foo.txt.tmp").status());
+}
+
+TYPED_TEST_P(FsTest, ReplaceAtomicallyCreatesFile) {
+  this->RecursiveMkDir("/a");
+  auto stream = this->mount().fopenForRandomWrite("/a/foo.dat",
+                                                  kReplaceAtomically);
+  ASSERT_EQ(kOk, stream->status());
+  stream->writeFully((const byte*)"????body", 8);
+  stream->seek(0);
+  stream->writeFully((const byte*)"HEAD", 4);
+  stream->close();
+  ASSERT_EQ(kClosed, stream->status());
+  EXPECT_EQ("HEADbody", fakefs::ReadTextFile(this->fake(), "/a/foo.dat"));
+  EXPECT_EQ(kNotFound, this->mount().stat("/a/foo.dat.tmp").status());
+}
+
+TYPED_TEST_P(FsTest, ReplaceAtomicallyAbandoned) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  {
+    auto stream = this->mount().fopenForWrite("/a/foo.txt", kReplaceAtomically);
+    ASSERT_EQ(kOk, stream->status());
+    stream->writeFully((const byte*)"New", 3);
+    // Destroyed without close().
+  }
+  EXPECT_EQ("Previous contents",
+            fakefs::ReadTextFile(this->fake(), "/a/foo.txt"));
+  EXPECT_EQ(kNotFound, this->mount().stat("/a/foo.txt.tmp").status());
+}
+
+TYPED_TEST_P(FsTest, UnsuccessfulReplaceAtomically) {
+  this->CreateTextFile("/a/foo.txt", "Previous contents");
+  EXPECT_EQ(kNotFile,
+            this->mount().fopenForWrite("/a", kReplaceAtomically)->status());
+  EXPECT_EQ(kNotFound, this->mount()
+                           .fopenForWrite("/b/foo.txt", kReplaceAtomically)
+                           ->status());
+}
+
 TYPED_TEST_P(FsTest, ReadSeekAndSkip) {
   this->CreateTextFile("/a/b/foo.txt", "This is my text file");
 
@@ -443,6 +606,15 @@ REGISTER_TYPED_TEST_SUITE_P(FsTest, StatExistingDir, StatNonExistentDir,
                             ListOneElemDir, ListDir, SuccessfullyReadFile,
                             UnsuccessfulFopen, SuccessfulCreateFile,
                             SuccessfulOverwriteFile, SuccessfulAppendToFile,
-                            ReadSeekAndSkip, ReadStressTest);
+                            RandomWritePatchesHeader,
+                            RandomWriteAppendKeepsContents,
+                            RandomWriteSeekPastEnd, UnsuccessfulRandomWrite,
+                            Truncate, UnsuccessfulTruncate,
+                            PreallocateKeepsContents, SyncKeepsStreamOpen,
+                            ReplaceAtomically,
+                            ReplaceAtomicallyCreatesFile,
+                            ReplaceAtomicallyAbandoned,
+                            UnsuccessfulReplaceAtomically, ReadSeekAndSkip,
+                            ReadStressTest);
 
 }  // namespace roo_io
@@ -0,0 +1,159 @@
+#include "roo_io/fs/posix/posix_file_input_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+namespace roo_io {
+
+namespace {
+
+constexpr size_t kFileSize = 20000;
+
+std::string TestData(size_t size) {
+  std::string data;
+  for (size_t i = 0; i < size; ++i) {
+    data.push_back('a' + (i * 7 + i / 26) % 26);
+  }
+  return data;
+}
+
+class PosixFileInputStreamTest : public testing::Test {
+ public:
+  PosixFileInputStreamTest()
+      : path_(testing::TempDir() + "/posix_file_input_stream_test"),
+        data_(TestData(kFileSize)) {
+    FILE* f = fopen(path_.c_str(), "wb");
+    EXPECT_NE(nullptr, f);
+    EXPECT_EQ(data_.size(), fwrite(data_.data(), 1, data_.size(), f));
+    fclose(f);
+  }
+
+  ~PosixFileInputStreamTest() { remove(path_.c_str()); }
+
+  std::unique_ptr<PosixFileInputStream> open() {
+    FILE* f = fopen(path_.c_str(), "rb");
+    EXPECT_NE(nullptr, f);
+    return std::unique_ptr<PosixFileInputStream>(
+        new PosixFileInputStream(nullptr, f));
+  }
+
+  // Reads `count` bytes, and checks that they match the file contents.
+  void expectRead(PosixFileInputStream& in, size_t count) {
+    uint64_t position = in.position();
+    std::string buf(count, '\0');
+    ASSERT_EQ(count, in.readFully((byte*)&buf[0], count));
+    EXPECT_EQ(data_.substr(position, count), buf);
+    EXPECT_EQ(position + count, in.position());
+  }
+
+  std::string path_;
+  std::string data_;
+};
+
+}  // namespace
+
+TEST_F(PosixFileInputStreamTest, SequentialReadsGrowTheBuffer) {
+  auto in = open();
+  ASSERT_EQ(kOk, in->status());
+  EXPECT_EQ(kFileSize, in->size());
+  std::string result;
+  byte buf[100];
+  while (true) {
+    size_t n = in->read(buf, sizeof(buf));
+    if (n == 0) break;
+    result.append((const char*)buf, n);
+  }
+  EXPECT_EQ(data_, result);
+  EXPECT_EQ(kEndOfStream, in->status());
+  EXPECT_EQ(kFileSize, in->position());
+  const ReadAheadStats& stats = in->readAheadStats();
+  EXPECT_EQ(1, stats.random_reads);
+  EXPECT_LT(0, stats.sequential_reads);
+  EXPECT_EQ(ROO_IO_POSIX_FILE_READ_AHEAD_MAX, stats.peak_size);
+}
+
+TEST_F(PosixFileInputStreamTest, SeekWithinAndOutsideTheBuffer) {
+  auto in = open();
+  expectRead(*in, 10);
+  EXPECT_EQ(ROO_IO_POSIX_FILE_READ_AHEAD_MIN, in->readAheadStats().last_size);
+
+  // Within the buffered bytes, forward and back; no refill.
+  in->seek(300);
+  expectRead(*in, 10);
+  in->seek(5);
+  expectRead(*in, 10);
+  EXPECT_EQ(1, in->readAheadStats().random_reads);
+  EXPECT_EQ(0, in->readAheadStats().sequential_reads);
+
+  // Outside of it.
+  in->seek(12345);
+  EXPECT_EQ(12345, in->position());
+  expectRead(*in, 10);
+  EXPECT_EQ(2, in->readAheadStats().random_reads);
+  in->seek(0);
+  expectRead(*in, 10);
+  EXPECT_EQ(3, in->readAheadStats().random_reads);
+
+  // Reading across the end of the buffer refills it.
+  in->seek(ROO_IO_POSIX_FILE_READ_AHEAD_MIN - 5);
+  expectRead(*in, 10);
+  EXPECT_EQ(kOk, in->status());
+}
+
+TEST_F(PosixFileInputStreamTest, SkipPastEnd) {
+  auto in = open();
+  expectRead(*in, 10);
+  // Within the buffer.
+  in->skip(100);
+  EXPECT_EQ(110, in->position());
+  expectRead(*in, 10);
+
+  in->skip(kFileSize);
+  EXPECT_EQ(kEndOfStream, in->status());
+  byte buf[10];
+  EXPECT_EQ(0, in->read(buf, sizeof(buf)));
+  EXPECT_EQ(kEndOfStream, in->status());
+
+  // Seeking back recovers.
+  in->seek(kFileSize - 5);
+  EXPECT_EQ(kOk, in->status());
+  EXPECT_EQ(5, in->readFully(buf, sizeof(buf)));
+  EXPECT_EQ(0, memcmp(buf, &data_[kFileSize - 5], 5));
+  EXPECT_EQ(kEndOfStream, in->status());
+}
+
+TEST_F(PosixFileInputStreamTest, LargeReadsBypassTheBuffer) {
+  auto in = open();
+  expectRead(*in, 10);
+  // Drain the buffer, so that the next read goes to the file.
+  in->seek(ROO_IO_POSIX_FILE_READ_AHEAD_MIN);
+  size_t count = ROO_IO_POSIX_FILE_READ_AHEAD_MAX * 2;
+  std::string buf(count, '\0');
+  EXPECT_EQ(count, in->read((byte*)&buf[0], count));
+  EXPECT_EQ(data_.substr(ROO_IO_POSIX_FILE_READ_AHEAD_MIN, count), buf);
+  // Not buffered.
+  EXPECT_EQ(1, in->readAheadStats().random_reads);
+  EXPECT_EQ(ROO_IO_POSIX_FILE_READ_AHEAD_MIN, in->readAheadStats().peak_size);
+  expectRead(*in, 10);
+}
+
+TEST_F(PosixFileInputStreamTest, ReadAfterClose) {
+  auto in = open();
+  expectRead(*in, 10);
+  EXPECT_TRUE(in->isOpen());
+  in->close();
+  EXPECT_EQ(kClosed, in->status());
+  EXPECT_FALSE(in->isOpen());
+  byte buf[10];
+  EXPECT_EQ(0, in->read(buf, sizeof(buf)));
+  EXPECT_EQ(kClosed, in->status());
+  in->seek(0);
+  EXPECT_EQ(0, in->read(buf, sizeof(buf)));
+  EXPECT_EQ(kClosed, in->status());
+}
+
+}  // namespace roo_io
@@ -167,4 +167,22 @@ TEST(Load, DoubleEndian) {
 }
 #endif  // ROO_IO_IEEE754
 
+TEST(Load, ArrayBeS16) {
+  const byte in[] = {byte{0x11}, byte{0x22}, byte{0xFF}, byte{0xFE},
+                     byte{0x00}, byte{0x01}};
+  int16_t result[3];
+  LoadArray<int16_t, kBigEndian>(in, result, 3);
+  EXPECT_EQ(0x1122, result[0]);
+  EXPECT_EQ(-2, result[1]);
+  EXPECT_EQ(1, result[2]);
+}
+
+TEST(Load, ArrayLeU64) {
+  byte in[8 * 5];
+  for (size_t i = 0; i < sizeof(in); ++i) in[i] = (byte)i;
+  uint64_t result[5];
+  LoadArray<uint64_t, kLittleEndian>(in, result, 5);
+  for (int i = 0; i < 5; ++i) EXPECT_EQ(LoadLeU64(&in[i * 8]), result[i]);
+}
+
 }  // namespace roo_io
\ No newline at end of file
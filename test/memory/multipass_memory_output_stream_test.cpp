@@ -0,0 +1,54 @@
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "roo_io/memory/memory_output_stream.h"
+
+namespace roo_io {
+
+TEST(MultipassMemoryOutputStream, PatchesHeader) {
+  byte buf[16];
+  MultipassMemoryOutputStream<byte*> os(buf, buf + sizeof(buf));
+  EXPECT_EQ(0, os.size());
+  EXPECT_EQ(8, os.writeFully((const byte*)"????body", 8));
+  EXPECT_EQ(8, os.position());
+  EXPECT_EQ(8, os.size());
+  os.seek(0);
+  EXPECT_EQ(0, os.position());
+  EXPECT_EQ(4, os.writeFully((const byte*)"HEAD", 4));
+  EXPECT_EQ(4, os.position());
+  EXPECT_EQ(8, os.size());
+  EXPECT_EQ(kOk, os.status());
+  EXPECT_EQ("HEADbody", std::string((const char*)os.data(), os.size()));
+  os.close();
+  EXPECT_EQ(kClosed, os.status());
+}
+
+TEST(MultipassMemoryOutputStream, SeekPastEndZeroFills) {
+  byte buf[16];
+  memset(buf, 'x', sizeof(buf));
+  MultipassMemoryOutputStream<byte*> os(buf, buf + sizeof(buf));
+  os.writeFully((const byte*)"ab", 2);
+  os.seek(5);
+  EXPECT_EQ(2, os.size());
+  os.writeFully((const byte*)"cd", 2);
+  EXPECT_EQ(7, os.size());
+  EXPECT_EQ(std::string("ab\0\0\0cd", 7),
+            std::string((const char*)os.data(), os.size()));
+}
+
+TEST(MultipassMemoryOutputStream, Overflow) {
+  byte buf[4];
+  MultipassMemoryOutputStream<byte*> os(buf, buf + sizeof(buf));
+  EXPECT_EQ(4, os.write((const byte*)"abcdef", 6));
+  EXPECT_EQ(kNoSpaceLeftOnDevice, os.status());
+  EXPECT_EQ(4, os.size());
+
+  MultipassMemoryOutputStream<byte*> os2(buf, buf + sizeof(buf));
+  os2.seek(10);
+  EXPECT_EQ(kOk, os2.status());
+  EXPECT_EQ(0, os2.write((const byte*)"a", 1));
+  EXPECT_EQ(kNoSpaceLeftOnDevice, os2.status());
+}
+
+}  // namespace roo_io
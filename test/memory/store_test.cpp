@@ -191,4 +191,24 @@ TEST(Store, Float) {
   EXPECT_EQ(r, v);
 }
 
+TEST(Store, ArrayBeS16) {
+  const int16_t data[] = {0x1122, -2, 1};
+  uint8_t result[] = {9, 9, 9, 9, 9, 9, 9};
+  StoreArray<int16_t, kBigEndian>(data, 3, (byte*)result + 1);
+  EXPECT_THAT(result, ElementsAre(9, 0x11, 0x22, 0xFF, 0xFE, 0x00, 0x01));
+}
+
+#if ROO_IO_IEEE754
+TEST(Store, ArrayRoundTripsFloats) {
+  float data[21];
+  for (int i = 0; i < 21; ++i) data[i] = i * 0.37f - 3.0f;
+  byte stored[sizeof(data)];
+  StoreArray<float, kBigEndian>(data, 21, stored);
+  EXPECT_EQ(data[5], LoadBeFloat(&stored[5 * 4]));
+  float loaded[21];
+  LoadArray<float, kBigEndian>(stored, loaded, 21);
+  EXPECT_EQ(0, memcmp(data, loaded, sizeof(data)));
+}
+#endif  // ROO_IO_IEEE754
+
 }  // namespace roo_io
\ No newline at end of file
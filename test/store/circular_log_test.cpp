@@ -0,0 +1,225 @@
+#include "roo_io/store/circular_log.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "fakefs_test_fixture.h"
+#include "gtest/gtest.h"
+
+namespace roo_io {
+
+namespace {
+
+class CircularLogTest : public FakeFsTest {
+ public:
+  // Four sectors of 64 bytes; each fits two records made by `Record()`.
+  static CircularLogOptions SmallSectors() {
+    CircularLogOptions options;
+    options.sector_size = 64;
+    options.sector_count = 4;
+    return options;
+  }
+
+  static std::string Record(int i) {
+    char record[16];
+    snprintf(record, sizeof(record), "record #%02d", i);
+    return record;
+  }
+
+  Status append(CircularLog& log, const std::string& record) {
+    return log.append((const byte*)record.data(), record.size());
+  }
+
+  std::vector<std::string> read(CircularLog& log) {
+    std::vector<std::string> result;
+    CircularLogReader reader = log.read();
+    while (reader.next()) {
+      result.emplace_back((const char*)reader.data(), reader.size());
+    }
+    EXPECT_EQ(kEndOfStream, reader.status());
+    return result;
+  }
+
+  std::vector<std::string> records(int begin, int end) {
+    std::vector<std::string> result;
+    for (int i = begin; i < end; ++i) result.push_back(Record(i));
+    return result;
+  }
+};
+
+}  // namespace
+
+TEST_F(CircularLogTest, EmptyLog) {
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kClosed, log.status());
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ(256, fileSize("/log"));
+  EXPECT_TRUE(read(log).empty());
+  EXPECT_EQ(kOk, log.close());
+  EXPECT_EQ(kClosed, log.status());
+}
+
+TEST_F(CircularLogTest, AppendAndRead) {
+  {
+    CircularLog log(mount_, "/log");
+    ASSERT_EQ(kOk, log.open());
+    EXPECT_EQ(kOk, append(log, "foo"));
+    EXPECT_EQ(kOk, append(log, ""));
+    EXPECT_EQ(kOk, append(log, "barbaz"));
+    EXPECT_EQ(kOk, log.sync());
+  }
+  EXPECT_EQ(16 * 4096, fileSize("/log"));
+  CircularLog log(mount_, "/log");
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ((std::vector<std::string>{"foo", "", "barbaz"}), read(log));
+  EXPECT_EQ(kOk, append(log, "qux"));
+  EXPECT_EQ((std::vector<std::string>{"foo", "", "barbaz", "qux"}), read(log));
+}
+
+TEST_F(CircularLogTest, OverwritesOldestSector) {
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_EQ(kOk, append(log, Record(i)));
+  }
+  EXPECT_EQ(records(0, 8), read(log));
+  // The next record goes to the first sector, dropping its two records.
+  ASSERT_EQ(kOk, append(log, Record(8)));
+  EXPECT_EQ(records(2, 9), read(log));
+  for (int i = 9; i < 30; ++i) {
+    ASSERT_EQ(kOk, append(log, Record(i)));
+  }
+  EXPECT_EQ(records(22, 30), read(log));
+  EXPECT_EQ(256, fileSize("/log"));
+}
+
+TEST_F(CircularLogTest, LocatesHeadAtEveryPosition) {
+  // Reopen the log after every append, so that the head is found in every
+  // sector, in several passes around the ring.
+  for (int i = 0; i < 40; ++i) {
+    CircularLog log(mount_, "/log", SmallSectors());
+    ASSERT_EQ(kOk, log.open());
+    // Sector k holds records 2k and 2k + 1; the four newest sectors remain.
+    int head = (i - 1) / 2;
+    int begin = (i == 0 || head < 3) ? 0 : 2 * (head - 3);
+    ASSERT_EQ(records(begin, i), read(log)) << i;
+    ASSERT_EQ(kOk, append(log, Record(i)));
+  }
+}
+
+TEST_F(CircularLogTest, RecordFillingSector) {
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ(40, log.maxRecordSize());
+  std::string big(40, 'x');
+  ASSERT_EQ(kOk, append(log, big));
+  ASSERT_EQ(kOk, append(log, big));
+  ASSERT_EQ(kOk, append(log, "small"));
+  EXPECT_EQ((std::vector<std::string>{big, big, "small"}), read(log));
+}
+
+TEST_F(CircularLogTest, RejectsOversizedRecord) {
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ(kOutOfRange, append(log, std::string(41, 'x')));
+  EXPECT_EQ(kOk, log.status());
+  EXPECT_EQ(kOk, append(log, "foo"));
+  EXPECT_EQ((std::vector<std::string>{"foo"}), read(log));
+}
+
+TEST_F(CircularLogTest, DiscardsTornRecord) {
+  {
+    CircularLog log(mount_, "/log", SmallSectors());
+    ASSERT_EQ(kOk, log.open());
+    ASSERT_EQ(kOk, append(log, "foo"));
+    ASSERT_EQ(kOk, append(log, "bar"));
+  }
+  // A record with a checksum that does not match, right after "bar".
+  writeRaw("/log", 16 + 11 + 11, std::string("\x03\0\0\0\0\0\0\0baz", 11));
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ((std::vector<std::string>{"foo", "bar"}), read(log));
+  ASSERT_EQ(kOk, append(log, "qux"));
+  EXPECT_EQ((std::vector<std::string>{"foo", "bar", "qux"}), read(log));
+}
+
+TEST_F(CircularLogTest, IgnoresStaleRecordsOfOverwrittenSector) {
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  for (int i = 0; i < 9; ++i) {
+    ASSERT_EQ(kOk, append(log, Record(i)));
+  }
+  ASSERT_EQ(kOk, log.close());
+  // The first sector now holds one new record, followed by one intact, but
+  // stale record from the previous pass.
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ(records(2, 9), read(log));
+  ASSERT_EQ(kOk, append(log, Record(9)));
+  EXPECT_EQ(records(2, 10), read(log));
+}
+
+TEST_F(CircularLogTest, RecoversFromTornSectorHeaderWhenWrapping) {
+  {
+    CircularLog log(mount_, "/log", SmallSectors());
+    ASSERT_EQ(kOk, log.open());
+    for (int i = 0; i < 8; ++i) {
+      ASSERT_EQ(kOk, append(log, Record(i)));
+    }
+  }
+  // A crash while starting the next pass around the ring.
+  writeRaw("/log", 0, "RCLG\x04");
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ(records(2, 8), read(log));
+  ASSERT_EQ(kOk, append(log, Record(8)));
+  EXPECT_EQ(records(2, 9), read(log));
+}
+
+TEST_F(CircularLogTest, RecoversFromTornSectorHeader) {
+  {
+    CircularLog log(mount_, "/log", SmallSectors());
+    ASSERT_EQ(kOk, log.open());
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_EQ(kOk, append(log, Record(i)));
+    }
+  }
+  // A crash while starting the second sector, in the second pass.
+  writeRaw("/log", 64, "garbage");
+  CircularLog log(mount_, "/log", SmallSectors());
+  ASSERT_EQ(kOk, log.open());
+  EXPECT_EQ(records(4, 10), read(log));
+  ASSERT_EQ(kOk, append(log, Record(10)));
+  EXPECT_EQ(records(4, 11), read(log));
+}
+
+TEST_F(CircularLogTest, RejectsMismatchedGeometry) {
+  {
+    CircularLog log(mount_, "/log", SmallSectors());
+    ASSERT_EQ(kOk, log.open());
+  }
+  CircularLogOptions options = SmallSectors();
+  options.sector_count = 2;
+  CircularLog log(mount_, "/log", options);
+  EXPECT_EQ(kInvalidFormat, log.open());
+  EXPECT_EQ(kInvalidFormat, append(log, "foo"));
+}
+
+TEST_F(CircularLogTest, ReaderInErrorState) {
+  CircularLog log(mount_, "/log", SmallSectors());
+  CircularLogReader reader = log.read();
+  EXPECT_EQ(kClosed, reader.status());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(nullptr, reader.data());
+  EXPECT_EQ(0, reader.size());
+}
+
+TEST_F(CircularLogTest, OutOfSpace) {
+  fakefs_.setCapacity(100);
+  CircularLog log(mount_, "/log", SmallSectors());
+  EXPECT_EQ(kNoSpaceLeftOnDevice, log.open());
+  EXPECT_EQ(kNoSpaceLeftOnDevice, append(log, "foo"));
+}
+
+}  // namespace roo_io
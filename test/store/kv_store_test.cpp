@@ -0,0 +1,333 @@
+#include "roo_io/store/kv_store.h"
+
+#include <string>
+#include <vector>
+
+#include "fakefs_test_fixture.h"
+#include "gtest/gtest.h"
+#include "roo_threads/thread.h"
+
+namespace roo_io {
+
+namespace {
+
+class KvStoreTest : public FakeFsTest {
+ public:
+  static KvStoreOptions SmallFiles() {
+    KvStoreOptions options;
+    options.max_file_size = 128;
+    options.compaction_threshold = 0;
+    options.read_buffer_size = 16;
+    return options;
+  }
+
+  Status put(KvStore& store, const std::string& key,
+             const std::string& value) {
+    return store.put(key, (const byte*)value.data(), value.size());
+  }
+
+  std::string get(KvStore& store, const std::string& key) {
+    std::vector<byte> value;
+    Status status = store.get(key, value);
+    if (status != kOk) return "<" + std::string(StatusAsString(status)) + ">";
+    return std::string((const char*)value.data(), value.size());
+  }
+
+  std::vector<std::string> contents(KvStore& store) {
+    std::vector<std::string> result;
+    KvIterator itr = store.iterate();
+    while (itr.next()) {
+      result.push_back(itr.key() + "=" +
+                       std::string((const char*)itr.value().data(),
+                                   itr.value().size()));
+    }
+    EXPECT_EQ(kEndOfStream, itr.status());
+    return result;
+  }
+};
+
+}  // namespace
+
+TEST_F(KvStoreTest, EmptyStore) {
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kClosed, store.status());
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_TRUE(mount_.stat("/kv/00000001.dat").isFile());
+  EXPECT_EQ(0, store.size());
+  EXPECT_EQ("<not found>", get(store, "foo"));
+  EXPECT_TRUE(contents(store).empty());
+  EXPECT_EQ(kOk, store.close());
+  EXPECT_EQ(kClosed, store.status());
+}
+
+TEST_F(KvStoreTest, PutGetRemove) {
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(kOk, put(store, "foo", "bar"));
+  EXPECT_EQ(kOk, put(store, "empty", ""));
+  EXPECT_EQ("bar", get(store, "foo"));
+  EXPECT_EQ("", get(store, "empty"));
+  EXPECT_EQ(kOk, put(store, "foo", "baz"));
+  EXPECT_EQ("baz", get(store, "foo"));
+  EXPECT_EQ(2, store.size());
+  EXPECT_EQ(kOk, store.remove("foo"));
+  EXPECT_EQ(kNotFound, store.remove("foo"));
+  EXPECT_EQ("<not found>", get(store, "foo"));
+  EXPECT_EQ(1, store.size());
+}
+
+TEST_F(KvStoreTest, PersistsAcrossReopen) {
+  {
+    KvStore store(mount_, "/kv");
+    ASSERT_EQ(kOk, store.open());
+    ASSERT_EQ(kOk, put(store, "a", "1"));
+    ASSERT_EQ(kOk, put(store, "b", "2"));
+    ASSERT_EQ(kOk, put(store, "a", "3"));
+    ASSERT_EQ(kOk, store.remove("b"));
+    ASSERT_EQ(kOk, put(store, "c", "4"));
+  }
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ((std::vector<std::string>{"a=3", "c=4"}), contents(store));
+  ASSERT_EQ(kOk, put(store, "b", "5"));
+  EXPECT_EQ((std::vector<std::string>{"a=3", "b=5", "c=4"}), contents(store));
+}
+
+TEST_F(KvStoreTest, IterateSkipsKeysRemovedMeanwhile) {
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  ASSERT_EQ(kOk, put(store, "c", "3"));
+  ASSERT_EQ(kOk, put(store, "a", "1"));
+  ASSERT_EQ(kOk, put(store, "b", "2"));
+  KvIterator itr = store.iterate();
+  ASSERT_TRUE(itr.next());
+  EXPECT_EQ("a", itr.key());
+  ASSERT_EQ(kOk, store.remove("b"));
+  ASSERT_TRUE(itr.next());
+  EXPECT_EQ("c", itr.key());
+  EXPECT_FALSE(itr.next());
+  EXPECT_EQ(kEndOfStream, itr.status());
+}
+
+TEST_F(KvStoreTest, Batch) {
+  {
+    KvStore store(mount_, "/kv");
+    ASSERT_EQ(kOk, store.open());
+    ASSERT_EQ(kOk, put(store, "old", "x"));
+    KvBatch batch;
+    batch.put("a", (const byte*)"1", 1);
+    batch.put("b", (const byte*)"2", 1);
+    batch.remove("old");
+    batch.put("a", (const byte*)"3", 1);
+    ASSERT_EQ(kOk, store.write(batch));
+    EXPECT_EQ((std::vector<std::string>{"a=3", "b=2"}), contents(store));
+    EXPECT_EQ(kOk, store.write(KvBatch()));
+  }
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ((std::vector<std::string>{"a=3", "b=2"}), contents(store));
+}
+
+TEST_F(KvStoreTest, TornBatchIsDiscarded) {
+  {
+    KvStore store(mount_, "/kv");
+    ASSERT_EQ(kOk, store.open());
+    ASSERT_EQ(kOk, put(store, "a", "1"));
+  }
+  uint64_t intact_size = fileSize("/kv/00000001.dat");
+  {
+    KvStore store(mount_, "/kv");
+    ASSERT_EQ(kOk, store.open());
+    KvBatch batch;
+    batch.put("a", (const byte*)"2", 1);
+    batch.put("b", (const byte*)"3", 1);
+    ASSERT_EQ(kOk, store.write(batch));
+  }
+  // Simulate a crash in the middle of writing the batch.
+  ASSERT_EQ(kOk, mount_.truncate("/kv/00000001.dat",
+                                 fileSize("/kv/00000001.dat") - 3));
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(intact_size, fileSize("/kv/00000001.dat"));
+  EXPECT_EQ((std::vector<std::string>{"a=1"}), contents(store));
+  ASSERT_EQ(kOk, put(store, "c", "4"));
+  EXPECT_EQ((std::vector<std::string>{"a=1", "c=4"}), contents(store));
+}
+
+TEST_F(KvStoreTest, RejectsOversizedBatch) {
+  KvStoreOptions options;
+  options.max_batch_size = 16;
+  KvStore store(mount_, "/kv", options);
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(kOutOfRange, put(store, "key", std::string(10, 'x')));
+  EXPECT_EQ(kOutOfRange, put(store, std::string(70000, 'k'), ""));
+  EXPECT_EQ(kOutOfRange, store.remove(std::string(70000, 'k')));
+  EXPECT_EQ(kOk, store.status());
+  EXPECT_EQ(kOk, put(store, "key", "value"));
+  EXPECT_EQ("value", get(store, "key"));
+}
+
+TEST_F(KvStoreTest, RollsOverFiles) {
+  {
+    KvStore store(mount_, "/kv", SmallFiles());
+    ASSERT_EQ(kOk, store.open());
+    for (int i = 0; i < 20; ++i) {
+      ASSERT_EQ(kOk, put(store, "key" + std::to_string(i % 5),
+                         "value #" + std::to_string(i)));
+    }
+    EXPECT_LT(4, store.fileCount());
+    EXPECT_LE(fileSize("/kv/00000001.dat"), 128);
+  }
+  KvStore store(mount_, "/kv", SmallFiles());
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ((std::vector<std::string>{"key0=value #15", "key1=value #16",
+                                      "key2=value #17", "key3=value #18",
+                                      "key4=value #19"}),
+            contents(store));
+}
+
+TEST_F(KvStoreTest, Compaction) {
+  KvStore store(mount_, "/kv", SmallFiles());
+  ASSERT_EQ(kOk, store.open());
+  for (int i = 0; i < 30; ++i) {
+    ASSERT_EQ(kOk, put(store, "key" + std::to_string(i % 3),
+                       "value #" + std::to_string(i)));
+  }
+  ASSERT_EQ(kOk, put(store, "removed", "x"));
+  ASSERT_EQ(kOk, store.remove("removed"));
+  size_t files = store.fileCount();
+  EXPECT_LT(5, files);
+  ASSERT_EQ(kOk, store.compact());
+  // The compacted file, and the new active one.
+  EXPECT_EQ(2, store.fileCount());
+  EXPECT_EQ(kNotFound, mount_.stat("/kv/00000001.dat").status());
+  uint32_t compacted = files + 1;
+  char hint[32];
+  snprintf(hint, sizeof(hint), "/kv/%08x.hint", compacted);
+  EXPECT_TRUE(mount_.stat(hint).isFile());
+  std::vector<std::string> expected{"key0=value #27", "key1=value #28",
+                                    "key2=value #29"};
+  EXPECT_EQ(expected, contents(store));
+  ASSERT_EQ(kOk, store.close());
+
+  // Recovers from the hint file.
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(expected, contents(store));
+  ASSERT_EQ(kOk, store.close());
+
+  // Falls back to scanning if the hint file is damaged.
+  appendRaw(hint, "garbage");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(expected, contents(store));
+  ASSERT_EQ(kOk, store.close());
+
+  // ... or incomplete, even if it ends on a record boundary.
+  ASSERT_EQ(kOk, mount_.truncate(hint, 0));
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(expected, contents(store));
+}
+
+TEST_F(KvStoreTest, CompactionKeepsLaterWrites) {
+  KvStore store(mount_, "/kv", SmallFiles());
+  ASSERT_EQ(kOk, store.open());
+  ASSERT_EQ(kOk, put(store, "a", "1"));
+  ASSERT_EQ(kOk, put(store, "b", "2"));
+  ASSERT_EQ(kOk, store.compact());
+  ASSERT_EQ(kOk, put(store, "a", "3"));
+  ASSERT_EQ(kOk, store.remove("b"));
+  ASSERT_EQ(kOk, store.compact());
+  ASSERT_EQ(kOk, put(store, "c", "4"));
+  EXPECT_EQ((std::vector<std::string>{"a=3", "c=4"}), contents(store));
+  ASSERT_EQ(kOk, store.close());
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ((std::vector<std::string>{"a=3", "c=4"}), contents(store));
+}
+
+TEST_F(KvStoreTest, RemovesLeftoversOfInterruptedCompaction) {
+  {
+    KvStore store(mount_, "/kv");
+    ASSERT_EQ(kOk, store.open());
+    ASSERT_EQ(kOk, put(store, "a", "1"));
+  }
+  // Compacting into file #2 starts file #3 first.
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/kv/00000003.dat", ""));
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/kv/00000002.dat.tmp", "?"));
+  ASSERT_EQ(kOk,
+            fakefs::CreateTextFile(fakefs_, "/kv/00000002.hint.tmp.7.1", "?"));
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/kv/README", "hello"));
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_EQ(kNotFound, mount_.stat("/kv/00000002.dat.tmp").status());
+  EXPECT_EQ(kNotFound, mount_.stat("/kv/00000002.hint.tmp.7.1").status());
+  EXPECT_TRUE(mount_.stat("/kv/README").isFile());
+  EXPECT_EQ(2, store.fileCount());
+  EXPECT_EQ((std::vector<std::string>{"a=1"}), contents(store));
+}
+
+TEST_F(KvStoreTest, AdoptsActiveFileOfInterruptedTruncation) {
+  {
+    KvStore store(mount_, "/kv");
+    ASSERT_EQ(kOk, store.open());
+    ASSERT_EQ(kOk, put(store, "a", "1"));
+    ASSERT_EQ(kOk, put(store, "b", "2"));
+  }
+  // The truncated copy, with the original already removed.
+  ASSERT_EQ(kOk, mount_.rename("/kv/00000001.dat", "/kv/00000001.dat.tmp.3"));
+  KvStore store(mount_, "/kv");
+  ASSERT_EQ(kOk, store.open());
+  EXPECT_TRUE(mount_.stat("/kv/00000001.dat").isFile());
+  EXPECT_EQ(kNotFound, mount_.stat("/kv/00000001.dat.tmp.3").status());
+  EXPECT_EQ((std::vector<std::string>{"a=1", "b=2"}), contents(store));
+}
+
+TEST_F(KvStoreTest, BackgroundCompaction) {
+  KvStoreOptions options = SmallFiles();
+  options.compaction_threshold = 256;
+  {
+    KvStore store(mount_, "/kv", options);
+    ASSERT_EQ(kOk, store.open());
+    for (int i = 0; i < 200; ++i) {
+      ASSERT_EQ(kOk, put(store, "key" + std::to_string(i % 4),
+                         "value #" + std::to_string(i)));
+      // Keeps the result independent of thread scheduling.
+      store.waitForCompaction();
+    }
+  }
+  KvStore store(mount_, "/kv", options);
+  ASSERT_EQ(kOk, store.open());
+  // Without compaction, there would be over 50 files.
+  EXPECT_GT(5, store.fileCount());
+  EXPECT_EQ((std::vector<std::string>{"key0=value #196", "key1=value #197",
+                                      "key2=value #198", "key3=value #199"}),
+            contents(store));
+}
+
+TEST_F(KvStoreTest, ConcurrentWritesAndCompaction) {
+  KvStore store(mount_, "/kv", SmallFiles());
+  ASSERT_EQ(kOk, store.open());
+  roo::thread writer([this, &store]() {
+    for (int i = 0; i < 100; ++i) {
+      EXPECT_EQ(kOk, put(store, "key" + std::to_string(i % 10),
+                         std::to_string(i)));
+      EXPECT_EQ(std::to_string(i), get(store, "key" + std::to_string(i % 10)));
+    }
+  });
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(kOk, store.compact());
+  }
+  writer.join();
+  ASSERT_EQ(kOk, store.close());
+  ASSERT_EQ(kOk, store.open());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(std::to_string(90 + i), get(store, "key" + std::to_string(i)));
+  }
+}
+
+TEST_F(KvStoreTest, OpenFailsWhenDirectoryIsAFile) {
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/kv", "hello"));
+  KvStore store(mount_, "/kv");
+  EXPECT_NE(kOk, store.open());
+  EXPECT_NE(kOk, put(store, "foo", "bar"));
+}
+
+}  // namespace roo_io
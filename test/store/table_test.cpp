@@ -0,0 +1,220 @@
+#include "roo_io/store/table.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "fakefs_test_fixture.h"
+#include "gtest/gtest.h"
+
+namespace roo_io {
+
+namespace {
+
+class TableTest : public FakeFsTest {
+ public:
+  static std::string Key(int i) {
+    char key[32];
+    snprintf(key, sizeof(key), "sensor/calibration/%05d", i);
+    return key;
+  }
+
+  static std::string Value(int i) { return "value of " + std::to_string(i); }
+
+  // Writes a table with keys `Key(0)`, `Key(step)`, `Key(2 * step)`, ...
+  void writeTable(int count, int step = 1,
+                  TableOptions options = TableOptions()) {
+    auto out = mount_.fopenForWrite("/table", kTruncateIfExists);
+    ASSERT_EQ(kOk, out->status());
+    TableWriter writer(*out, options);
+    for (int i = 0; i < count; ++i) {
+      std::string value = Value(i * step);
+      ASSERT_EQ(kOk, writer.add(Key(i * step), (const byte*)value.data(),
+                                value.size()));
+    }
+    EXPECT_EQ(count, writer.entryCount());
+    ASSERT_EQ(kOk, writer.finish());
+    EXPECT_EQ(kClosed, writer.status());
+    out->close();
+    ASSERT_EQ(kClosed, out->status());
+  }
+
+  std::string get(TableReader& reader, const std::string& key) {
+    std::vector<byte> value;
+    Status status = reader.get(key, value);
+    if (status != kOk) return "<" + std::string(StatusAsString(status)) + ">";
+    return std::string((const char*)value.data(), value.size());
+  }
+};
+
+}  // namespace
+
+TEST_F(TableTest, EmptyTable) {
+  writeTable(0);
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kClosed, reader.status());
+  ASSERT_EQ(kOk, reader.open());
+  EXPECT_EQ(0, reader.blockCount());
+  EXPECT_EQ("<not found>", get(reader, "foo"));
+  TableIterator itr = reader.iterate();
+  EXPECT_EQ(nullptr, itr.value());
+  EXPECT_FALSE(itr.next());
+  EXPECT_EQ(kEndOfStream, itr.status());
+  EXPECT_EQ(nullptr, itr.value());
+  EXPECT_EQ(0, itr.size());
+}
+
+TEST_F(TableTest, Get) {
+  writeTable(1000, 2);
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  EXPECT_LT(1, reader.blockCount());
+  for (int i = 0; i < 2000; ++i) {
+    if (i % 2 == 0) {
+      ASSERT_EQ(Value(i), get(reader, Key(i)));
+    } else {
+      ASSERT_EQ("<not found>", get(reader, Key(i)));
+    }
+  }
+  EXPECT_EQ("<not found>", get(reader, ""));
+  EXPECT_EQ("<not found>", get(reader, "zzz"));
+}
+
+TEST_F(TableTest, Iterate) {
+  writeTable(500, 1);
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  TableIterator itr = reader.iterate();
+  int count = 0;
+  while (itr.next()) {
+    ASSERT_EQ(Key(count), itr.key());
+    ASSERT_EQ(Value(count), std::string((const char*)itr.value(), itr.size()));
+    ++count;
+  }
+  EXPECT_EQ(kEndOfStream, itr.status());
+  EXPECT_EQ(500, count);
+}
+
+TEST_F(TableTest, Seek) {
+  writeTable(500, 2);
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  TableIterator itr = reader.iterate();
+  for (int i = 0; i < 999; i += 37) {
+    itr.seek(Key(i));
+    ASSERT_TRUE(itr.next());
+    EXPECT_EQ(Key((i + 1) / 2 * 2), itr.key());
+    ASSERT_TRUE(itr.next());
+    EXPECT_EQ(Key((i + 1) / 2 * 2 + 2), itr.key());
+  }
+  itr.seek("");
+  ASSERT_TRUE(itr.next());
+  EXPECT_EQ(Key(0), itr.key());
+  itr.seek(Key(998) + "x");
+  EXPECT_FALSE(itr.next());
+  EXPECT_EQ(kEndOfStream, itr.status());
+}
+
+TEST_F(TableTest, KeysArePrefixCompressed) {
+  TableOptions options;
+  options.bloom_bits_per_key = 0;
+  writeTable(1000, 1, options);
+  // Keys are 24 bytes each, but share a 21-byte or longer prefix.
+  EXPECT_GT(1000 * 24, mount_.stat("/table").size());
+}
+
+TEST_F(TableTest, BloomFilter) {
+  writeTable(1000, 2);
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  int false_positives = 0;
+  for (int i = 0; i < 2000; ++i) {
+    if (i % 2 == 0) {
+      ASSERT_TRUE(reader.mayContain(Key(i)));
+    } else if (reader.mayContain(Key(i))) {
+      ++false_positives;
+    }
+  }
+  // About 1% expected.
+  EXPECT_GT(50, false_positives);
+}
+
+TEST_F(TableTest, NoBloomFilter) {
+  TableOptions options;
+  options.bloom_bits_per_key = 0;
+  writeTable(100, 2, options);
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  EXPECT_TRUE(reader.mayContain(Key(1)));
+  EXPECT_EQ("<not found>", get(reader, Key(1)));
+  EXPECT_EQ(Value(2), get(reader, Key(2)));
+}
+
+TEST_F(TableTest, LargeValues) {
+  TableOptions options;
+  options.block_size = 64;
+  auto out = mount_.fopenForWrite("/table", kTruncateIfExists);
+  TableWriter writer(*out, options);
+  std::string big(1000, 'x');
+  ASSERT_EQ(kOk, writer.add("a", (const byte*)big.data(), big.size()));
+  ASSERT_EQ(kOk, writer.add("b", (const byte*)"small", 5));
+  ASSERT_EQ(kOk, writer.add("c", (const byte*)big.data(), big.size()));
+  ASSERT_EQ(kOk, writer.finish());
+  out->close();
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  EXPECT_EQ(big, get(reader, "a"));
+  EXPECT_EQ("small", get(reader, "b"));
+  EXPECT_EQ(big, get(reader, "c"));
+}
+
+TEST_F(TableTest, RejectsUnorderedKeys) {
+  auto out = mount_.fopenForWrite("/table", kTruncateIfExists);
+  TableWriter writer(*out);
+  ASSERT_EQ(kOk, writer.add("b", (const byte*)"1", 1));
+  EXPECT_EQ(kInvalidFormat, writer.add("a", (const byte*)"2", 1));
+  EXPECT_EQ(kInvalidFormat, writer.add("b", (const byte*)"3", 1));
+  EXPECT_EQ(kOk, writer.status());
+  ASSERT_EQ(kOk, writer.add("c", (const byte*)"4", 1));
+  ASSERT_EQ(kOk, writer.finish());
+  EXPECT_EQ(kClosed, writer.add("d", (const byte*)"5", 1));
+  out->close();
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  EXPECT_EQ("1", get(reader, "b"));
+  EXPECT_EQ("4", get(reader, "c"));
+  EXPECT_EQ("<not found>", get(reader, "a"));
+}
+
+TEST_F(TableTest, DetectsCorruptedBlock) {
+  TableOptions options;
+  options.block_size = 256;
+  writeTable(100, 1, options);
+  writeRaw("/table", 10, "garbage");
+  TableReader reader(mount_.fopen("/table"));
+  ASSERT_EQ(kOk, reader.open());
+  EXPECT_EQ("<invalid format>", get(reader, Key(0)));
+  EXPECT_EQ(Value(99), get(reader, Key(99)));
+  TableIterator itr = reader.iterate();
+  EXPECT_FALSE(itr.next());
+  EXPECT_EQ(kInvalidFormat, itr.status());
+}
+
+TEST_F(TableTest, RejectsInvalidFile) {
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/short", "RTBL"));
+  TableReader short_reader(mount_.fopen("/short"));
+  EXPECT_EQ(kInvalidFormat, short_reader.open());
+  EXPECT_EQ("<invalid format>", get(short_reader, "foo"));
+
+  writeTable(10);
+  uint64_t size = mount_.stat("/table").size();
+  writeRaw("/table", size - 4, "XXXX");
+  TableReader reader(mount_.fopen("/table"));
+  EXPECT_EQ(kInvalidFormat, reader.open());
+
+  TableReader missing(mount_.fopen("/missing"));
+  EXPECT_EQ(kNotFound, missing.open());
+}
+
+}  // namespace roo_io
@@ -0,0 +1,280 @@
+#include "roo_io/store/wal.h"
+
+#include <string>
+#include <vector>
+
+#include "fakefs_test_fixture.h"
+#include "gtest/gtest.h"
+#include "roo_threads/thread.h"
+
+namespace roo_io {
+
+namespace {
+
+class WalTest : public FakeFsTest {
+ public:
+  static WalOptions SmallSegments() {
+    WalOptions options;
+    options.segment_size = 64;
+    options.read_buffer_size = 16;
+    return options;
+  }
+
+  Status append(Wal& wal, const std::string& record) {
+    return wal.appendAndCommit((const byte*)record.data(), record.size());
+  }
+
+  std::vector<std::string> replay(Wal& wal) {
+    std::vector<std::string> result;
+    WalReader reader = wal.replay();
+    while (reader.next()) {
+      result.emplace_back((const char*)reader.data(), reader.size());
+    }
+    EXPECT_EQ(kEndOfStream, reader.status());
+    return result;
+  }
+};
+
+}  // namespace
+
+TEST_F(WalTest, EmptyLog) {
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kClosed, wal.status());
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(1, wal.segmentCount());
+  EXPECT_TRUE(mount_.stat("/log/00000001.wal").isFile());
+  EXPECT_TRUE(replay(wal).empty());
+  EXPECT_EQ(kOk, wal.close());
+  EXPECT_EQ(kClosed, wal.status());
+}
+
+TEST_F(WalTest, AppendAndReplay) {
+  {
+    Wal wal(mount_, "/log");
+    ASSERT_EQ(kOk, wal.open());
+    EXPECT_EQ(kOk, append(wal, "foo"));
+    EXPECT_EQ(kOk, append(wal, ""));
+    EXPECT_EQ(kOk, append(wal, "barbaz"));
+  }
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ((std::vector<std::string>{"foo", "", "barbaz"}), replay(wal));
+  EXPECT_EQ(kOk, append(wal, "qux"));
+  EXPECT_EQ((std::vector<std::string>{"foo", "", "barbaz", "qux"}),
+            replay(wal));
+}
+
+TEST_F(WalTest, BatchedAppendsAndCommit) {
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  uint64_t t1 = wal.append((const byte*)"a", 1);
+  uint64_t t2 = wal.append((const byte*)"b", 1);
+  EXPECT_LT(0, t1);
+  EXPECT_LT(t1, t2);
+  EXPECT_EQ(kOk, wal.commit(t2));
+  EXPECT_EQ(kOk, wal.commit(t1));
+  EXPECT_EQ((std::vector<std::string>{"a", "b"}), replay(wal));
+}
+
+TEST_F(WalTest, RejectsOversizedRecord) {
+  WalOptions options;
+  options.max_record_size = 4;
+  Wal wal(mount_, "/log", options);
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(0, wal.append((const byte*)"12345", 5));
+  EXPECT_EQ(kOutOfRange, append(wal, "12345"));
+  EXPECT_EQ(kOk, wal.status());
+  EXPECT_EQ(kOk, append(wal, "1234"));
+  EXPECT_EQ((std::vector<std::string>{"1234"}), replay(wal));
+}
+
+TEST_F(WalTest, RollsOverSegments) {
+  std::vector<std::string> expected;
+  {
+    Wal wal(mount_, "/log", SmallSegments());
+    ASSERT_EQ(kOk, wal.open());
+    for (int i = 0; i < 20; ++i) {
+      expected.push_back("record #" + std::to_string(i));
+      ASSERT_EQ(kOk, append(wal, expected.back()));
+    }
+    EXPECT_LT(4, wal.segmentCount());
+    EXPECT_LE(fileSize("/log/00000001.wal"), 64);
+  }
+  Wal wal(mount_, "/log", SmallSegments());
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(expected, replay(wal));
+}
+
+TEST_F(WalTest, Checkpoint) {
+  Wal wal(mount_, "/log", SmallSegments());
+  ASSERT_EQ(kOk, wal.open());
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(kOk, append(wal, "old record #" + std::to_string(i)));
+  }
+  EXPECT_LT(1, wal.segmentCount());
+  ASSERT_EQ(kOk, wal.checkpoint());
+  EXPECT_EQ(1, wal.segmentCount());
+  EXPECT_EQ(kNotFound, mount_.stat("/log/00000001.wal").status());
+  EXPECT_TRUE(replay(wal).empty());
+  ASSERT_EQ(kOk, append(wal, "new"));
+  EXPECT_EQ((std::vector<std::string>{"new"}), replay(wal));
+}
+
+TEST_F(WalTest, RecoveryTruncatesTornRecord) {
+  {
+    Wal wal(mount_, "/log");
+    ASSERT_EQ(kOk, wal.open());
+    ASSERT_EQ(kOk, append(wal, "foo"));
+    ASSERT_EQ(kOk, append(wal, "bar"));
+  }
+  uint64_t intact_size = fileSize("/log/00000001.wal");
+  // A header promising 100 bytes, followed by only a few.
+  appendRaw("/log/00000001.wal", std::string("\x64\0\0\0\x12\x34\x56\x78", 8));
+  appendRaw("/log/00000001.wal", "partial");
+
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(intact_size, fileSize("/log/00000001.wal"));
+  EXPECT_EQ((std::vector<std::string>{"foo", "bar"}), replay(wal));
+  ASSERT_EQ(kOk, append(wal, "baz"));
+  EXPECT_EQ((std::vector<std::string>{"foo", "bar", "baz"}), replay(wal));
+}
+
+TEST_F(WalTest, RecoveryTruncatesTornHeader) {
+  {
+    Wal wal(mount_, "/log");
+    ASSERT_EQ(kOk, wal.open());
+    ASSERT_EQ(kOk, append(wal, "foo"));
+  }
+  appendRaw("/log/00000001.wal", "\x03");
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(11, fileSize("/log/00000001.wal"));
+  EXPECT_EQ((std::vector<std::string>{"foo"}), replay(wal));
+}
+
+TEST_F(WalTest, RecoveryDropsCorruptedRecordAndEverythingAfter) {
+  {
+    Wal wal(mount_, "/log");
+    ASSERT_EQ(kOk, wal.open());
+    ASSERT_EQ(kOk, append(wal, "foo"));
+  }
+  // A complete record, with a checksum that does not match.
+  appendRaw("/log/00000001.wal", std::string("\x03\0\0\0\0\0\0\0bar", 11));
+  {
+    Wal wal(mount_, "/log");
+    ASSERT_EQ(kOk, wal.open());
+    EXPECT_EQ(11, fileSize("/log/00000001.wal"));
+    ASSERT_EQ(kOk, append(wal, "baz"));
+  }
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ((std::vector<std::string>{"foo", "baz"}), replay(wal));
+}
+
+TEST_F(WalTest, ReplayReportsCorruptedEarlierSegment) {
+  {
+    Wal wal(mount_, "/log", SmallSegments());
+    ASSERT_EQ(kOk, wal.open());
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_EQ(kOk, append(wal, "record #" + std::to_string(i)));
+    }
+  }
+  appendRaw("/log/00000001.wal", "garbage!");
+  Wal wal(mount_, "/log", SmallSegments());
+  ASSERT_EQ(kOk, wal.open());
+  WalReader reader = wal.replay();
+  while (reader.next()) {
+  }
+  EXPECT_EQ(kInvalidFormat, reader.status());
+}
+
+TEST_F(WalTest, RecoveryAdoptsSegmentOfInterruptedTruncation) {
+  {
+    Wal wal(mount_, "/log", SmallSegments());
+    ASSERT_EQ(kOk, wal.open());
+    for (int i = 0; i < 10; ++i) {
+      ASSERT_EQ(kOk, append(wal, "record #" + std::to_string(i)));
+    }
+  }
+  std::vector<std::string> expected;
+  {
+    Wal wal(mount_, "/log", SmallSegments());
+    ASSERT_EQ(kOk, wal.open());
+    expected = replay(wal);
+  }
+  // The truncated copy of the last segment, with the original already
+  // removed; and a leftover of an earlier segment.
+  ASSERT_EQ(kOk, mount_.rename("/log/00000004.wal", "/log/00000004.wal.tmp.5"));
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/log/00000002.wal.tmp", "?"));
+  Wal wal(mount_, "/log", SmallSegments());
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_TRUE(mount_.stat("/log/00000004.wal").isFile());
+  EXPECT_EQ(kNotFound, mount_.stat("/log/00000004.wal.tmp.5").status());
+  EXPECT_EQ(kNotFound, mount_.stat("/log/00000002.wal.tmp").status());
+  EXPECT_EQ(expected, replay(wal));
+}
+
+TEST_F(WalTest, IgnoresUnrelatedFiles) {
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/log/README", "hello"));
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/log/0000000x.wal", "??"));
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(1, wal.segmentCount());
+  EXPECT_TRUE(replay(wal).empty());
+}
+
+TEST_F(WalTest, OutOfSpace) {
+  {
+    Wal wal(mount_, "/log");
+    ASSERT_EQ(kOk, wal.open());
+    ASSERT_EQ(kOk, append(wal, "foo"));
+    fakefs_.setCapacity(fileSize("/log/00000001.wal") + 12);
+    EXPECT_EQ(kOk, append(wal, "bar"));
+    EXPECT_EQ(kNoSpaceLeftOnDevice, append(wal, "baz"));
+    EXPECT_EQ(kNoSpaceLeftOnDevice, wal.status());
+    EXPECT_EQ(0, wal.append((const byte*)"qux", 3));
+  }
+  fakefs_.setCapacity(1024 * 1024);
+  // The failed append left a torn record behind.
+  EXPECT_EQ(23, fileSize("/log/00000001.wal"));
+  Wal wal(mount_, "/log");
+  ASSERT_EQ(kOk, wal.open());
+  EXPECT_EQ(22, fileSize("/log/00000001.wal"));
+  EXPECT_EQ((std::vector<std::string>{"foo", "bar"}), replay(wal));
+}
+
+TEST_F(WalTest, OpenFailsWhenDirectoryIsAFile) {
+  ASSERT_EQ(kOk, fakefs::CreateTextFile(fakefs_, "/log", "hello"));
+  Wal wal(mount_, "/log");
+  EXPECT_NE(kOk, wal.open());
+  EXPECT_EQ(0, wal.append((const byte*)"foo", 3));
+}
+
+TEST_F(WalTest, ConcurrentWriters) {
+  static const int kThreads = 4;
+  static const int kRecordsPerThread = 25;
+  Wal wal(mount_, "/log", SmallSegments());
+  ASSERT_EQ(kOk, wal.open());
+  std::vector<roo::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([this, &wal, i]() {
+      for (int j = 0; j < kRecordsPerThread; ++j) {
+        EXPECT_EQ(kOk, append(wal, std::to_string(i) + ":" +
+                                       std::to_string(j)));
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  std::vector<std::string> records = replay(wal);
+  EXPECT_EQ(kThreads * kRecordsPerThread, records.size());
+  // Each thread's records are in order.
+  std::vector<int> next(kThreads, 0);
+  for (const std::string& record : records) {
+    int i = std::stoi(record.substr(0, record.find(':')));
+    int j = std::stoi(record.substr(record.find(':') + 1));
+    EXPECT_EQ(next[i]++, j);
+  }
+}
+
+}  // namespace roo_io
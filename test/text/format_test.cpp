@@ -0,0 +1,230 @@
+#include "roo_io/text/format.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "roo_io/core/buffered_output_stream_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+#include "roo_io/memory/memory_output_stream.h"
+#include "roo_io/net/mac_address.h"
+
+namespace roo_io {
+
+namespace {
+
+template <typename S, typename... Args>
+std::string Fmt(S format, const Args&... args) {
+  char buf[256];
+  size_t len = FormatToBuffer(buf, sizeof(buf), format, args...);
+  EXPECT_LT(len, sizeof(buf));
+  EXPECT_EQ(len, strlen(buf));
+  return std::string(buf, len);
+}
+
+struct Point {
+  int x;
+  int y;
+};
+
+}  // namespace
+
+template <>
+struct Formatter<Point> {
+  static void format(FormatSink& sink, const FormatSpec& spec,
+                     const Point& p) {
+    char buf[32];
+    size_t len =
+        FormatToBuffer(buf, sizeof(buf), ROO_IO_FMT("({}, {})"), p.x, p.y);
+    sink.writePadded(spec, buf, len);
+  }
+};
+
+TEST(Format, Literals) {
+  EXPECT_EQ("", Fmt(ROO_IO_FMT("")));
+  EXPECT_EQ("abc", Fmt(ROO_IO_FMT("abc")));
+  EXPECT_EQ("{}", Fmt(ROO_IO_FMT("{{}}")));
+  EXPECT_EQ("a{b}c", Fmt(ROO_IO_FMT("a{{b}}c")));
+}
+
+TEST(Format, Integers) {
+  EXPECT_EQ("42", Fmt(ROO_IO_FMT("{}"), 42));
+  EXPECT_EQ("-42", Fmt(ROO_IO_FMT("{}"), -42));
+  EXPECT_EQ("0", Fmt(ROO_IO_FMT("{}"), 0u));
+  EXPECT_EQ("18446744073709551615",
+            Fmt(ROO_IO_FMT("{}"), (uint64_t)18446744073709551615u));
+  EXPECT_EQ("-9223372036854775808",
+            Fmt(ROO_IO_FMT("{}"), std::numeric_limits<int64_t>::min()));
+  EXPECT_EQ("200", Fmt(ROO_IO_FMT("{}"), (uint8_t)200));
+  EXPECT_EQ("-5", Fmt(ROO_IO_FMT("{}"), (int8_t)-5));
+  EXPECT_EQ("1 2 3", Fmt(ROO_IO_FMT("{} {} {}"), 1, (short)2, 3L));
+}
+
+TEST(Format, IntegerPresentation) {
+  EXPECT_EQ("ff", Fmt(ROO_IO_FMT("{:x}"), 255));
+  EXPECT_EQ("FF", Fmt(ROO_IO_FMT("{:X}"), 255));
+  EXPECT_EQ("0xff", Fmt(ROO_IO_FMT("{:#x}"), 255));
+  EXPECT_EQ("0XFF", Fmt(ROO_IO_FMT("{:#X}"), 255));
+  EXPECT_EQ("101", Fmt(ROO_IO_FMT("{:b}"), 5));
+  EXPECT_EQ("0b101", Fmt(ROO_IO_FMT("{:#b}"), 5));
+  EXPECT_EQ("17", Fmt(ROO_IO_FMT("{:o}"), 15));
+  EXPECT_EQ("017", Fmt(ROO_IO_FMT("{:#o}"), 15));
+  EXPECT_EQ("0", Fmt(ROO_IO_FMT("{:#o}"), 0));
+  EXPECT_EQ("-0x10", Fmt(ROO_IO_FMT("{:#x}"), -16));
+  EXPECT_EQ("A", Fmt(ROO_IO_FMT("{:c}"), 65));
+}
+
+TEST(Format, WidthFillAlign) {
+  EXPECT_EQ("   42", Fmt(ROO_IO_FMT("{:5}"), 42));
+  EXPECT_EQ("42   ", Fmt(ROO_IO_FMT("{:<5}"), 42));
+  EXPECT_EQ(" 42  ", Fmt(ROO_IO_FMT("{:^5}"), 42));
+  EXPECT_EQ("***42", Fmt(ROO_IO_FMT("{:*>5}"), 42));
+  EXPECT_EQ("ab   ", Fmt(ROO_IO_FMT("{:5}"), "ab"));
+  EXPECT_EQ("   ab", Fmt(ROO_IO_FMT("{:>5}"), "ab"));
+  EXPECT_EQ("-ab--", Fmt(ROO_IO_FMT("{:-^5}"), "ab"));
+  EXPECT_EQ("··ab", Fmt(ROO_IO_FMT("{:·>4}"), "ab"));
+  EXPECT_EQ("  °C", Fmt(ROO_IO_FMT("{:>4}"), "°C"));
+  EXPECT_EQ("123456", Fmt(ROO_IO_FMT("{:3}"), 123456));
+}
+
+TEST(Format, SignAndZeroPad) {
+  EXPECT_EQ("+42", Fmt(ROO_IO_FMT("{:+}"), 42));
+  EXPECT_EQ(" 42", Fmt(ROO_IO_FMT("{: }"), 42));
+  EXPECT_EQ("-42", Fmt(ROO_IO_FMT("{:+}"), -42));
+  EXPECT_EQ("00042", Fmt(ROO_IO_FMT("{:05}"), 42));
+  EXPECT_EQ("-0042", Fmt(ROO_IO_FMT("{:05}"), -42));
+  EXPECT_EQ("0x002a", Fmt(ROO_IO_FMT("{:#06x}"), 42));
+  EXPECT_EQ("   42", Fmt(ROO_IO_FMT("{:>05}"), 42));
+}
+
+TEST(Format, Floats) {
+  EXPECT_EQ("1.5", Fmt(ROO_IO_FMT("{}"), 1.5));
+  EXPECT_EQ("0.1", Fmt(ROO_IO_FMT("{}"), 0.1));
+  EXPECT_EQ("100", Fmt(ROO_IO_FMT("{}"), 100.0));
+  EXPECT_EQ("1e+20", Fmt(ROO_IO_FMT("{}"), 1e20));
+  EXPECT_EQ("0.30000000000000004", Fmt(ROO_IO_FMT("{}"), 0.1 + 0.2));
+  EXPECT_EQ("0.25", Fmt(ROO_IO_FMT("{}"), 0.25f));
+  EXPECT_EQ("3.142", Fmt(ROO_IO_FMT("{:.3f}"), 3.14159));
+  EXPECT_EQ("3.141590", Fmt(ROO_IO_FMT("{:f}"), 3.14159));
+  EXPECT_EQ("1.23e+04", Fmt(ROO_IO_FMT("{:.2e}"), 12345.0));
+  EXPECT_EQ("1.23E+04", Fmt(ROO_IO_FMT("{:.2E}"), 12345.0));
+  EXPECT_EQ("3.1", Fmt(ROO_IO_FMT("{:.2}"), 3.14159));
+  EXPECT_EQ(" 12.3°C", Fmt(ROO_IO_FMT("{:5.1f}°C"), 12.31));
+  EXPECT_EQ("-0012.3", Fmt(ROO_IO_FMT("{:07.1f}"), -12.31));
+  EXPECT_EQ("+1.0", Fmt(ROO_IO_FMT("{:+.1f}"), 1.0));
+  EXPECT_EQ("-0", Fmt(ROO_IO_FMT("{}"), -0.0));
+  EXPECT_EQ("inf", Fmt(ROO_IO_FMT("{}"), INFINITY));
+  EXPECT_EQ("-INF", Fmt(ROO_IO_FMT("{:F}"), -INFINITY));
+  EXPECT_EQ("  nan", Fmt(ROO_IO_FMT("{:05}"), NAN));
+}
+
+// Verifies that values that don't fit in the regular stack buffer are still
+// formatted in full.
+TEST(Format, LongFloats) {
+  char expected[200];
+  snprintf(expected, sizeof(expected), "%.2f", 1e100);
+  EXPECT_EQ(expected, Fmt(ROO_IO_FMT("{:.2f}"), 1e100));
+}
+
+TEST(Format, StringsCharsBools) {
+  std::string str = "hello";
+  roo::string_view sv("world");
+  const char* cstr = "c-string";
+  EXPECT_EQ("hello world c-string",
+            Fmt(ROO_IO_FMT("{} {} {}"), str, sv, cstr));
+  EXPECT_EQ("hel", Fmt(ROO_IO_FMT("{:.3}"), str));
+  EXPECT_EQ("(null)", Fmt(ROO_IO_FMT("{}"), (const char*)nullptr));
+  EXPECT_EQ("x", Fmt(ROO_IO_FMT("{}"), 'x'));
+  EXPECT_EQ("120", Fmt(ROO_IO_FMT("{:d}"), 'x'));
+  EXPECT_EQ("true false", Fmt(ROO_IO_FMT("{} {}"), true, false));
+  EXPECT_EQ("1", Fmt(ROO_IO_FMT("{:d}"), true));
+  EXPECT_EQ("true ", Fmt(ROO_IO_FMT("{:5}"), true));
+}
+
+TEST(Format, Pointers) {
+  EXPECT_EQ("0x0", Fmt(ROO_IO_FMT("{}"), nullptr));
+  EXPECT_EQ("0x1234", Fmt(ROO_IO_FMT("{}"), (const void*)0x1234));
+  EXPECT_EQ("  0x1234", Fmt(ROO_IO_FMT("{:8p}"), (int*)0x1234));
+}
+
+TEST(Format, ExplicitIndexes) {
+  EXPECT_EQ("b a b", Fmt(ROO_IO_FMT("{1} {0} {1}"), "a", "b"));
+  EXPECT_EQ("  x", Fmt(ROO_IO_FMT("{0:>3}"), "x"));
+}
+
+TEST(Format, StatusAndMacAddress) {
+  EXPECT_EQ("not found", Fmt(ROO_IO_FMT("{}"), kNotFound));
+  EXPECT_EQ("[OK  ]", Fmt(ROO_IO_FMT("[{:4}]"), kOk));
+  MacAddress mac(0x01, 0x23, 0x45, 0x67, 0x89, 0xAB);
+  EXPECT_EQ("mac=01-23-45-67-89-AB", Fmt(ROO_IO_FMT("mac={}"), mac));
+  EXPECT_EQ("  01-23-45-67-89-AB", Fmt(ROO_IO_FMT("{:>19}"), mac));
+}
+
+TEST(Format, CustomFormatter) {
+  Point p{3, -4};
+  EXPECT_EQ("p=(3, -4)", Fmt(ROO_IO_FMT("p={}"), p));
+  EXPECT_EQ("  (3, -4)", Fmt(ROO_IO_FMT("{:>9}"), p));
+}
+
+// Verifies snprintf-like truncation and the reported full length.
+TEST(Format, BufferTruncation) {
+  char buf[6];
+  EXPECT_EQ(11u, FormatToBuffer(buf, sizeof(buf), ROO_IO_FMT("{} {}"), "hello",
+                                "world"));
+  EXPECT_STREQ("hello", buf);
+  EXPECT_EQ(3u, FormatToBuffer(buf, 0, ROO_IO_FMT("{}"), 123));
+}
+
+TEST(Format, ToMemoryOutputIterator) {
+  byte buf[8];
+  MemoryOutputIterator itr(buf, buf + sizeof(buf));
+  EXPECT_EQ(4u, FormatTo(itr, ROO_IO_FMT("{:04}"), 7));
+  EXPECT_EQ(kOk, itr.status());
+  EXPECT_EQ(0, memcmp(buf, "0007", 4));
+  FormatTo(itr, ROO_IO_FMT("{}"), "overflow");
+  EXPECT_EQ(kNoSpaceLeftOnDevice, itr.status());
+}
+
+TEST(Format, ToBackInsertingIterator) {
+  std::vector<char> out;
+  BackInsertingIterator<std::vector<char>> itr(out);
+  FormatTo(itr, ROO_IO_FMT("{}-{}"), 1, 2);
+  EXPECT_EQ("1-2", std::string(out.begin(), out.end()));
+}
+
+// Verifies output through a stream, with a result larger than the internal
+// staging buffer.
+TEST(Format, ToStream) {
+  byte buf[200];
+  MemoryOutputStream<byte*> os(buf, buf + sizeof(buf));
+  std::string long_str(100, 'x');
+  size_t count = FormatToStream(os, ROO_IO_FMT("[{}] [{}] {:>10}"), 12,
+                                long_str, kOk);
+  std::string expected = "[12] [" + long_str + "]         OK";
+  EXPECT_EQ(expected.size(), count);
+  EXPECT_EQ(kOk, os.status());
+  EXPECT_EQ(expected, std::string((const char*)buf, expected.size()));
+}
+
+TEST(Format, ToBufferedOutputStreamIterator) {
+  byte buf[100];
+  MemoryOutputStream<byte*> os(buf, buf + sizeof(buf));
+  BufferedOutputStreamIterator itr(os);
+  FormatTo(itr, ROO_IO_FMT("{}={:.1f}"), "t", 21.55);
+  itr.flush();
+  EXPECT_EQ("t=21.6", std::string((const char*)buf, 6));
+}
+
+// Verifies that the format string is parsed at compile time.
+TEST(Format, CompileTimeParsing) {
+  auto format = ROO_IO_FMT("a{:>5}b{}");
+  using S = decltype(format);
+  static_assert(internal::ParsedFormat<S>::kCount == 4, "");
+  static_assert(internal::ParsedFormat<S>::kParsed.segments[1].spec.width == 5,
+                "");
+  static_assert(internal::ParsedFormat<S>::kParsed.segments[3].arg_index == 1,
+                "");
+}
+
+}  // namespace roo_io
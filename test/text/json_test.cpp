@@ -0,0 +1,527 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_output_iterator.h"
+#include "roo_io/text/json.h"
+#include "roo_io/text/json_reader.h"
+#include "roo_io/text/json_writer.h"
+
+namespace roo_io {
+
+namespace {
+
+// Writes with `fn`, and returns the output.
+template <typename Fn>
+std::string Write(Fn fn) {
+  byte buf[1024];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  JsonWriter<MemoryOutputIterator> writer(out);
+  fn(writer);
+  EXPECT_EQ(kOk, writer.status());
+  return std::string((const char*)buf, (const char*)out.ptr());
+}
+
+// Hides the memory iterator type, so that the reader takes the generic path.
+class OpaqueIterator {
+ public:
+  OpaqueIterator(const byte* begin, const byte* end) : itr_(begin, end) {}
+
+  byte read() { return itr_.read(); }
+  size_t read(byte* result, size_t count) { return itr_.read(result, count); }
+  void skip(size_t count) { itr_.skip(count); }
+  Status status() const { return itr_.status(); }
+
+ private:
+  MemoryIterator itr_;
+};
+
+// Reports a read error, instead of the end of stream, past the data.
+class FailingIterator {
+ public:
+  FailingIterator(const byte* begin, const byte* end) : itr_(begin, end) {}
+
+  byte read() { return itr_.read(); }
+  size_t read(byte* result, size_t count) { return itr_.read(result, count); }
+  void skip(size_t count) { itr_.skip(count); }
+  Status status() const {
+    return itr_.status() == kEndOfStream ? kReadError : itr_.status();
+  }
+
+ private:
+  MemoryIterator itr_;
+};
+
+template <typename Itr>
+class JsonReaderTest : public testing::Test {
+ protected:
+  // Holds the iterator and the reader over `json`.
+  struct Parser {
+    explicit Parser(std::string json)
+        : json(std::move(json)),
+          in((const byte*)this->json.data(),
+             (const byte*)this->json.data() + this->json.size()),
+          reader(in) {}
+
+    std::string json;
+    Itr in;
+    JsonReader<Itr> reader;
+  };
+};
+
+using Iterators = testing::Types<MemoryIterator, MultipassMemoryIterator,
+                                 OpaqueIterator>;
+TYPED_TEST_SUITE(JsonReaderTest, Iterators);
+
+// Reads the whole content of the current string.
+template <typename Itr>
+std::string ReadAll(JsonReader<Itr>& reader) {
+  std::string result;
+  char buf[5];
+  size_t n;
+  while ((n = reader.readString(buf, sizeof(buf))) > 0) result.append(buf, n);
+  return result;
+}
+
+// Returns the tokens of `json`, in a compact notation, followed by the final
+// status.
+template <typename Itr>
+std::string Tokens(const std::string& json) {
+  Itr in((const byte*)json.data(), (const byte*)json.data() + json.size());
+  JsonReader<Itr> reader(in);
+  std::string result;
+  while (reader.next()) {
+    switch (reader.token()) {
+      case JsonToken::kBeginObject: {
+        result += "{";
+        break;
+      }
+      case JsonToken::kEndObject: {
+        result += "}";
+        break;
+      }
+      case JsonToken::kBeginArray: {
+        result += "[";
+        break;
+      }
+      case JsonToken::kEndArray: {
+        result += "]";
+        break;
+      }
+      case JsonToken::kKey: {
+        result += "k:" + ReadAll(reader) + " ";
+        break;
+      }
+      case JsonToken::kString: {
+        result += "s:" + ReadAll(reader) + " ";
+        break;
+      }
+      case JsonToken::kNumber: {
+        result += "n:" + std::string(reader.numberText()) + " ";
+        break;
+      }
+      case JsonToken::kTrue: {
+        result += "T ";
+        break;
+      }
+      case JsonToken::kFalse: {
+        result += "F ";
+        break;
+      }
+      case JsonToken::kNull: {
+        result += "N ";
+        break;
+      }
+      default: {
+        result += "? ";
+        break;
+      }
+    }
+  }
+  result += (reader.status() == kEndOfStream ? "$" : "!");
+  return result;
+}
+
+size_t ReferencePlainPrefixLength(const char* data, size_t size) {
+  size_t i = 0;
+  while (i < size && data[i] != '"' && data[i] != '\\' &&
+         (uint8_t)data[i] >= 0x20) {
+    ++i;
+  }
+  return i;
+}
+
+}  // namespace
+
+TEST(JsonPlainPrefixLength, MatchesReference) {
+  char buf[80];
+  for (size_t i = 0; i < sizeof(buf); ++i) buf[i] = (char)('a' + i % 26);
+  EXPECT_EQ(sizeof(buf), internal::JsonPlainPrefixLength(buf, sizeof(buf)));
+  const uint8_t specials[] = {'"', '\\', 0x00, 0x1F, 0x0A};
+  const uint8_t plain[] = {0x20, 0x7F, 0x80, 0xFF, '[', ']', '#'};
+  for (size_t pos = 0; pos < sizeof(buf); ++pos) {
+    for (uint8_t s : specials) {
+      char copy[sizeof(buf)];
+      memcpy(copy, buf, sizeof(buf));
+      copy[pos] = (char)s;
+      // A second special character after the first must not matter.
+      if (pos + 3 < sizeof(buf)) copy[pos + 3] = '"';
+      for (size_t size = 0; size <= sizeof(buf); size += 7) {
+        EXPECT_EQ(ReferencePlainPrefixLength(copy, size),
+                  internal::JsonPlainPrefixLength(copy, size))
+            << "pos " << pos << ", char " << (int)s << ", size " << size;
+      }
+    }
+    for (uint8_t p : plain) {
+      char copy[sizeof(buf)];
+      memcpy(copy, buf, sizeof(buf));
+      copy[pos] = (char)p;
+      EXPECT_EQ(sizeof(buf), internal::JsonPlainPrefixLength(copy, sizeof(buf)))
+          << "pos " << pos << ", char " << (int)p;
+    }
+  }
+}
+
+TEST(JsonWriter, Structure) {
+  EXPECT_EQ(R"({"id":42,"tags":["a","b"],"nested":{},"empty":[]})",
+            Write([](JsonWriter<MemoryOutputIterator>& w) {
+              w.beginObject();
+              w.key("id");
+              w.writeUInt(42);
+              w.key("tags");
+              w.beginArray();
+              w.writeString("a");
+              w.writeString("b");
+              w.endArray();
+              w.key("nested");
+              w.beginObject();
+              w.endObject();
+              w.key("empty");
+              w.beginArray();
+              w.endArray();
+              w.endObject();
+            }));
+}
+
+TEST(JsonWriter, TopLevelValuesAreNewlineDelimited) {
+  EXPECT_EQ("{\"a\":1}\n[true,false,null]\n7",
+            Write([](JsonWriter<MemoryOutputIterator>& w) {
+              w.beginObject();
+              w.key("a");
+              w.writeInt(1);
+              w.endObject();
+              w.beginArray();
+              w.writeBool(true);
+              w.writeBool(false);
+              w.writeNull();
+              w.endArray();
+              w.writeInt(7);
+            }));
+}
+
+TEST(JsonWriter, Integers) {
+  EXPECT_EQ("[0,9,10,99,100,-1,-12345,9223372036854775807,"
+            "-9223372036854775808,18446744073709551615]",
+            Write([](JsonWriter<MemoryOutputIterator>& w) {
+              w.beginArray();
+              w.writeInt(0);
+              w.writeInt(9);
+              w.writeInt(10);
+              w.writeInt(99);
+              w.writeUInt(100);
+              w.writeInt(-1);
+              w.writeInt(-12345);
+              w.writeInt(std::numeric_limits<int64_t>::max());
+              w.writeInt(std::numeric_limits<int64_t>::min());
+              w.writeUInt(std::numeric_limits<uint64_t>::max());
+              w.endArray();
+            }));
+}
+
+TEST(JsonWriter, Doubles) {
+  EXPECT_EQ("[0,1.5,-0.1,1e+100,0.30000000000000004,null,null]",
+            Write([](JsonWriter<MemoryOutputIterator>& w) {
+              w.beginArray();
+              w.writeDouble(0.0);
+              w.writeDouble(1.5);
+              w.writeDouble(-0.1);
+              w.writeDouble(1e100);
+              w.writeDouble(0.1 + 0.2);
+              w.writeDouble(std::numeric_limits<double>::infinity());
+              w.writeDouble(std::numeric_limits<double>::quiet_NaN());
+              w.endArray();
+            }));
+}
+
+TEST(JsonWriter, Escapes) {
+  EXPECT_EQ(R"({"k\"ey":"a\\b\"c\n\r\t\b\f\u0001\u001f/ż"})",
+            Write([](JsonWriter<MemoryOutputIterator>& w) {
+              w.beginObject();
+              w.key("k\"ey");
+              w.writeString("a\\b\"c\n\r\t\b\f\x01\x1f/ż");
+              w.endObject();
+            }));
+}
+
+TEST(JsonWriter, LongString) {
+  std::string s(100, 'x');
+  s[40] = '"';
+  s[70] = '\n';
+  std::string expected = "\"" + std::string(40, 'x') + "\\\"" +
+                         std::string(29, 'x') + "\\n" + std::string(29, 'x') +
+                         "\"";
+  EXPECT_EQ(expected, Write([&](JsonWriter<MemoryOutputIterator>& w) {
+              w.writeString(s);
+            }));
+}
+
+TEST(JsonWriter, TooDeep) {
+  byte buf[256];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  JsonWriter<MemoryOutputIterator> writer(out);
+  for (int i = 0; i < JsonWriter<MemoryOutputIterator>::kMaxDepth; ++i) {
+    writer.beginArray();
+  }
+  EXPECT_EQ(kOk, writer.status());
+  writer.beginArray();
+  EXPECT_EQ(kOutOfRange, writer.status());
+  EXPECT_EQ(JsonWriter<MemoryOutputIterator>::kMaxDepth, writer.depth());
+  // Closing the overflowing container keeps the enclosing levels in sync.
+  writer.endArray();
+  EXPECT_EQ(JsonWriter<MemoryOutputIterator>::kMaxDepth, writer.depth());
+  writer.endArray();
+  EXPECT_EQ(JsonWriter<MemoryOutputIterator>::kMaxDepth - 1, writer.depth());
+}
+
+TEST(JsonWriter, ReportsIteratorErrors) {
+  byte buf[4];
+  MemoryOutputIterator out(buf, buf + sizeof(buf));
+  JsonWriter<MemoryOutputIterator> writer(out);
+  writer.writeString("too long");
+  EXPECT_EQ(kNoSpaceLeftOnDevice, writer.status());
+}
+
+TYPED_TEST(JsonReaderTest, Tokens) {
+  EXPECT_EQ("{k:id n:42 k:tags [s:a s:b ]k:o {}k:e []k:t T k:f F k:n N }$",
+            Tokens<TypeParam>(R"( { "id" : 42, "tags": ["a","b"],
+                "o": {}, "e": [], "t": true, "f": false, "n": null } )"));
+}
+
+TYPED_TEST(JsonReaderTest, TopLevelSequence) {
+  EXPECT_EQ("{k:a n:1 }[T ]n:7 s:x N $",
+            Tokens<TypeParam>("{\"a\":1}\n[true]\n7 \"x\"\r\nnull\n"));
+  EXPECT_EQ("$", Tokens<TypeParam>(""));
+  EXPECT_EQ("$", Tokens<TypeParam>(" \n\t "));
+}
+
+TYPED_TEST(JsonReaderTest, Escapes) {
+  EXPECT_EQ(
+      "s:a\\b\"c\n\r\t\b\f/ x:\xC5\xBC \xF0\x9F\x98\x80 $",
+      Tokens<TypeParam>(
+          R"("a\\b\"c\n\r\t\b\f\/ x:\u017c \ud83D\uDE00")"));
+}
+
+TYPED_TEST(JsonReaderTest, LongStrings) {
+  std::string plain(100, 'y');
+  std::string json = "[\"" + plain + "\",\"" + std::string(40, 'z') +
+                     "\\u0041" + std::string(40, 'z') + "\"]";
+  EXPECT_EQ("[s:" + plain + " s:" + std::string(40, 'z') + "A" +
+                std::string(40, 'z') + " ]$",
+            Tokens<TypeParam>(json));
+}
+
+TYPED_TEST(JsonReaderTest, Numbers) {
+  EXPECT_EQ("[n:0 n:-0 n:12 n:-3.25 n:1e5 n:1E+5 n:2.5e-3 ]$",
+            Tokens<TypeParam>("[0,-0,12,-3.25,1e5,1E+5,2.5e-3]"));
+  EXPECT_EQ("n:1 $", Tokens<TypeParam>("1"));
+}
+
+TYPED_TEST(JsonReaderTest, NumberValues) {
+  typename TestFixture::Parser p(
+      "[-9223372036854775808, 3.5, 1e400, 99999999999999999999]");
+  JsonReader<TypeParam>& reader = p.reader;
+  Status status;
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  EXPECT_TRUE(reader.isInteger());
+  EXPECT_EQ(std::numeric_limits<int64_t>::min(), reader.intValue(status));
+  EXPECT_EQ(kOk, status);
+  ASSERT_TRUE(reader.next());
+  EXPECT_FALSE(reader.isInteger());
+  reader.intValue(status);
+  EXPECT_EQ(kInvalidFormat, status);
+  EXPECT_EQ(3.5, reader.doubleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_TRUE(std::isinf(reader.doubleValue()));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(std::numeric_limits<int64_t>::max(), reader.intValue(status));
+  EXPECT_EQ(kOutOfRange, status);
+  EXPECT_EQ(1e20, reader.doubleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kEndArray, reader.token());
+}
+
+TYPED_TEST(JsonReaderTest, InvalidNumbers) {
+  for (const char* json :
+       {"01", "-", "1.", ".5", "1e", "1e+", "+1", "--1", "1.5.5", "0x10"}) {
+    std::string tokens = Tokens<TypeParam>(std::string("[") + json + "]");
+    EXPECT_EQ('!', tokens.back()) << json;
+  }
+}
+
+TYPED_TEST(JsonReaderTest, Malformed) {
+  for (const char* json :
+       {"{", "[1,", "[1 2]", "[1,]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}",
+        "{1:2}", "[}", "{]", "]", "tru", "nul", "\"abc", "\"a\\x\"",
+        "\"a\nb\"", "\"\\ud800\"", "\"\\udc00\"", "\"\\u12G4\"", "[1]]"}) {
+    std::string tokens = Tokens<TypeParam>(json);
+    EXPECT_EQ('!', tokens.back()) << json;
+  }
+}
+
+TEST(JsonReader, ReportsIteratorErrors) {
+  for (const char* json : {"", "[1,", "123", "tr", "{\"a\":\"b"}) {
+    FailingIterator in((const byte*)json, (const byte*)json + strlen(json));
+    JsonReader<FailingIterator> reader(in);
+    while (reader.next()) {
+      char buf[8];
+      while (reader.readString(buf, sizeof(buf)) > 0) {
+      }
+    }
+    EXPECT_EQ(kReadError, reader.status()) << json;
+  }
+}
+
+TYPED_TEST(JsonReaderTest, TooDeep) {
+  std::string json(JsonReader<TypeParam>::kMaxDepth, '[');
+  json += std::string(JsonReader<TypeParam>::kMaxDepth, ']');
+  EXPECT_EQ(json + "$", Tokens<TypeParam>(json));
+  json = "[" + json + "]";
+  typename TestFixture::Parser p(json);
+  while (p.reader.next()) {
+  }
+  EXPECT_EQ(kOutOfRange, p.reader.status());
+}
+
+TYPED_TEST(JsonReaderTest, TooLongNumber) {
+  typename TestFixture::Parser p(std::string(100, '1'));
+  EXPECT_FALSE(p.reader.next());
+  EXPECT_EQ(kOutOfRange, p.reader.status());
+}
+
+TYPED_TEST(JsonReaderTest, UnreadStringsAreSkipped) {
+  typename TestFixture::Parser p(R"({"skipped\"key":"value \\ \u00e9","b":1})");
+  JsonReader<TypeParam>& reader = p.reader;
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kKey, reader.token());
+  char c;
+  EXPECT_EQ(1u, reader.readString(&c, 1));
+  EXPECT_EQ('s', c);
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kString, reader.token());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kKey, reader.token());
+  EXPECT_EQ("b", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ("1", reader.numberText());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kEndObject, reader.token());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+TYPED_TEST(JsonReaderTest, Skip) {
+  typename TestFixture::Parser p(
+      R"({"a":{"x":[1,{"y":"]}"}],"z":null},"b":[[],[]],"c":"long string"})");
+  JsonReader<TypeParam>& reader = p.reader;
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ("a", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kBeginObject, reader.token());
+  EXPECT_TRUE(reader.skip());
+  EXPECT_EQ(1, reader.depth());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ("b", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kBeginArray, reader.token());
+  EXPECT_TRUE(reader.skip());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kKey, reader.token());
+  EXPECT_TRUE(reader.skip());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kString, reader.token());
+  EXPECT_TRUE(reader.skip());
+  EXPECT_EQ(0u, ReadAll(reader).size());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kEndObject, reader.token());
+  EXPECT_EQ(0, reader.depth());
+}
+
+TYPED_TEST(JsonReaderTest, SkipTruncated) {
+  typename TestFixture::Parser p("[[1,2");
+  ASSERT_TRUE(p.reader.next());
+  EXPECT_FALSE(p.reader.skip());
+  EXPECT_EQ(kInvalidFormat, p.reader.status());
+}
+
+TYPED_TEST(JsonReaderTest, StringView) {
+  typename TestFixture::Parser p(R"(["plain","esc\"aped"])");
+  JsonReader<TypeParam>& reader = p.reader;
+  bool in_memory = !std::is_same<TypeParam, OpaqueIterator>::value;
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  roo::string_view sv;
+  EXPECT_EQ(in_memory, reader.readStringView(sv));
+  if (in_memory) EXPECT_EQ("plain", sv);
+  ASSERT_TRUE(reader.next());
+  EXPECT_FALSE(reader.readStringView(sv));
+  EXPECT_EQ("esc\"aped", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kEndArray, reader.token());
+}
+
+TYPED_TEST(JsonReaderTest, RoundTrip) {
+  std::string written = Write([](JsonWriter<MemoryOutputIterator>& w) {
+    w.beginObject();
+    w.key("name");
+    w.writeString("tab\there \"quoted\" \x01");
+    w.key("values");
+    w.beginArray();
+    w.writeInt(-17);
+    w.writeDouble(0.1);
+    w.writeBool(false);
+    w.endArray();
+    w.endObject();
+  });
+  typename TestFixture::Parser p(written);
+  JsonReader<TypeParam>& reader = p.reader;
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ("name", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ("tab\there \"quoted\" \x01", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ("values", ReadAll(reader));
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  Status status;
+  EXPECT_EQ(-17, reader.intValue(status));
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(0.1, reader.doubleValue());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kFalse, reader.token());
+  ASSERT_TRUE(reader.next());
+  ASSERT_TRUE(reader.next());
+  EXPECT_EQ(JsonToken::kEndObject, reader.token());
+  EXPECT_FALSE(reader.next());
+  EXPECT_EQ(kEndOfStream, reader.status());
+}
+
+}  // namespace roo_io
@@ -0,0 +1,225 @@
+#include "roo_io/text/utf8_stream.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "roo_io/core/input_stream.h"
+#include "roo_io/memory/memory_input_iterator.h"
+#include "roo_io/memory/memory_input_stream.h"
+#include "roo_io/memory/memory_output_iterator.h"
+
+using testing::ElementsAre;
+
+namespace roo_io {
+
+namespace {
+
+// Returns at most `chunk` bytes per read, to exercise sequences that straddle
+// refills.
+class ChunkedInputStream : public InputStream {
+ public:
+  ChunkedInputStream(const std::string& data, size_t chunk)
+      : data_(data), chunk_(chunk), pos_(0), status_(kOk) {}
+
+  size_t read(byte* buf, size_t count) override {
+    if (status_ != kOk) return 0;
+    if (pos_ == data_.size()) {
+      status_ = kEndOfStream;
+      return 0;
+    }
+    if (count > chunk_) count = chunk_;
+    if (count > data_.size() - pos_) count = data_.size() - pos_;
+    memcpy(buf, data_.data() + pos_, count);
+    pos_ += count;
+    return count;
+  }
+
+  Status status() const override { return status_; }
+
+ private:
+  std::string data_;
+  size_t chunk_;
+  size_t pos_;
+  Status status_;
+};
+
+template <typename Source>
+std::u32string DecodeAll(Source& in,
+                         Utf8ErrorPolicy policy = Utf8ErrorPolicy::kReplace,
+                         Status expected_status = kEndOfStream) {
+  Utf8StreamDecoder<Source> decoder(in, policy);
+  std::u32string result;
+  char32_t buf[7];
+  size_t n;
+  while ((n = decoder.decode(buf, 7)) > 0) {
+    result.append(buf, n);
+  }
+  EXPECT_EQ(expected_status, decoder.status());
+  return result;
+}
+
+std::u32string DecodeChunked(const std::string& in, size_t chunk,
+                             Utf8ErrorPolicy policy = Utf8ErrorPolicy::kReplace,
+                             Status expected_status = kEndOfStream) {
+  ChunkedInputStream is(in, chunk);
+  return DecodeAll(is, policy, expected_status);
+}
+
+}  // namespace
+
+TEST(Utf8StreamDecoder, Empty) {
+  EXPECT_EQ(U"", DecodeChunked("", 1));
+}
+
+TEST(Utf8StreamDecoder, ValidAcrossChunkBoundaries) {
+  std::string in =
+      "Pełżą 나는 유 \xF0\x9F\x98\x80, with a long enough ASCII tail to need "
+      "more than one full buffer of input: 0123456789abcdef0123456789abcdef";
+  std::u32string expected =
+      U"Pełżą 나는 유 \U0001F600, with a long enough ASCII tail to need "
+      U"more than one full buffer of input: 0123456789abcdef0123456789abcdef";
+  for (size_t chunk = 1; chunk <= 70; ++chunk) {
+    SCOPED_TRACE(chunk);
+    EXPECT_EQ(expected, DecodeChunked(in, chunk));
+  }
+}
+
+TEST(Utf8StreamDecoder, OverIterator) {
+  std::string in = "a\xC5\x82\xE2\x82\xAC";
+  MemoryIterator itr((const byte*)in.data(),
+                     (const byte*)in.data() + in.size());
+  EXPECT_EQ(U"ał€", DecodeAll(itr));
+}
+
+TEST(Utf8StreamDecoder, OverMemoryStream) {
+  std::string in = "x\xF0\x9F\x98\x80y";
+  MemoryInputStream<const byte*> is((const byte*)in.data(),
+                                    (const byte*)in.data() + in.size());
+  EXPECT_EQ(U"x\U0001F600y", DecodeAll(is));
+}
+
+TEST(Utf8StreamDecoder, Next) {
+  ChunkedInputStream is("a\xC5\x82", 1);
+  Utf8StreamDecoder<InputStream> decoder(is);
+  char32_t ch;
+  ASSERT_TRUE(decoder.next(ch));
+  EXPECT_EQ(U'a', ch);
+  ASSERT_TRUE(decoder.next(ch));
+  EXPECT_EQ(U'ł', ch);
+  EXPECT_EQ(kOk, decoder.status());
+  EXPECT_FALSE(decoder.next(ch));
+  EXPECT_EQ(kEndOfStream, decoder.status());
+}
+
+TEST(Utf8StreamDecoder, ReplacesMaximalSubparts) {
+  for (size_t chunk = 1; chunk <= 8; ++chunk) {
+    SCOPED_TRACE(chunk);
+    // Stray continuation, overlong, truncated 3-byte sequence followed by
+    // ASCII, and an encoded surrogate.
+    EXPECT_EQ(U"a�b��c�d���e",
+              DecodeChunked("a\x80"
+                            "b\xC0\xAF"
+                            "c\xE2\x82"
+                            "d\xED\xA0\x80"
+                            "e",
+                            chunk));
+  }
+}
+
+TEST(Utf8StreamDecoder, TruncatedAtEnd) {
+  for (size_t chunk = 1; chunk <= 4; ++chunk) {
+    EXPECT_EQ(U"ab�", DecodeChunked("ab\xF0\x9F\x98", chunk));
+  }
+}
+
+TEST(Utf8StreamDecoder, Skip) {
+  EXPECT_EQ(U"abcde",
+            DecodeChunked("a\x80"
+                          "b\xC0\xAF"
+                          "c\xE2\x82"
+                          "d\xED\xA0\x80"
+                          "e",
+                          3, Utf8ErrorPolicy::kSkip));
+}
+
+TEST(Utf8StreamDecoder, Stop) {
+  EXPECT_EQ(U"ab", DecodeChunked("ab\xFF"
+                                 "cd",
+                                 2, Utf8ErrorPolicy::kStop, kInvalidFormat));
+}
+
+TEST(Utf8StreamDecoder, CustomReplacement) {
+  ChunkedInputStream is("a\xFF"
+                        "b",
+                        5);
+  Utf8StreamDecoder<InputStream> decoder(is, Utf8ErrorPolicy::kReplace, '?');
+  char32_t buf[8];
+  ASSERT_EQ(3u, decoder.decode(buf, 8));
+  EXPECT_THAT(std::vector<char32_t>(buf, buf + 3), ElementsAre('a', '?', 'b'));
+}
+
+TEST(Utf8StreamEncoder, Encodes) {
+  std::string out;
+  BackInsertingIterator<std::string> itr(out);
+  {
+    Utf8StreamEncoder<BackInsertingIterator<std::string>> encoder(itr);
+    encoder.write(U'P');
+    std::u32string rest = U"ełżą 나는 유 \U0001F600";
+    encoder.write(rest.data(), rest.size());
+  }
+  EXPECT_EQ("Pełżą 나는 유 \xF0\x9F\x98\x80", out);
+}
+
+TEST(Utf8StreamEncoder, LongInput) {
+  std::string out;
+  BackInsertingIterator<std::string> itr(out);
+  std::u32string in;
+  std::string expected;
+  for (int i = 0; i < 100; ++i) {
+    in += U"zażółć ";
+    expected += "zażółć ";
+  }
+  Utf8StreamEncoder<BackInsertingIterator<std::string>> encoder(itr);
+  encoder.write(in.data(), in.size());
+  encoder.flush();
+  EXPECT_EQ(expected, out);
+  EXPECT_EQ(kOk, encoder.status());
+}
+
+TEST(Utf8StreamEncoder, InvalidCodePoints) {
+  char32_t in[] = {'a', 0xD800, 'b', 0x110000, 'c'};
+  {
+    std::string out;
+    BackInsertingIterator<std::string> itr(out);
+    Utf8StreamEncoder<BackInsertingIterator<std::string>> encoder(itr);
+    encoder.write(in, 5);
+    encoder.flush();
+    EXPECT_EQ("a\xEF\xBF\xBD"
+              "b\xEF\xBF\xBD"
+              "c",
+              out);
+  }
+  {
+    std::string out;
+    BackInsertingIterator<std::string> itr(out);
+    Utf8StreamEncoder<BackInsertingIterator<std::string>> encoder(
+        itr, Utf8ErrorPolicy::kSkip);
+    encoder.write(in, 5);
+    encoder.flush();
+    EXPECT_EQ("abc", out);
+  }
+  {
+    std::string out;
+    BackInsertingIterator<std::string> itr(out);
+    Utf8StreamEncoder<BackInsertingIterator<std::string>> encoder(
+        itr, Utf8ErrorPolicy::kStop);
+    encoder.write(in, 5);
+    encoder.flush();
+    EXPECT_EQ("a", out);
+    EXPECT_EQ(kInvalidFormat, encoder.status());
+  }
+}
+
+}  // namespace roo_io
@@ -0,0 +1,198 @@
+#include "roo_io/text/utf_transcode.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "roo_io/text/unicode.h"
+
+using testing::ElementsAre;
+
+namespace roo_io {
+
+namespace {
+
+std::u32string ToUtf32(const std::string& in) {
+  std::u32string out(Utf32LengthFromUtf8(in.data(), in.size()), 0);
+  UtfResult result = Utf8ToUtf32(in.data(), in.size(), &out[0]);
+  EXPECT_TRUE(result.valid);
+  EXPECT_EQ(out.size(), result.count);
+  return out;
+}
+
+std::u16string ToUtf16(const std::string& in) {
+  std::u16string out(Utf16LengthFromUtf8(in.data(), in.size()), 0);
+  UtfResult result = Utf8ToUtf16(in.data(), in.size(), &out[0]);
+  EXPECT_TRUE(result.valid);
+  EXPECT_EQ(out.size(), result.count);
+  return out;
+}
+
+std::string FromUtf32(const std::u32string& in) {
+  std::string out(Utf8LengthFromUtf32(in.data(), in.size()), 0);
+  UtfResult result = Utf32ToUtf8(in.data(), in.size(), &out[0]);
+  EXPECT_TRUE(result.valid);
+  EXPECT_EQ(out.size(), result.count);
+  return out;
+}
+
+std::string FromUtf16(const std::u16string& in) {
+  std::string out(Utf8LengthFromUtf16(in.data(), in.size()), 0);
+  UtfResult result = Utf16ToUtf8(in.data(), in.size(), &out[0]);
+  EXPECT_TRUE(result.valid);
+  EXPECT_EQ(out.size(), result.count);
+  return out;
+}
+
+}  // namespace
+
+TEST(UtfTranscode, Empty) {
+  EXPECT_TRUE(ValidateUtf8("", 0));
+  EXPECT_EQ(U"", ToUtf32(""));
+  EXPECT_EQ(u"", ToUtf16(""));
+  EXPECT_EQ("", FromUtf32(U""));
+  EXPECT_EQ("", FromUtf16(u""));
+}
+
+TEST(UtfTranscode, Ascii) {
+  std::string in = "The quick brown fox jumps over the lazy dog, twice over.";
+  EXPECT_TRUE(ValidateUtf8(in));
+  EXPECT_EQ(U"The quick brown fox jumps over the lazy dog, twice over.",
+            ToUtf32(in));
+  EXPECT_EQ(u"The quick brown fox jumps over the lazy dog, twice over.",
+            ToUtf16(in));
+  EXPECT_EQ(in, FromUtf32(ToUtf32(in)));
+  EXPECT_EQ(in, FromUtf16(ToUtf16(in)));
+}
+
+TEST(UtfTranscode, Mixed) {
+  std::string in = "Pełżą 나는 유 \xF0\x9F\x98\x80 and some more ASCII text";
+  EXPECT_TRUE(ValidateUtf8(in));
+  std::u32string utf32 = ToUtf32(in);
+  EXPECT_EQ(U"Pełżą 나는 유 \U0001F600 and some more ASCII text", utf32);
+  std::u16string utf16 = ToUtf16(in);
+  EXPECT_EQ(u"Pełżą 나는 유 \U0001F600 and some more ASCII text", utf16);
+  EXPECT_EQ(in, FromUtf32(utf32));
+  EXPECT_EQ(in, FromUtf16(utf16));
+}
+
+TEST(UtfTranscode, SurrogatePair) {
+  EXPECT_THAT(ToUtf16("\xF4\x8F\xBF\xBF"), ElementsAre(0xDBFF, 0xDFFF));
+  EXPECT_THAT(ToUtf16("\xF0\x90\x80\x80"), ElementsAre(0xD800, 0xDC00));
+}
+
+TEST(UtfTranscode, InvalidUtf8) {
+  struct Case {
+    std::string in;
+    size_t error_offset;
+  } cases[] = {
+      {"abc\x80", 3},                  // Stray continuation.
+      {"abc\xC0\x80", 3},              // Overlong NUL.
+      {"abc\xC1\xBF", 3},              // Overlong.
+      {"ab\xE0\x9F\xBF", 2},           // Overlong 3-byte.
+      {"a\xED\xA0\x80", 1},            // Encoded surrogate.
+      {"\xF0\x8F\xBF\xBF", 0},         // Overlong 4-byte.
+      {"x\xF4\x90\x80\x80", 1},        // Above U+10FFFF.
+      {"\xF5\x80\x80\x80", 0},         // Invalid lead.
+      {"\xC3", 0},                     // Truncated.
+      {"ok\xE2\x82", 2},               // Truncated.
+      {"\xE2\x28\xA1", 0},             // Bad continuation.
+      {"0123456789abcdef0123456789abcdef\xFF", 32},
+  };
+  for (const auto& c : cases) {
+    SCOPED_TRACE(c.error_offset);
+    EXPECT_FALSE(ValidateUtf8(c.in));
+    UtfResult result = ValidateUtf8WithErrors(c.in.data(), c.in.size());
+    EXPECT_FALSE(result.valid);
+    EXPECT_EQ(c.error_offset, result.count);
+    std::vector<char32_t> utf32(c.in.size());
+    result = Utf8ToUtf32(c.in.data(), c.in.size(), utf32.data());
+    EXPECT_FALSE(result.valid);
+    EXPECT_EQ(c.error_offset, result.count);
+    std::vector<char16_t> utf16(c.in.size() * 2);
+    result = Utf8ToUtf16(c.in.data(), c.in.size(), utf16.data());
+    EXPECT_FALSE(result.valid);
+    EXPECT_EQ(c.error_offset, result.count);
+  }
+}
+
+TEST(UtfTranscode, InvalidUtf16) {
+  char buf[16];
+  std::u16string lone_high = u"ab";
+  lone_high += (char16_t)0xD800;
+  EXPECT_FALSE(ValidateUtf16(lone_high.data(), lone_high.size()));
+  UtfResult result = Utf16ToUtf8(lone_high.data(), lone_high.size(), buf);
+  EXPECT_FALSE(result.valid);
+  EXPECT_EQ(2u, result.count);
+
+  std::u16string lone_low = u"a";
+  lone_low += (char16_t)0xDC00;
+  lone_low += u"b";
+  EXPECT_FALSE(ValidateUtf16(lone_low.data(), lone_low.size()));
+  result = Utf16ToUtf8(lone_low.data(), lone_low.size(), buf);
+  EXPECT_FALSE(result.valid);
+  EXPECT_EQ(1u, result.count);
+}
+
+TEST(UtfTranscode, InvalidUtf32) {
+  char buf[16];
+  char32_t surrogate[] = {'a', 0xDFFF};
+  EXPECT_FALSE(ValidateUtf32(surrogate, 2));
+  UtfResult result = Utf32ToUtf8(surrogate, 2, buf);
+  EXPECT_FALSE(result.valid);
+  EXPECT_EQ(1u, result.count);
+
+  char32_t too_large[] = {0x110000};
+  EXPECT_FALSE(ValidateUtf32(too_large, 1));
+  EXPECT_FALSE(Utf32ToUtf8(too_large, 1, buf).valid);
+}
+
+// Round-trips random code points, mixing long ASCII runs with non-ASCII, and
+// cross-checks against the per-code-point encoder.
+TEST(UtfTranscode, RandomRoundTrip) {
+  std::mt19937 rng(1234);
+  for (int iteration = 0; iteration < 200; ++iteration) {
+    std::u32string expected;
+    std::string utf8;
+    int len = rng() % 200;
+    bool ascii_run = false;
+    for (int i = 0; i < len; ++i) {
+      if (rng() % 16 == 0) ascii_run = !ascii_run;
+      char32_t cp;
+      if (ascii_run) {
+        cp = rng() % 0x80;
+      } else {
+        switch (rng() % 4) {
+          case 0:
+            cp = rng() % 0x80;
+            break;
+          case 1:
+            cp = 0x80 + rng() % (0x800 - 0x80);
+            break;
+          case 2:
+            cp = 0x800 + rng() % (0x10000 - 0x800);
+            if (cp >= 0xD800 && cp <= 0xDFFF) cp = 0xFFFD;
+            break;
+          default:
+            cp = 0x10000 + rng() % (0x110000 - 0x10000);
+            break;
+        }
+      }
+      expected.push_back(cp);
+      char encoded[4];
+      int n = WriteUtf8Char(encoded, cp);
+      utf8.append(encoded, n);
+    }
+    ASSERT_TRUE(ValidateUtf8(utf8));
+    ASSERT_EQ(expected, ToUtf32(utf8));
+    std::u16string utf16 = ToUtf16(utf8);
+    ASSERT_TRUE(ValidateUtf16(utf16.data(), utf16.size()));
+    ASSERT_TRUE(ValidateUtf32(expected.data(), expected.size()));
+    ASSERT_EQ(utf8, FromUtf32(expected));
+    ASSERT_EQ(utf8, FromUtf16(utf16));
+  }
+}
+
+}  // namespace roo_io